@@ -0,0 +1,119 @@
+// Measures object file loading on a generated object file.
+//
+// Usage: object_file_benchmark [text_section_count] [repetitions] [file_name]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include "common/object_file.h"
+
+using sicxe::ObjectFile;
+using std::string;
+
+namespace {
+
+// Full text sections with a relocation record for every tenth word and a
+// few exported and imported symbols, like the output of a large program.
+void GenerateObjectFile(size_t text_section_count, ObjectFile* file) {
+  file->set_program_name("bench");
+  file->set_start_address(0);
+  file->set_code_size(text_section_count * ObjectFile::kMaxTextSectionSize);
+  file->set_entry_point(0);
+  uint32 seed = 1;
+  for (size_t i = 0; i < text_section_count; i++) {
+    ObjectFile::TextSection section;
+    section.address = i * ObjectFile::kMaxTextSectionSize;
+    section.size = ObjectFile::kMaxTextSectionSize;
+    section.data = file->AllocateText(section.size);
+    for (int j = 0; j < section.size; j++) {
+      seed = seed * 1103515245 + 12345;
+      section.data[j] = static_cast<uint8>(seed >> 16);
+    }
+    file->mutable_text_sections()->push_back(section);
+    if (i % 3 == 0) {
+      std::unique_ptr<ObjectFile::RelocationSection> relocation(
+          new ObjectFile::RelocationSection);
+      relocation->address = section.address + 1;
+      relocation->nibbles = 5;
+      relocation->type = (i % 2 == 0);
+      relocation->sign = true;
+      relocation->symbol_name = "ext";
+      file->mutable_relocation_sections()->emplace_back(std::move(relocation));
+    }
+  }
+  std::unique_ptr<ObjectFile::SymbolExportSection> exports(
+      new ObjectFile::SymbolExportSection);
+  exports->symbols.push_back(std::make_pair(string("bench"), 0u));
+  file->mutable_export_sections()->emplace_back(std::move(exports));
+  std::unique_ptr<ObjectFile::SymbolImportSection> imports(
+      new ObjectFile::SymbolImportSection);
+  imports->symbols.push_back("ext");
+  file->mutable_import_sections()->emplace_back(std::move(imports));
+}
+
+// Returns the best time of |repetitions| loads, or a negative value on error.
+double MeasureLoad(const string& file_name, int repetitions, size_t text_section_count) {
+  double best_seconds = 0.0;
+  for (int repetition = 0; repetition < repetitions; repetition++) {
+    ObjectFile object_file;
+    auto start = std::chrono::steady_clock::now();
+    if (object_file.LoadFile(file_name.c_str()) != ObjectFile::OK) {
+      fprintf(stderr, "loading '%s' failed\n", file_name.c_str());
+      return -1.0;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (repetition == 0 || elapsed.count() < best_seconds) {
+      best_seconds = elapsed.count();
+    }
+    if (object_file.text_sections().size() != text_section_count) {
+      fprintf(stderr, "wrong number of text sections\n");
+      return -1.0;
+    }
+  }
+  return best_seconds;
+}
+
+long FileSize(const string& file_name) {
+  FILE* file = fopen(file_name.c_str(), "r");
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t text_section_count = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 200000;
+  int repetitions = (argc > 2) ? atoi(argv[2]) : 5;
+  string file_name = (argc > 3) ? argv[3] : "object_file_benchmark.obj";
+  string binary_file_name = file_name + ".sobj";
+
+  {
+    ObjectFile file;
+    GenerateObjectFile(text_section_count, &file);
+    if (!file.SaveFile(file_name.c_str()) ||
+        !file.SaveBinaryFile(binary_file_name.c_str())) {
+      fprintf(stderr, "cannot write '%s'\n", file_name.c_str());
+      return 1;
+    }
+  }
+
+  printf("sections:   %zu\n", text_section_count);
+  const string* file_names[] = {&file_name, &binary_file_name};
+  const char* const format_names[] = {"text", "binary"};
+  for (int i = 0; i < 2; i++) {
+    long byte_count = FileSize(*file_names[i]);
+    double seconds = MeasureLoad(*file_names[i], repetitions, text_section_count);
+    remove(file_names[i]->c_str());
+    if (seconds < 0.0) {
+      return 1;
+    }
+    printf("%-7s     %ld bytes, %.3f s, %.1f MB/s\n", format_names[i], byte_count,
+           seconds, byte_count / seconds / 1e6);
+  }
+  return 0;
+}
@@ -0,0 +1,93 @@
+// Measures tokenizer throughput on a generated source file.
+//
+// Usage: tokenizer_benchmark [line_count] [repetitions]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include "assembler/tokenizer.h"
+#include "common/arena.h"
+#include "common/error_db.h"
+#include "common/string_pool.h"
+#include "common/text_file.h"
+
+using sicxe::Arena;
+using sicxe::ErrorDB;
+using sicxe::StringPool;
+using sicxe::TextFile;
+using sicxe::assembler::Tokenizer;
+using std::string;
+
+namespace {
+
+void GenerateSource(size_t line_count, TextFile* file) {
+  static const char* const kLines[] = {
+    "loop%05u  LDA     #[3 * 4 + %u]     . load the next value from the table",
+    "          +ADD    value%u",
+    "          STA     buffer,X          . store it",
+    "          +LDX    =X'%02X'",
+    "          COMPR   A,X",
+    "          JLT     loop%05u",
+    "data%05u  BYTE    C'HELLO WORLD %u'",
+    "          WORD    0x%04X",
+    "          RESW    %u",
+    "          .       long comment line that only the comment scanner sees %u",
+  };
+  static const size_t kLineKinds = sizeof(kLines) / sizeof(kLines[0]);
+  char buffer[128];
+  file->set_file_name("generated.asm");
+  for (size_t i = 0; i < line_count; i++) {
+    unsigned int n = static_cast<unsigned int>(i / kLineKinds);
+    snprintf(buffer, sizeof(buffer), kLines[i % kLineKinds], n & 0xff, n & 0xff);
+    file->AppendLine(buffer);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t line_count = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 1000000;
+  int repetitions = (argc > 2) ? atoi(argv[2]) : 5;
+
+  TextFile file;
+  GenerateSource(line_count, &file);
+  size_t byte_count = 0;
+  for (size_t i = 0; i < file.line_count(); i++) {
+    byte_count += file.line(i).size() + 1;
+  }
+
+  Arena arena;
+  StringPool names;
+  Tokenizer tokenizer(&arena, &names);
+  Tokenizer::TokenList tokens;
+  ErrorDB error_db;
+  double best_seconds = 0.0;
+  size_t token_count = 0;
+  for (int repetition = 0; repetition < repetitions; repetition++) {
+    token_count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < file.line_count(); i++) {
+      if (!tokenizer.TokenizeLine(file, i, &tokens, &error_db)) {
+        fprintf(stderr, "tokenizing line %zu failed\n", i + 1);
+        return 1;
+      }
+      token_count += tokens.size();
+      for (auto token : tokens) {
+        tokenizer.ReleaseToken(token);
+      }
+      tokens.clear();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (repetition == 0 || elapsed.count() < best_seconds) {
+      best_seconds = elapsed.count();
+    }
+  }
+
+  printf("lines:      %zu\n", line_count);
+  printf("tokens:     %zu\n", token_count);
+  printf("time:       %.3f s\n", best_seconds);
+  printf("throughput: %.1f MB/s, %.1f ns/line\n",
+         byte_count / best_seconds / 1e6, best_seconds * 1e9 / line_count);
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include "assembler/base_plan.h"
+
+#include <memory>
+#include "common/text_file.h"
+
+using std::unique_ptr;
+
+namespace sicxe {
+namespace assembler {
+
+BasePlan::Region::Region()
+    : first_node(nullptr), last_node(nullptr), start_address(0), end_address(0),
+      base_node(nullptr), base_address(0), instruction_count(0), load_size(0) {}
+
+BasePlan::BasePlan() : inserted_(false), register_b_used_(false) {}
+BasePlan::~BasePlan() {}
+
+const BasePlan::RegionVector& BasePlan::regions() const {
+  return regions_;
+}
+
+BasePlan::RegionVector* BasePlan::mutable_regions() {
+  return &regions_;
+}
+
+bool BasePlan::inserted() const {
+  return inserted_;
+}
+
+void BasePlan::set_inserted(bool value) {
+  inserted_ = value;
+}
+
+bool BasePlan::register_b_used() const {
+  return register_b_used_;
+}
+
+void BasePlan::set_register_b_used(bool value) {
+  register_b_used_ = value;
+}
+
+int BasePlan::saved_bytes() const {
+  int saved = 0;
+  for (const Region& region : regions_) {
+    saved += region.instruction_count - region.load_size;
+  }
+  return saved;
+}
+
+void BasePlan::OutputToTextFile(TextFile* file) const {
+  size_t buffer_size = 200;
+  unique_ptr<char[]> buffer(new char[buffer_size]);
+  if (register_b_used_) {
+    file->AppendLine("register B is used by the program, no regions planned");
+    return;
+  }
+  snprintf(buffer.get(), buffer_size, "%-7s %-7s %-7s %-9s %-5s %s",
+           "START", "END", "BASE", "FORMAT 3", "LOAD", "SAVED");
+  file->AppendLine(buffer.get());
+  for (const Region& region : regions_) {
+    snprintf(buffer.get(), buffer_size, "%06x  %06x  %06x  %-9d %-5d %d",
+             region.start_address, region.end_address, region.base_address,
+             region.instruction_count, region.load_size,
+             region.instruction_count - region.load_size);
+    file->AppendLine(buffer.get());
+  }
+  snprintf(buffer.get(), buffer_size,
+           "%d bytes of code saved, %d bytes fewer fetched per pass through all regions",
+           saved_bytes(), saved_bytes());
+  file->AppendLine(buffer.get());
+  if (!inserted_) {
+    file->AppendLine("LDB and BASE not inserted, use --insert-base");
+  }
+}
+
+}  // namespace assembler
+}  // namespace sicxe
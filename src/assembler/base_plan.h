@@ -0,0 +1,65 @@
+#ifndef ASSEMBLER_BASE_PLAN_H
+#define ASSEMBLER_BASE_PLAN_H
+
+#include <vector>
+#include "assembler/node.h"
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+
+class TextFile;
+
+namespace assembler {
+
+// Code regions in which loading the base register lets format 4 instructions
+// use format 3 base relative addressing, found by BasePlanner. Addresses are
+// those of the code the plan was made for.
+class BasePlan {
+ public:
+  DISALLOW_COPY_AND_MOVE(BasePlan);
+
+  struct Region {
+    Region();
+
+    // first and last instruction of the region
+    const node::Node* first_node;
+    const node::Node* last_node;
+    uint32 start_address;
+    uint32 end_address;  // address of the first byte after the region
+    // the base register is loaded with the operand of this instruction
+    const node::InstructionFS34* base_node;
+    uint32 base_address;
+    int instruction_count;  // format 4 instructions that fit format 3
+    int load_size;  // size of the LDB instruction
+  };
+
+  typedef std::vector<Region> RegionVector;
+
+  BasePlan();
+  ~BasePlan();
+
+  const RegionVector& regions() const;
+  RegionVector* mutable_regions();
+  // LDB and BASE were inserted into the code
+  bool inserted() const;
+  void set_inserted(bool value);
+  // the program uses the base register itself, nothing was planned
+  bool register_b_used() const;
+  void set_register_b_used(bool value);
+  // Bytes of code saved by all regions, which is also the number of bytes
+  // fewer fetched each time every region is executed once.
+  int saved_bytes() const;
+
+  void OutputToTextFile(TextFile* file) const;
+
+ private:
+  RegionVector regions_;
+  bool inserted_;
+  bool register_b_used_;
+};
+
+}  // namespace assembler
+}  // namespace sicxe
+
+#endif  // ASSEMBLER_BASE_PLAN_H
@@ -0,0 +1,346 @@
+#include "assembler/base_planner.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include "assembler/expression_util.h"
+#include "assembler/token.h"
+#include "common/cpu_state.h"
+#include "common/error_db.h"
+#include "common/opcode.h"
+
+using std::make_pair;
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace sicxe {
+namespace assembler {
+
+namespace {
+
+enum NodeClassId {
+  INSTRUCTION = 0,
+  TRANSPARENT,  // generates nothing and does not move the address
+  BARRIER
+};
+
+NodeClassId ClassifyNode(const node::Node* node) {
+  if (isa<node::Instruction>(node)) {
+    return INSTRUCTION;
+  }
+  if (isa<node::Empty>(node) || isa<node::DirectiveExtdef>(node) ||
+      isa<node::DirectiveExtref>(node)) {
+    return TRANSPARENT;
+  }
+  const node::DirectiveEqu* equ = dyn_cast<node::DirectiveEqu>(node);
+  if (equ != nullptr && !equ->assign_current_address()) {
+    return TRANSPARENT;
+  }
+  return BARRIER;
+}
+
+bool UsesRegisterB(const node::Node* node) {
+  if (isa<node::DirectiveBase>(node) || isa<node::DirectiveNobase>(node)) {
+    return true;
+  }
+  const node::InstructionF2* f2 = dyn_cast<node::InstructionF2>(node);
+  if (f2 != nullptr) {
+    return f2->r1() == CpuState::REG_B || f2->r2() == CpuState::REG_B;
+  }
+  const node::InstructionFS34* fs34 = dyn_cast<node::InstructionFS34>(node);
+  return fs34 != nullptr && (fs34->opcode() == Opcode::LDB || fs34->opcode() == Opcode::STB);
+}
+
+void AppendNames(const node::Node::TokenList& tokens, vector<StringPool::Id>* names) {
+  for (const Token* token : tokens) {
+    if (token->type() == Token::NAME) {
+      names->push_back(token->name_id());
+    }
+  }
+}
+
+// Names of symbols referenced by |node|.
+void ReferencedNames(const node::Node* node, vector<StringPool::Id>* names) {
+  names->clear();
+  const node::InstructionFS34* instruction = dyn_cast<node::InstructionFS34>(node);
+  if (instruction != nullptr) {
+    AppendNames(instruction->expression(), names);
+    return;
+  }
+  const node::ExpressionDirective* expression_directive =
+      dyn_cast<node::ExpressionDirective>(node);
+  if (expression_directive != nullptr) {
+    AppendNames(expression_directive->expression(), names);
+    return;
+  }
+  const node::SymbolListDirective* symbol_list_directive =
+      dyn_cast<node::SymbolListDirective>(node);
+  if (symbol_list_directive != nullptr) {
+    AppendNames(symbol_list_directive->symbol_list(), names);
+  }
+}
+
+bool IsPCReachable(int32 value, uint32 address) {
+  int32 offset = value - static_cast<int32>(address + 3);
+  return offset >= -2048 && offset <= 2047;
+}
+
+}  // namespace
+
+BasePlanner::BasePlanner(const InstructionVector* candidates)
+    : candidates_(candidates), code_(nullptr), register_b_used_(false) {}
+BasePlanner::~BasePlanner() {}
+
+BasePlan* BasePlanner::PlanRegions(const Code& code, ErrorDB* error_db) {
+  CodeGenerator code_generator;
+  CodeGenerator::OutputWriterVector output_writers;
+  output_writers.push_back(this);
+  if (!code_generator.GenerateCode(code, &output_writers, error_db)) {
+    return nullptr;
+  }
+
+  unique_ptr<BasePlan> plan(new BasePlan);
+  if (register_b_used_) {
+    plan->set_register_b_used(true);
+    return plan.release();
+  }
+  vector<int> region;
+  AssignRegions(&region);
+  size_t begin = 0;
+  size_t end = 0;  // after the last instruction of the current region
+  for (size_t i = 0; i < records_.size(); i++) {
+    if (region[i] < 0) {
+      continue;
+    }
+    if (end == 0) {
+      begin = i;
+    } else if (region[i] != region[begin]) {
+      PlanRegion(begin, end, plan.get());
+      begin = i;
+    }
+    end = i + 1;
+  }
+  if (end != 0) {
+    PlanRegion(begin, end, plan.get());
+  }
+  records_.clear();
+  return plan.release();
+}
+
+void BasePlanner::InsertBaseLoads(const BasePlan& plan, Code* code, Code::NodeList* nodes) {
+  const BasePlan::RegionVector& regions = plan.regions();
+  if (regions.empty()) {
+    return;
+  }
+  // regions are in the order of the nodes
+  Code::NodeList output_nodes;
+  output_nodes.reserve(nodes->size() + 3 * regions.size());
+  size_t next_region = 0;
+  const BasePlan::Region* open_region = nullptr;
+  for (node::Node* node : *nodes) {
+    if (next_region < regions.size() && node == regions[next_region].first_node) {
+      open_region = &regions[next_region++];
+      const node::InstructionFS34* base_node = open_region->base_node;
+
+      node::InstructionFS34* load = code->arena()->New<node::InstructionFS34>();
+      load->set_opcode(Opcode::LDB);
+      load->set_syntax(Syntax::FS34_LOAD_W);
+      load->set_addressing(node::InstructionFS34::IMMEDIATE);
+      *load->mutable_expression() = base_node->expression();
+      *load->mutable_compiled_expression() = base_node->compiled_expression();
+      // jumps to the region must load the base register
+      load->set_label(node->mutable_label());
+      node->set_label(nullptr);
+      output_nodes.push_back(load);
+
+      node::DirectiveBase* base = code->arena()->New<node::DirectiveBase>();
+      *base->mutable_expression() = base_node->expression();
+      *base->mutable_compiled_expression() = base_node->compiled_expression();
+      output_nodes.push_back(base);
+    }
+    output_nodes.push_back(node);
+    if (open_region != nullptr && node == open_region->last_node) {
+      output_nodes.push_back(code->arena()->New<node::DirectiveNobase>());
+      open_region = nullptr;
+    }
+  }
+  nodes->swap(output_nodes);
+}
+
+void BasePlanner::Begin(const Code& code) {
+  code_ = &code;
+  records_.clear();
+  register_b_used_ = false;
+}
+
+void BasePlanner::WriteNode(const node::Node& node, uint32 address) {
+  AddRecord(node, address, 0);
+}
+
+void BasePlanner::WriteNode(const node::Node& node, uint32 address,
+                            const string& data, bool) {
+  AddRecord(node, address, data.size());
+}
+
+void BasePlanner::WriteRelocationRecord(const RelocationRecord&) {}
+
+void BasePlanner::End() {}
+
+void BasePlanner::AddRecord(const node::Node& node, uint32 address, uint32 size) {
+  if (UsesRegisterB(&node)) {
+    register_b_used_ = true;
+  }
+  Record record;
+  record.node = &node;
+  record.address = address;
+  record.size = size;
+  records_.push_back(record);
+}
+
+void BasePlanner::AssignRegions(vector<int>* region) {
+  const size_t count = records_.size();
+  vector<bool> region_start(count, false);
+  bool region_open = false;
+  for (size_t i = 0; i < count; i++) {
+    const node::Node* node = records_[i].node;
+    NodeClassId node_class = ClassifyNode(node);
+    if (node_class == INSTRUCTION) {
+      if (!region_open) {
+        region_start[i] = true;
+        region_open = true;
+      }
+      // the subroutine may change the base register
+      const node::InstructionFS34* instruction = dyn_cast<node::InstructionFS34>(node);
+      if (instruction != nullptr && instruction->opcode() == Opcode::JSUB) {
+        region_open = false;
+      }
+    } else if (node_class == BARRIER) {
+      region_open = false;
+    }
+  }
+
+  // labels of instructions, indexed by name id
+  vector<int> label_index;
+  for (size_t i = 0; i < count; i++) {
+    const Token* label = records_[i].node->label();
+    if (label != nullptr && isa<node::Instruction>(records_[i].node)) {
+      if (label->name_id() >= label_index.size()) {
+        label_index.resize(label->name_id() + 1, -1);
+      }
+      label_index[label->name_id()] = i;
+    }
+  }
+  // references from instructions to labels, others split the region at once
+  vector<pair<size_t, size_t> > references;
+  vector<StringPool::Id> names;
+  for (size_t i = 0; i < count; i++) {
+    const node::Node* node = records_[i].node;
+    ReferencedNames(node, &names);
+    for (StringPool::Id name : names) {
+      if (name >= label_index.size() || label_index[name] < 0) {
+        continue;
+      }
+      size_t target = label_index[name];
+      if (isa<node::Instruction>(node)) {
+        references.push_back(make_pair(i, target));
+      } else {
+        region_start[target] = true;
+      }
+    }
+  }
+
+  // a region may only be entered at its start, splitting one can make more
+  // references cross regions
+  region->assign(count, -1);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    int current_region = -1;
+    for (size_t i = 0; i < count; i++) {
+      if (isa<node::Instruction>(records_[i].node)) {
+        if (region_start[i]) {
+          current_region++;
+        }
+        (*region)[i] = current_region;
+      }
+    }
+    for (const auto& reference : references) {
+      if ((*region)[reference.first] != (*region)[reference.second] &&
+          !region_start[reference.second]) {
+        region_start[reference.second] = true;
+        changed = true;
+      }
+    }
+  }
+}
+
+void BasePlanner::PlanRegion(size_t begin, size_t end, BasePlan* plan) {
+  ErrorDB unused_error_db;
+  vector<pair<int32, const node::InstructionFS34*> > targets;
+  for (size_t i = begin; i < end; i++) {
+    const node::InstructionFS34* instruction =
+        dyn_cast<node::InstructionFS34>(records_[i].node);
+    if (instruction == nullptr || !instruction->extended() ||
+        instruction->syntax() == Syntax::FS34_NONE ||
+        instruction->addressing() == node::InstructionFS34::LITERAL_POOL) {
+      continue;
+    }
+    if (candidates_ != nullptr &&
+        !std::binary_search(candidates_->begin(), candidates_->end(), instruction)) {
+      continue;
+    }
+    int32 value = 0;
+    bool relative = false;
+    ExpressionUtil::ExternalSymbolVector external_symbols;
+    if (!ExpressionUtil::Evaluate(instruction->compiled_expression(), *code_->symbol_table(),
+                                  true, &value, &relative, &external_symbols,
+                                  &unused_error_db) ||
+        !relative || !external_symbols.empty() ||
+        IsPCReachable(value, records_[i].address)) {
+      continue;
+    }
+    targets.push_back(make_pair(value, instruction));
+  }
+  if (targets.empty()) {
+    return;
+  }
+
+  // the widest window of 4096 bytes starts at one of the targets
+  std::stable_sort(targets.begin(), targets.end(),
+                   [](const pair<int32, const node::InstructionFS34*>& a,
+                      const pair<int32, const node::InstructionFS34*>& b) {
+                     return a.first < b.first;
+                   });
+  size_t best_first = 0;
+  int best_count = 0;
+  size_t first = 0;
+  for (size_t last = 0; last < targets.size(); last++) {
+    while (targets[last].first - targets[first].first > 4095) {
+      first++;
+    }
+    int count = last - first + 1;
+    if (count > best_count) {
+      best_first = first;
+      best_count = count;
+    }
+  }
+
+  BasePlan::Region region;
+  region.first_node = records_[begin].node;
+  region.last_node = records_[end - 1].node;
+  region.start_address = records_[begin].address;
+  region.end_address = records_[end - 1].address + records_[end - 1].size;
+  region.base_node = targets[best_first].second;
+  region.base_address = targets[best_first].first;
+  region.instruction_count = best_count;
+  region.load_size = IsPCReachable(region.base_address, region.start_address) ? 3 : 4;
+  // every instruction that fits saves one byte
+  if (region.instruction_count > region.load_size) {
+    plan->mutable_regions()->push_back(region);
+  }
+}
+
+}  // namespace assembler
+}  // namespace sicxe
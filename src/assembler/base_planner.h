@@ -0,0 +1,75 @@
+#ifndef ASSEMBLER_BASE_PLANNER_H
+#define ASSEMBLER_BASE_PLANNER_H
+
+#include <string>
+#include <vector>
+#include "assembler/base_plan.h"
+#include "assembler/code.h"
+#include "assembler/code_generator.h"
+#include "assembler/node.h"
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+
+class ErrorDB;
+
+namespace assembler {
+
+// Splits the code into straight-line regions which can only be entered at
+// their first instruction, and picks for every region the base address that
+// lets the most format 4 instructions use format 3 base relative addressing.
+//
+// A region ends at directives that place code or data (ORG, USE, LTORG, data,
+// EQU *, ...), after JSUB, and before labels referenced from outside of it or
+// by anything but an instruction. Programs that use the base register
+// themselves are left alone.
+class BasePlanner : public CodeOutputWriter {
+ public:
+  DISALLOW_COPY_AND_MOVE(BasePlanner);
+
+  typedef std::vector<const node::InstructionFS34*> InstructionVector;
+
+  // Only instructions in |candidates|, which must be sorted, are considered to
+  // become format 3, or all format 4 instructions if it is nullptr.
+  explicit BasePlanner(const InstructionVector* candidates);
+  ~BasePlanner();
+
+  // |code| must have its tables built. Returns nullptr if the code cannot be
+  // generated.
+  BasePlan* PlanRegions(const Code& code, ErrorDB* error_db);
+
+  // Inserts LDB and BASE before and NOBASE after every region of |plan| into
+  // |nodes|, the parsed nodes of |code|. A label of the first instruction of a
+  // region is moved to its LDB.
+  static void InsertBaseLoads(const BasePlan& plan, Code* code, Code::NodeList* nodes);
+
+ private:
+  struct Record {
+    const node::Node* node;
+    uint32 address;
+    uint32 size;
+  };
+
+  virtual void Begin(const Code& code);
+  virtual void WriteNode(const node::Node& node, uint32 address);
+  virtual void WriteNode(const node::Node& node, uint32 address,
+                         const std::string& data, bool can_split);
+  virtual void WriteRelocationRecord(const RelocationRecord& record);
+  virtual void End();
+
+  void AddRecord(const node::Node& node, uint32 address, uint32 size);
+  // Sets the region of every instruction record, -1 for other records.
+  void AssignRegions(std::vector<int>* region);
+  void PlanRegion(size_t begin, size_t end, BasePlan* plan);
+
+  const InstructionVector* candidates_;
+  const Code* code_;
+  std::vector<Record> records_;
+  bool register_b_used_;
+};
+
+}  // namespace assembler
+}  // namespace sicxe
+
+#endif  // ASSEMBLER_BASE_PLANNER_H
@@ -1,8 +1,8 @@
 #include "assembler/block_table.h"
 
+#include <assert.h>
 #include "common/text_file.h"
 
-using std::map;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -33,23 +33,24 @@ BlockTable::Entry* BlockTable::GetBlock(int block) {
   return nullptr;
 }
 
-const BlockTable::Entry* BlockTable::FindName(const string& name) const {
-  auto it = name_map_.find(name);
-  if (it == name_map_.end()) {
+const BlockTable::Entry* BlockTable::FindName(StringPool::Id name_id) const {
+  if (name_id >= name_index_.size()) {
     return nullptr;
   }
-  return it->second;
+  return name_index_[name_id];
 }
 
-BlockTable::Entry* BlockTable::FindNameOrCreate(const string& name) {
-  auto p = name_map_.insert(make_pair(name, nullptr));
-  if (p.second) {
+BlockTable::Entry* BlockTable::FindNameOrCreate(StringPool::Id name_id, StringView name) {
+  assert(name_id != StringPool::kInvalidId);
+  if (name_id >= name_index_.size()) {
+    name_index_.resize(name_id + 1, nullptr);
+  }
+  if (name_index_[name_id] == nullptr) {
     int block = entries_.size();
-    entries_.emplace_back(new Entry(block, name));
-    return (p.first->second = entries_.back().get());
-  } else {
-    return p.first->second;
+    entries_.emplace_back(new Entry(block, name.ToString()));
+    name_index_[name_id] = entries_.back().get();
   }
+  return name_index_[name_id];
 }
 
 void BlockTable::OrderBlocks(uint32* start, uint32* end) {
@@ -67,11 +68,11 @@ void BlockTable::OutputToTextFile(TextFile* file) const {
   unique_ptr<char[]> buffer(new char[buffer_size]);
   snprintf(buffer.get(), buffer_size, "%-26s %-7s %-8s %s",
            "NAME", "START", "", "SIZE");
-  file->mutable_lines()->emplace_back(string(buffer.get()));
+  file->AppendLine(buffer.get());
   for (const auto& entry : entries_) {
     snprintf(buffer.get(), buffer_size, "%-26.26s %06x  %-8u %u",
              entry->name.c_str(), entry->start, entry->start, entry->size);
-    file->mutable_lines()->emplace_back(string(buffer.get()));
+    file->AppendLine(buffer.get());
   }
 }
 
@@ -1,11 +1,11 @@
 #ifndef ASSEMBLER_BLOCK_TABLE_H
 #define ASSEMBLER_BLOCK_TABLE_H
 
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 #include "common/macros.h"
+#include "common/string_pool.h"
 #include "common/types.h"
 
 namespace sicxe {
@@ -35,8 +35,10 @@ class BlockTable {
 
   const Entry* GetBlock(int block) const;
   Entry* GetBlock(int block);
-  const Entry* FindName(const std::string& name) const;
-  Entry* FindNameOrCreate(const std::string& name);
+  // Blocks are looked up by the interned id of their name, |name| must be the
+  // string of |name_id|.
+  const Entry* FindName(StringPool::Id name_id) const;
+  Entry* FindNameOrCreate(StringPool::Id name_id, StringView name);
   void OrderBlocks(uint32* start, uint32* end);
 
   void OutputToTextFile(TextFile* file) const;
@@ -45,7 +47,7 @@ class BlockTable {
 
  private:
   EntryVector entries_;
-  std::map<std::string, Entry*> name_map_;
+  std::vector<Entry*> name_index_;  // indexed by name id
 };
 
 }  // namespace assembler
@@ -0,0 +1,124 @@
+#include "assembler/char_scan_util.h"
+
+#include <assert.h>
+#include "common/types.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace sicxe {
+namespace assembler {
+
+namespace {
+
+bool InRange(char c, char low, char high) {
+  return c >= low && c <= high;
+}
+
+bool BelongsTo(CharScanUtil::ClassId class_id, char c) {
+  char lower = static_cast<char>(c | 0x20);
+  switch (class_id) {
+    case CharScanUtil::BLANK:
+      return c == ' ' || c == '\t';
+    case CharScanUtil::NAME:
+      return InRange(c, '0', '9') || InRange(lower, 'a', 'z') || c == '_';
+    case CharScanUtil::DECIMAL:
+      return InRange(c, '0', '9');
+    case CharScanUtil::HEX:
+      return InRange(c, '0', '9') || InRange(lower, 'a', 'f');
+    case CharScanUtil::PRINTABLE:
+      return InRange(c, 0x20, 0x7e);
+  }
+  assert(false);
+  return false;
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+#if defined(__AVX2__)
+typedef __m256i Vector;
+const size_t kVectorSize = 32;
+const uint32 kAllMatched = 0xffffffff;
+
+inline Vector Load(const char* data) {
+  return _mm256_loadu_si256(reinterpret_cast<const Vector*>(data));
+}
+inline Vector Splat(int c) { return _mm256_set1_epi8(static_cast<char>(c)); }
+inline Vector Add(Vector a, Vector b) { return _mm256_add_epi8(a, b); }
+inline Vector Or(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+inline Vector Equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+inline Vector Less(Vector a, Vector b) { return _mm256_cmpgt_epi8(b, a); }
+inline uint32 MoveMask(Vector v) { return static_cast<uint32>(_mm256_movemask_epi8(v)); }
+#else
+typedef __m128i Vector;
+const size_t kVectorSize = 16;
+const uint32 kAllMatched = 0xffff;
+
+inline Vector Load(const char* data) {
+  return _mm_loadu_si128(reinterpret_cast<const Vector*>(data));
+}
+inline Vector Splat(int c) { return _mm_set1_epi8(static_cast<char>(c)); }
+inline Vector Add(Vector a, Vector b) { return _mm_add_epi8(a, b); }
+inline Vector Or(Vector a, Vector b) { return _mm_or_si128(a, b); }
+inline Vector Equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+inline Vector Less(Vector a, Vector b) { return _mm_cmplt_epi8(a, b); }
+inline uint32 MoveMask(Vector v) { return static_cast<uint32>(_mm_movemask_epi8(v)); }
+#endif
+
+// There is no unsigned byte comparison, so the range is shifted to start at
+// -128 and compared signed.
+inline Vector InRange(Vector v, int low, int high) {
+  return Less(Add(v, Splat(0x80 - low)), Splat(-128 + (high - low + 1)));
+}
+
+inline Vector BelongsTo(CharScanUtil::ClassId class_id, Vector v) {
+  Vector lower = Or(v, Splat(0x20));
+  switch (class_id) {
+    case CharScanUtil::BLANK:
+      return Or(Equal(v, Splat(' ')), Equal(v, Splat('\t')));
+    case CharScanUtil::NAME:
+      return Or(Or(InRange(v, '0', '9'), InRange(lower, 'a', 'z')),
+                Equal(v, Splat('_')));
+    case CharScanUtil::DECIMAL:
+      return InRange(v, '0', '9');
+    case CharScanUtil::HEX:
+      return Or(InRange(v, '0', '9'), InRange(lower, 'a', 'f'));
+    case CharScanUtil::PRINTABLE:
+      return InRange(v, 0x20, 0x7e);
+  }
+  assert(false);
+  return v;
+}
+
+#endif
+
+}  // namespace
+
+size_t CharScanUtil::SkipRun(ClassId class_id, const char* data, size_t begin,
+                             size_t end) {
+  size_t i = begin;
+#if defined(__AVX2__) || defined(__SSE2__)
+  for (; i + kVectorSize <= end; i += kVectorSize) {
+    uint32 mismatch = ~MoveMask(BelongsTo(class_id, Load(data + i))) & kAllMatched;
+    if (mismatch != 0) {
+      return i + __builtin_ctz(mismatch);
+    }
+  }
+#endif
+  return SkipRunScalar(class_id, data, i, end);
+}
+
+size_t CharScanUtil::SkipRunScalar(ClassId class_id, const char* data, size_t begin,
+                                   size_t end) {
+  size_t i = begin;
+  while (i < end && BelongsTo(class_id, data[i])) {
+    i++;
+  }
+  return i;
+}
+
+}  // namespace assembler
+}  // namespace sicxe
@@ -0,0 +1,35 @@
+#ifndef ASSEMBLER_CHAR_SCAN_UTIL_H
+#define ASSEMBLER_CHAR_SCAN_UTIL_H
+
+#include <stddef.h>
+#include "common/macros.h"
+
+namespace sicxe {
+namespace assembler {
+
+// Finds the end of runs of characters that belong to one class. With AVX2 or
+// SSE2 available 32 or 16 characters are classified at once.
+class CharScanUtil {
+ public:
+  DISALLOW_INSTANTIATE(CharScanUtil);
+
+  enum ClassId {
+    BLANK,      // ' ' and '\t'
+    NAME,       // letters, digits and '_'
+    DECIMAL,    // '0' through '9'
+    HEX,        // digits and letters 'a' through 'f'
+    PRINTABLE   // 0x20 through 0x7e
+  };
+
+  // Returns the index of the first character in [begin, end) of |data| that
+  // does not belong to |class_id|, or |end| if all of them do.
+  static size_t SkipRun(ClassId class_id, const char* data, size_t begin, size_t end);
+  // Same as SkipRun, one character at a time.
+  static size_t SkipRunScalar(ClassId class_id, const char* data, size_t begin,
+                              size_t end);
+};
+
+}  // namespace assembler
+}  // namespace sicxe
+
+#endif  // ASSEMBLER_CHAR_SCAN_UTIL_H
@@ -1,7 +1,9 @@
 #include "assembler/code.h"
 
+#include "assembler/base_plan.h"
 #include "assembler/block_table.h"
 #include "assembler/literal_table.h"
+#include "assembler/peephole_report.h"
 #include "assembler/symbol_table.h"
 
 using std::string;
@@ -20,6 +22,14 @@ void Code::set_text_file(const TextFile* file) {
   text_file_ = file;
 }
 
+Arena* Code::arena() {
+  return &arena_;
+}
+
+StringPool* Code::names() {
+  return &names_;
+}
+
 const Code::NodeList& Code::nodes() const {
   return nodes_;
 }
@@ -52,6 +62,22 @@ void Code::set_literal_table(LiteralTable* table) {
   literal_table_.reset(table);
 }
 
+const BasePlan* Code::base_plan() const {
+  return base_plan_.get();
+}
+
+void Code::set_base_plan(BasePlan* plan) {
+  base_plan_.reset(plan);
+}
+
+const PeepholeReport* Code::peephole_report() const {
+  return peephole_report_.get();
+}
+
+void Code::set_peephole_report(PeepholeReport* report) {
+  peephole_report_.reset(report);
+}
+
 const string& Code::program_name() const {
   return program_name_;
 }
@@ -1,11 +1,13 @@
 #ifndef ASSEMBLER_CODE_H
 #define ASSEMBLER_CODE_H
 
-#include <list>
 #include <memory>
 #include <string>
+#include <vector>
 #include "assembler/node.h"
+#include "common/arena.h"
 #include "common/macros.h"
+#include "common/string_pool.h"
 #include "common/types.h"
 
 namespace sicxe {
@@ -14,21 +16,27 @@ class TextFile;
 
 namespace assembler {
 
+class BasePlan;
 class BlockTable;
 class LiteralTable;
+class PeepholeReport;
 class SymbolTable;
 
 class Code {
  public:
   DISALLOW_COPY_AND_MOVE(Code);
 
-  typedef std::list<std::unique_ptr<node::Node> > NodeList;
+  // nodes and their tokens are owned by arena()
+  typedef std::vector<node::Node*> NodeList;
 
   Code();
   ~Code();
 
   const TextFile* text_file() const;
   void set_text_file(const TextFile* file);
+  Arena* arena();
+  // names of tokens and symbols
+  StringPool* names();
   const NodeList& nodes() const;
   NodeList* mutable_nodes();
   const SymbolTable* symbol_table() const;
@@ -37,6 +45,12 @@ class Code {
   void set_block_table(BlockTable* table);
   const LiteralTable* literal_table() const;
   void set_literal_table(LiteralTable* table);
+  // nullptr unless base register placement was requested
+  const BasePlan* base_plan() const;
+  void set_base_plan(BasePlan* plan);
+  // nullptr unless the peephole optimizer ran
+  const PeepholeReport* peephole_report() const;
+  void set_peephole_report(PeepholeReport* report);
   const std::string& program_name() const;
   void set_program_name(const std::string& name);
   uint32 start_address() const;
@@ -48,10 +62,14 @@ class Code {
 
  private:
   const TextFile* text_file_;
+  Arena arena_;
+  StringPool names_;
   NodeList nodes_;
   std::unique_ptr<SymbolTable> symbol_table_;
   std::unique_ptr<BlockTable> block_table_;
   std::unique_ptr<LiteralTable> literal_table_;
+  std::unique_ptr<BasePlan> base_plan_;
+  std::unique_ptr<PeepholeReport> peephole_report_;
   std::string program_name_;
   uint32 start_address_;  // lowest address of code
   uint32 end_address_;  // highes address (address of first free byte)
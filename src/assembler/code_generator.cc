@@ -28,7 +28,8 @@ CodeGenerator::CodeGenerator()
     : code_(nullptr), symbol_table_(nullptr), block_table_(nullptr),
       literal_table_(nullptr), output_writers_(nullptr), error_db_(nullptr),
       current_block_(-1), current_address_(0), base_enabled_(false),
-      base_relative_(false), base_address_(0), success_(false) {}
+      base_relative_(false), base_address_(0), success_(false),
+      unaddressable_nodes_(nullptr) {}
 
 CodeGenerator::~CodeGenerator() {}
 
@@ -64,6 +65,16 @@ bool CodeGenerator::GenerateCode(const Code& code, OutputWriterVector* output_wr
   return true;
 }
 
+bool CodeGenerator::FindUnaddressableInstructions(const Code& code,
+                                                  InstructionVector* nodes,
+                                                  ErrorDB* error_db) {
+  OutputWriterVector no_writers;
+  unaddressable_nodes_ = nodes;
+  bool success = GenerateCode(code, &no_writers, error_db);
+  unaddressable_nodes_ = nullptr;
+  return success;
+}
+
 void CodeGenerator::VisitNode(const node::Empty* node) {
   WriteNode(*node);
 }
@@ -187,14 +198,21 @@ void CodeGenerator::VisitNode(const node::InstructionFS34* node) {
       value = entry->address;
       relative = entry->relative;
     } else {
-      if (!ExpressionUtil::Solve(node->expression(), *symbol_table_, true,
-                                 &value, &relative, &external_symbols, error_db_) ||
+      if (!ExpressionUtil::Evaluate(node->compiled_expression(), *symbol_table_, true,
+                                    &value, &relative, &external_symbols, error_db_) ||
           !CheckExpressionLimits(0, 0xffffff, value, node->expression())) {
         success_ = false;
         return;
       }
     }
 
+    if (unaddressable_nodes_ != nullptr && !node->extended() &&
+        !external_symbols.empty()) {
+      unaddressable_nodes_->push_back(node);
+      current_address_ += size;
+      return;
+    }
+
     bool addressing_selected = false;
     if (external_symbols.empty() && !node->extended()) {
       if (TryPCRelativeAddressing(value, relative, &instance)) {
@@ -246,6 +264,10 @@ void CodeGenerator::VisitNode(const node::InstructionFS34* node) {
           instance.operands.fS34.p = false;
           instance.operands.fS34.b = false;
           instance.operands.fS34.address = static_cast<uint32>(value) & 0x7fff;
+        } else if (unaddressable_nodes_ != nullptr && !node->extended()) {
+          unaddressable_nodes_->push_back(node);
+          current_address_ += size;
+          return;
         } else {
           // no addressing possible, fail
           const char* message = nullptr;
@@ -305,8 +327,8 @@ void CodeGenerator::VisitNode(const node::DirectiveLtorg* node) {
 void CodeGenerator::VisitNode(const node::DirectiveBase* node) {
   int32 value = 0;
   bool relative = false;
-  if (!ExpressionUtil::Solve(node->expression(), *symbol_table_, false,
-                             &value, &relative, nullptr, error_db_) ||
+  if (!ExpressionUtil::Evaluate(node->compiled_expression(), *symbol_table_, false,
+                                &value, &relative, nullptr, error_db_) ||
       !CheckExpressionLimits(0, 0xfffff, value, node->expression())) {
     success_ = false;
     return;
@@ -347,8 +369,8 @@ void CodeGenerator::VisitNode(const node::DirectiveMemInit* node) {
     const bool is_byte = (node->width() == node::DirectiveMemInit::BYTE);
     int32 limit_min = is_byte ? -(1 << 7) : -(1 << 23);
     int32 limit_max = is_byte ? (1 << 8) - 1 : (1 << 24) - 1;
-    if (!ExpressionUtil::Solve(node->expression(), *symbol_table_, true,
-                               &value, &relative, &external_symbols, error_db_) ||
+    if (!ExpressionUtil::Evaluate(node->compiled_expression(), *symbol_table_, true,
+                                  &value, &relative, &external_symbols, error_db_) ||
         !CheckExpressionLimits(limit_min, limit_max, value, node->expression())) {
       success_ = false;
       return;
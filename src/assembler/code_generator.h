@@ -53,12 +53,18 @@ class CodeGenerator : public ConstNodeVisitor {
   DISALLOW_COPY_AND_MOVE(CodeGenerator);
 
   typedef std::vector<CodeOutputWriter*> OutputWriterVector;
+  typedef std::vector<const node::InstructionFS34*> InstructionVector;
 
   CodeGenerator();
   ~CodeGenerator();
 
   bool GenerateCode(const Code& code, OutputWriterVector* output_writers,
                     ErrorDB* error_db);
+  // Generates code without output and collects format 3 instructions whose
+  // operand cannot be addressed or references external symbols, instead of
+  // failing on them. These are the instructions that need format 4.
+  bool FindUnaddressableInstructions(const Code& code, InstructionVector* nodes,
+                                     ErrorDB* error_db);
 
  private:
   virtual void VisitNode(const node::Empty* node);
@@ -103,6 +109,7 @@ class CodeGenerator : public ConstNodeVisitor {
   uint32 base_address_;
   bool success_;
   std::unique_ptr<uint32[]> block_address_table_;
+  InstructionVector* unaddressable_nodes_;  // set while collecting them
 };
 
 }  // namespace assembler
@@ -0,0 +1,140 @@
+#include "assembler/code_site_writer.h"
+
+#include "assembler/code.h"
+#include "assembler/node.h"
+#include "assembler/symbol_table.h"
+#include "assembler/token.h"
+
+using std::string;
+
+namespace sicxe {
+namespace assembler {
+
+namespace {
+
+// flags in the second byte of format 3 and 4 instructions
+const uint8 kFlagBase = 0x40;
+const uint8 kFlagPCRelative = 0x20;
+const uint8 kFlagExtended = 0x10;
+
+}  // namespace
+
+CodeSiteWriter::CodeSiteWriter()
+    : code_(nullptr), relaxable_(true), has_extended_(false) {}
+CodeSiteWriter::~CodeSiteWriter() {}
+
+const ObjectFile::CodeSiteVector& CodeSiteWriter::code_sites() const {
+  return code_sites_;
+}
+
+void CodeSiteWriter::Begin(const Code& code) {
+  code_ = &code;
+  code_sites_.clear();
+  relaxable_ = true;
+  has_extended_ = false;
+}
+
+void CodeSiteWriter::WriteNode(const node::Node& node, uint32) {
+  if (isa<node::DirectiveOrg>(&node)) {
+    relaxable_ = false;
+    return;
+  }
+  const node::DirectiveMemReserve* reserve = dyn_cast<node::DirectiveMemReserve>(&node);
+  if (reserve != nullptr && CountRelativeSymbols(reserve->compiled_expression()) != 0) {
+    // the reserved size depends on addresses
+    relaxable_ = false;
+    return;
+  }
+  const node::DirectiveEqu* equ = dyn_cast<node::DirectiveEqu>(&node);
+  if (equ != nullptr && !equ->assign_current_address()) {
+    int relative_count = CountRelativeSymbols(equ->compiled_expression());
+    if (relative_count < 0) {
+      relaxable_ = false;
+    } else if (relative_count == 0) {
+      // the linker treats exported symbols as addresses and would move it
+      const SymbolTable::Entry* entry =
+          code_->symbol_table()->Find(equ->label()->name_id());
+      if (entry != nullptr && entry->exported) {
+        relaxable_ = false;
+      }
+    }
+  }
+}
+
+void CodeSiteWriter::WriteNode(const node::Node& node, uint32 address,
+                               const string& data, bool) {
+  const node::InstructionFS34* instruction = dyn_cast<node::InstructionFS34>(&node);
+  if (instruction != nullptr) {
+    AddInstruction(*instruction, address, data);
+    return;
+  }
+  const node::DirectiveMemInit* mem_init = dyn_cast<node::DirectiveMemInit>(&node);
+  if (mem_init != nullptr && mem_init->data_token() == nullptr &&
+      CountRelativeSymbols(mem_init->compiled_expression()) < 0) {
+    relaxable_ = false;
+  }
+}
+
+void CodeSiteWriter::WriteRelocationRecord(const RelocationRecord&) {}
+
+void CodeSiteWriter::End() {
+  if (!relaxable_ || !has_extended_) {
+    code_sites_.clear();
+  }
+}
+
+int CodeSiteWriter::CountRelativeSymbols(const ExpressionUtil::Program& program) const {
+  const SymbolTable* symbol_table = code_->symbol_table();
+  int count = 0;
+  int sum = 0;
+  bool external = false;
+  for (const auto& operation : program.operations) {
+    if (operation.opcode != ExpressionUtil::Program::ADD_SYMBOL &&
+        operation.opcode != ExpressionUtil::Program::SUBTRACT_SYMBOL) {
+      continue;
+    }
+    const SymbolTable::Entry* entry = symbol_table->Find(operation.operand);
+    if (entry == nullptr) {
+      continue;
+    }
+    if (entry->type == SymbolTable::EXTERNAL) {
+      external = true;
+    } else if (entry->relative) {
+      count++;
+      sum += (operation.opcode == ExpressionUtil::Program::ADD_SYMBOL) ? 1 : -1;
+    }
+  }
+  // with imported symbols every relative symbol gets its own relocation record
+  if (external || count == 0 || (count == 1 && sum == 1)) {
+    return count;
+  }
+  return -1;
+}
+
+void CodeSiteWriter::AddInstruction(const node::InstructionFS34& node, uint32 address,
+                                    const string& data) {
+  if (node.addressing() != node::InstructionFS34::LITERAL_POOL &&
+      CountRelativeSymbols(node.compiled_expression()) < 0) {
+    relaxable_ = false;
+  }
+  uint8 flags = static_cast<uint8>(data[1]);
+  if ((data[0] & 0x3) == 0) {
+    // SIC addressing only takes absolute addresses
+    return;
+  }
+  ObjectFile::CodeSite site;
+  site.address = address;
+  if (data.size() == 4 && (flags & kFlagExtended) != 0) {
+    site.kind = ObjectFile::EXTENDED_INSTRUCTION;
+    has_extended_ = true;
+    code_sites_.push_back(site);
+  } else if ((flags & kFlagBase) != 0) {
+    relaxable_ = false;
+  } else if ((flags & kFlagPCRelative) != 0) {
+    site.kind = ObjectFile::PC_RELATIVE_INSTRUCTION;
+    code_sites_.push_back(site);
+  }
+}
+
+}  // namespace assembler
+}  // namespace sicxe
@@ -0,0 +1,56 @@
+#ifndef ASSEMBLER_CODE_SITE_WRITER_H
+#define ASSEMBLER_CODE_SITE_WRITER_H
+
+#include <string>
+#include "assembler/code_generator.h"
+#include "assembler/expression_util.h"
+#include "common/macros.h"
+#include "common/object_file.h"
+#include "common/types.h"
+
+namespace sicxe {
+namespace assembler {
+
+class Code;
+
+// Collects the format 4 and PC relative format 3 instructions of the code as
+// object file code sites, for sicld --relax. The linker shortens format 4
+// instructions and moves the code after them, which is only correct if no
+// value depends on the distance between two addresses in the code. Code that
+// uses ORG or base relative addressing, has an expression that is absolute but
+// uses relative symbols or uses more than one relative symbol, or exports an
+// absolute symbol, gets no code sites at all.
+class CodeSiteWriter : public CodeOutputWriter {
+ public:
+  DISALLOW_COPY_AND_MOVE(CodeSiteWriter);
+
+  CodeSiteWriter();
+  ~CodeSiteWriter();
+
+  // Empty if the code cannot be relaxed or has no format 4 instructions.
+  const ObjectFile::CodeSiteVector& code_sites() const;
+
+ private:
+  virtual void Begin(const Code& code);
+  virtual void WriteNode(const node::Node& node, uint32 address);
+  virtual void WriteNode(const node::Node& node, uint32 address,
+                         const std::string& data, bool can_split);
+  virtual void WriteRelocationRecord(const RelocationRecord& record);
+  virtual void End();
+
+  // Returns the number of relative symbols in |program|, or -1 if its value
+  // depends on the distance between addresses.
+  int CountRelativeSymbols(const ExpressionUtil::Program& program) const;
+  void AddInstruction(const node::InstructionFS34& node, uint32 address,
+                      const std::string& data);
+
+  const Code* code_;
+  ObjectFile::CodeSiteVector code_sites_;
+  bool relaxable_;
+  bool has_extended_;
+};
+
+}  // namespace assembler
+}  // namespace sicxe
+
+#endif  // ASSEMBLER_CODE_SITE_WRITER_H
@@ -1,12 +1,16 @@
 #include "assembler/expression_util.h"
 
-#include <map>
+#include <algorithm>
+#include <utility>
 #include "assembler/symbol_table.h"
 #include "assembler/token.h"
 #include "common/error_db.h"
 
-using std::map;
+using std::make_pair;
+using std::pair;
+using std::sort;
 using std::string;
+using std::vector;
 
 namespace sicxe {
 namespace assembler {
@@ -17,194 +21,157 @@ ExpressionUtil::ExternalSymbol::ExternalSymbol(SignId the_sign,
 
 namespace {
 
+typedef ExpressionUtil::Program Program;
+
+bool IsSymbolOperation(Program::OpcodeId opcode) {
+  switch (opcode) {
+    case Program::ADD_SYMBOL:
+    case Program::SUBTRACT_SYMBOL:
+    case Program::LOAD_SYMBOL:
+    case Program::MULTIPLY_SYMBOL:
+    case Program::DIVIDE_SYMBOL:
+      return true;
+    default:
+      return false;
+  }
+}
+
 // Checks that all symbols in the expression are defined and their value is known.
 // If there are any external symbols in the expression sets |has_external| to true.
-bool ValidateExpressionSymbols(const ExpressionUtil::TokenList& expression,
-                               const SymbolTable& symbol_table,
-                               bool allow_external, bool* has_external,
-                               ErrorDB* error_db) {
+bool ValidateProgramSymbols(const Program& program, const SymbolTable& symbol_table,
+                            bool allow_external, bool* has_external,
+                            ErrorDB* error_db) {
   bool success = true;
-  for (const auto& token : expression) {
-    if (token->type() == Token::NAME) {
-      const SymbolTable::Entry* entry = symbol_table.Find(token->value());
-      if (entry == nullptr || entry->type == SymbolTable::UNKNOWN ||
-          (entry->type == SymbolTable::INTERNAL && !entry->defined)) {
-        error_db->AddError(ErrorDB::ERROR, "undefined symbol", token->pos());
+  for (const auto& operation : program.operations) {
+    if (!IsSymbolOperation(operation.opcode)) {
+      continue;
+    }
+    const SymbolTable::Entry* entry = symbol_table.Find(operation.operand);
+    if (entry == nullptr || entry->type == SymbolTable::UNKNOWN ||
+        (entry->type == SymbolTable::INTERNAL && !entry->defined)) {
+      error_db->AddError(ErrorDB::ERROR, "undefined symbol", operation.token->pos());
+      success = false;
+      continue;
+    }
+    if (entry->type == SymbolTable::EXTERNAL) {
+      *has_external = true;
+      if (!allow_external) {
+        error_db->AddError(ErrorDB::ERROR,
+                           "imported external symbols not allowed in this expression",
+                           operation.token->pos());
         success = false;
         continue;
       }
-      if (entry->type == SymbolTable::EXTERNAL) {
-        *has_external = true;
-        if (!allow_external) {
-          error_db->AddError(ErrorDB::ERROR,
-                             "imported external symbols not allowed in this expression",
-                             token->pos());
-          success = false;
-          continue;
-        }
-      } else if (entry->type == SymbolTable::INTERNAL) {
-        if (!entry->resolved) {
-          error_db->AddError(ErrorDB::ERROR,
-                             "symbols from blocks not allowed in this expression",
-                             token->pos());
-          success = false;
-          continue;
-        }
+    } else if (entry->type == SymbolTable::INTERNAL) {
+      if (!entry->resolved) {
+        error_db->AddError(ErrorDB::ERROR,
+                           "symbols from blocks not allowed in this expression",
+                           operation.token->pos());
+        success = false;
+        continue;
       }
     }
   }
   return success;
 }
 
-bool PeekIsEndOfTerm(const ExpressionUtil::TokenList& expression,
-                     const ExpressionUtil::TokenList::const_iterator it) {
-  ExpressionUtil::TokenList::const_iterator next_it = it;
-  ++next_it;
-  if (next_it == expression.end()) {
+bool IsEndOfTerm(const ExpressionUtil::TokenList& expression, size_t index) {
+  if (index + 1 == expression.size()) {
     return true;
+  }
+  const Token& token = *expression[index + 1];
+  assert(token.type() == Token::OPERATOR);
+  return token.operator_id() == Token::OP_ADD ||
+         token.operator_id() == Token::OP_SUB;
+}
+
+// Appends |integer_opcode| or |symbol_opcode| depending on the type of |token|,
+// the symbol variant always directly follows the integer one.
+void AppendOperand(Program::OpcodeId integer_opcode, const Token* token,
+                   Program* program) {
+  Program::Operation operation;
+  operation.token = token;
+  if (token->type() == Token::INTEGER) {
+    operation.opcode = integer_opcode;
+    operation.operand = token->integer();
+  } else if (token->type() == Token::NAME) {
+    operation.opcode = static_cast<Program::OpcodeId>(integer_opcode + 1);
+    operation.operand = token->name_id();
   } else {
-    const Token& token = *next_it->get();
-    assert(token.type() == Token::OPERATOR);
-    return token.operator_id() == Token::OP_ADD ||
-           token.operator_id() == Token::OP_SUB;
+    assert(false);
+    return;
   }
+  program->operations.push_back(operation);
 }
 
-bool CheckOverflow(int64 value, const ExpressionUtil::TokenList& expression,
-                   ErrorDB* error_db) {
+bool CheckOverflow(int64 value, const Program& program, ErrorDB* error_db) {
   if (value < -2147483648LL || value > 2147483647LL) {
     error_db->AddError(ErrorDB::ERROR, "overflow while evaluating expression",
-                       expression.front()->pos(), expression.back()->pos());
+                       program.first_token->pos(), program.last_token->pos());
     return false;
   }
   return true;
 }
 
-bool GetTermTokenValue(const Token& token, const SymbolTable& symbol_table,
-                         int64* value, ErrorDB* error_db) {
-  if (token.type() == Token::INTEGER) {
-    *value = token.integer();
-  } else if (token.type() == Token::NAME) {
-    const SymbolTable::Entry* entry = symbol_table.Find(token.value());
-    assert(entry != nullptr);
-    if (entry->type == SymbolTable::EXTERNAL) {
-      error_db->AddError(ErrorDB::ERROR,
-                         "external imported symbols must not be operands to '*' and '/'",
-                         token.pos());
-      return false;
-    }
-    assert(entry->type == SymbolTable::INTERNAL);
-    if (entry->relative) {
-      error_db->AddError(ErrorDB::ERROR,
-                         "relative symbols must not be operands to '*' and '/'",
-                         token.pos());
-      return false;
-    }
-    assert(entry->resolved);
-    *value = entry->address;
-  } else {
-    assert(false);
+// Value of an operand to '*' and '/'.
+bool GetTermOperandValue(const Program::Operation& operation,
+                         const SymbolTable& symbol_table, int64* value,
+                         ErrorDB* error_db) {
+  switch (operation.opcode) {
+    case Program::LOAD_INTEGER:
+    case Program::MULTIPLY_INTEGER:
+    case Program::DIVIDE_INTEGER:
+      *value = operation.operand;
+      return true;
+    default:
+      break;
   }
-  return true;
-}
-
-bool SolveTerm(const ExpressionUtil::TokenList& expression,
-                 const SymbolTable& symbol_table,
-                 ExpressionUtil::TokenList::const_iterator* it,
-                 int64* value_ptr, ErrorDB* error_db) {
-  int64 value = 0;
-  if (!GetTermTokenValue(*(*it)->get(), symbol_table, &value, error_db) ||
-      !CheckOverflow(value, expression, error_db)) {
+  const SymbolTable::Entry* entry = symbol_table.Find(operation.operand);
+  assert(entry != nullptr);
+  if (entry->type == SymbolTable::EXTERNAL) {
+    error_db->AddError(ErrorDB::ERROR,
+                       "external imported symbols must not be operands to '*' and '/'",
+                       operation.token->pos());
     return false;
   }
-  while (true) {
-    if (PeekIsEndOfTerm(expression, *it)) {
-      break;
-    }
-    ++(*it);
-    const Token& operator_token = *(*it)->get();
-    assert(operator_token.type() == Token::OPERATOR);
-    ++(*it);
-    const Token& operand_token = *(*it)->get();
-    int64 operand_value = 0;
-    if (!GetTermTokenValue(operand_token, symbol_table, &operand_value, error_db) ||
-        !CheckOverflow(operand_value, expression, error_db)) {
-        return false;
-    }
-    if (operator_token.operator_id() == Token::OP_MUL) {
-      value *= operand_value;
-    } else if (operator_token.operator_id() == Token::OP_DIV) {
-      if (operand_value == 0) {
-        error_db->AddError(ErrorDB::ERROR, "division by zero", operand_token.pos());
-        return false;
-      }
-      value /= operand_value;
-    } else {
-      assert(false);
-    }
-    if (!CheckOverflow(value, expression, error_db)) {
-      return false;
-    }
+  assert(entry->type == SymbolTable::INTERNAL);
+  if (entry->relative) {
+    error_db->AddError(ErrorDB::ERROR,
+                       "relative symbols must not be operands to '*' and '/'",
+                       operation.token->pos());
+    return false;
   }
-  *value_ptr = value;
+  assert(entry->resolved);
+  *value = entry->address;
   return true;
 }
 
-bool SolveSingle(const Token& token, const SymbolTable& symbol_table,
-                 ExpressionUtil::SignId sign, bool has_external, int64* value,
-                 bool* relative, map<string, int>* external_map_ptr, ErrorDB* error_db) {
-  if (token.type() == Token::INTEGER) {
-    *relative = false;
-    *value = token.integer();
-  } else if (token.type() == Token::NAME) {
-    const SymbolTable::Entry* entry = symbol_table.Find(token.value());
-    assert(entry != nullptr);
-    if (has_external &&
-        (entry->type == SymbolTable::EXTERNAL ||
-         (entry->type == SymbolTable::INTERNAL && entry->exported))) {
-      *relative = true;
-      (*external_map_ptr)[token.value()] += (sign == ExpressionUtil::PLUS) ? 1 : -1;
-    } else {
-      assert(entry->type == SymbolTable::INTERNAL);
-      if (has_external && entry->relative) {
-        error_db->AddError(ErrorDB::ERROR,
-                           "non-exported relative symbols not allowed in expression that "
-                           "contains external imported symbols", token.pos());
-        return false;
-      }
-      assert(entry->resolved);
-      *relative = entry->relative;
-      *value = entry->address;
+// Adds |count| to the net count of external symbol |name_id|.
+void CountExternal(StringPool::Id name_id, int count,
+                   vector<pair<StringPool::Id, int>>* external_counts) {
+  for (auto& external : *external_counts) {
+    if (external.first == name_id) {
+      external.second += count;
+      return;
     }
-  } else {
-    assert(false);
   }
-  return true;
+  external_counts->push_back(make_pair(name_id, count));
 }
 
 }  // namespace
 
-bool ExpressionUtil::Solve(const TokenList& expression, const SymbolTable& symbol_table,
-                           bool allow_external, int32* result, bool* relative,
-                           ExternalSymbolVector* external_symbols, ErrorDB* error_db) {
-  if (allow_external) {
-    assert(external_symbols != nullptr);
-  }
-  bool has_external = false;
-  if (!ValidateExpressionSymbols(expression, symbol_table, allow_external,
-                                 &has_external, error_db)) {
-    return false;
-  }
+ExpressionUtil::Program::Program() : first_token(nullptr), last_token(nullptr) {}
 
-  int64 value = 0;
-  int relative_count = 0;
-  SignId sign = PLUS;
-  map<string, int> external_map;
+void ExpressionUtil::Compile(const TokenList& expression, Program* program) {
+  program->operations.clear();
+  program->first_token = expression.empty() ? nullptr : expression.front();
+  program->last_token = expression.empty() ? nullptr : expression.back();
 
-  for (auto it = expression.begin(); it != expression.end(); ++it) {
-    const Token& token = *it->get();
-    if (token.type() == Token::OPERATOR) {
-      switch (token.operator_id()) {
+  SignId sign = PLUS;
+  for (size_t i = 0; i < expression.size(); i++) {
+    const Token* token = expression[i];
+    if (token->type() == Token::OPERATOR) {
+      switch (token->operator_id()) {
         case Token::OP_ADD:
           sign = PLUS;
           break;
@@ -215,29 +182,126 @@ bool ExpressionUtil::Solve(const TokenList& expression, const SymbolTable& symbo
           assert(false);
           break;
       }
-    } else if (token.type() == Token::NAME || token.type() == Token::INTEGER) {
-      bool term_single = PeekIsEndOfTerm(expression, it);
-      bool term_relative = false;
-      int64 term_value = 0;
-      if (term_single) {
-        if (!SolveSingle(token, symbol_table, sign, has_external, &term_value,
-                         &term_relative, &external_map, error_db)) {
+      continue;
+    }
+    if (IsEndOfTerm(expression, i)) {
+      AppendOperand((sign == PLUS) ? Program::ADD_INTEGER : Program::SUBTRACT_INTEGER,
+                    token, program);
+      continue;
+    }
+    AppendOperand(Program::LOAD_INTEGER, token, program);
+    while (!IsEndOfTerm(expression, i)) {
+      const Token* operator_token = expression[i + 1];
+      const Token* operand_token = expression[i + 2];
+      i += 2;
+      if (operator_token->operator_id() == Token::OP_MUL) {
+        AppendOperand(Program::MULTIPLY_INTEGER, operand_token, program);
+      } else if (operator_token->operator_id() == Token::OP_DIV) {
+        AppendOperand(Program::DIVIDE_INTEGER, operand_token, program);
+      } else {
+        assert(false);
+      }
+    }
+    Program::Operation operation;
+    operation.opcode = (sign == PLUS) ? Program::ADD_TERM : Program::SUBTRACT_TERM;
+    operation.operand = 0;
+    operation.token = nullptr;
+    program->operations.push_back(operation);
+  }
+}
+
+bool ExpressionUtil::Evaluate(const Program& program, const SymbolTable& symbol_table,
+                              bool allow_external, int32* result, bool* relative,
+                              ExternalSymbolVector* external_symbols, ErrorDB* error_db) {
+  if (allow_external) {
+    assert(external_symbols != nullptr);
+  }
+  bool has_external = false;
+  if (!ValidateProgramSymbols(program, symbol_table, allow_external,
+                              &has_external, error_db)) {
+    return false;
+  }
+
+  int64 value = 0;
+  int64 term_value = 0;
+  int relative_count = 0;
+  vector<pair<StringPool::Id, int>> external_counts;
+
+  for (const auto& operation : program.operations) {
+    switch (operation.opcode) {
+      case Program::ADD_INTEGER:
+        value += operation.operand;
+        break;
+      case Program::SUBTRACT_INTEGER:
+        value -= operation.operand;
+        break;
+      case Program::ADD_SYMBOL:
+      case Program::SUBTRACT_SYMBOL: {
+        int sign = (operation.opcode == Program::ADD_SYMBOL) ? 1 : -1;
+        const SymbolTable::Entry* entry = symbol_table.Find(operation.operand);
+        assert(entry != nullptr);
+        if (has_external &&
+            (entry->type == SymbolTable::EXTERNAL ||
+             (entry->type == SymbolTable::INTERNAL && entry->exported))) {
+          relative_count += sign;
+          CountExternal(operation.operand, sign, &external_counts);
+        } else {
+          assert(entry->type == SymbolTable::INTERNAL);
+          if (has_external && entry->relative) {
+            error_db->AddError(ErrorDB::ERROR,
+                               "non-exported relative symbols not allowed in expression "
+                               "that contains external imported symbols",
+                               operation.token->pos());
+            return false;
+          }
+          assert(entry->resolved);
+          value += sign * static_cast<int64>(entry->address);
+          if (entry->relative) {
+            relative_count += sign;
+          }
+        }
+        break;
+      }
+      case Program::LOAD_INTEGER:
+      case Program::LOAD_SYMBOL:
+        if (!GetTermOperandValue(operation, symbol_table, &term_value, error_db) ||
+            !CheckOverflow(term_value, program, error_db)) {
           return false;
         }
-      } else {
-        if (!SolveTerm(expression, symbol_table, &it, &term_value, error_db)) {
+        continue;
+      case Program::MULTIPLY_INTEGER:
+      case Program::MULTIPLY_SYMBOL:
+      case Program::DIVIDE_INTEGER:
+      case Program::DIVIDE_SYMBOL: {
+        int64 operand_value = 0;
+        if (!GetTermOperandValue(operation, symbol_table, &operand_value, error_db) ||
+            !CheckOverflow(operand_value, program, error_db)) {
           return false;
         }
+        if (operation.opcode == Program::MULTIPLY_INTEGER ||
+            operation.opcode == Program::MULTIPLY_SYMBOL) {
+          term_value *= operand_value;
+        } else {
+          if (operand_value == 0) {
+            error_db->AddError(ErrorDB::ERROR, "division by zero", operation.token->pos());
+            return false;
+          }
+          term_value /= operand_value;
+        }
+        if (!CheckOverflow(term_value, program, error_db)) {
+          return false;
+        }
+        continue;
       }
-      value += (sign == PLUS) ? term_value : -term_value;
-      if (term_relative) {
-        relative_count += (sign == PLUS) ? 1 : -1;
-      }
-      if (!CheckOverflow(value, expression, error_db)) {
-        return false;
-      }
-    } else {
-      assert(false);
+      case Program::ADD_TERM:
+        value += term_value;
+        break;
+      case Program::SUBTRACT_TERM:
+        value -= term_value;
+        break;
+    }
+    if (!CheckOverflow(value, program, error_db)) {
+      return false;
     }
   }
 
@@ -247,26 +311,44 @@ bool ExpressionUtil::Solve(const TokenList& expression, const SymbolTable& symbo
     *relative = true;
   } else {
     error_db->AddError(ErrorDB::ERROR, "expression is neither relative nor absolute",
-                       expression.front()->pos(), expression.back()->pos());
+                       program.first_token->pos(), program.last_token->pos());
     return false;
   }
   *result = static_cast<int32>(value);
-  for (const auto& symbol : external_map) {
-    SignId symbol_sign = PLUS;
-    int count = 0;
-    if (symbol.second > 0) {
-      symbol_sign = PLUS;
-      count = symbol.second;
-    } else if (symbol.second < 0) {
-      symbol_sign = MINUS;
-      count = -symbol.second;
-    }
+  sort(external_counts.begin(), external_counts.end(),
+            [&symbol_table](const pair<StringPool::Id, int>& a,
+                            const pair<StringPool::Id, int>& b) {
+              return symbol_table.name(a.first) < symbol_table.name(b.first);
+            });
+  for (const auto& symbol : external_counts) {
+    SignId symbol_sign = (symbol.second > 0) ? PLUS : MINUS;
+    int count = (symbol.second > 0) ? symbol.second : -symbol.second;
+    string name = symbol_table.name(symbol.first).ToString();
     for (int i = 0; i < count; i++) {
-      external_symbols->push_back(ExternalSymbol(symbol_sign, symbol.first));
+      external_symbols->push_back(ExternalSymbol(symbol_sign, name));
     }
   }
   return true;
 }
 
+void ExpressionUtil::RemapNames(const vector<StringPool::Id>& name_map,
+                                Program* program) {
+  for (auto& operation : program->operations) {
+    if (IsSymbolOperation(operation.opcode)) {
+      assert(operation.operand < name_map.size());
+      operation.operand = name_map[operation.operand];
+    }
+  }
+}
+
+bool ExpressionUtil::Solve(const TokenList& expression, const SymbolTable& symbol_table,
+                           bool allow_external, int32* result, bool* relative,
+                           ExternalSymbolVector* external_symbols, ErrorDB* error_db) {
+  Program program;
+  Compile(expression, &program);
+  return Evaluate(program, symbol_table, allow_external, result, relative,
+                  external_symbols, error_db);
+}
+
 }  // namespace assembler
 }  // namespace sicxe
@@ -1,11 +1,10 @@
 #ifndef ASSEMBLER_EXPRESSION_UTIL_H
 #define ASSEMBLER_EXPRESSION_UTIL_H
 
-#include <list>
-#include <memory>
 #include <string>
 #include <vector>
 #include "common/macros.h"
+#include "common/string_pool.h"
 #include "common/types.h"
 
 namespace sicxe {
@@ -34,9 +33,57 @@ class ExpressionUtil {
   };
 
   typedef std::vector<ExternalSymbol> ExternalSymbolVector;
-  typedef std::list<std::unique_ptr<Token> > TokenList;
+  typedef std::vector<Token*> TokenList;
+
+  // Expression compiled into a flat list of operations in evaluation order.
+  // Operands are stored in the operations themselves, symbols by their name id,
+  // so evaluating does not walk the token list or look at token text again.
+  struct Program {
+    enum OpcodeId {
+      // term made of a single operand, added to or subtracted from the result
+      ADD_INTEGER = 0,
+      ADD_SYMBOL,
+      SUBTRACT_INTEGER,
+      SUBTRACT_SYMBOL,
+      // term made of '*' and '/' operations, computed in a separate register
+      LOAD_INTEGER,
+      LOAD_SYMBOL,
+      MULTIPLY_INTEGER,
+      MULTIPLY_SYMBOL,
+      DIVIDE_INTEGER,
+      DIVIDE_SYMBOL,
+      ADD_TERM,
+      SUBTRACT_TERM
+    };
+
+    struct Operation {
+      OpcodeId opcode;
+      uint32 operand;      // integer value or symbol name id
+      const Token* token;  // for error positions, nullptr for ADD_TERM and SUBTRACT_TERM
+    };
+
+    Program();
+
+    std::vector<Operation> operations;
+    // first and last token of the expression, nullptr if it is empty
+    const Token* first_token;
+    const Token* last_token;
+  };
+
+  // Translates the parsed |expression| into |program|. Symbols need not be
+  // defined yet, they are looked up by Evaluate.
+  static void Compile(const TokenList& expression, Program* program);
 
   // Assumes |error_db|'s current file is set correctly
+  static bool Evaluate(const Program& program, const SymbolTable& symbol_table,
+                       bool allow_external, int32* result, bool* relative,
+                       ExternalSymbolVector* external_symbols, ErrorDB* error_db);
+
+  // Replaces every symbol name id in |program| by its entry in |name_map|, for
+  // programs compiled against a different string pool.
+  static void RemapNames(const std::vector<StringPool::Id>& name_map, Program* program);
+
+  // Compiles and evaluates |expression|.
   static bool Solve(const TokenList& expression, const SymbolTable& symbol_table,
                     bool allow_external, int32* result, bool* relative,
                     ExternalSymbolVector* external_symbols, ErrorDB* error_db);
@@ -16,7 +16,9 @@ namespace assembler {
 LiteralTable::Entry::Entry(int the_id, TypeId the_type)
   : id(the_id), type(the_type) {}
 
-LiteralTable::LiteralTable() {}
+LiteralTable::LiteralTable() {
+  ClearLookupTables();
+}
 LiteralTable::~LiteralTable() {}
 
 string LiteralTable::LiteralSymbolName(int literal_id) {
@@ -33,16 +35,15 @@ const LiteralTable::Entry* LiteralTable::GetLiteral(int literal_id) const {
 }
 
 int LiteralTable::NewLiteralByte(uint8 value) {
-  auto it = byte_map_.find(value);
-  if (it != byte_map_.end()) {
-    return it->second->id;
+  if (byte_index_[value] != nullptr) {
+    return byte_index_[value]->id;
   }
 
   int id = entries_.size();
   entries_.emplace_back(new Entry(id, BYTE));
   Entry* entry = entries_.back().get();
   entry->value.byte = value;
-  byte_map_.insert(make_pair(value, entry));
+  byte_index_[value] = entry;
   return id;
 }
 
@@ -101,16 +102,43 @@ int LiteralTable::NewLiteralFloat(const std::string& data) {
 }
 
 void LiteralTable::ClearLookupTables() {
-  byte_map_.clear();
+  for (auto& entry : byte_index_) {
+    entry = nullptr;
+  }
   word_map_.clear();
   float_map_.clear();
 }
 
+void LiteralTable::ForgetLiteral(int literal_id) {
+  Entry* entry = entries_[literal_id].get();
+  switch (entry->type) {
+    case BYTE:
+      if (byte_index_[entry->value.byte] == entry) {
+        byte_index_[entry->value.byte] = nullptr;
+      }
+      break;
+    case WORD: {
+      auto it = word_map_.find(entry->value.word);
+      if (it != word_map_.end() && it->second == entry) {
+        word_map_.erase(it);
+      }
+      break;
+    }
+    case FLOAT: {
+      auto it = float_map_.find(entry->value.float_bin);
+      if (it != float_map_.end() && it->second == entry) {
+        float_map_.erase(it);
+      }
+      break;
+    }
+  }
+}
+
 void LiteralTable::OutputToTextFile(TextFile* file) const {
   size_t buffer_size = 200;
   unique_ptr<char[]> buffer(new char[buffer_size]);
   snprintf(buffer.get(), buffer_size, "%-20s %-5s %s", "LITERAL", "TYPE", "VALUE");
-  file->mutable_lines()->emplace_back(string(buffer.get()));
+  file->AppendLine(buffer.get());
   for (const auto& entry : entries_) {
     snprintf(buffer.get(), buffer_size, "*%-19d ", entry->id);
     string line(buffer.get());
@@ -135,7 +163,7 @@ void LiteralTable::OutputToTextFile(TextFile* file) const {
       assert(false);
     }
     line += string(buffer.get());
-    file->mutable_lines()->emplace_back(std::move(line));
+    file->AppendLine(line);
   }
 }
 
@@ -1,9 +1,9 @@
 #ifndef ASSEMBLER_LITERAL_TABLE_H
 #define ASSEMBLER_LITERAL_TABLE_H
 
-#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "common/macros.h"
 #include "common/types.h"
@@ -52,6 +52,9 @@ class LiteralTable {
 
   // Clears deduplication lookup tables - should be called when literals are emitted
   void ClearLookupTables();
+  // Removes one literal from the lookup tables, so the next literal with its
+  // value gets a new entry.
+  void ForgetLiteral(int literal_id);
 
   void OutputToTextFile(TextFile* file) const;
 
@@ -59,9 +62,9 @@ class LiteralTable {
 
  private:
   EntryVector entries_;
-  std::map<uint8, Entry*> byte_map_;
-  std::map<uint32, Entry*> word_map_;
-  std::map<uint64, Entry*> float_map_;
+  Entry* byte_index_[1 << 8];  // indexed by value
+  std::unordered_map<uint32, Entry*> word_map_;
+  std::unordered_map<uint64, Entry*> float_map_;
 };
 
 }  // namespace assembler
@@ -1,9 +1,11 @@
 #include "assembler/log_file_writer.h"
 
 #include <algorithm>
+#include "assembler/base_plan.h"
 #include "assembler/block_table.h"
 #include "assembler/code.h"
 #include "assembler/literal_table.h"
+#include "assembler/peephole_report.h"
 #include "assembler/symbol_table.h"
 #include "common/cpu_state.h"
 #include "common/instruction.h"
@@ -22,6 +24,10 @@ static const char* kBlockTableHeader =
     "********** BLOCKS ******************************************";
 static const char* kLiteralTableHeader =
     "********** LITERALS ****************************************";
+static const char* kBaseTableHeader =
+    "********** BASE ********************************************";
+static const char* kPeepholeHeader =
+    "********** PEEPHOLE ****************************************";
 static const char* kSymbolTableHeader =
     "********** SYMBOLS *****************************************";
 
@@ -41,15 +47,15 @@ LogFileWriter::~LogFileWriter() {}
 
 void LogFileWriter::Begin(const Code& code) {
   code_ = &code;
-  text_file_->mutable_lines()->emplace_back(kCodeHeader);
+  text_file_->AppendLine(kCodeHeader);
 }
 
 void LogFileWriter::WriteNode(const node::Node& node, uint32 address) {
   address_ = address;
   has_data_ = false;
   node.AcceptVisitor(this);
-  text_file_->mutable_lines()->emplace_back(std::move(line_));
-  line_ = string();
+  text_file_->AppendLine(line_);
+  line_.clear();
 }
 
 void LogFileWriter::WriteNode(const node::Node& node, uint32 address,
@@ -58,20 +64,28 @@ void LogFileWriter::WriteNode(const node::Node& node, uint32 address,
   has_data_ = true;
   data_ = &data;
   node.AcceptVisitor(this);
-  text_file_->mutable_lines()->emplace_back(std::move(line_));
-  line_ = string();
+  text_file_->AppendLine(line_);
+  line_.clear();
 }
 
 void LogFileWriter::WriteRelocationRecord(const RelocationRecord&) {}
 
 void LogFileWriter::End() {
-  text_file_->mutable_lines()->emplace_back(kBlockTableHeader);
+  text_file_->AppendLine(kBlockTableHeader);
   code_->block_table()->OutputToTextFile(text_file_);
   if (!code_->literal_table()->entries().empty()) {
-    text_file_->mutable_lines()->emplace_back(kLiteralTableHeader);
+    text_file_->AppendLine(kLiteralTableHeader);
     code_->literal_table()->OutputToTextFile(text_file_);
   }
-  text_file_->mutable_lines()->emplace_back(kSymbolTableHeader);
+  if (code_->base_plan() != nullptr) {
+    text_file_->AppendLine(kBaseTableHeader);
+    code_->base_plan()->OutputToTextFile(text_file_);
+  }
+  if (code_->peephole_report() != nullptr) {
+    text_file_->AppendLine(kPeepholeHeader);
+    code_->peephole_report()->OutputToTextFile(text_file_);
+  }
+  text_file_->AppendLine(kSymbolTableHeader);
   code_->symbol_table()->OutputToTextFile(code_->block_table(), text_file_);
 }
 
@@ -79,7 +93,7 @@ void LogFileWriter::VisitNode(const node::Empty* node) {
   LineWriteAddress();
   if (node->comment() != nullptr) {
     AddSpaces(kColumnCommentEmptyNode);
-    line_ += node->comment()->value();
+    line_ += node->comment()->value().ToString();
   }
 }
 
@@ -194,7 +208,7 @@ void LogFileWriter::VisitNode(const node::DirectiveUse* node) {
   LineWriteDirective(node);
   AddSpaces(kColumnOperands);
   if (node->block_name() != nullptr) {
-    line_ += node->block_name()->value();
+    line_ += node->block_name()->value().ToString();
   }
   LineWriteComment(node);
 }
@@ -304,7 +318,7 @@ void LogFileWriter::LineWriteInstruction(const node::Instruction* node, bool ext
   LineWriteAddress();
   LineWriteData();
   if (node->label() != nullptr) {
-    LineWriteLabel(node->label()->value());
+    LineWriteLabel(node->label()->value().ToString());
   }
   AddSpaces(kColumnMnemonic);
   string mnemonic;
@@ -324,7 +338,7 @@ void LogFileWriter::LineWriteDirective(const node::Directive* node) {
   LineWriteAddress();
   LineWriteData();
   if (node->label() != nullptr) {
-    LineWriteLabel(node->label()->value());
+    LineWriteLabel(node->label()->value().ToString());
   }
   AddSpaces(kColumnMnemonic);
   const char* mnemonic_str = nullptr;
@@ -386,7 +400,7 @@ void LogFileWriter::LineWriteExpression(const node::Node::TokenList& expression)
     } else {
       line_ += " ";
     }
-    line_ += token->value();
+    line_ += token->value().ToString();
   }
 }
 
@@ -398,7 +412,7 @@ void LogFileWriter::LineWriteSymbolList(const node::Node::TokenList& symbols) {
     } else {
       line_ += ", ";
     }
-    line_ += token->value();
+    line_ += token->value().ToString();
   }
 }
 
@@ -420,11 +434,23 @@ void LogFileWriter::LineWriteDataLiteral(const std::string& data) {
 }
 
 void LogFileWriter::LineWriteComment(const node::Node* node) {
-  if (node->comment() != nullptr) {
+  const string* note = nullptr;
+  if (code_->peephole_report() != nullptr) {
+    note = code_->peephole_report()->FindNote(node);
+  }
+  if (node->comment() != nullptr || note != nullptr) {
     size_t column = std::max(line_.size() + kCommentMinSpace, kColumnComment);
     column = ((column + kCommentRoundTo - 1) / kCommentRoundTo) * kCommentRoundTo;
     AddSpaces(column);
-    line_ += node->comment()->value();
+  }
+  if (node->comment() != nullptr) {
+    line_ += node->comment()->value().ToString();
+  }
+  if (note != nullptr) {
+    if (node->comment() != nullptr) {
+      line_ += "  ";
+    }
+    line_ += ". peephole: " + *note;
   }
 }
 
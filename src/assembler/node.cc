@@ -7,7 +7,8 @@ namespace assembler {
 namespace node {
 
 // Node implementation
-Node::Node(NodeKind the_kind) : kind_(the_kind) {}
+Node::Node(NodeKind the_kind)
+    : kind_(the_kind), label_(nullptr), comment_(nullptr) {}
 Node::~Node() {}
 
 Node::NodeKind Node::kind() const {
@@ -15,19 +16,23 @@ Node::NodeKind Node::kind() const {
 }
 
 const Token* Node::label() const {
-  return label_.get();
+  return label_;
+}
+
+Token* Node::mutable_label() {
+  return label_;
 }
 
 void Node::set_label(Token* the_label) {
-  label_.reset(the_label);
+  label_ = the_label;
 }
 
 const Token* Node::comment() const {
-  return comment_.get();
+  return comment_;
 }
 
 void Node::set_comment(Token* the_comment) {
-  comment_.reset(the_comment);
+  comment_ = the_comment;
 }
 
 // Empty implementation
@@ -49,7 +54,8 @@ void Empty::AcceptVisitor(ConstNodeVisitor* visitor) const {
 
 // Instruction implementation
 Instruction::Instruction(NodeKind the_kind, Format::FormatId the_format)
-    : Node(the_kind), format_(the_format), opcode_(0), syntax_(Syntax::F1_NONE) {}
+    : Node(the_kind), format_(the_format), opcode_(0), syntax_(Syntax::F1_NONE),
+      mnemonic_(nullptr) {}
 Instruction::~Instruction() {}
 
 bool Instruction::ClassOf(const Node* node) {
@@ -77,11 +83,11 @@ void Instruction::set_syntax(Syntax::SyntaxId id) {
 }
 
 const Token* Instruction::mnemonic() const {
-  return mnemonic_.get();
+  return mnemonic_;
 }
 
 void Instruction::set_mnemonic(Token* the_mnemonic) {
-  mnemonic_.reset(the_mnemonic);
+  mnemonic_ = the_mnemonic;
 }
 
 // InstructionF1 implementation
@@ -135,8 +141,8 @@ void InstructionF2::set_r2(uint8 value) {
 
 // InstructionFS34 implementation
 InstructionFS34::InstructionFS34()
-    : Instruction(NK_InstructionFS34, Format::FS34), addressing_(SIMPLE),
-      extended_(false), indexed_(false), literal_id_(-1) {}
+    : Instruction(NK_InstructionFS34, Format::FS34), data_token_(nullptr),
+      addressing_(SIMPLE), extended_(false), indexed_(false), literal_id_(-1) {}
 InstructionFS34::~InstructionFS34() {}
 
 bool InstructionFS34::ClassOf(const Node* node) {
@@ -159,12 +165,20 @@ Node::TokenList* InstructionFS34::mutable_expression() {
   return &expression_;
 }
 
+const ExpressionUtil::Program& InstructionFS34::compiled_expression() const {
+  return compiled_expression_;
+}
+
+ExpressionUtil::Program* InstructionFS34::mutable_compiled_expression() {
+  return &compiled_expression_;
+}
+
 const Token* InstructionFS34::data_token() const {
-  return data_token_.get();
+  return data_token_;
 }
 
 void InstructionFS34::set_data_token(Token* the_data_token) {
-  data_token_.reset(the_data_token);
+  data_token_ = the_data_token;
 }
 
 InstructionFS34::AddressingId InstructionFS34::addressing() const {
@@ -201,7 +215,7 @@ void InstructionFS34::set_literal_id(int the_literal_id) {
 
 // Directive implementation
 Directive::Directive(NodeKind the_kind, DirectiveId the_id)
-    : Node(the_kind), directive_id_(the_id) {}
+    : Node(the_kind), directive_id_(the_id), mnemonic_(nullptr) {}
 Directive::~Directive() {}
 
 bool Directive::ClassOf(const Node* node) {
@@ -213,11 +227,11 @@ Directive::DirectiveId Directive::directive_id() const {
 }
 
 const Token* Directive::mnemonic() const {
-  return mnemonic_.get();
+  return mnemonic_;
 }
 
 void Directive::set_mnemonic(Token* the_mnemonic) {
-  mnemonic_.reset(the_mnemonic);
+  mnemonic_ = the_mnemonic;
 }
 
 // ExpressionDirective implementation
@@ -238,6 +252,14 @@ Node::TokenList* ExpressionDirective::mutable_expression() {
   return &expression_;
 }
 
+const ExpressionUtil::Program& ExpressionDirective::compiled_expression() const {
+  return compiled_expression_;
+}
+
+ExpressionUtil::Program* ExpressionDirective::mutable_compiled_expression() {
+  return &compiled_expression_;
+}
+
 // SymbolListDirective implementation
 SymbolListDirective::SymbolListDirective(NodeKind the_kind, DirectiveId the_id)
     : Directive(the_kind, the_id) {}
@@ -343,7 +365,8 @@ void DirectiveEqu::set_assign_current_address(bool value) {
 
 // DirectiveUse implementation
 DirectiveUse::DirectiveUse()
-    : Directive(NK_DirectiveUse, assembler::Directive::USE), block_id_(-1) {}
+    : Directive(NK_DirectiveUse, assembler::Directive::USE), block_id_(-1),
+      block_name_(nullptr) {}
 DirectiveUse::~DirectiveUse() {}
 
 bool DirectiveUse::ClassOf(const Node* node) {
@@ -367,11 +390,11 @@ void DirectiveUse::set_block_id(int id) {
 }
 
 const Token* DirectiveUse::block_name() const {
-  return block_name_.get();
+  return block_name_;
 }
 
 void DirectiveUse::set_block_name(Token* the_block_name) {
-  block_name_.reset(the_block_name);
+  block_name_ = the_block_name;
 }
 
 // DirectiveLtorg implementation
@@ -410,7 +433,7 @@ void DirectiveBase::AcceptVisitor(ConstNodeVisitor* visitor) const {
 
 // DirectiveNobase implementation
 DirectiveNobase::DirectiveNobase()
-    : Directive(NK_DirectiveBase, assembler::Directive::NOBASE) {}
+    : Directive(NK_DirectiveNobase, assembler::Directive::NOBASE) {}
 DirectiveNobase::~DirectiveNobase() {}
 
 bool DirectiveNobase::ClassOf(const Node* node) {
@@ -463,7 +486,7 @@ void DirectiveExtref::AcceptVisitor(ConstNodeVisitor* visitor) const {
 DirectiveMemInit::DirectiveMemInit(WidthId the_width)
     : ExpressionDirective(NK_DirectiveMemInit,
         (the_width == WORD) ? assembler::Directive::WORD : assembler::Directive::BYTE),
-      width_(the_width) {}
+      width_(the_width), data_token_(nullptr) {}
 DirectiveMemInit::~DirectiveMemInit() {}
 
 bool DirectiveMemInit::ClassOf(const Node* node) {
@@ -483,11 +506,11 @@ DirectiveMemInit::WidthId DirectiveMemInit::width() const {
 }
 
 const Token* DirectiveMemInit::data_token() const {
-  return data_token_.get();
+  return data_token_;
 }
 
 void DirectiveMemInit::set_data_token(Token* the_data_token) {
-  data_token_.reset(the_data_token);
+  data_token_ = the_data_token;
 }
 
 // DirectiveMemReserve implementation
@@ -1,9 +1,9 @@
 #ifndef ASSEMBLER_NODE_H
 #define ASSEMBLER_NODE_H
 
-#include <list>
-#include <memory>
+#include <vector>
 #include "assembler/directive.h"
+#include "assembler/expression_util.h"
 #include "assembler/token.h"
 #include "common/format.h"
 #include "common/macros.h"
@@ -78,7 +78,8 @@ class Node {
     NK_Node_Last
   };
 
-  typedef std::list<std::unique_ptr<Token> > TokenList;
+  // tokens are owned by the arena of the code, see Code::arena()
+  typedef std::vector<Token*> TokenList;
 
   Node(NodeKind the_kind);
   virtual ~Node();
@@ -88,14 +89,15 @@ class Node {
 
   NodeKind kind() const;
   const Token* label() const;
+  Token* mutable_label();
   void set_label(Token* the_label);
   const Token* comment() const;
   void set_comment(Token* the_comment);
 
  private:
   const NodeKind kind_;
-  std::unique_ptr<Token> label_;
-  std::unique_ptr<Token> comment_;
+  Token* label_;
+  Token* comment_;
 };
 
 // Empty node (blank line)
@@ -131,7 +133,7 @@ class Instruction : public Node {
   const Format::FormatId format_;
   uint8 opcode_;
   Syntax::SyntaxId syntax_;
-  std::unique_ptr<Token> mnemonic_;
+  Token* mnemonic_;
 };
 
 // Instruction nodes
@@ -182,6 +184,9 @@ class InstructionFS34 : public Instruction {
 
   const TokenList& expression() const;
   TokenList* mutable_expression();
+  // |expression| compiled by the parser, used for evaluation
+  const ExpressionUtil::Program& compiled_expression() const;
+  ExpressionUtil::Program* mutable_compiled_expression();
   const Token* data_token() const;
   void set_data_token(Token* the_data_token);
   AddressingId addressing() const;
@@ -195,7 +200,8 @@ class InstructionFS34 : public Instruction {
 
  private:
   TokenList expression_;
-  std::unique_ptr<Token> data_token_;
+  ExpressionUtil::Program compiled_expression_;
+  Token* data_token_;
   AddressingId addressing_;
   bool extended_;
   bool indexed_;
@@ -220,7 +226,7 @@ class Directive : public Node {
 
  private:
   const DirectiveId directive_id_;
-  std::unique_ptr<Token> mnemonic_;
+  Token* mnemonic_;
 };
 
 // Abstract nodes for types of similar directives
@@ -235,9 +241,13 @@ class ExpressionDirective : public Directive {
 
   const TokenList& expression() const;
   TokenList* mutable_expression();
+  // |expression| compiled by the parser, used for evaluation
+  const ExpressionUtil::Program& compiled_expression() const;
+  ExpressionUtil::Program* mutable_compiled_expression();
 
  private:
   TokenList expression_;
+  ExpressionUtil::Program compiled_expression_;
 };
 
 class SymbolListDirective : public Directive {
@@ -325,7 +335,7 @@ class DirectiveUse : public Directive {
 
  private:
   int block_id_;
-  std::unique_ptr<Token> block_name_;
+  Token* block_name_;
 };
 
 class DirectiveLtorg : public Directive {
@@ -399,7 +409,7 @@ class DirectiveMemInit : public ExpressionDirective {
 
  private:
   WidthId width_;
-  std::unique_ptr<Token> data_token_;
+  Token* data_token_;
 };
 
 // directives RESB and RESW
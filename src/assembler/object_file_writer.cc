@@ -2,16 +2,16 @@
 
 #include <string.h>
 #include <algorithm>
+#include <string>
 #include "assembler/code.h"
 #include "assembler/symbol_table.h"
-
-using std::unique_ptr;
+#include "common/object_file.h"
 
 namespace sicxe {
 namespace assembler {
 
-ObjectFileWriter::ObjectFileWriter(ObjectFile* object_file)
-    : code_(nullptr), object_file_(object_file),
+ObjectFileWriter::ObjectFileWriter(ObjectFileStream* stream)
+    : code_(nullptr), stream_(stream),
       text_buffer_(new uint8[ObjectFile::kMaxTextSectionSize]), text_address_(0),
       text_position_(0), text_next_address_(0) {}
 
@@ -19,18 +19,23 @@ ObjectFileWriter::~ObjectFileWriter() {}
 
 void ObjectFileWriter::Begin(const Code& code) {
   code_ = &code;
+  assert(code_->program_name().size() <= 6);
+  stream_->BeginRecord('H');
+  stream_->AppendName(code_->program_name());
+  stream_->AppendHex(code_->start_address() & 0xfffff, 6);
+  stream_->AppendHex((code_->end_address() - code_->start_address()) & 0xfffff, 6);
+  stream_->EndRecord();
 }
 
 void ObjectFileWriter::WriteNode(const node::Node&, uint32) {}
 
 void ObjectFileWriter::CommitTextSection() {
   if (text_position_ > 0) {
-    unique_ptr<ObjectFile::TextSection> section(new ObjectFile::TextSection);
-    section->address = text_address_;
-    section->size = text_position_;
-    section->data.reset(new uint8[text_position_]);
-    memcpy(section->data.get(), text_buffer_.get(), text_position_);
-    object_file_->mutable_text_sections()->emplace_back(std::move(section));
+    stream_->BeginRecord('T');
+    stream_->AppendHex(text_address_ & 0xffffff, 6);
+    stream_->AppendHex(text_position_, 2);
+    stream_->AppendHexBytes(text_buffer_.get(), text_position_);
+    stream_->EndRecord();
     text_position_ = 0;
     text_address_ = text_next_address_;
   }
@@ -70,54 +75,65 @@ void ObjectFileWriter::WriteNode(const node::Node&, uint32 address,
 }
 
 void ObjectFileWriter::WriteRelocationRecord(const RelocationRecord& record) {
-  unique_ptr<ObjectFile::RelocationSection> section(new ObjectFile::RelocationSection);
-  section->address = record.address;
-  section->nibbles = record.nibbles;
-  section->type = (record.type == RelocationRecord::SYMBOL);
+  relocation_records_.BeginRecord('M');
+  relocation_records_.AppendHex(record.address, 6);
+  relocation_records_.AppendHex(record.nibbles, 2);
   if (record.type == RelocationRecord::SYMBOL) {
-    section->sign = record.sign;
-    section->symbol_name = record.symbol_name;
+    assert(record.symbol_name.size() <= 6);
+    relocation_records_.AppendChar(record.sign ? '+' : '-');
+    relocation_records_.AppendName(record.symbol_name);
   }
-  object_file_->mutable_relocation_sections()->emplace_back(std::move(section));
+  relocation_records_.EndRecord();
 }
 
 void ObjectFileWriter::End() {
   CommitTextSection();
-  object_file_->set_program_name(code_->program_name());
-  object_file_->set_start_address(code_->start_address());
-  object_file_->set_code_size(code_->end_address() - code_->start_address());
-  object_file_->set_entry_point(code_->entry_point());
+  WriteSymbolRecords();
+  stream_->AppendStream(relocation_records_);
+  stream_->BeginRecord('E');
+  stream_->AppendHex(code_->entry_point() & 0xfffff, 6);
+  stream_->EndRecord();
+}
 
-  unique_ptr<ObjectFile::SymbolImportSection> import_section;
-  unique_ptr<ObjectFile::SymbolExportSection> export_section;
-  for (const auto& entry_pair : code_->symbol_table()->entry_map()) {
-    const SymbolTable::Entry& entry = entry_pair.second;
-    if (entry.type == SymbolTable::EXTERNAL &&
-        entry.referenced) {
-      if (import_section.get() == nullptr) {
-        import_section.reset(new ObjectFile::SymbolImportSection);
-      }
-      import_section->symbols.push_back(entry_pair.first);
-      if (static_cast<int>(import_section->symbols.size()) >=
-          ObjectFile::kMaxSymbolsPerImportSection) {
-        object_file_->mutable_import_sections()->emplace_back(std::move(import_section));
-      }
-    } else if (entry.type == SymbolTable::INTERNAL && entry.exported) {
-      if (export_section.get() == nullptr) {
-        export_section.reset(new ObjectFile::SymbolExportSection);
-      }
-      export_section->symbols.push_back(make_pair(entry_pair.first, entry.address));
-      if (static_cast<int>(export_section->symbols.size()) >=
-          ObjectFile::kMaxSymbolsPerExportSection) {
-        object_file_->mutable_export_sections()->emplace_back(std::move(export_section));
+void ObjectFileWriter::WriteSymbolRecords() {
+  // symbols are written sorted by name, all exports before all imports
+  const SymbolTable* symbol_table = code_->symbol_table();
+  SymbolTable::IdList export_ids;
+  SymbolTable::IdList import_ids;
+  for (StringPool::Id name_id : symbol_table->ids()) {
+    const SymbolTable::Entry* entry = symbol_table->Find(name_id);
+    if (entry->type == SymbolTable::EXTERNAL && entry->referenced) {
+      import_ids.push_back(name_id);
+    } else if (entry->type == SymbolTable::INTERNAL && entry->exported) {
+      export_ids.push_back(name_id);
+    }
+  }
+  symbol_table->SortByName(&export_ids);
+  symbol_table->SortByName(&import_ids);
+  for (size_t i = 0; i < export_ids.size(); i++) {
+    if (i % ObjectFile::kMaxSymbolsPerExportSection == 0) {
+      if (i > 0) {
+        stream_->EndRecord();
       }
+      stream_->BeginRecord('D');
     }
+    stream_->AppendName(symbol_table->name(export_ids[i]));
+    stream_->AppendHex(symbol_table->Find(export_ids[i])->address & 0xfffff, 6);
+  }
+  if (!export_ids.empty()) {
+    stream_->EndRecord();
   }
-  if (import_section.get() != nullptr) {
-    object_file_->mutable_import_sections()->emplace_back(std::move(import_section));
+  for (size_t i = 0; i < import_ids.size(); i++) {
+    if (i % ObjectFile::kMaxSymbolsPerImportSection == 0) {
+      if (i > 0) {
+        stream_->EndRecord();
+      }
+      stream_->BeginRecord('R');
+    }
+    stream_->AppendName(symbol_table->name(import_ids[i]));
   }
-  if (export_section.get() != nullptr) {
-    object_file_->mutable_export_sections()->emplace_back(std::move(export_section));
+  if (!import_ids.empty()) {
+    stream_->EndRecord();
   }
 }
 
@@ -5,7 +5,7 @@
 #include <memory>
 #include "assembler/code_generator.h"
 #include "common/macros.h"
-#include "common/object_file.h"
+#include "common/object_file_stream.h"
 
 namespace sicxe {
 
@@ -13,11 +13,14 @@ namespace assembler {
 
 class Code;
 
+// Encodes the object file while code is generated. Text records go to the
+// stream as soon as they are complete, only the relocation records are kept
+// until the end, because they follow the symbol records.
 class ObjectFileWriter : public CodeOutputWriter {
  public:
   DISALLOW_COPY_AND_MOVE(ObjectFileWriter);
 
-  explicit ObjectFileWriter(ObjectFile* object_file);
+  explicit ObjectFileWriter(ObjectFileStream* stream);
   ~ObjectFileWriter();
 
  private:
@@ -29,9 +32,11 @@ class ObjectFileWriter : public CodeOutputWriter {
   virtual void End();
 
   void CommitTextSection();
+  void WriteSymbolRecords();
 
   const Code* code_;
-  ObjectFile* object_file_;
+  ObjectFileStream* stream_;
+  ObjectFileStream relocation_records_;  // in memory
   std::unique_ptr<uint8[]> text_buffer_;
   uint32 text_address_;
   int text_position_;
@@ -1,102 +1,225 @@
 #include "assembler/parser.h"
 
 #include <assert.h>
+#include <memory>
+#include <vector>
 #include "assembler/code.h"
 #include "assembler/directive.h"
+#include "assembler/expression_util.h"
 #include "assembler/tokenizer.h"
+#include "common/arena.h"
 #include "common/cpu_state.h"
 #include "common/error_db.h"
 #include "common/instruction.h"
 #include "common/instruction_db.h"
+#include "common/parallel_util.h"
+#include "common/string_pool.h"
 #include "common/text_file.h"
 
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 namespace sicxe {
 namespace assembler {
 
 Parser::Config::Config()
-    : instruction_db(nullptr), case_sensitive(false), allow_brackets(true) {}
+    : instruction_db(nullptr), case_sensitive(false), allow_brackets(true),
+      thread_count(1) {}
+
+// Range of lines that is parsed on its own thread. The lines of a chunk are
+// tokenized with their own arena, string pool and error database, which are
+// merged into the code in order once all chunks are parsed.
+struct Parser::Chunk {
+  DISALLOW_COPY_AND_MOVE(Chunk);
+
+  Chunk(size_t the_begin, size_t the_end, Arena* the_arena, StringPool* the_names);
+
+  size_t begin;
+  size_t end;
+  Arena* arena;
+  StringPool* names;
+  unique_ptr<Arena> own_arena;
+  unique_ptr<StringPool> own_names;
+  ErrorDB error_db;
+  NodeList nodes;  // one per line, nullptr if the line has errors
+  TokenList tokens;  // tokens allocated from |own_arena|
+};
+
+Parser::Chunk::Chunk(size_t the_begin, size_t the_end, Arena* the_arena,
+                     StringPool* the_names)
+    : begin(the_begin), end(the_end), arena(the_arena), names(the_names) {
+  if (arena == nullptr) {
+    own_arena.reset(new Arena);
+    arena = own_arena.get();
+  }
+  if (names == nullptr) {
+    own_names.reset(new StringPool);
+    names = own_names.get();
+  }
+}
+
+namespace {
+
+// Smaller files are not worth the cost of starting threads and merging.
+const size_t kMinChunkLineCount = 16384;
+
+}  // namespace
 
 Parser::Parser(const Config* config)
-  : config_(config), code_(nullptr), error_db_(nullptr), extended_(false),
-    visit_success_(false) {}
+  : config_(config), arena_(nullptr), error_db_(nullptr), tokenizer_(nullptr),
+    next_token_(0),
+    node_(nullptr), extended_(false), visit_success_(false) {}
 Parser::~Parser() {}
 
 bool Parser::ParseFile(const TextFile& file, Code* code, ErrorDB* error_db) {
-  code_ = code;
-  error_db_ = error_db;
-  code_->set_text_file(&file);
-  error_db_->SetCurrentFile(&file);
+  code->set_text_file(&file);
+  error_db->SetCurrentFile(&file);
+
+  size_t line_count = file.line_count();
+  size_t chunk_count = (config_->thread_count > 1) ? config_->thread_count : 1;
+  size_t max_chunk_count = line_count / kMinChunkLineCount;
+  if (chunk_count > max_chunk_count) {
+    chunk_count = (max_chunk_count > 0) ? max_chunk_count : 1;
+  }
+  vector<unique_ptr<Chunk>> chunks;
+  if (chunk_count == 1) {
+    chunks.emplace_back(new Chunk(0, line_count, code->arena(), code->names()));
+    ParseChunk(file, chunks[0].get());
+  } else {
+    for (size_t i = 0; i < chunk_count; i++) {
+      chunks.emplace_back(new Chunk(line_count * i / chunk_count,
+                                    line_count * (i + 1) / chunk_count, nullptr, nullptr));
+    }
+    ParallelUtil::ForEachIndex(chunk_count, chunk_count, [this, &file, &chunks](size_t index) {
+      if (index == 0) {
+        ParseChunk(file, chunks[0].get());
+      } else {
+        Parser parser(config_);
+        parser.ParseChunk(file, chunks[index].get());
+      }
+    });
+    // names are interned in chunk order, so ids match a sequential parse
+    for (auto& chunk : chunks) {
+      MergeChunk(chunk.get(), code);
+    }
+  }
 
-  Tokenizer tokenizer;
-  size_t line_count = file.lines().size();
   bool success = true;
   bool seen_start = false;
   bool seen_end = false;
   const Token* last_mnemonic_token = nullptr;
-  for (size_t i = 0; i < line_count; i++) {
-    tokens_.clear();
-    if (!tokenizer.TokenizeLine(file, i, &tokens_, error_db_)) {
-      success = false;
-      continue;
-    }
-    if (!ParseLine()) {
-      success = false;
-      continue;
-    }
+  for (const auto& chunk : chunks) {
+    for (node::Node* node : chunk->nodes) {
+      if (node == nullptr) {
+        success = false;
+        continue;
+      }
 
-    if (isa<node::Directive>(*node_)) {
-      last_mnemonic_token = cast<node::Directive>(*node_).mnemonic();
-    } else if (isa<node::Instruction>(*node_)) {
-      last_mnemonic_token = cast<node::Instruction>(*node_).mnemonic();
-    }
+      if (isa<node::Directive>(*node)) {
+        last_mnemonic_token = cast<node::Directive>(*node).mnemonic();
+      } else if (isa<node::Instruction>(*node)) {
+        last_mnemonic_token = cast<node::Instruction>(*node).mnemonic();
+      }
 
-    if (success) {
-      if (!seen_start) {
-        if (isa<node::DirectiveStart>(*node_)) {
-          seen_start = true;
-        } else if (!isa<node::Empty>(*node_)) {
+      if (success) {
+        if (!seen_start) {
+          if (isa<node::DirectiveStart>(*node)) {
+            seen_start = true;
+          } else if (!isa<node::Empty>(*node)) {
+            success = false;
+            error_db->AddError(ErrorDB::ERROR, "code must begin with START directive",
+                               last_mnemonic_token->pos());
+          }
+        } else if (isa<node::DirectiveStart>(*node)) {
           success = false;
-          error_db_->AddError(ErrorDB::ERROR, "code must begin with START directive",
-                              last_mnemonic_token->pos());
+          error_db->AddError(ErrorDB::ERROR, "only one START directive allowed",
+                             last_mnemonic_token->pos());
         }
-      } else if (isa<node::DirectiveStart>(*node_)) {
-        success = false;
-        error_db_->AddError(ErrorDB::ERROR, "only one START directive allowed",
-                            last_mnemonic_token->pos());
-      }
-      if (!seen_end) {
-        if (isa<node::DirectiveEnd>(*node_)) {
-          seen_end = true;
-        }
-      } else {
-        if (!isa<node::Empty>(*node_)) {
-          success = false;
-          error_db_->AddError(ErrorDB::ERROR, "no code allowed after END directive",
-                              last_mnemonic_token->pos());
+        if (!seen_end) {
+          if (isa<node::DirectiveEnd>(*node)) {
+            seen_end = true;
+          }
+        } else {
+          if (!isa<node::Empty>(*node)) {
+            success = false;
+            error_db->AddError(ErrorDB::ERROR, "no code allowed after END directive",
+                               last_mnemonic_token->pos());
+          }
         }
       }
+      code->mutable_nodes()->push_back(node);
     }
-    code_->mutable_nodes()->emplace_back(std::move(node_));
-    node_ = unique_ptr<node::Node>();
+  }
+  // Lines with errors stop the checks above, so their errors come after the
+  // check error as in a line by line pass.
+  for (auto& chunk : chunks) {
+    error_db->Append(&chunk->error_db);
   }
   if (!success) {
     return false;
   }
   if (!seen_start) {
-    error_db_->AddError(ErrorDB::ERROR, "file contains no code");
+    error_db->AddError(ErrorDB::ERROR, "file contains no code");
     return false;
   }
   if (!seen_end) {
-    error_db_->AddError(ErrorDB::ERROR, "code must end with END directive",
-                        last_mnemonic_token->pos());
+    error_db->AddError(ErrorDB::ERROR, "code must end with END directive",
+                       last_mnemonic_token->pos());
     return false;
   }
   return true;
 }
 
+void Parser::ParseChunk(const TextFile& file, Chunk* chunk) {
+  arena_ = chunk->arena;
+  error_db_ = &chunk->error_db;
+  error_db_->SetCurrentFile(&file);
+  Tokenizer tokenizer(chunk->arena, chunk->names);
+  if (chunk->own_names != nullptr) {
+    tokenizer.set_allocated_tokens(&chunk->tokens);
+  }
+  tokenizer_ = &tokenizer;
+  chunk->nodes.reserve(chunk->end - chunk->begin);
+  for (size_t i = chunk->begin; i < chunk->end; i++) {
+    tokens_.clear();
+    next_token_ = 0;
+    if (!tokenizer_->TokenizeLine(file, i, &tokens_, error_db_) || !ParseLine()) {
+      chunk->nodes.push_back(nullptr);
+      continue;
+    }
+    chunk->nodes.push_back(node_);
+    node_ = nullptr;
+  }
+  tokenizer_ = nullptr;
+}
+
+void Parser::MergeChunk(Chunk* chunk, Code* code) {
+  assert(chunk->own_arena != nullptr && chunk->own_names != nullptr);
+  vector<StringPool::Id> name_map(chunk->names->size());
+  for (StringPool::Id id = 0; id < name_map.size(); id++) {
+    name_map[id] = code->names()->Intern(chunk->names->Get(id));
+  }
+  for (Token* token : chunk->tokens) {
+    if (token->type() == Token::NAME && token->name_id() != StringPool::kInvalidId) {
+      token->set_name_id(name_map[token->name_id()]);
+    }
+  }
+  for (node::Node* node : chunk->nodes) {
+    if (node == nullptr) {
+      continue;
+    }
+    if (isa<node::InstructionFS34>(*node)) {
+      ExpressionUtil::RemapNames(
+          name_map, cast<node::InstructionFS34>(*node).mutable_compiled_expression());
+    } else if (isa<node::ExpressionDirective>(*node)) {
+      ExpressionUtil::RemapNames(
+          name_map, cast<node::ExpressionDirective>(*node).mutable_compiled_expression());
+    }
+  }
+  code->arena()->Absorb(chunk->arena);
+}
+
 namespace {
 
 string StringToUppercase(const string& str) {
@@ -109,50 +232,50 @@ string StringToUppercase(const string& str) {
   return r;
 }
 
-node::Directive* CreateDirectiveNode(Directive::DirectiveId directive_id) {
+node::Directive* CreateDirectiveNode(Directive::DirectiveId directive_id, Arena* arena) {
   switch (directive_id) {
     case Directive::START:
-      return new node::DirectiveStart;
+      return arena->New<node::DirectiveStart>();
     case Directive::END:
-      return new node::DirectiveEnd;
+      return arena->New<node::DirectiveEnd>();
     case Directive::ORG:
-      return new node::DirectiveOrg;
+      return arena->New<node::DirectiveOrg>();
     case Directive::EQU:
-      return new node::DirectiveEqu;
+      return arena->New<node::DirectiveEqu>();
     case Directive::USE:
-      return new node::DirectiveUse;
+      return arena->New<node::DirectiveUse>();
     case Directive::LTORG:
-      return new node::DirectiveLtorg;
+      return arena->New<node::DirectiveLtorg>();
     case Directive::BASE:
-      return new node::DirectiveBase;
+      return arena->New<node::DirectiveBase>();
     case Directive::NOBASE:
-      return new node::DirectiveNobase;
+      return arena->New<node::DirectiveNobase>();
     case Directive::EXTDEF:
-      return new node::DirectiveExtdef;
+      return arena->New<node::DirectiveExtdef>();
     case Directive::EXTREF:
-      return new node::DirectiveExtref;
+      return arena->New<node::DirectiveExtref>();
     case Directive::BYTE:
-      return new node::DirectiveMemInit(node::DirectiveMemInit::BYTE);
+      return arena->New<node::DirectiveMemInit>(node::DirectiveMemInit::BYTE);
     case Directive::WORD:
-      return new node::DirectiveMemInit(node::DirectiveMemInit::WORD);
+      return arena->New<node::DirectiveMemInit>(node::DirectiveMemInit::WORD);
     case Directive::RESB:
-      return new node::DirectiveMemReserve(node::DirectiveMemReserve::BYTE);
+      return arena->New<node::DirectiveMemReserve>(node::DirectiveMemReserve::BYTE);
     case Directive::RESW:
-      return new node::DirectiveMemReserve(node::DirectiveMemReserve::WORD);
+      return arena->New<node::DirectiveMemReserve>(node::DirectiveMemReserve::WORD);
     default:
       assert(false);
   }
   return nullptr;
 }
 
-node::Instruction* CreateInstructionNode(Format::FormatId format_id) {
+node::Instruction* CreateInstructionNode(Format::FormatId format_id, Arena* arena) {
   switch (format_id) {
     case Format::F1:
-      return new node::InstructionF1;
+      return arena->New<node::InstructionF1>();
     case Format::F2:
-      return new node::InstructionF2;
+      return arena->New<node::InstructionF2>();
     case Format::FS34:
-      return new node::InstructionFS34;
+      return arena->New<node::InstructionFS34>();
     default:
       assert(false);
   }
@@ -162,41 +285,41 @@ node::Instruction* CreateInstructionNode(Format::FormatId format_id) {
 }  // namespace
 
 bool Parser::ParseLine() {
-  unique_ptr<Token> label, comment, extended_plus, mnemonic;
+  Token* label = nullptr;
+  Token* comment = nullptr;
+  Token* extended_plus = nullptr;
+  Token* mnemonic = nullptr;
   extended_ = false;
 
-  if (!tokens_.empty() && tokens_.back()->type() == Token::COMMENT) {
-    comment = std::move(tokens_.back());
+  if (!NoTokens() && BackToken()->type() == Token::COMMENT) {
+    comment = BackToken();
     tokens_.pop_back();
   }
 
-  if (tokens_.empty()) {
-    node_.reset(new node::Empty);
+  if (NoTokens()) {
+    node_ = arena_->New<node::Empty>();
   } else {
-    if (tokens_.front()->type() == Token::NAME && tokens_.front()->pos().column == 0) {
-      label = std::move(tokens_.front());
-      tokens_.pop_front();
-      if (tokens_.empty()) {
+    if (FrontToken()->type() == Token::NAME && FrontToken()->pos().column == 0) {
+      label = TakeToken();
+      if (NoTokens()) {
         EndOfLineError(*label);
         return false;
       }
     }
-    if (tokens_.front()->type() == Token::OPERATOR &&
-        tokens_.front()->operator_id() == Token::OP_ADD) {
-      extended_plus = std::move(tokens_.front());
-      tokens_.pop_front();
+    if (FrontToken()->type() == Token::OPERATOR &&
+        FrontToken()->operator_id() == Token::OP_ADD) {
+      extended_plus = TakeToken();
       extended_ = true;
-      if (tokens_.empty()) {
+      if (NoTokens()) {
         EndOfLineError(*extended_plus);
         return false;
       }
     }
-    if (tokens_.front()->type() != Token::NAME) {
-      error_db_->AddError(ErrorDB::ERROR, "expected mnemonic", tokens_.front()->pos());
+    if (FrontToken()->type() != Token::NAME) {
+      error_db_->AddError(ErrorDB::ERROR, "expected mnemonic", FrontToken()->pos());
       return false;
     }
-    mnemonic = std::move(tokens_.front());
-    tokens_.pop_front();
+    mnemonic = TakeToken();
     if (extended_ && (mnemonic->pos().column - extended_plus->pos().column) != 1) {
       error_db_->AddError(ErrorDB::ERROR, "whitespace between '+' and mnemonic",
                           extended_plus->pos(), mnemonic->pos());
@@ -205,9 +328,9 @@ bool Parser::ParseLine() {
 
     string mnemonic_str;
     if (config_->case_sensitive) {
-      mnemonic_str = mnemonic->value();
+      mnemonic_str = mnemonic->value().ToString();
     } else {
-      mnemonic_str = StringToUppercase(mnemonic->value());
+      mnemonic_str = StringToUppercase(mnemonic->value().ToString());
     }
 
     Directive::DirectiveId directive_id = Directive::START;
@@ -219,9 +342,9 @@ bool Parser::ParseLine() {
         return false;
       }
 
-      node::Directive* directive_node = CreateDirectiveNode(directive_id);
-      directive_node->set_mnemonic(mnemonic.release());
-      node_.reset(directive_node);
+      node::Directive* directive_node = CreateDirectiveNode(directive_id, arena_);
+      directive_node->set_mnemonic(mnemonic);
+      node_ = directive_node;
     } else if ((instruction = config_->instruction_db->FindMnemonic(mnemonic_str))
                != nullptr) {
       if (extended_ && instruction->format() != Format::FS34) {
@@ -230,18 +353,22 @@ bool Parser::ParseLine() {
         return false;
       }
 
-      node::Instruction* node_instruction = CreateInstructionNode(instruction->format());
+      node::Instruction* node_instruction = CreateInstructionNode(instruction->format(),
+                                                                arena_);
       node_instruction->set_opcode(instruction->opcode());
       node_instruction->set_syntax(instruction->syntax());
-      node_instruction->set_mnemonic(mnemonic.release());
-      node_.reset(node_instruction);
+      node_instruction->set_mnemonic(mnemonic);
+      node_ = node_instruction;
     } else {
       error_db_->AddError(ErrorDB::ERROR, "invalid mnemonic", mnemonic->pos());
       return false;
     }
-    node_->set_label(label.release());
+    node_->set_label(label);
+    if (extended_plus != nullptr) {
+      DiscardToken(extended_plus);
+    }
   }
-  node_->set_comment(comment.release());
+  node_->set_comment(comment);
 
   visit_success_ = true;
   node_->AcceptVisitor(this);
@@ -249,14 +376,37 @@ bool Parser::ParseLine() {
     return false;
   }
 
-  if (!tokens_.empty()) {
+  if (!NoTokens()) {
     error_db_->AddError(ErrorDB::ERROR, "unexpected tokens at end of line",
-                        tokens_.front()->pos(), tokens_.back()->pos());
+                        FrontToken()->pos(), BackToken()->pos());
     return false;
   }
   return true;
 }
 
+bool Parser::NoTokens() const {
+  return next_token_ == tokens_.size();
+}
+
+Token* Parser::FrontToken() const {
+  assert(next_token_ < tokens_.size());
+  return tokens_[next_token_];
+}
+
+Token* Parser::BackToken() const {
+  assert(next_token_ < tokens_.size());
+  return tokens_.back();
+}
+
+Token* Parser::TakeToken() {
+  assert(next_token_ < tokens_.size());
+  return tokens_[next_token_++];
+}
+
+void Parser::DiscardToken(Token* token) {
+  tokenizer_->ReleaseToken(token);
+}
+
 void Parser::VisitNode(node::Empty*) {}
 
 void Parser::VisitNode(node::InstructionF1*) {}
@@ -267,7 +417,7 @@ bool Parser::ParseRegisterName(const Token& token, uint8* register_id) {
     return false;
   }
   CpuState::RegisterId id;
-  if (!CpuState::RegisterNameToId(token.value(), &id)) {
+  if (!CpuState::RegisterNameToId(token.value().ToString(), &id)) {
     error_db_->AddError(ErrorDB::ERROR, "invalid register name", token.pos());
     return false;
   }
@@ -277,14 +427,14 @@ bool Parser::ParseRegisterName(const Token& token, uint8* register_id) {
 
 void Parser::VisitNode(node::InstructionF2* node) {
   uint8 r1 = 0, r2 = 0;
-  unique_ptr<Token> operand1, operand2;
-  if (tokens_.empty()) {
+  Token* operand1 = nullptr;
+  Token* operand2 = nullptr;
+  if (NoTokens()) {
     EndOfLineError(*node->mnemonic());
     visit_success_ = false;
     return;
   }
-  operand1 = std::move(tokens_.front());
-  tokens_.pop_front();
+  operand1 = TakeToken();
   if (!ParseRegisterName(*operand1, &r1)) {
     visit_success_ = false;
     return;
@@ -292,26 +442,24 @@ void Parser::VisitNode(node::InstructionF2* node) {
   node->set_r1(r1);
 
   if (node->syntax() == Syntax::F2_REG_REG || node->syntax() == Syntax::F2_REG_N) {
-    unique_ptr<Token> comma;
-    if (tokens_.empty()) {
+    Token* comma = nullptr;
+    if (NoTokens()) {
       EndOfLineError(*operand1);
       visit_success_ = false;
       return;
     }
-    comma = std::move(tokens_.front());
-    tokens_.pop_front();
+    comma = TakeToken();
     if (comma->type() != Token::OPERATOR || comma->operator_id() != Token::OP_COMMA) {
       error_db_->AddError(ErrorDB::ERROR, "expected ','", comma->pos());
       visit_success_ = false;
       return;
     }
-    if (tokens_.empty()) {
+    if (NoTokens()) {
       EndOfLineError(*comma);
       visit_success_ = false;
       return;
     }
-    operand2 = std::move(tokens_.front());
-    tokens_.pop_front();
+    operand2 = TakeToken();
     if (node->syntax() == Syntax::F2_REG_REG) {
       if (!ParseRegisterName(*operand2, &r2)) {
         visit_success_ = false;
@@ -332,52 +480,51 @@ void Parser::VisitNode(node::InstructionF2* node) {
       r2 = static_cast<uint8>(operand2->integer() & 0xf);
     }
     node->set_r2(r2);
+    DiscardToken(comma);
+    DiscardToken(operand2);
   }
+  DiscardToken(operand1);
 }
 
 bool Parser::ParseExpression(bool allow_brackets, TokenList* expression) {
-  assert(!tokens_.empty());
-  unique_ptr<Token> bracket_start;
-  if (allow_brackets && tokens_.front()->type() == Token::OPERATOR &&
-      tokens_.front()->operator_id() == Token::OP_LBRACKET) {
-    bracket_start = std::move(tokens_.front());
-    tokens_.pop_front();
-    if (tokens_.empty()) {
+  assert(!NoTokens());
+  Token* bracket_start = nullptr;
+  if (allow_brackets && FrontToken()->type() == Token::OPERATOR &&
+      FrontToken()->operator_id() == Token::OP_LBRACKET) {
+    bracket_start = TakeToken();
+    if (NoTokens()) {
       EndOfLineError(*bracket_start);
       return false;
     }
   }
 
   // allow one '-' before expression
-  if (tokens_.front()->type() == Token::OPERATOR &&
-      tokens_.front()->operator_id() == Token::OP_SUB) {
-    expression->emplace_back(std::move(tokens_.front()));
-    tokens_.pop_front();
-    if (tokens_.empty()) {
+  if (FrontToken()->type() == Token::OPERATOR &&
+      FrontToken()->operator_id() == Token::OP_SUB) {
+    expression->push_back(TakeToken());
+    if (NoTokens()) {
       EndOfLineError(*expression->back());
       return false;
     }
   }
 
   while (true) {
-    const Token& value_token = *tokens_.front();
+    const Token& value_token = *FrontToken();
     if (value_token.type() != Token::NAME && value_token.type() != Token::INTEGER) {
       error_db_->AddError(ErrorDB::ERROR, "expected symbol name or integer",
                           value_token.pos());
       return false;
     }
-    expression->emplace_back(std::move(tokens_.front()));
-    tokens_.pop_front();
-    if (tokens_.empty()) {
+    expression->push_back(TakeToken());
+    if (NoTokens()) {
       break;
     }
 
-    const Token& operator_token = *tokens_.front();
+    const Token& operator_token = *FrontToken();
     if (operator_token.type() == Token::OPERATOR) {
       if (operator_token.operator_id() >= Token::OP_ADD &&
           operator_token.operator_id() <= Token::OP_DIV) {
-        expression->emplace_back(std::move(tokens_.front()));
-        tokens_.pop_front();
+        expression->push_back(TakeToken());
       } else {
         break;
       }
@@ -385,25 +532,26 @@ bool Parser::ParseExpression(bool allow_brackets, TokenList* expression) {
       error_db_->AddError(ErrorDB::ERROR, "expected operator", operator_token.pos());
       return false;
     }
-    if (tokens_.empty()) {
+    if (NoTokens()) {
       EndOfLineError(operator_token);
       return false;
     }
   }
 
   if (bracket_start != nullptr) {
-    if (tokens_.empty()) {
+    if (NoTokens()) {
       error_db_->AddError(ErrorDB::ERROR, "unmatched '['", bracket_start->pos());
       return false;
     } else {
-      unique_ptr<Token> bracket_end = std::move(tokens_.front());
-      tokens_.pop_front();
+      Token* bracket_end = TakeToken();
       if (bracket_end->type() != Token::OPERATOR ||
           bracket_end->operator_id() != Token::OP_RBRACKET) {
         error_db_->AddError(ErrorDB::ERROR, "expected ']' or arithmetic operator",
                             bracket_end->pos());
         return false;
       }
+      DiscardToken(bracket_start);
+      DiscardToken(bracket_end);
     }
   }
   return true;
@@ -436,15 +584,14 @@ string* CreateIndexRegName() {
 }  // namespace
 
 bool Parser::ParseAddressingOperator(node::InstructionFS34* node) {
-  unique_ptr<Token> addressing_operator;
+  Token* addressing_operator = nullptr;
   node::InstructionFS34::AddressingId addressing = node::InstructionFS34::SIMPLE;
-  if (tokens_.front()->type() == Token::OPERATOR &&
-      tokens_.front()->operator_id() >= Token::OP_ASSIGN &&
-      tokens_.front()->operator_id() <= Token::OP_AT) {
-    addressing_operator = std::move(tokens_.front());
-    tokens_.pop_front();
+  if (FrontToken()->type() == Token::OPERATOR &&
+      FrontToken()->operator_id() >= Token::OP_ASSIGN &&
+      FrontToken()->operator_id() <= Token::OP_AT) {
+    addressing_operator = TakeToken();
     addressing = AddressingFromOperatorToken(*addressing_operator);
-    if (tokens_.empty()) {
+    if (NoTokens()) {
       EndOfLineError(*addressing_operator);
       return false;
     }
@@ -474,6 +621,9 @@ bool Parser::ParseAddressingOperator(node::InstructionFS34* node) {
                         "point instructions", addressing_operator->pos());
     return false;
   }
+  if (addressing_operator != nullptr) {
+    DiscardToken(addressing_operator);
+  }
   return true;
 }
 
@@ -503,19 +653,17 @@ bool Parser::CheckDataTokenMaxSize(const Token& data_token, Syntax::SyntaxId syn
 }
 
 bool Parser::ParseIndexOperator(node::InstructionFS34* node) {
-  unique_ptr<Token> comma = std::move(tokens_.front());
-  tokens_.pop_front();
+  Token* comma = TakeToken();
   if (comma->type() != Token::OPERATOR || comma->operator_id() != Token::OP_COMMA) {
     error_db_->AddError(ErrorDB::ERROR, "expected ','", comma->pos());
     return false;
   }
-  if (tokens_.empty()) {
+  if (NoTokens()) {
     EndOfLineError(*comma);
     return false;
   }
   static const string* index_reg_name = CreateIndexRegName();
-  unique_ptr<Token> index_reg_token = std::move(tokens_.front());
-  tokens_.pop_front();
+  Token* index_reg_token = TakeToken();
   if (index_reg_token->type() != Token::NAME ||
       index_reg_token->value() != *index_reg_name) {
     error_db_->AddError(ErrorDB::ERROR, ("expected '" + *index_reg_name + "'").c_str(),
@@ -529,6 +677,8 @@ bool Parser::ParseIndexOperator(node::InstructionFS34* node) {
     return false;
   }
   node->set_indexed(true);
+  DiscardToken(comma);
+  DiscardToken(index_reg_token);
   return true;
 }
 
@@ -536,7 +686,7 @@ void Parser::VisitNode(node::InstructionFS34* node) {
   if (node->syntax() == Syntax::FS34_NONE) {
     return;
   }
-  if (tokens_.empty()) {
+  if (NoTokens()) {
     EndOfLineError(*node->mnemonic());
     visit_success_ = false;
     return;
@@ -550,8 +700,7 @@ void Parser::VisitNode(node::InstructionFS34* node) {
   node::InstructionFS34::AddressingId addressing = node->addressing();
   if (addressing == node::InstructionFS34::LITERAL_POOL) {
     if (node->syntax() == Syntax::FS34_LOAD_F) {
-      unique_ptr<Token> data_token = std::move(tokens_.front());
-      tokens_.pop_front();
+      Token* data_token = TakeToken();
       if (data_token->type() != Token::DATA_FLOAT &&
           data_token->type() != Token::DATA_BIN) {
         error_db_->AddError(ErrorDB::ERROR, "expected data constant", data_token->pos());
@@ -562,29 +711,29 @@ void Parser::VisitNode(node::InstructionFS34* node) {
         visit_success_ = false;
         return;
       }
-      node->set_data_token(data_token.release());
+      node->set_data_token(data_token);
     } else if (node->syntax() == Syntax::FS34_LOAD_B ||
                node->syntax() == Syntax::FS34_LOAD_W) {
-      if (tokens_.front()->type() == Token::DATA_FLOAT) {
+      if (FrontToken()->type() == Token::DATA_FLOAT) {
         error_db_->AddError(ErrorDB::ERROR,
                             "float literal not allowed with this instruction",
-                            tokens_.front()->pos());
+                            FrontToken()->pos());
         visit_success_ = false;
         return;
       }
-      if (tokens_.front()->type() == Token::DATA_BIN) {
-        unique_ptr<Token> data_token = std::move(tokens_.front());
-        tokens_.pop_front();
+      if (FrontToken()->type() == Token::DATA_BIN) {
+        Token* data_token = TakeToken();
         if (!CheckDataTokenMaxSize(*data_token, node->syntax())) {
           visit_success_ = false;
           return;
         }
-        node->set_data_token(data_token.release());
+        node->set_data_token(data_token);
       } else {
         if (!ParseExpression(config_->allow_brackets, node->mutable_expression())) {
           visit_success_ = false;
           return;
         }
+        ExpressionUtil::Compile(node->expression(), node->mutable_compiled_expression());
       }
     } else {
       assert(false);
@@ -597,9 +746,10 @@ void Parser::VisitNode(node::InstructionFS34* node) {
       visit_success_ = false;
       return;
     }
+    ExpressionUtil::Compile(node->expression(), node->mutable_compiled_expression());
   }
 
-  if (tokens_.empty()) {
+  if (NoTokens()) {
     return;
   }
   if (!ParseIndexOperator(node)) {
@@ -609,7 +759,7 @@ void Parser::VisitNode(node::InstructionFS34* node) {
 }
 
 void Parser::VisitExpressionDirective(node::ExpressionDirective* node) {
-  if (tokens_.empty()) {
+  if (NoTokens()) {
     EndOfLineError(*node->mnemonic());
     visit_success_ = false;
     return;
@@ -618,6 +768,7 @@ void Parser::VisitExpressionDirective(node::ExpressionDirective* node) {
     visit_success_ = false;
     return;
   }
+  ExpressionUtil::Compile(node->expression(), node->mutable_compiled_expression());
 }
 
 void Parser::VisitNode(node::DirectiveStart* node) {
@@ -661,9 +812,9 @@ void Parser::VisitNode(node::DirectiveEqu* node) {
     visit_success_ = false;
     return;
   }
-  if (!tokens_.empty() && tokens_.front()->type() == Token::OPERATOR &&
-      tokens_.front()->operator_id() == Token::OP_MUL) {
-    tokens_.pop_front();
+  if (!NoTokens() && FrontToken()->type() == Token::OPERATOR &&
+      FrontToken()->operator_id() == Token::OP_MUL) {
+    DiscardToken(TakeToken());
     node->set_assign_current_address(true);
   } else {
     VisitExpressionDirective(node);
@@ -676,15 +827,14 @@ void Parser::VisitNode(node::DirectiveUse* node) {
     visit_success_ = false;
     return;
   }
-  if (!tokens_.empty()) {
-    unique_ptr<Token> block_name(std::move(tokens_.front()));
-    tokens_.pop_front();
+  if (!NoTokens()) {
+    Token* block_name = TakeToken();
     if (block_name->type() != Token::NAME) {
       error_db_->AddError(ErrorDB::ERROR, "expected block name", block_name->pos());
       visit_success_ = false;
       return;
     }
-    node->set_block_name(block_name.release());
+    node->set_block_name(block_name);
   }
 }
 
@@ -714,16 +864,15 @@ void Parser::VisitNode(node::DirectiveNobase* node) {
 }
 
 void Parser::VisitSymbolListDirective(node::SymbolListDirective* node) {
-  if (tokens_.empty()) {
+  if (NoTokens()) {
     EndOfLineError(*node->mnemonic());
     visit_success_ = false;
     return;
   }
 
-  unique_ptr<Token> token;
+  Token* token = nullptr;
   while (true) {
-    token = std::move(tokens_.front());
-    tokens_.pop_front();
+    token = TakeToken();
     if (token->type() != Token::NAME) {
       error_db_->AddError(ErrorDB::ERROR, "expected symbol name", token->pos());
       visit_success_ = false;
@@ -735,24 +884,24 @@ void Parser::VisitSymbolListDirective(node::SymbolListDirective* node) {
                           token->pos());
       visit_success_ = false;
     }
-    node->mutable_symbol_list()->emplace_back(std::move(token));
-    if (tokens_.empty()) {
+    node->mutable_symbol_list()->push_back(token);
+    if (NoTokens()) {
       break;
     }
 
-    token = std::move(tokens_.front());
-    tokens_.pop_front();
+    token = TakeToken();
 
     if (token->type() != Token::OPERATOR || token->operator_id() != Token::OP_COMMA) {
       error_db_->AddError(ErrorDB::ERROR, "expected ','", token->pos());
       visit_success_ = false;
       return;
     }
-    if (tokens_.empty()) {
+    if (NoTokens()) {
       EndOfLineError(*token);
       visit_success_ = false;
       return;
     }
+    DiscardToken(token);
   }
 }
 
@@ -775,11 +924,10 @@ void Parser::VisitNode(node::DirectiveExtref* node) {
 }
 
 void Parser::VisitNode(node::DirectiveMemInit* node) {
-  if (!tokens_.empty() &&
-      (tokens_.front()->type() == Token::DATA_BIN ||
-       tokens_.front()->type() == Token::DATA_FLOAT)) {
-    node->set_data_token(tokens_.front().release());
-    tokens_.pop_front();
+  if (!NoTokens() &&
+      (FrontToken()->type() == Token::DATA_BIN ||
+       FrontToken()->type() == Token::DATA_FLOAT)) {
+    node->set_data_token(TakeToken());
   } else {
     VisitExpressionDirective(node);
   }
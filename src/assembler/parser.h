@@ -1,9 +1,8 @@
 #ifndef ASSEMBLER_PARSER_H
 #define ASSEMBLER_PARSER_H
 
-#include <list>
-#include <memory>
 #include <string>
+#include <vector>
 #include "assembler/node.h"
 #include "assembler/node_visitor.h"
 #include "assembler/token.h"
@@ -11,6 +10,7 @@
 
 namespace sicxe {
 
+class Arena;
 class ErrorDB;
 class InstructionDB;
 class TextFile;
@@ -18,6 +18,7 @@ class TextFile;
 namespace assembler {
 
 class Code;
+class Tokenizer;
 
 class Parser : public NodeVisitor {
  public:
@@ -29,6 +30,9 @@ class Parser : public NodeVisitor {
     const InstructionDB* instruction_db;
     bool case_sensitive;  // directives and mnemonics are case sensitive
     bool allow_brackets;
+    // Lines of large files are tokenized and parsed on up to this many threads.
+    // The result does not depend on the thread count.
+    int thread_count;
   };
 
   typedef node::Node::TokenList TokenList;
@@ -39,8 +43,24 @@ class Parser : public NodeVisitor {
   bool ParseFile(const TextFile& file, Code* code, ErrorDB* error_db);
 
  private:
+  struct Chunk;
+  typedef std::vector<node::Node*> NodeList;
+
+  // Tokenizes and parses the lines of |chunk|.
+  void ParseChunk(const TextFile& file, Chunk* chunk);
+  // Moves the names and memory of a chunk parsed with its own pool and arena
+  // into |code|.
+  static void MergeChunk(Chunk* chunk, Code* code);
   bool ParseLine();
 
+  // Tokens of the current line are consumed from the front.
+  bool NoTokens() const;
+  Token* FrontToken() const;
+  Token* BackToken() const;
+  Token* TakeToken();
+  // Returns a consumed token that is not stored in the node for reuse.
+  void DiscardToken(Token* token);
+
   bool ParseRegisterName(const Token& token, uint8* register_id);
   bool ParseExpression(bool allow_brackets, TokenList* expression);
   bool ParseAddressingOperator(node::InstructionFS34* node);
@@ -71,10 +91,12 @@ class Parser : public NodeVisitor {
   void LabelNotAllowedError(const Token& label);
 
   const Config* config_;
-  Code* code_;
+  Arena* arena_;  // of the chunk being parsed
   ErrorDB* error_db_;
+  Tokenizer* tokenizer_;
   TokenList tokens_;
-  std::unique_ptr<node::Node> node_;
+  size_t next_token_;  // first token of |tokens_| that was not consumed yet
+  node::Node* node_;
   bool extended_;
   bool visit_success_;
 };
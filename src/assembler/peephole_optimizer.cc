@@ -0,0 +1,328 @@
+#include "assembler/peephole_optimizer.h"
+
+#include <memory>
+#include "assembler/expression_util.h"
+#include "assembler/peephole_report.h"
+#include "assembler/symbol_table.h"
+#include "assembler/token.h"
+#include "common/cpu_state.h"
+#include "common/error_db.h"
+#include "common/opcode.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace sicxe {
+namespace assembler {
+
+namespace {
+
+struct StoreLoad {
+  uint8 store;
+  uint8 load;
+  const char* load_mnemonic;
+};
+
+const StoreLoad kStoreLoads[] = {
+  {Opcode::STA, Opcode::LDA, "LDA"},
+  {Opcode::STX, Opcode::LDX, "LDX"},
+  {Opcode::STL, Opcode::LDL, "LDL"},
+  {Opcode::STB, Opcode::LDB, "LDB"},
+  {Opcode::STS, Opcode::LDS, "LDS"},
+  {Opcode::STT, Opcode::LDT, "LDT"},
+};
+
+// Longest chain of jumps followed, which also ends loops of jumps.
+const int kMaxJumpChain = 16;
+
+bool IsConditionalJump(const node::Instruction* node) {
+  return node->opcode() == Opcode::JEQ || node->opcode() == Opcode::JGT ||
+         node->opcode() == Opcode::JLT;
+}
+
+// Simple addressing of a memory operand, not indexed.
+bool IsSimpleOperand(const node::InstructionFS34* node) {
+  return node->syntax() != Syntax::FS34_NONE &&
+         node->addressing() == node::InstructionFS34::SIMPLE && !node->indexed();
+}
+
+// Operand is a single symbol name.
+const Token* JumpLabel(const node::InstructionFS34* node) {
+  if (!IsSimpleOperand(node) || node->expression().size() != 1 ||
+      node->expression().front()->type() != Token::NAME) {
+    return nullptr;
+  }
+  return node->expression().front();
+}
+
+bool IsGeneralRegister(uint8 reg) {
+  return reg <= CpuState::REG_T;
+}
+
+}  // namespace
+
+PeepholeOptimizer::PeepholeOptimizer(const TableBuilder::Config* config)
+    : config_(config), code_(nullptr), report_(nullptr) {}
+PeepholeOptimizer::~PeepholeOptimizer() {}
+
+bool PeepholeOptimizer::Optimize(Code* code, ErrorDB* error_db) {
+  // addresses of the nodes, for the reach of redirected jumps
+  CodeGenerator code_generator;
+  CodeGenerator::OutputWriterVector output_writers;
+  output_writers.push_back(this);
+  ErrorDB address_error_db;
+  if (!code_generator.GenerateCode(*code, &output_writers, &address_error_db)) {
+    // the errors are reported by the real code generation
+    return true;
+  }
+
+  label_index_.clear();
+  for (node::Node* node : code->nodes()) {
+    node::InstructionFS34* instruction = dyn_cast<node::InstructionFS34>(node);
+    if (instruction != nullptr && instruction->label() != nullptr) {
+      StringPool::Id name_id = instruction->label()->name_id();
+      if (name_id >= label_index_.size()) {
+        label_index_.resize(name_id + 1, nullptr);
+      }
+      label_index_[name_id] = instruction;
+    }
+  }
+
+  unique_ptr<PeepholeReport> report(new PeepholeReport);
+  report_ = report.get();
+  // literal nodes are left out, the tables are built again
+  Code::NodeList output_nodes;
+  output_nodes.reserve(code->nodes().size());
+  node::Instruction* previous = nullptr;  // instruction right before, if any
+  const node::Instruction* compare = nullptr;  // compare that set the condition code
+  for (node::Node* node : code->nodes()) {
+    if (isa<node::DirectiveInternalLiteral>(node)) {
+      continue;
+    }
+    if (isa<node::Empty>(node)) {
+      output_nodes.push_back(node);
+      continue;
+    }
+    node::Instruction* instruction = dyn_cast<node::Instruction>(node);
+    if (instruction == nullptr || instruction->label() != nullptr) {
+      previous = nullptr;
+      compare = nullptr;
+    }
+    if (instruction == nullptr) {
+      output_nodes.push_back(node);
+      continue;
+    }
+
+    if (previous != nullptr && IsRedundantLoad(previous, instruction)) {
+      continue;
+    }
+    if (compare != nullptr && IsSameCompare(compare, instruction)) {
+      continue;
+    }
+    if (previous != nullptr && MergeClearAdd(previous, instruction)) {
+      continue;
+    }
+    node::InstructionFS34* jump = dyn_cast<node::InstructionFS34>(instruction);
+    if (jump != nullptr) {
+      RetargetJump(jump);
+    }
+
+    output_nodes.push_back(instruction);
+    previous = instruction;
+    // Any instruction other than JEQ, JGT or JLT ends the sequence. Compares
+    // are not the only instructions that set the condition code, TIX and TIXR
+    // do too, and the jumps are the only ones known to leave it and the
+    // compared values unchanged.
+    if (instruction->opcode() == Opcode::COMP || instruction->opcode() == Opcode::COMPR ||
+        instruction->opcode() == Opcode::COMPF) {
+      compare = instruction;
+    } else if (!IsConditionalJump(instruction)) {
+      compare = nullptr;
+    }
+  }
+  report_ = nullptr;
+  addresses_.clear();
+
+  if (report->rewrite_count() > 0) {
+    *code->mutable_nodes() = output_nodes;
+    TableBuilder::Config table_builder_config = *config_;
+    table_builder_config.relax = config_->relax ||
+                                 config_->base_placement == TableBuilder::Config::INSERT_BASE;
+    table_builder_config.base_placement = TableBuilder::Config::NO_BASE_PLACEMENT;
+    TableBuilder table_builder(&table_builder_config);
+    // messages of the first build are already reported
+    ErrorDB table_error_db;
+    if (!table_builder.BuildTables(code, &table_error_db)) {
+      error_db->Append(&table_error_db);
+      return false;
+    }
+  }
+  code->set_peephole_report(report.release());
+  return true;
+}
+
+void PeepholeOptimizer::Begin(const Code& code) {
+  code_ = &code;
+  addresses_.clear();
+}
+
+void PeepholeOptimizer::WriteNode(const node::Node& node, uint32 address) {
+  addresses_[&node] = address;
+}
+
+void PeepholeOptimizer::WriteNode(const node::Node& node, uint32 address,
+                                  const string&, bool) {
+  addresses_[&node] = address;
+}
+
+void PeepholeOptimizer::WriteRelocationRecord(const RelocationRecord&) {}
+
+void PeepholeOptimizer::End() {}
+
+bool PeepholeOptimizer::EvaluateOperand(const node::InstructionFS34* node, int32* value,
+                                        bool* relative) {
+  ErrorDB unused_error_db;
+  ExpressionUtil::ExternalSymbolVector external_symbols;
+  return ExpressionUtil::Evaluate(node->compiled_expression(), *code_->symbol_table(), true,
+                                  value, relative, &external_symbols, &unused_error_db) &&
+         external_symbols.empty();
+}
+
+bool PeepholeOptimizer::IsRedundantLoad(const node::Instruction* previous,
+                                        const node::Instruction* node) {
+  const node::InstructionFS34* store = dyn_cast<node::InstructionFS34>(previous);
+  const node::InstructionFS34* load = dyn_cast<node::InstructionFS34>(node);
+  if (store == nullptr || load == nullptr || !IsSimpleOperand(store) ||
+      !IsSimpleOperand(load)) {
+    return false;
+  }
+  for (const StoreLoad& store_load : kStoreLoads) {
+    if (store->opcode() != store_load.store || load->opcode() != store_load.load) {
+      continue;
+    }
+    int32 store_value = 0;
+    int32 load_value = 0;
+    bool store_relative = false;
+    bool load_relative = false;
+    if (!EvaluateOperand(store, &store_value, &store_relative) ||
+        !EvaluateOperand(load, &load_value, &load_relative) ||
+        store_value != load_value || store_relative != load_relative) {
+      return false;
+    }
+    report_->AddNote(store, PeepholeReport::REDUNDANT_LOAD, load->extended() ? 4 : 3,
+                     string(store_load.load_mnemonic) + " removed");
+    return true;
+  }
+  return false;
+}
+
+bool PeepholeOptimizer::IsSameCompare(const node::Instruction* previous,
+                                      const node::Instruction* node) {
+  if (previous->opcode() != node->opcode()) {
+    return false;
+  }
+  const node::InstructionF2* previous_f2 = dyn_cast<node::InstructionF2>(previous);
+  const node::InstructionF2* node_f2 = dyn_cast<node::InstructionF2>(node);
+  if (previous_f2 != nullptr && node_f2 != nullptr) {
+    if (previous_f2->r1() != node_f2->r1() || previous_f2->r2() != node_f2->r2()) {
+      return false;
+    }
+    report_->AddNote(previous, PeepholeReport::REPEATED_COMPARE, 2, "COMPR removed");
+    return true;
+  }
+
+  const node::InstructionFS34* previous_fs34 = dyn_cast<node::InstructionFS34>(previous);
+  const node::InstructionFS34* node_fs34 = dyn_cast<node::InstructionFS34>(node);
+  if (previous_fs34 == nullptr || node_fs34 == nullptr ||
+      previous_fs34->addressing() != node_fs34->addressing() ||
+      previous_fs34->indexed() || node_fs34->indexed()) {
+    return false;
+  }
+  if (node_fs34->addressing() == node::InstructionFS34::LITERAL_POOL) {
+    if (previous_fs34->literal_id() != node_fs34->literal_id()) {
+      return false;
+    }
+  } else {
+    int32 previous_value = 0;
+    int32 node_value = 0;
+    bool previous_relative = false;
+    bool node_relative = false;
+    if (!EvaluateOperand(previous_fs34, &previous_value, &previous_relative) ||
+        !EvaluateOperand(node_fs34, &node_value, &node_relative) ||
+        previous_value != node_value || previous_relative != node_relative) {
+      return false;
+    }
+  }
+  const char* note = node->opcode() == Opcode::COMPF ? "COMPF removed" : "COMP removed";
+  report_->AddNote(previous, PeepholeReport::REPEATED_COMPARE, node_fs34->extended() ? 4 : 3,
+                   note);
+  return true;
+}
+
+bool PeepholeOptimizer::MergeClearAdd(node::Instruction* previous,
+                                      const node::Instruction* node) {
+  node::InstructionF2* clear = dyn_cast<node::InstructionF2>(previous);
+  const node::InstructionF2* add = dyn_cast<node::InstructionF2>(node);
+  if (clear == nullptr || add == nullptr || clear->opcode() != Opcode::CLEAR ||
+      add->opcode() != Opcode::ADDR || add->r2() != clear->r1() ||
+      !IsGeneralRegister(add->r1()) || !IsGeneralRegister(add->r2())) {
+    return false;
+  }
+  if (add->r1() == add->r2()) {
+    // the register stays zero
+    report_->AddNote(clear, PeepholeReport::CLEAR_ADD, 2, "ADDR removed");
+    return true;
+  }
+  clear->set_opcode(Opcode::RMO);
+  clear->set_syntax(Syntax::F2_REG_REG);
+  clear->set_r1(add->r1());
+  clear->set_r2(add->r2());
+  report_->AddNote(clear, PeepholeReport::CLEAR_ADD, 2, "CLEAR and ADDR merged into RMO");
+  return true;
+}
+
+void PeepholeOptimizer::RetargetJump(node::InstructionFS34* node) {
+  if (!IsConditionalJump(node) && node->opcode() != Opcode::J &&
+      node->opcode() != Opcode::JSUB) {
+    return;
+  }
+  const Token* label = JumpLabel(node);
+  if (label == nullptr) {
+    return;
+  }
+  const StringPool::Id original_name_id = label->name_id();
+  const node::InstructionFS34* target = nullptr;
+  for (int i = 0; i < kMaxJumpChain; i++) {
+    StringPool::Id name_id = label->name_id();
+    if (name_id >= label_index_.size() || label_index_[name_id] == nullptr) {
+      break;
+    }
+    const node::InstructionFS34* next = label_index_[name_id];
+    if (next->opcode() != Opcode::J || JumpLabel(next) == nullptr || next == node) {
+      break;
+    }
+    target = next;
+    label = JumpLabel(next);
+  }
+  int32 value = 0;
+  bool relative = false;
+  if (target == nullptr || label->name_id() == original_name_id ||
+      !EvaluateOperand(target, &value, &relative)) {
+    return;
+  }
+  // without relaxation format 3 jumps may only be redirected within reach
+  if (!node->extended() && !config_->relax &&
+      config_->base_placement != TableBuilder::Config::INSERT_BASE) {
+    int32 offset = value - static_cast<int32>(addresses_[node] + 3);
+    if (!relative || offset < -2048 || offset > 2047) {
+      return;
+    }
+  }
+  *node->mutable_expression() = target->expression();
+  *node->mutable_compiled_expression() = target->compiled_expression();
+  report_->AddNote(node, PeepholeReport::JUMP_TO_JUMP, 0,
+                   "jump redirected to " + label->value().ToString());
+}
+
+}  // namespace assembler
+}  // namespace sicxe
@@ -0,0 +1,69 @@
+#ifndef ASSEMBLER_PEEPHOLE_OPTIMIZER_H
+#define ASSEMBLER_PEEPHOLE_OPTIMIZER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "assembler/code.h"
+#include "assembler/code_generator.h"
+#include "assembler/node.h"
+#include "assembler/table_builder.h"
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+
+class ErrorDB;
+
+namespace assembler {
+
+class PeepholeReport;
+
+// Rewrites short instruction sequences of code whose tables are built:
+//  - a load right after a store of the same register to the same address is
+//    removed,
+//  - a compare repeated with only conditional jumps since the same compare is
+//    removed,
+//  - jumps to a J are redirected to its target,
+//  - CLEAR r followed by ADDR s,r becomes RMO s,r.
+// Instructions with a label are never removed and start a new sequence, so
+// code reached by jumps, ORG, USE or other programs keeps its meaning. The
+// rewrites are noted in a PeepholeReport set on the code.
+class PeepholeOptimizer : public CodeOutputWriter {
+ public:
+  DISALLOW_COPY_AND_MOVE(PeepholeOptimizer);
+
+  // The tables are built again with |config|, without base placement.
+  explicit PeepholeOptimizer(const TableBuilder::Config* config);
+  ~PeepholeOptimizer();
+
+  bool Optimize(Code* code, ErrorDB* error_db);
+
+ private:
+  virtual void Begin(const Code& code);
+  virtual void WriteNode(const node::Node& node, uint32 address);
+  virtual void WriteNode(const node::Node& node, uint32 address,
+                         const std::string& data, bool can_split);
+  virtual void WriteRelocationRecord(const RelocationRecord& record);
+  virtual void End();
+
+  // Value of a memory operand without external symbols.
+  bool EvaluateOperand(const node::InstructionFS34* node, int32* value, bool* relative);
+  bool IsRedundantLoad(const node::Instruction* previous, const node::Instruction* node);
+  bool IsSameCompare(const node::Instruction* previous, const node::Instruction* node);
+  // Returns true if |node| was rewritten or should be removed.
+  bool MergeClearAdd(node::Instruction* previous, const node::Instruction* node);
+  void RetargetJump(node::InstructionFS34* node);
+
+  const TableBuilder::Config* config_;
+  const Code* code_;
+  PeepholeReport* report_;
+  std::unordered_map<const node::Node*, uint32> addresses_;
+  // labeled instructions, indexed by name id
+  std::vector<node::InstructionFS34*> label_index_;
+};
+
+}  // namespace assembler
+}  // namespace sicxe
+
+#endif  // ASSEMBLER_PEEPHOLE_OPTIMIZER_H
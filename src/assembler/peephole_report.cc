@@ -0,0 +1,72 @@
+#include "assembler/peephole_report.h"
+
+#include <memory>
+#include "common/text_file.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace sicxe {
+namespace assembler {
+
+static const char* const kRewriteNames[] = {
+  "redundant load",
+  "repeated compare",
+  "jump to jump",
+  "CLEAR and ADDR",
+};
+
+PeepholeReport::PeepholeReport() {
+  for (int i = 0; i < REWRITE_COUNT; i++) {
+    counts_[i] = 0;
+    saved_bytes_[i] = 0;
+  }
+}
+
+PeepholeReport::~PeepholeReport() {}
+
+void PeepholeReport::AddNote(const node::Node* node, RewriteId rewrite, int saved_bytes,
+                             const string& note) {
+  counts_[rewrite]++;
+  saved_bytes_[rewrite] += saved_bytes;
+  string* text = &notes_[node];
+  if (!text->empty()) {
+    *text += ", ";
+  }
+  *text += note;
+}
+
+const string* PeepholeReport::FindNote(const node::Node* node) const {
+  auto it = notes_.find(node);
+  if (it == notes_.end()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+int PeepholeReport::rewrite_count() const {
+  int count = 0;
+  for (int i = 0; i < REWRITE_COUNT; i++) {
+    count += counts_[i];
+  }
+  return count;
+}
+
+void PeepholeReport::OutputToTextFile(TextFile* file) const {
+  size_t buffer_size = 200;
+  unique_ptr<char[]> buffer(new char[buffer_size]);
+  snprintf(buffer.get(), buffer_size, "%-20s %-7s %s", "REWRITE", "COUNT", "SAVED");
+  file->AppendLine(buffer.get());
+  int total_saved_bytes = 0;
+  for (int i = 0; i < REWRITE_COUNT; i++) {
+    snprintf(buffer.get(), buffer_size, "%-20s %-7d %d",
+             kRewriteNames[i], counts_[i], saved_bytes_[i]);
+    file->AppendLine(buffer.get());
+    total_saved_bytes += saved_bytes_[i];
+  }
+  snprintf(buffer.get(), buffer_size, "%d bytes of code saved", total_saved_bytes);
+  file->AppendLine(buffer.get());
+}
+
+}  // namespace assembler
+}  // namespace sicxe
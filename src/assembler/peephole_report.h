@@ -0,0 +1,49 @@
+#ifndef ASSEMBLER_PEEPHOLE_REPORT_H
+#define ASSEMBLER_PEEPHOLE_REPORT_H
+
+#include <string>
+#include <unordered_map>
+#include "assembler/node.h"
+#include "common/macros.h"
+
+namespace sicxe {
+
+class TextFile;
+
+namespace assembler {
+
+// Rewrites made by PeepholeOptimizer. Every rewrite is noted on the node that
+// remains in the code, which is the preceding one for removed nodes.
+class PeepholeReport {
+ public:
+  DISALLOW_COPY_AND_MOVE(PeepholeReport);
+
+  enum RewriteId {
+    REDUNDANT_LOAD = 0,
+    REPEATED_COMPARE,
+    JUMP_TO_JUMP,
+    CLEAR_ADD,
+    REWRITE_COUNT
+  };
+
+  PeepholeReport();
+  ~PeepholeReport();
+
+  void AddNote(const node::Node* node, RewriteId rewrite, int saved_bytes,
+               const std::string& note);
+  // Notes of |node| joined, nullptr if there are none.
+  const std::string* FindNote(const node::Node* node) const;
+  int rewrite_count() const;
+
+  void OutputToTextFile(TextFile* file) const;
+
+ private:
+  std::unordered_map<const node::Node*, std::string> notes_;
+  int counts_[REWRITE_COUNT];
+  int saved_bytes_[REWRITE_COUNT];
+};
+
+}  // namespace assembler
+}  // namespace sicxe
+
+#endif  // ASSEMBLER_PEEPHOLE_REPORT_H
@@ -1,5 +1,7 @@
 #include "assembler/symbol_table.h"
 
+#include <assert.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 #include "assembler/block_table.h"
@@ -16,19 +18,46 @@ SymbolTable::Entry::Entry()
     resolved(false), exported(false), address(0), block(-1), block_address(0) {}
 
 
-SymbolTable::SymbolTable() {}
+SymbolTable::SymbolTable(StringPool* names) : names_(names) {}
 SymbolTable::~SymbolTable() {}
 
-const SymbolTable::Entry* SymbolTable::Find(const std::string& symbol_name) const {
-  auto it = entry_map_.find(symbol_name);
-  if (it == entry_map_.end()) {
+const SymbolTable::Entry* SymbolTable::Find(StringPool::Id name_id) const {
+  if (name_id >= index_.size()) {
     return nullptr;
   }
-  return &it->second;
+  return index_[name_id];
 }
 
-SymbolTable::Entry* SymbolTable::FindOrCreateNew(const std::string& symbol_name) {
-  return &entry_map_[symbol_name];
+SymbolTable::Entry* SymbolTable::Find(StringPool::Id name_id) {
+  if (name_id >= index_.size()) {
+    return nullptr;
+  }
+  return index_[name_id];
+}
+
+const SymbolTable::Entry* SymbolTable::Find(StringView symbol_name) const {
+  StringPool::Id name_id = names_->Find(symbol_name);
+  if (name_id == StringPool::kInvalidId) {
+    return nullptr;
+  }
+  return Find(name_id);
+}
+
+SymbolTable::Entry* SymbolTable::FindOrCreateNew(StringPool::Id name_id) {
+  assert(name_id < names_->size());
+  if (name_id >= index_.size()) {
+    index_.resize(names_->size(), nullptr);
+  }
+  if (index_[name_id] == nullptr) {
+    entries_.emplace_back();
+    index_[name_id] = &entries_.back();
+    ids_.push_back(name_id);
+  }
+  return index_[name_id];
+}
+
+SymbolTable::Entry* SymbolTable::FindOrCreateNew(StringView symbol_name) {
+  return FindOrCreateNew(names_->Intern(symbol_name));
 }
 
 void SymbolTable::OutputToTextFile(const BlockTable* block_table, TextFile* file) const {
@@ -36,10 +65,10 @@ void SymbolTable::OutputToTextFile(const BlockTable* block_table, TextFile* file
   unique_ptr<char[]> buffer(new char[buffer_size]);
   snprintf(buffer.get(), buffer_size, "%-20s %-5s %-7s %-8s %s",
            "NAME", "TYPE", "VALUE", "" ,"BLOCK");
-  file->mutable_lines()->emplace_back(string(buffer.get()));
-  for (const auto& entry_pair : entry_map_) {
-    const string& name = entry_pair.first;
-    const Entry& entry = entry_pair.second;
+  file->AppendLine(buffer.get());
+  for (StringPool::Id name_id : SortedIds()) {
+    StringView name = names_->Get(name_id);
+    const Entry& entry = *index_[name_id];
     const char* type_str = nullptr;
     if (entry.type == UNKNOWN && (entry.type == INTERNAL && !entry.defined)) {
       type_str = "U";
@@ -54,10 +83,10 @@ void SymbolTable::OutputToTextFile(const BlockTable* block_table, TextFile* file
     }
     if (entry.type == EXTERNAL || entry.type == UNKNOWN ||
         (entry.type == INTERNAL && !entry.defined)) {
-      snprintf(buffer.get(), buffer_size, "%-20.20s %-5s", name.c_str(), type_str);
+      snprintf(buffer.get(), buffer_size, "%-20.20s %-5s", name.data(), type_str);
     } else {
       snprintf(buffer.get(), buffer_size, "%-20.20s %-5s %06x  %-8u",
-               name.c_str(), type_str, entry.address, entry.address);
+               name.data(), type_str, entry.address, entry.address);
     }
     string line = string(buffer.get());
     if (entry.block >= 0) {
@@ -71,16 +100,29 @@ void SymbolTable::OutputToTextFile(const BlockTable* block_table, TextFile* file
       }
       line += string(buffer.get());
     }
-    file->mutable_lines()->emplace_back(std::move(line));
+    file->AppendLine(line);
   }
 }
 
-const SymbolTable::EntryMap& SymbolTable::entry_map() const {
-  return entry_map_;
+StringView SymbolTable::name(StringPool::Id name_id) const {
+  return names_->Get(name_id);
+}
+
+const SymbolTable::IdList& SymbolTable::ids() const {
+  return ids_;
+}
+
+SymbolTable::IdList SymbolTable::SortedIds() const {
+  IdList sorted_ids(ids_);
+  SortByName(&sorted_ids);
+  return sorted_ids;
 }
 
-SymbolTable::EntryMap* SymbolTable::mutable_entry_map() {
-  return &entry_map_;
+void SymbolTable::SortByName(IdList* name_ids) const {
+  std::sort(name_ids->begin(), name_ids->end(),
+            [this](StringPool::Id a, StringPool::Id b) {
+              return names_->Get(a) < names_->Get(b);
+            });
 }
 
 }  // namespace assembler
@@ -1,9 +1,10 @@
 #ifndef ASSEMBLER_SYMBOL_TABLE_H
 #define ASSEMBLER_SYMBOL_TABLE_H
 
-#include <map>
-#include <string>
+#include <deque>
+#include <vector>
 #include "common/macros.h"
+#include "common/string_pool.h"
 #include "common/types.h"
 
 namespace sicxe {
@@ -45,21 +46,32 @@ class SymbolTable {
     uint32 block_address;  // address in block (only for symbols within blocks)
   };
 
-  typedef std::map<std::string, Entry> EntryMap;
+  typedef std::vector<StringPool::Id> IdList;
 
-  SymbolTable();
+  // Symbol names are interned in |names|, which must outlive the table.
+  explicit SymbolTable(StringPool* names);
   ~SymbolTable();
 
-  const Entry* Find(const std::string& symbol_name) const;
-  Entry* FindOrCreateNew(const std::string& symbol_name);
+  const Entry* Find(StringPool::Id name_id) const;
+  Entry* Find(StringPool::Id name_id);
+  const Entry* Find(StringView symbol_name) const;
+  Entry* FindOrCreateNew(StringPool::Id name_id);
+  Entry* FindOrCreateNew(StringView symbol_name);
 
   void OutputToTextFile(const BlockTable* block_table, TextFile* file) const;
 
-  const EntryMap& entry_map() const;
-  EntryMap* mutable_entry_map();
+  StringView name(StringPool::Id name_id) const;
+  // Ids of all symbols in order of creation.
+  const IdList& ids() const;
+  // Ids of all symbols sorted by name.
+  IdList SortedIds() const;
+  void SortByName(IdList* name_ids) const;
 
  private:
-   EntryMap entry_map_;
+  StringPool* names_;
+  IdList ids_;
+  std::vector<Entry*> index_;  // indexed by name id, nullptr if no symbol
+  std::deque<Entry> entries_;
 };
 
 }  // namespace assembler
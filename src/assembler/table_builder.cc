@@ -2,7 +2,10 @@
 
 #include <algorithm>
 #include <memory>
+#include "assembler/base_plan.h"
+#include "assembler/base_planner.h"
 #include "assembler/block_table.h"
+#include "assembler/code_generator.h"
 #include "assembler/expression_util.h"
 #include "assembler/literal_table.h"
 #include "assembler/node.h"
@@ -10,6 +13,7 @@
 #include "assembler/token.h"
 #include "common/error_db.h"
 #include "common/format.h"
+#include "common/opcode.h"
 
 using std::make_pair;
 using std::pair;
@@ -21,15 +25,134 @@ using std::vector;
 namespace sicxe {
 namespace assembler {
 
-TableBuilder::TableBuilder()
-    : code_(nullptr), error_db_(nullptr), start_address_(0), entry_point_(0),
+TableBuilder::Config::Config()
+    : relax(false), base_placement(NO_BASE_PLACEMENT), place_literals(false) {}
+
+TableBuilder::TableBuilder(const Config* config)
+    : config_(config), code_(nullptr), error_db_(nullptr), start_address_(0), entry_point_(0),
       segment_start_(0), current_block_(-1), current_address_(0), success_(false),
-      next_literal_id_(0) {}
+      next_literal_id_(0), current_node_(nullptr), current_node_added_(false) {}
 TableBuilder::~TableBuilder() {}
 
 bool TableBuilder::BuildTables(Code* code, ErrorDB* error_db) {
+  if (config_->relax || config_->base_placement == Config::INSERT_BASE) {
+    return RelaxInstructions(code, error_db);
+  }
+  if (!LayoutPass(code, error_db)) {
+    return false;
+  }
+  if (config_->base_placement == Config::SUGGEST_BASE) {
+    // errors of the plan are reported again by the real code generation
+    BasePlanner planner(nullptr);
+    ErrorDB plan_error_db;
+    code->set_base_plan(planner.PlanRegions(*code, &plan_error_db));
+  }
+  return true;
+}
+
+bool TableBuilder::RelaxInstructions(Code* code, ErrorDB* error_db) {
+  // every pass starts from the parsed nodes, literals are inserted again
+  const Code::NodeList input_nodes = code->nodes();
+  vector<node::InstructionFS34*> candidates;
+  for (node::Node* node : input_nodes) {
+    node::InstructionFS34* instruction = dyn_cast<node::InstructionFS34>(node);
+    if (instruction != nullptr && !instruction->extended() &&
+        instruction->syntax() != Syntax::FS34_NONE) {
+      candidates.push_back(instruction);
+    }
+  }
+
+  ErrorDB relax_error_db;
+  ErrorDB base_error_db;
+  ErrorDB* pass_error_db = &relax_error_db;  // of the passes that are kept
+  if (!RelaxPasses(code, input_nodes, &relax_error_db)) {
+    error_db->Append(&relax_error_db);
+    return false;
+  }
+  if (config_->base_placement != Config::NO_BASE_PLACEMENT) {
+    // only the instructions extended by relaxation may get format 3 again
+    BasePlanner::InstructionVector extended;
+    for (const node::InstructionFS34* instruction : candidates) {
+      if (instruction->extended()) {
+        extended.push_back(instruction);
+      }
+    }
+    sort(extended.begin(), extended.end());
+    BasePlanner planner(config_->base_placement == Config::INSERT_BASE ? &extended : nullptr);
+    ErrorDB plan_error_db;
+    unique_ptr<BasePlan> plan(planner.PlanRegions(*code, &plan_error_db));
+    if (plan != nullptr && config_->base_placement == Config::INSERT_BASE &&
+        !plan->regions().empty()) {
+      Code::NodeList nodes = input_nodes;
+      BasePlanner::InsertBaseLoads(*plan, code, &nodes);
+      plan->set_inserted(true);
+      for (node::InstructionFS34* instruction : candidates) {
+        instruction->set_extended(false);
+      }
+      *code->mutable_nodes() = nodes;
+      pass_error_db = &base_error_db;
+      if (!RelaxPasses(code, nodes, &base_error_db)) {
+        error_db->Append(&base_error_db);
+        return false;
+      }
+    }
+    code->set_base_plan(plan.release());
+  }
+  error_db->Append(pass_error_db);
+
+  int extended_count = 0;
+  for (const node::InstructionFS34* instruction : candidates) {
+    if (instruction->extended()) {
+      extended_count++;
+    }
+  }
+  int candidate_count = candidates.size();
+  int saved_count = candidate_count - extended_count;
+  char message_buffer[200];
+  snprintf(message_buffer, sizeof(message_buffer),
+           "relaxation: %d of %d %s extended to format 4, %d %s saved over "
+           "extending all",
+           extended_count, candidate_count,
+           (candidate_count == 1) ? "instruction" : "instructions",
+           saved_count, (saved_count == 1) ? "byte" : "bytes");
+  error_db->AddError(ErrorDB::INFO, message_buffer, code->text_file());
+  return true;
+}
+
+bool TableBuilder::RelaxPasses(Code* code, const Code::NodeList& input_nodes,
+                               ErrorDB* error_db) {
+  // instructions only grow, so the passes end after at most one per candidate
+  while (true) {
+    ErrorDB pass_error_db;
+    if (!LayoutPass(code, &pass_error_db)) {
+      error_db->Append(&pass_error_db);
+      return false;
+    }
+    CodeGenerator::InstructionVector unaddressable;
+    CodeGenerator code_generator;
+    ErrorDB check_error_db;
+    // errors of the check are reported again by the real code generation
+    if (!code_generator.FindUnaddressableInstructions(*code, &unaddressable,
+                                                      &check_error_db) ||
+        unaddressable.empty()) {
+      error_db->Append(&pass_error_db);
+      return true;
+    }
+    sort(unaddressable.begin(), unaddressable.end());
+    *code->mutable_nodes() = input_nodes;
+    for (node::Node* node : input_nodes) {
+      node::InstructionFS34* instruction = dyn_cast<node::InstructionFS34>(node);
+      if (instruction != nullptr &&
+          std::binary_search(unaddressable.begin(), unaddressable.end(), instruction)) {
+        instruction->set_extended(true);
+      }
+    }
+  }
+}
+
+bool TableBuilder::LayoutPass(Code* code, ErrorDB* error_db) {
   code_ = code;
-  symbol_table_ .reset(new SymbolTable);
+  symbol_table_.reset(new SymbolTable(code_->names()));
   block_table_.reset(new BlockTable);
   literal_table_.reset(new LiteralTable);
   error_db_ = error_db;
@@ -44,11 +167,22 @@ bool TableBuilder::BuildTables(Code* code, ErrorDB* error_db) {
   current_address_ = 0;
   success_ = true;
   next_literal_id_ = 0;
-
-  Code::NodeList* nodes = code_->mutable_nodes();
-  for (it_ = nodes->begin(); it_ != nodes->end(); ++it_) {
-    (*it_)->AcceptVisitor(this);
+  literal_locations_.clear();
+
+  // the node list is rebuilt, so literal nodes can be inserted in one pass
+  Code::NodeList input_nodes;
+  input_nodes.swap(*code_->mutable_nodes());
+  code_->mutable_nodes()->reserve(input_nodes.size());
+  for (size_t i = 0; i < input_nodes.size(); i++) {
+    current_node_ = input_nodes[i];
+    current_node_added_ = false;
+    current_node_->AcceptVisitor(this);
+    if (!current_node_added_) {
+      code_->mutable_nodes()->push_back(current_node_);
+    }
     if (!success_ || !CheckAddressOverflow(current_address_)) {
+      code_->mutable_nodes()->insert(code_->mutable_nodes()->end(),
+                                     input_nodes.begin() + i + 1, input_nodes.end());
       return false;
     }
   }
@@ -121,42 +255,15 @@ void TableBuilder::VisitNode(node::InstructionFS34* node) {
 
   if (node->addressing() == node::InstructionFS34::LITERAL_POOL) {
     int literal_id = 0;
-    if (node->data_token() != nullptr) {
-      switch (node->syntax()) {
-        case Syntax::FS34_LOAD_B:
-          literal_id = literal_table_->NewLiteralByte(node->data_token()->data());
-          break;
-        case Syntax::FS34_LOAD_W:
-          literal_id = literal_table_->NewLiteralWord(node->data_token()->data());
-          break;
-        case Syntax::FS34_LOAD_F:
-          literal_id = literal_table_->NewLiteralFloat(node->data_token()->data());
-          break;
-        default:
-          assert(false);
-          break;
-      }
-    } else {
-      int32 value = 0;
-      const bool is_byte = (node->syntax() == Syntax::FS34_LOAD_B);
-      int32 limit_min = is_byte ? -(1 << 7) : -(1 << 23);
-      int32 limit_max = is_byte ? (1 << 8) - 1 : (1 << 24) - 1;
-      if (!SolveAbsoluteExpression(node->expression(), limit_min, limit_max, &value)) {
-        success_ = false;
-        return;
-      }
-      value &= limit_max;
-      switch (node->syntax()) {
-        case Syntax::FS34_LOAD_B:
-          literal_id = literal_table_->NewLiteralByte(static_cast<uint8>(value));
-          break;
-        case Syntax::FS34_LOAD_W:
-          literal_id = literal_table_->NewLiteralWord(value);
-          break;
-        default:
-          assert(false);
-          break;
-      }
+    if (!AddLiteral(node, &literal_id)) {
+      success_ = false;
+      return;
+    }
+    if (config_->place_literals && !node->extended() && literal_id < next_literal_id_ &&
+        !LiteralInReach(literal_id)) {
+      // a copy in the next pool is closer than the one emitted before
+      literal_table_->ForgetLiteral(literal_id);
+      AddLiteral(node, &literal_id);
     }
     node->set_literal_id(literal_id);
     string symbol_name = LiteralTable::LiteralSymbolName(literal_id);
@@ -164,13 +271,70 @@ void TableBuilder::VisitNode(node::InstructionFS34* node) {
   } else {
     ReferenceExpression(node->expression());
   }
+
+  // execution never continues after these, so a pool can go right behind them
+  if (config_->place_literals &&
+      (node->opcode() == Opcode::J || node->opcode() == Opcode::RSUB)) {
+    InsertLiterals(true);
+  }
+}
+
+bool TableBuilder::AddLiteral(const node::InstructionFS34* node, int* literal_id) {
+  if (node->data_token() != nullptr) {
+    switch (node->syntax()) {
+      case Syntax::FS34_LOAD_B:
+        *literal_id = literal_table_->NewLiteralByte(node->data_token()->data());
+        break;
+      case Syntax::FS34_LOAD_W:
+        *literal_id = literal_table_->NewLiteralWord(node->data_token()->data());
+        break;
+      case Syntax::FS34_LOAD_F:
+        *literal_id = literal_table_->NewLiteralFloat(node->data_token()->data());
+        break;
+      default:
+        assert(false);
+        break;
+    }
+    return true;
+  }
+  int32 value = 0;
+  const bool is_byte = (node->syntax() == Syntax::FS34_LOAD_B);
+  int32 limit_min = is_byte ? -(1 << 7) : -(1 << 23);
+  int32 limit_max = is_byte ? (1 << 8) - 1 : (1 << 24) - 1;
+  if (!SolveAbsoluteExpression(node->expression(), node->compiled_expression(),
+                               limit_min, limit_max, &value)) {
+    return false;
+  }
+  value &= limit_max;
+  switch (node->syntax()) {
+    case Syntax::FS34_LOAD_B:
+      *literal_id = literal_table_->NewLiteralByte(static_cast<uint8>(value));
+      break;
+    case Syntax::FS34_LOAD_W:
+      *literal_id = literal_table_->NewLiteralWord(value);
+      break;
+    default:
+      assert(false);
+      break;
+  }
+  return true;
+}
+
+bool TableBuilder::LiteralInReach(int literal_id) {
+  const pair<int, uint32>& location = literal_locations_[literal_id];
+  if (location.first != current_block_) {
+    return false;
+  }
+  int32 offset = static_cast<int32>(location.second) - static_cast<int32>(current_address_);
+  return offset >= -2048;
 }
 
 void TableBuilder::VisitNode(node::DirectiveStart* node) {
   assert(node->label() != nullptr);
-  code_->set_program_name(node->label()->value());
+  code_->set_program_name(node->label()->value().ToString());
   int32 value = 0;
-  if (!SolveAbsoluteExpression(node->expression(), 0, 0xfffff, &value)) {
+  if (!SolveAbsoluteExpression(node->expression(), node->compiled_expression(),
+                               0, 0xfffff, &value)) {
     success_ = false;
     return;
   }
@@ -181,7 +345,7 @@ void TableBuilder::VisitNode(node::DirectiveStart* node) {
   current_address_ = 0;
   current_block_ = 0;
   // create symbol
-  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(node->label()->value());
+  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(node->label()->name_id());
   assert(entry->type == SymbolTable::UNKNOWN);
   entry->type = SymbolTable::INTERNAL;
   entry->relative = true;
@@ -197,7 +361,8 @@ void TableBuilder::VisitNode(node::DirectiveEnd* node) {
   InsertLiterals(false);
   EndSegment();
   int32 value = 0;
-  if (!SolveRelativeExpression(node->expression(), 0, 0xfffff, &value)) {
+  if (!SolveRelativeExpression(node->expression(), node->compiled_expression(),
+                               0, 0xfffff, &value)) {
     success_ = false;
     return;
   }
@@ -208,7 +373,8 @@ void TableBuilder::VisitNode(node::DirectiveOrg* node) {
   const node::Node::TokenList& expression = node->expression();
   EndSegment();
   int32 value = 0;
-  if (!SolveAbsoluteExpression(expression, 0, 0xfffff, &value)) {
+  if (!SolveAbsoluteExpression(expression, node->compiled_expression(),
+                               0, 0xfffff, &value)) {
     success_ = false;
     return;
   }
@@ -235,13 +401,13 @@ void TableBuilder::VisitNode(node::DirectiveEqu* node) {
   }
   int32 value = 0;
   bool relative = false;
-  if (!ExpressionUtil::Solve(node->expression(), *symbol_table_, false,
-                             &value, &relative, nullptr, error_db_) ||
+  if (!ExpressionUtil::Evaluate(node->compiled_expression(), *symbol_table_, false,
+                                &value, &relative, nullptr, error_db_) ||
       !CheckExpressionLimits(0, 0xfffff, value, node->expression())) {
     success_ = false;
     return;
   }
-  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(node->label()->value());
+  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(node->label()->name_id());
   if (entry->type == SymbolTable::EXTERNAL) {
     error_db_->AddError(ErrorDB::ERROR, "cannot define external imported symbol",
                         node->label()->pos());
@@ -279,7 +445,8 @@ void TableBuilder::VisitNode(node::DirectiveUse* node) {
   if (node->block_name() == nullptr) {
     entry = block_table_->GetBlock(0);
   } else {
-    entry = block_table_->FindNameOrCreate(node->block_name()->value());
+    entry = block_table_->FindNameOrCreate(node->block_name()->name_id(),
+                                           node->block_name()->value());
   }
   node->set_block_id(entry->block);
   current_block_ = entry->block;
@@ -341,7 +508,8 @@ void TableBuilder::VisitNode(node::DirectiveMemReserve* node) {
     }
   }
   int32 size = 0;
-  if (!SolveAbsoluteExpression(node->expression(), 1, 0xfffff, &size)) {
+  if (!SolveAbsoluteExpression(node->expression(), node->compiled_expression(),
+                               1, 0xfffff, &size)) {
     success_ = false;
     return;
   }
@@ -357,22 +525,20 @@ void TableBuilder::VisitNode(node::DirectiveInternalLiteral*) {
 }
 
 void TableBuilder::InsertLiterals(bool after_node) {
-  literal_table_->ClearLookupTables();
+  if (!config_->place_literals) {
+    literal_table_->ClearLookupTables();
+  }
   int literal_table_size = literal_table_->entries().size();
   for (; next_literal_id_ < literal_table_size; next_literal_id_++) {
     // insert node
-    unique_ptr<node::DirectiveInternalLiteral> node(new node::DirectiveInternalLiteral);
+    node::DirectiveInternalLiteral* node =
+      code_->arena()->New<node::DirectiveInternalLiteral>();
     node->set_literal_id(next_literal_id_);
-    if (after_node) {
-      // insert after current node and advance it_
-      auto next_it = it_;
-      ++next_it;
-      code_->mutable_nodes()->emplace(next_it, std::move(node));
-      ++it_;
-    } else {
-      // insert before current node
-      code_->mutable_nodes()->emplace(it_, std::move(node));
+    if (after_node && !current_node_added_) {
+      code_->mutable_nodes()->push_back(current_node_);
+      current_node_added_ = true;
     }
+    code_->mutable_nodes()->push_back(node);
     // create symbol
     string symbol_name = LiteralTable::LiteralSymbolName(next_literal_id_);
     SymbolTable::Entry* symbol_entry = symbol_table_->FindOrCreateNew(symbol_name);
@@ -382,6 +548,7 @@ void TableBuilder::InsertLiterals(bool after_node) {
     symbol_entry->defined = true;
     symbol_entry->block = current_block_;
     symbol_entry->block_address = current_address_;
+    literal_locations_.push_back(make_pair(current_block_, current_address_));
     if (current_block_ == -1) {
       symbol_entry->address = current_address_;
       symbol_entry->resolved = true;
@@ -406,12 +573,13 @@ void TableBuilder::InsertLiterals(bool after_node) {
 }
 
 bool TableBuilder::SolveAbsoluteExpression(const node::Node::TokenList& expression,
+                                           const ExpressionUtil::Program& program,
                                            int32 limit_min, int32 limit_max,
                                            int32* result) {
   int32 value = 0;
   bool relative = false;
-  if (!ExpressionUtil::Solve(expression, *symbol_table_, false,
-                             &value, &relative, nullptr, error_db_)) {
+  if (!ExpressionUtil::Evaluate(program, *symbol_table_, false,
+                                &value, &relative, nullptr, error_db_)) {
     return false;
   }
   if (relative) {
@@ -427,12 +595,13 @@ bool TableBuilder::SolveAbsoluteExpression(const node::Node::TokenList& expressi
 }
 
 bool TableBuilder::SolveRelativeExpression(const node::Node::TokenList& expression,
+                                           const ExpressionUtil::Program& program,
                                           int32 limit_min, int32 limit_max,
                                           int32* result) {
   int32 value = 0;
   bool relative = false;
-  if (!ExpressionUtil::Solve(expression, *symbol_table_, false,
-                             &value, &relative, nullptr, error_db_)) {
+  if (!ExpressionUtil::Evaluate(program, *symbol_table_, false,
+                                &value, &relative, nullptr, error_db_)) {
     return false;
   }
   if (!relative) {
@@ -485,7 +654,7 @@ bool TableBuilder::CheckExpressionLimits(int32 limit_min, int32 limit_max, int32
 }
 
 bool TableBuilder::DefineSymbol(const Token& token) {
-  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(token.value());
+  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(token.name_id());
   if (entry->type == SymbolTable::EXTERNAL) {
     error_db_->AddError(ErrorDB::ERROR, "cannot define external imported symbol",
                         token.pos());
@@ -518,7 +687,7 @@ void TableBuilder::ReferenceSymbol(const std::string& name) {
 }
 
 void TableBuilder::ReferenceSymbolToken(const Token& token) {
-  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(token.value());
+  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(token.name_id());
   if (entry->type == SymbolTable::UNKNOWN ||
       (entry->type == SymbolTable::INTERNAL && !entry->defined)) {
     undefined_symbol_tokens_.push_back(make_pair(&token, entry));
@@ -535,7 +704,7 @@ void TableBuilder::ReferenceExpression(const node::Node::TokenList& expression)
 }
 
 bool TableBuilder::ImportSymbol(const Token& token) {
-  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(token.value());
+  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(token.name_id());
   if (entry->type == SymbolTable::EXTERNAL) {
     error_db_->AddError(ErrorDB::WARNING, "symbol already marked as imported",
                         token.pos());
@@ -558,7 +727,7 @@ bool TableBuilder::ImportSymbol(const Token& token) {
 }
 
 bool TableBuilder::ExportSymbol(const Token& token) {
-  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(token.value());
+  SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(token.name_id());
   if (entry->type == SymbolTable::EXTERNAL) {
     error_db_->AddError(ErrorDB::ERROR, "cannot export symbol marked as imported",
                         token.pos());
@@ -634,8 +803,8 @@ bool TableBuilder::CheckIntersect() {
 
 void TableBuilder::FinalizeSymbolTable(bool* has_undefined_symbols) {
   *has_undefined_symbols = false;
-  for (auto& entry_pair : *symbol_table_->mutable_entry_map()) {
-    SymbolTable::Entry* entry = &entry_pair.second;
+  for (StringPool::Id name_id : symbol_table_->ids()) {
+    SymbolTable::Entry* entry = symbol_table_->Find(name_id);
     // set final address for symbols from blocks
     if (entry->type == SymbolTable::INTERNAL &&
         entry->defined && !entry->resolved) {
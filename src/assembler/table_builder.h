@@ -24,12 +24,38 @@ class TableBuilder : public NodeVisitor {
  public:
   DISALLOW_COPY_AND_MOVE(TableBuilder);
 
-  TableBuilder();
+  struct Config {
+    enum BasePlacementId {
+      NO_BASE_PLACEMENT = 0,
+      SUGGEST_BASE,  // base register loads are only planned, see BasePlanner
+      INSERT_BASE    // LDB and BASE are inserted, implies relax
+    };
+
+    Config();
+
+    // Instructions written without '+' get format 4 only where their operand
+    // cannot be addressed with format 3, see RelaxInstructions().
+    bool relax;
+    BasePlacementId base_placement;
+    // Literal pools are also inserted after J and RSUB, close to the
+    // instructions that use them, and literals of earlier pools are reused
+    // where they are in reach of PC relative addressing.
+    bool place_literals;
+  };
+
+  explicit TableBuilder(const Config* config);
   ~TableBuilder();
 
   bool BuildTables(Code* code, ErrorDB* error_db);
 
  private:
+  bool LayoutPass(Code* code, ErrorDB* error_db);
+  // Repeats the layout, extending format 3 instructions which cannot reach
+  // their operand, until no instruction grows.
+  bool RelaxInstructions(Code* code, ErrorDB* error_db);
+  // Layout passes of RelaxInstructions(), starting from |input_nodes|.
+  bool RelaxPasses(Code* code, const Code::NodeList& input_nodes, ErrorDB* error_db);
+
   virtual void VisitNode(node::Empty* node);
   virtual void VisitNode(node::InstructionF1* node);
   virtual void VisitNode(node::InstructionF2* node);
@@ -48,10 +74,17 @@ class TableBuilder : public NodeVisitor {
   virtual void VisitNode(node::DirectiveMemReserve* node);
   virtual void VisitNode(node::DirectiveInternalLiteral* node);
 
+  // Adds the literal operand of |node| to the literal table.
+  bool AddLiteral(const node::InstructionFS34* node, int* literal_id);
+  // Literal |literal_id| was already emitted within PC relative reach of the
+  // format 3 instruction that ends at the current address.
+  bool LiteralInReach(int literal_id);
   void InsertLiterals(bool after_node);
   bool SolveAbsoluteExpression(const node::Node::TokenList& expression,
+                               const ExpressionUtil::Program& program,
                                int32 limit_min, int32 limit_max, int32* result);
   bool SolveRelativeExpression(const node::Node::TokenList& expression,
+                               const ExpressionUtil::Program& program,
                                int32 limit_min, int32 limit_max, int32* result);
   void EndSegment();
   bool CheckAddressOverflow(uint32 address);
@@ -70,6 +103,7 @@ class TableBuilder : public NodeVisitor {
   void UndefinedSymbolsError();
   uint32 GetEndAddress();
 
+  const Config* config_;
   Code* code_;
   std::unique_ptr<SymbolTable> symbol_table_;
   std::unique_ptr<BlockTable> block_table_;
@@ -85,7 +119,10 @@ class TableBuilder : public NodeVisitor {
   uint32 current_address_;
   bool success_;
   int next_literal_id_;  // next literal that has not yet been inserted
-  Code::NodeList::iterator it_;
+  // block and address in the block of every inserted literal
+  std::vector<std::pair<int, uint32> > literal_locations_;
+  node::Node* current_node_;
+  bool current_node_added_;  // current node is already in the rebuilt node list
 };
 
 }  // namespace assembler
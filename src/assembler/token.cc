@@ -10,8 +10,8 @@ namespace assembler {
 Token::Token(TypeId the_type, const TextFile& text_file,
              const TextFile::Position& the_pos)
     : type_(the_type), pos_(the_pos),
-      value_(text_file.lines()[pos_.row].substr(pos_.column, pos_.size)),
-      integer_(0) {}
+      value_(text_file.line(pos_.row).substr(pos_.column, pos_.size)),
+      integer_(0), name_id_(StringPool::kInvalidId) {}
 
 Token::~Token() {}
 
@@ -23,7 +23,7 @@ const TextFile::Position& Token::pos() const {
   return pos_;
 }
 
-const string& Token::value() const {
+StringView Token::value() const {
   return value_;
 }
 
@@ -55,5 +55,13 @@ string* Token::mutable_data() {
   return &data_;
 }
 
+StringPool::Id Token::name_id() const {
+  return name_id_;
+}
+
+void Token::set_name_id(StringPool::Id id) {
+  name_id_ = id;
+}
+
 }  // namespace assembler
 }  // namespace sicxe
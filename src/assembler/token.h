@@ -3,6 +3,8 @@
 
 #include <string>
 #include "common/macros.h"
+#include "common/string_pool.h"
+#include "common/string_view.h"
 #include "common/text_file.h"
 #include "common/types.h"
 
@@ -40,7 +42,8 @@ class Token {
 
   TypeId type() const;
   const TextFile::Position& pos() const;
-  const std::string& value() const;
+  // View into the source file, valid while the file is unchanged.
+  StringView value() const;
   OperatorId operator_id() const;
   void set_operator_id(OperatorId id);
   uint32 integer() const;
@@ -48,14 +51,18 @@ class Token {
   const std::string& data() const;
   void set_data(const std::string& the_data);
   std::string* mutable_data();
+  // Interned value of NAME tokens, kInvalidId for other tokens.
+  StringPool::Id name_id() const;
+  void set_name_id(StringPool::Id id);
 
  private:
   TypeId type_;
   TextFile::Position pos_;
-  std::string value_;
+  StringView value_;
   OperatorId operator_id_;
   uint32 integer_;
   std::string data_;
+  StringPool::Id name_id_;
 };
 
 }  // namespace assembler
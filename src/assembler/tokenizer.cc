@@ -1,28 +1,30 @@
 #include "assembler/tokenizer.h"
 
 #include <assert.h>
-#include <errno.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
-#include <memory>
+#include <new>
 #include <string>
+#include "assembler/char_scan_util.h"
 #include "assembler/token.h"
+#include "common/arena.h"
 #include "common/error_db.h"
 #include "common/float_util.h"
+#include "common/string_pool.h"
 #include "common/text_file.h"
 
 using std::string;
-using std::unique_ptr;
 
 namespace sicxe {
 namespace assembler {
 
 const char* Tokenizer::kOperatorCharacters = "#@,[]=+-*/";
 
-Tokenizer::Tokenizer()
-    : tokens_(nullptr), error_db_(nullptr), line_nr_(0), line_(nullptr),
-      line_size_(0), state_(INVALID), token_start_(0), position_(0) {}
+Tokenizer::Tokenizer(Arena* arena, StringPool* names)
+    : arena_(arena), names_(names), file_(nullptr), tokens_(nullptr), error_db_(nullptr),
+      line_nr_(0), line_(nullptr), line_size_(0), state_(INVALID), token_start_(0),
+      position_(0), allocated_tokens_(nullptr) {}
 
 Tokenizer::~Tokenizer() {}
 
@@ -91,18 +93,30 @@ bool* CreateMaskValidFloat() {
   return mask;
 }
 
+char HexDigitValue(char digit) {
+  if (digit >= '0' && digit <= '9') {
+    return digit - '0';
+  } else if (digit >= 'a' && digit <= 'f') {
+    return digit - 'a' + 10;
+  } else if (digit >= 'A' && digit <= 'F') {
+    return digit - 'A' + 10;
+  }
+  return 0;
+}
+
 }  // namespace
 
 bool Tokenizer::TokenizeLine(const TextFile& file, int line_number,
                              TokenList* tokens, ErrorDB* error_db) {
-  assert(line_number < static_cast<int>(file.lines().size()));
+  assert(line_number < static_cast<int>(file.line_count()));
   error_db->SetCurrentFile(&file);
   file_ = &file;
   tokens_ = tokens;
   error_db_ = error_db;
   line_nr_ = line_number;
-  line_ = file.lines()[line_number].data();
-  line_size_ = file.lines()[line_number].size();
+  StringView line = file.line(line_number);
+  line_ = line.data();
+  line_size_ = line.size();
   state_ = NONE;
   token_start_ = 0;
   position_ = 0;
@@ -247,10 +261,40 @@ bool Tokenizer::TokenizeLine(const TextFile& file, int line_number,
         break;
       }
     }
+
+    // skip the characters that the state machine would step over without
+    // any action, only token boundaries are handled one at a time
+    CharScanUtil::ClassId run_class;
+    if (RunClass(state_, &run_class)) {
+      position_ = CharScanUtil::SkipRun(run_class, line_, position_ + 1, line_size_) - 1;
+    }
   }
   return true;
 }
 
+bool Tokenizer::RunClass(StateId state, CharScanUtil::ClassId* class_id) {
+  switch (state) {
+    case NONE:
+      *class_id = CharScanUtil::BLANK;
+      return true;
+    case NAME:
+      *class_id = CharScanUtil::NAME;
+      return true;
+    case INTEGER_DEC:
+      *class_id = CharScanUtil::DECIMAL;
+      return true;
+    case INTEGER_HEX:
+    case DATA_HEX:
+      *class_id = CharScanUtil::HEX;
+      return true;
+    case COMMENT:
+      *class_id = CharScanUtil::PRINTABLE;
+      return true;
+    default:
+      return false;
+  }
+}
+
 Tokenizer::StateId* Tokenizer::CreateStartLookupTable() {
   StateId* table = new StateId[1 << 8];
   for (size_t i = 0; i < (1 << 8); i++) {
@@ -385,9 +429,31 @@ void Tokenizer::ErrorCommentInvalidChar() {
                       TextFile::Position(line_nr_, position_, 1));
 }
 
+void Tokenizer::ReleaseToken(Token* token) {
+  free_tokens_.push_back(token);
+}
+
+void Tokenizer::set_allocated_tokens(TokenList* tokens) {
+  allocated_tokens_ = tokens;
+}
+
+Token* Tokenizer::NewToken(Token::TypeId type, const TextFile::Position& pos) {
+  if (free_tokens_.empty()) {
+    Token* token = arena_->New<Token>(type, *file_, pos);
+    if (allocated_tokens_ != nullptr) {
+      allocated_tokens_->push_back(token);
+    }
+    return token;
+  }
+  // reuse the memory of a released token, the arena still destroys it once
+  Token* token = free_tokens_.back();
+  free_tokens_.pop_back();
+  token->~Token();
+  return new (token) Token(type, *file_, pos);
+}
+
 void Tokenizer::CommitOperator() {
-  unique_ptr<Token> token(
-      new Token(Token::OPERATOR, *file_, TextFile::Position(line_nr_, token_start_, 1)));
+  Token* token = NewToken(Token::OPERATOR, TextFile::Position(line_nr_, token_start_, 1));
 
   Token::OperatorId id = Token::OP_ADD;
   switch (token->value()[0]) {
@@ -427,19 +493,21 @@ void Tokenizer::CommitOperator() {
   }
   token->set_operator_id(id);
 
-  tokens_->emplace_back(std::move(token));
+  tokens_->push_back(token);
   state_ = NONE;
 }
 
 void Tokenizer::CommitName() {
-  tokens_->emplace_back(new Token(Token::NAME, *file_,
-        TextFile::Position(line_nr_, token_start_, position_ - token_start_)));
+  Token* token = NewToken(Token::NAME,
+        TextFile::Position(line_nr_, token_start_, position_ - token_start_));
+  token->set_name_id(names_->Intern(token->value()));
+  tokens_->push_back(token);
   state_ = NONE;
 }
 
 bool Tokenizer::CommitInteger() {
-  unique_ptr<Token> token(new Token(Token::INTEGER, *file_,
-        TextFile::Position(line_nr_, token_start_, position_ - token_start_)));
+  Token* token = NewToken(Token::INTEGER,
+        TextFile::Position(line_nr_, token_start_, position_ - token_start_));
 
   int base = 0;
   switch (state_) {
@@ -460,37 +528,35 @@ bool Tokenizer::CommitInteger() {
       break;
   }
 
-  const char* value_str = nullptr;
-  if (state_ == INTEGER_DEC) {
-    value_str = token->value().c_str();
-  } else {
-    value_str = token->value().c_str() + 2;
-    if (token->value().size() <= 2) {
+  StringView digits = token->value();
+  if (state_ != INTEGER_DEC) {
+    if (digits.size() <= 2) {
       error_db_->AddError(ErrorDB::ERROR, "invalid integer constant", token->pos());
       return false;
     }
+    digits = digits.substr(2, digits.size() - 2);
   }
 
-  char* end_ptr = nullptr;
-  errno = 0;
-  uint64 value = static_cast<uint64>(strtoull(value_str, &end_ptr, base));
-  if (errno == ERANGE || value > 0xffffffff) {
-    error_db_->AddError(ErrorDB::ERROR, "integer constant is too large", token->pos());
-    return false;
-  } else {
-    assert(errno == 0);
+  // digits were validated while scanning the token
+  uint64 value = 0;
+  for (char digit : digits) {
+    assert(HexDigitValue(digit) < base);
+    value = value * base + HexDigitValue(digit);
+    if (value > 0xffffffff) {
+      error_db_->AddError(ErrorDB::ERROR, "integer constant is too large", token->pos());
+      return false;
+    }
   }
-  assert(*end_ptr == '\0');
   token->set_integer(value);
 
-  tokens_->emplace_back(std::move(token));
+  tokens_->push_back(token);
   state_ = NONE;
   return true;
 }
 
 bool Tokenizer::CommitDataChar() {
-  unique_ptr<Token> token(new Token(Token::DATA_BIN, *file_,
-        TextFile::Position(line_nr_, token_start_, position_ - token_start_ + 1)));
+  Token* token = NewToken(Token::DATA_BIN,
+        TextFile::Position(line_nr_, token_start_, position_ - token_start_ + 1));
 
   if (token->value().size() <= 3) {
     error_db_->AddError(ErrorDB::ERROR, "data constant cannot be empty", token->pos());
@@ -500,7 +566,7 @@ bool Tokenizer::CommitDataChar() {
   *token->mutable_data() = std::move(data_char_value_);
   data_char_value_ = string();
 
-  tokens_->emplace_back(std::move(token));
+  tokens_->push_back(token);
   state_ = NONE;
   return true;
 }
@@ -548,26 +614,11 @@ bool Tokenizer::AdvanceDataChar() {
   }
 }
 
-namespace {
-
-char HexDigitValue(char digit) {
-  if (digit >= '0' && digit <= '9') {
-    return digit - '0';
-  } else if (digit >= 'a' && digit <= 'f') {
-    return digit - 'a' + 10;
-  } else if (digit >= 'A' && digit <= 'F') {
-    return digit - 'A' + 10;
-  }
-  return 0;
-}
-
-}  // namespace
-
 bool Tokenizer::CommitDataHex() {
-  unique_ptr<Token> token(new Token(Token::DATA_BIN, *file_,
-        TextFile::Position(line_nr_, token_start_, position_ - token_start_ + 1)));
+  Token* token = NewToken(Token::DATA_BIN,
+        TextFile::Position(line_nr_, token_start_, position_ - token_start_ + 1));
 
-  const string& value = token->value();
+  StringView value = token->value();
   if (value.size() <= 3) {
     error_db_->AddError(ErrorDB::ERROR, "data constant cannot be empty", token->pos());
     return false;
@@ -589,16 +640,17 @@ bool Tokenizer::CommitDataHex() {
   }
   *token->mutable_data() = std::move(data);
 
-  tokens_->emplace_back(std::move(token));
+  tokens_->push_back(token);
   state_ = NONE;
   return true;
 }
 
 bool Tokenizer::CommitDataFloat() {
-  unique_ptr<Token> token(new Token(Token::DATA_FLOAT, *file_,
-        TextFile::Position(line_nr_, token_start_, position_ - token_start_ + 1)));
+  Token* token = NewToken(Token::DATA_FLOAT,
+        TextFile::Position(line_nr_, token_start_, position_ - token_start_ + 1));
 
-  const string& value = token->value();
+  // strtod needs a terminated string
+  string value = token->value().ToString();
   if (value.size() <= 3) {
     error_db_->AddError(ErrorDB::ERROR, "data constant cannot be empty", token->pos());
     return false;
@@ -616,13 +668,13 @@ bool Tokenizer::CommitDataFloat() {
   FloatUtil::EncodeFloatData(value_double, reinterpret_cast<uint8*>(&data[0]));
   *token->mutable_data() = std::move(data);
 
-  tokens_->emplace_back(std::move(token));
+  tokens_->push_back(token);
   state_ = NONE;
   return true;
 }
 
 void Tokenizer::CommitComment() {
-  tokens_->emplace_back(new Token(Token::COMMENT, *file_,
+  tokens_->push_back(NewToken(Token::COMMENT,
         TextFile::Position(line_nr_, token_start_, position_ - token_start_)));
   state_ = NONE;
 }
@@ -1,33 +1,43 @@
 #ifndef ASSEMBLER_TOKENIZER_H
 #define ASSEMBLER_TOKENIZER_H
 
-#include <list>
-#include <memory>
 #include <string>
+#include <vector>
+#include "assembler/char_scan_util.h"
+#include "assembler/token.h"
 #include "common/macros.h"
+#include "common/text_file.h"
 
 namespace sicxe {
 
+class Arena;
 class ErrorDB;
-class TextFile;
+class StringPool;
 
 namespace assembler {
 
-class Token;
-
 class Tokenizer {
  public:
   DISALLOW_COPY_AND_MOVE(Tokenizer);
 
-  typedef std::list<std::unique_ptr<Token> > TokenList;
+  typedef std::vector<Token*> TokenList;
 
   static const char* kOperatorCharacters;
 
-  Tokenizer();
+  // Tokens are allocated from |arena| and live as long as the arena. Values of
+  // NAME tokens are interned in |names|.
+  Tokenizer(Arena* arena, StringPool* names);
   ~Tokenizer();
 
+  // Appends tokens of the line to |tokens|.
   bool TokenizeLine(const TextFile& file, int line_number, TokenList* tokens,
                     ErrorDB* error_db);
+  // Hands back a token that is no longer referenced, its memory is reused for
+  // the next token.
+  void ReleaseToken(Token* token);
+  // If set, every token allocated from the arena is also appended to |tokens|,
+  // so the caller can visit them all later. Released tokens are listed once.
+  void set_allocated_tokens(TokenList* tokens);
 
  private:
   enum StateId {
@@ -38,8 +48,11 @@ class Tokenizer {
     OPERATOR = 10, INVALID = 11
   };
 
+  Token* NewToken(Token::TypeId type, const TextFile::Position& pos);
   StateId* CreateStartLookupTable();
   bool TokenStart();
+  // Returns the class of characters that |state| consumes without any action.
+  static bool RunClass(StateId state, CharScanUtil::ClassId* class_id);
 
   void ErrorUnmatchedQuote();
   void ErrorNameInvalidChar();
@@ -60,6 +73,8 @@ class Tokenizer {
   bool CommitDataFloat();
   void CommitComment();
 
+  Arena* arena_;
+  StringPool* names_;
   const TextFile* file_;
   TokenList* tokens_;
   ErrorDB* error_db_;
@@ -70,6 +85,8 @@ class Tokenizer {
   size_t token_start_;  // start of current token
   size_t position_;  // current position in line
   std::string data_char_value_;
+  TokenList free_tokens_;
+  TokenList* allocated_tokens_;
 };
 
 }  // namespace assembler
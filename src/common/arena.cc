@@ -0,0 +1,76 @@
+#include "common/arena.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+namespace sicxe {
+
+const size_t Arena::kBlockSize = 64 * 1024;
+
+Arena::Arena()
+  : destructors_(nullptr), current_(nullptr), remaining_(0), allocated_size_(0) {}
+
+Arena::~Arena() {
+  for (Destructor* destructor = destructors_; destructor != nullptr;
+       destructor = destructor->next) {
+    destructor->destroy(destructor->object);
+  }
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  size_t padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) %
+                   alignment;
+  if (current_ == nullptr || padding + size > remaining_) {
+    // large objects get a block of their own, the current block stays in use
+    if (size + alignment > kBlockSize / 4) {
+      blocks_.emplace_back(new char[size + alignment]);
+      char* block = blocks_.back().get();
+      padding = (alignment - reinterpret_cast<uintptr_t>(block) % alignment) %
+                alignment;
+      allocated_size_ += padding + size;
+      return block + padding;
+    }
+    blocks_.emplace_back(new char[kBlockSize]);
+    current_ = blocks_.back().get();
+    remaining_ = kBlockSize;
+    padding = (alignment - reinterpret_cast<uintptr_t>(current_) % alignment) %
+              alignment;
+  }
+  char* result = current_ + padding;
+  current_ += padding + size;
+  remaining_ -= padding + size;
+  allocated_size_ += padding + size;
+  return result;
+}
+
+void Arena::Absorb(Arena* other) {
+  assert(other != this);
+  for (auto& block : other->blocks_) {
+    blocks_.push_back(std::move(block));
+  }
+  other->blocks_.clear();
+  if (other->destructors_ != nullptr) {
+    Destructor* last = other->destructors_;
+    while (last->next != nullptr) {
+      last = last->next;
+    }
+    last->next = destructors_;
+    destructors_ = other->destructors_;
+  }
+  allocated_size_ += other->allocated_size_;
+  other->destructors_ = nullptr;
+  other->current_ = nullptr;
+  other->remaining_ = 0;
+  other->allocated_size_ = 0;
+}
+
+size_t Arena::block_count() const {
+  return blocks_.size();
+}
+
+size_t Arena::allocated_size() const {
+  return allocated_size_;
+}
+
+}  // namespace sicxe
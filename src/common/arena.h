@@ -0,0 +1,71 @@
+#ifndef COMMON_ARENA_H
+#define COMMON_ARENA_H
+
+#include <stddef.h>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "common/macros.h"
+
+namespace sicxe {
+
+// Bump pointer allocator for objects that share a lifetime. Objects are placed
+// in large blocks and destroyed together with the arena, in reverse order of
+// allocation. Objects with trivial destructors cost no bookkeeping.
+class Arena {
+ public:
+  DISALLOW_COPY_AND_MOVE(Arena);
+
+  static const size_t kBlockSize;
+
+  Arena();
+  ~Arena();
+
+  template<typename T, typename... Args>
+  T* New(Args&&... args) {
+    T* object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      Destructor* destructor = static_cast<Destructor*>(
+          Allocate(sizeof(Destructor), alignof(Destructor)));
+      destructor->destroy = &Destroy<T>;
+      destructor->object = object;
+      destructor->next = destructors_;
+      destructors_ = destructor;
+    }
+    return object;
+  }
+
+  // Returns uninitialized memory, freed when the arena is destroyed.
+  void* Allocate(size_t size, size_t alignment);
+
+  // Takes over the memory and objects of |other|, which is left empty. Objects
+  // of |other| are destroyed before the ones allocated here.
+  void Absorb(Arena* other);
+
+  size_t block_count() const;
+  size_t allocated_size() const;  // bytes handed out, including padding
+
+ private:
+  // kept in the arena itself, most recent first
+  struct Destructor {
+    void (*destroy)(void*);
+    void* object;
+    Destructor* next;
+  };
+
+  template<typename T>
+  static void Destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  std::vector<std::unique_ptr<char[]> > blocks_;
+  Destructor* destructors_;
+  char* current_;
+  size_t remaining_;
+  size_t allocated_size_;
+};
+
+}  // namespace sicxe
+
+#endif  // COMMON_ARENA_H
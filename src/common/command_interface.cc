@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -71,6 +72,28 @@ bool CommandInterface::ActionIsCancelled() {
   return cancellable_action_cancelled;
 }
 
+bool CommandInterface::ParseWord(const string& str, uint32* result) {
+  const char* buffer = str.c_str();
+  int base = 10;
+  if (str.length() > 2 && str[0] == '0' && str[1] == 'x') {  // hex
+    buffer += 2;
+    base = 16;
+  }
+  char* end_ptr = nullptr;
+  errno = 0;
+  int64 value = strtoll(buffer, &end_ptr, base);
+  if (end_ptr == buffer || *end_ptr != '\0' || errno == ERANGE) {
+    return false;
+  }
+  // signed and unsigned words are both accepted, hex numbers are unsigned
+  int64 min_value = (base == 10) ? -0x800000 : 0;
+  if (value < min_value || value > 0xFFFFFF) {
+    return false;
+  }
+  *result = static_cast<uint32>(value) & 0xFFFFFF;
+  return true;
+}
+
 namespace {
 
 CommandInterface::MenuNode* MenuMapFindOrNull(
@@ -392,29 +415,6 @@ bool NormalizeCommandString(string* command) {
   return true;
 }
 
-bool TryParseWord(const string& str, uint32* result) {
-  // TODO: Maybe make checks here a bit more strict (overflow?)
-  int32 value = 0;
-  if (str.length() > 2 && str[0] == '0' && str[1] == 'x') {  // hex
-    const char* buffer = str.c_str() + 2;
-    char* end_ptr = nullptr;
-    value = static_cast<int32>(strtol(buffer, &end_ptr, 16));
-    if (end_ptr == buffer || *end_ptr != '\0') {
-      return false;
-    }
-  } else {  // decimal
-    const char* buffer = str.c_str();
-    char* end_ptr = nullptr;
-    value = static_cast<int32>(strtol(buffer, &end_ptr, 10));
-    if (end_ptr == buffer || *end_ptr != '\0') {
-      return false;
-    }
-  }
-  value &= 0xFFFFFF;
-  *result = static_cast<uint32>(value);
-  return true;
-}
-
 bool TryParseBool(const string& str, bool* result) {
   string normalized = str;
   for (size_t i = 0; i < normalized.size(); i++) {
@@ -506,8 +506,8 @@ bool CommandInterface::ParseInput(const vector<string>& tokens,
       ParsedArgument* parsed_argument = &insert_result.first->second;
       parsed_argument->value_str = tokens[index + 2];
 
-      parsed_argument->is_word = TryParseWord(parsed_argument->value_str,
-                                              &parsed_argument->value_word);
+      parsed_argument->is_word = ParseWord(parsed_argument->value_str,
+                                           &parsed_argument->value_word);
 
       parsed_argument->is_bool = TryParseBool(parsed_argument->value_str,
                                               &parsed_argument->value_bool);
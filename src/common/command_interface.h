@@ -63,6 +63,10 @@ class CommandInterface {
   void EndCancellableAction();
   bool ActionIsCancelled();
 
+  // Parses a decimal or hexadecimal (0x prefix) number, returns false if it
+  // does not fit in a word. Negative decimal numbers are two's complement.
+  static bool ParseWord(const std::string& str, uint32* result);
+
  private:
   void ExitCommandHandler(const ParsedArgumentMap& arguments);
   MenuNode* FindMenuNode(const std::vector<std::string>& command_path,
@@ -62,6 +62,17 @@ void ErrorDB::SetCurrentFile(const TextFile* file) {
   current_file_ = file;
 }
 
+void ErrorDB::Append(ErrorDB* other) {
+  assert(other != this);
+  entries_.splice(entries_.end(), other->entries_);
+  error_count_ += other->error_count_;
+  warning_count_ += other->warning_count_;
+  info_count_ += other->info_count_;
+  other->error_count_ = 0;
+  other->warning_count_ = 0;
+  other->info_count_ = 0;
+}
+
 const ErrorDB::EntryList& ErrorDB::entries() const {
   return entries_;
 }
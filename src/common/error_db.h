@@ -51,6 +51,8 @@ class ErrorDB {
                 const TextFile::Position& start, const TextFile::Position& end);
 
   void SetCurrentFile(const TextFile* file);
+  // Moves all entries of |other| to the end of this database.
+  void Append(ErrorDB* other);
 
   const EntryList& entries() const;
   int error_count() const;
@@ -13,11 +13,11 @@ ErrorFormatter::~ErrorFormatter() {}
 
 void ErrorFormatter::FileUnderline(const TextFile* file,
                                    const TextFile::Position& pos) const {
-  assert(pos.row < static_cast<int>(file->lines().size()));
-  const string& line = file->lines()[pos.row];
+  assert(pos.row < static_cast<int>(file->line_count()));
+  StringView line = file->line(pos.row);
   assert(pos.size > 0);
   assert((pos.column + pos.size - 1) < static_cast<int>(line.size()));
-  fprintf(stderr, "%s\n", line.c_str());
+  fprintf(stderr, "%.*s\n", static_cast<int>(line.size()), line.data());
   for (int i = 0; i < pos.column; i++) {
     fprintf(stderr, " ");
   }
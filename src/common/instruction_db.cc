@@ -126,8 +126,8 @@ bool InstructionDB::LoadFromFile(const TextFile& file, InstructionDB* instructio
   static const SyntaxNameMap* syntax_name_map_f2 = CreateSyntaxNameMapF2();
   static const SyntaxNameMap* syntax_name_map_fs34 = CreateSyntaxNameMapFS34();
   error_db->SetCurrentFile(&file);
-  for (size_t row = 0; row < file.lines().size(); row++) {
-    const string& line = file.lines()[row];
+  for (size_t row = 0; row < file.line_count(); row++) {
+    StringView line = file.line(row);
     // split line by whitespace
     vector<pair<string, TextFile::Position> > tokens;
     string current_token;
@@ -0,0 +1,46 @@
+#ifndef COMMON_LITTLE_ENDIAN_H
+#define COMMON_LITTLE_ENDIAN_H
+
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+
+// Field access for the binary file formats - object files, archives and
+// incremental link state - which store integers little-endian and start every
+// part at a multiple of four bytes.
+class LittleEndian {
+ public:
+  DISALLOW_INSTANTIATE(LittleEndian);
+
+  static uint32 ReadUint32(const uint8* data) {
+    return static_cast<uint32>(data[0]) | (static_cast<uint32>(data[1]) << 8) |
+           (static_cast<uint32>(data[2]) << 16) | (static_cast<uint32>(data[3]) << 24);
+  }
+
+  static uint64 ReadUint64(const uint8* data) {
+    return static_cast<uint64>(ReadUint32(data)) |
+           (static_cast<uint64>(ReadUint32(data + 4)) << 32);
+  }
+
+  static void WriteUint32(uint32 value, uint8* data) {
+    data[0] = value & 0xff;
+    data[1] = (value >> 8) & 0xff;
+    data[2] = (value >> 16) & 0xff;
+    data[3] = (value >> 24) & 0xff;
+  }
+
+  static void WriteUint64(uint64 value, uint8* data) {
+    WriteUint32(static_cast<uint32>(value), data);
+    WriteUint32(static_cast<uint32>(value >> 32), data + 4);
+  }
+
+  // |size| padded to a multiple of four bytes
+  static uint64 RoundUp4(uint64 size) {
+    return (size + 3) & ~static_cast<uint64>(3);
+  }
+};
+
+}  // namespace sicxe
+
+#endif  // COMMON_LITTLE_ENDIAN_H
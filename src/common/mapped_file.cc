@@ -0,0 +1,98 @@
+#include "common/mapped_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sicxe {
+
+namespace {
+
+const size_t kReadBufferSize = 64 * 1024;
+
+}  // namespace
+
+MappedFile::MappedFile() : address_(nullptr), size_(0), mapped_(false) {}
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+bool MappedFile::Open(const char* file_name) {
+  Close();
+  int fd = open(file_name, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = static_cast<size_t>(file_stat.st_size);
+  if (S_ISREG(file_stat.st_mode) && size > 0) {
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (address != MAP_FAILED) {
+      address_ = address;
+      size_ = size;
+      mapped_ = true;
+    }
+  }
+  bool success = mapped_ || (S_ISREG(file_stat.st_mode) && size == 0) || Read(fd);
+  // the mapping stays valid after the descriptor is closed
+  close(fd);
+  return success;
+}
+
+bool MappedFile::Read(int fd) {
+  // pipes and other streams cannot be mapped, so they are read into a buffer
+  size_t size = 0;
+  while (true) {
+    buffer_.resize(size + kReadBufferSize);
+    ssize_t read_size = read(fd, &buffer_[size], kReadBufferSize);
+    if (read_size < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      buffer_.clear();
+      return false;
+    }
+    if (read_size == 0) {
+      break;
+    }
+    size += read_size;
+  }
+  buffer_.resize(size);
+  if (size > 0) {
+    address_ = buffer_.data();
+    size_ = size;
+  }
+  return true;
+}
+
+void MappedFile::Close() {
+  if (mapped_) {
+    munmap(address_, size_);
+  }
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+  address_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+}
+
+const char* MappedFile::data() const {
+  return static_cast<const char*>(address_);
+}
+
+char* MappedFile::mutable_data() {
+  return static_cast<char*>(address_);
+}
+
+size_t MappedFile::size() const {
+  return size_;
+}
+
+}  // namespace sicxe
@@ -0,0 +1,41 @@
+#ifndef COMMON_MAPPED_FILE_H
+#define COMMON_MAPPED_FILE_H
+
+#include <stddef.h>
+#include <vector>
+#include "common/macros.h"
+
+namespace sicxe {
+
+// Private memory mapping of a whole file. Pages are read on first access,
+// so loading large files does not copy them through a read buffer. Writes
+// through mutable_data() are copy-on-write and never reach the file. Files
+// that cannot be mapped, like pipes, are read into memory instead.
+class MappedFile {
+ public:
+  DISALLOW_COPY_AND_MOVE(MappedFile);
+
+  MappedFile();
+  ~MappedFile();
+
+  bool Open(const char* file_name);
+  void Close();
+
+  // nullptr for an empty file
+  const char* data() const;
+  char* mutable_data();
+  size_t size() const;
+
+ private:
+  // Reads the whole stream |fd| into buffer_.
+  bool Read(int fd);
+
+  void* address_;
+  size_t size_;
+  bool mapped_;
+  std::vector<char> buffer_;
+};
+
+}  // namespace sicxe
+
+#endif  // COMMON_MAPPED_FILE_H
@@ -4,6 +4,8 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
+#include "common/mapped_file.h"
+#include "common/object_file_stream.h"
 
 using std::pair;
 using std::string;
@@ -15,7 +17,8 @@ const int ObjectFile::kMaxSymbolsPerExportSection = 6;
 const int ObjectFile::kMaxSymbolsPerImportSection = 12;
 const int ObjectFile::kMaxTextSectionSize = 30;
 
-ObjectFile::ObjectFile() : start_address_(0), code_size_(0), entry_point_(0) {}
+ObjectFile::ObjectFile()
+    : format_(TEXT), start_address_(0), code_size_(0), entry_point_(0), text_arena_(new Arena) {}
 
 ObjectFile::~ObjectFile() {}
 
@@ -23,6 +26,10 @@ const string& ObjectFile::file_name() const {
   return file_name_;
 }
 
+ObjectFile::FormatId ObjectFile::format() const {
+  return format_;
+}
+
 const string& ObjectFile::program_name() const {
   return program_name_;
 }
@@ -87,45 +94,87 @@ ObjectFile::SymbolImportSectionVector* ObjectFile::mutable_import_sections() {
   return &import_sections_;
 }
 
+const ObjectFile::CodeSiteVector& ObjectFile::code_sites() const {
+  return code_sites_;
+}
+
 ObjectFile::RelocationSectionVector* ObjectFile::mutable_relocation_sections() {
   return &relocation_sections_;
 }
 
+ObjectFile::CodeSiteVector* ObjectFile::mutable_code_sites() {
+  return &code_sites_;
+}
+
+uint8* ObjectFile::AllocateText(size_t size) {
+  return static_cast<uint8*>(text_arena_->Allocate(size, 1));
+}
+
 void ObjectFile::Clear() {
   file_name_.clear();
+  format_ = TEXT;
   program_name_.clear();
   start_address_ = 0;
   code_size_ = 0;
   entry_point_ = 0;
   text_sections_.clear();
+  text_arena_.reset(new Arena);
+  mapped_file_.reset();
   export_sections_.clear();
   import_sections_.clear();
   relocation_sections_.clear();
+  code_sites_.clear();
 }
 
 namespace {
 
+// Value of every hex digit character, -1 for all other characters.
+const int8 kHexValues[256] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
 bool ParseHex(const char* buffer, int length, uint32* result) {
   uint32 rv = 0;
+  int8 invalid = 0;
   for (int i = 0; i < length; i++) {
-    uint32 c = 0;
-    if (buffer[i] >= '0' && buffer[i] <= '9') {
-      c = buffer[i] - '0';
-    } else if (buffer[i] >= 'A' && buffer[i] <= 'F') {
-      c = (buffer[i] - 'A') + 10;
-    } else if (buffer[i] >= 'a' && buffer[i] <= 'f') {
-      c = (buffer[i] - 'a') + 10;
-    }
-    else {
-      return false;
-    }
-    rv <<= 4;
-    rv |= c;
+    int8 value = kHexValues[static_cast<uint8>(buffer[i])];
+    invalid |= value;
+    rv = (rv << 4) | static_cast<uint8>(value & 0xf);
+  }
+  if (invalid < 0) {
+    return false;
   }
   *result = rv;
   return true;
 }
 
+// Decodes |size| bytes from pairs of hex digits.
+bool DecodeHexBytes(const char* buffer, size_t size, uint8* result) {
+  int8 invalid = 0;
+  for (size_t i = 0; i < size; i++) {
+    int8 high = kHexValues[static_cast<uint8>(buffer[2 * i])];
+    int8 low = kHexValues[static_cast<uint8>(buffer[2 * i + 1])];
+    invalid |= high | low;
+    result[i] = static_cast<uint8>((static_cast<uint8>(high) << 4) | (low & 0xf));
+  }
+  return invalid >= 0;
+}
+
 bool ParseSymbolName(const char* buffer, int length, string* result) {
   string rv;
   rv.resize(length, ' ');
@@ -160,29 +209,27 @@ bool ObjectFile::ParseEndSection(const char* line_buffer, size_t line_length) {
           ParseHex(line_buffer + 1, 6, &entry_point_));
 }
 
-bool ObjectFile::ParseTextSection(const char* line_buffer, size_t line_length) {
+bool ObjectFile::ParseTextSection(const char* line_buffer, size_t line_length,
+                                  uint8** text_data) {
   if (line_length < 9) {
     return false;
   }
-  unique_ptr<TextSection> section(new TextSection);
+  TextSection section;
   uint32 size = 0;
-  if (!ParseHex(line_buffer + 1, 6, &section->address) ||
+  if (!ParseHex(line_buffer + 1, 6, &section.address) ||
       !ParseHex(line_buffer + 7, 2, &size)) {
     return false;
   }
   if (size > 31 || (2 * size) + 9 != line_length) {
     return false;
   }
-  section->size = size;
-  section->data.reset(new uint8[size]);
-  for (size_t i = 0; i < size; i++) {
-    uint32 byte = 0;
-    if (!ParseHex(line_buffer + 9 + 2 * i, 2, &byte)) {
-      return false;
-    }
-    section->data[i] = byte;
+  section.size = size;
+  section.data = *text_data;
+  if (!DecodeHexBytes(line_buffer + 9, size, section.data)) {
+    return false;
   }
-  text_sections_.emplace_back(std::move(section));
+  *text_data += size;
+  text_sections_.push_back(section);
   return true;
 }
 
@@ -253,64 +300,116 @@ bool ObjectFile::ParseRelocationSection(const char* line_buffer, size_t line_len
 }
 
 ObjectFile::LoadResult ObjectFile::LoadFile(const char* the_file_name) {
-  FILE* file = fopen(the_file_name, "r");
-  if (file == nullptr) {
+  unique_ptr<MappedFile> mapped_file(new MappedFile);
+  if (!mapped_file->Open(the_file_name)) {
     return OPEN_FAILED;
   }
+  return LoadMappedFile(the_file_name, std::move(mapped_file));
+}
+
+ObjectFile::LoadResult ObjectFile::LoadMappedFile(const char* the_file_name,
+                                                  unique_ptr<MappedFile> mapped_file) {
   Clear();
+  bool success;
+  if (mapped_file->size() >= 4 && memcmp(mapped_file->data(), kBinaryMagic, 4) == 0) {
+    success = LoadBinary(reinterpret_cast<uint8*>(mapped_file->mutable_data()),
+                         mapped_file->size());
+    mapped_file_ = std::move(mapped_file);
+  } else {
+    success = ParseText(StringView(mapped_file->data(), mapped_file->size()));
+  }
+  if (!success) {
+    Clear();
+    return INVALID_FORMAT;
+  }
   file_name_ = string(the_file_name);
+  return OK;
+}
+
+ObjectFile::LoadResult ObjectFile::LoadText(StringView contents) {
+  Clear();
+  if (!ParseText(contents)) {
+    Clear();
+    return INVALID_FORMAT;
+  }
+  return OK;
+}
 
+ObjectFile::LoadResult ObjectFile::LoadContents(StringView contents) {
+  Clear();
+  bool success;
+  if (contents.size() >= 4 && memcmp(contents.data(), kBinaryMagic, 4) == 0) {
+    uint8* data = AllocateText(contents.size());
+    memcpy(data, contents.data(), contents.size());
+    success = LoadBinary(data, contents.size());
+  } else {
+    success = ParseText(contents);
+  }
+  if (!success) {
+    Clear();
+    return INVALID_FORMAT;
+  }
+  return OK;
+}
+
+bool ObjectFile::ParseText(StringView contents) {
   bool success = true;
   int start_section_position = -1;
   int end_section_position = -1;
 
+  // text data of all sections is decoded into one buffer, every byte takes at
+  // least two characters of the file
+  const char* position = contents.data();
+  const char* end = position + contents.size();
+  uint8* text_data = AllocateText(contents.size() / 2);
+
   // read lines
-  unique_ptr<char[]> line_buffer(new char[1024]);
-  size_t line_length = 0;
   int line = 0;
-  for (line = 0; true; line++) {
-    if (fgets(line_buffer.get(), 1024, file) == nullptr) {
-      break;
-    }
-    line_length = strlen(line_buffer.get());
-    if (line_buffer[line_length - 1] == '\n') {
-      line_length--;
-      line_buffer[line_length] = '\0';
+  for (line = 0; position < end; line++) {
+    const char* line_buffer = position;
+    const char* newline = static_cast<const char*>(memchr(position, '\n', end - position));
+    size_t line_length = 0;
+    if (newline != nullptr) {
+      line_length = newline - position;
+      position = newline + 1;
+    } else {
+      line_length = end - position;
+      position = end;
     }
 
-    char section_type = line_buffer[0];
+    char section_type = (line_length > 0) ? line_buffer[0] : '\0';
 
     if (section_type == 'H') {
       if (start_section_position != -1 ||
-          !ParseStartSection(line_buffer.get(), line_length)) {
+          !ParseStartSection(line_buffer, line_length)) {
         success = false;
         break;
       }
       start_section_position = line;
     } else if (section_type == 'E') {
       if (end_section_position != -1 ||
-          !ParseEndSection(line_buffer.get(), line_length)) {
+          !ParseEndSection(line_buffer, line_length)) {
         success = false;
         break;
       }
       end_section_position = line;
     } else if (section_type == 'T') {
-      if (!ParseTextSection(line_buffer.get(), line_length)) {
+      if (!ParseTextSection(line_buffer, line_length, &text_data)) {
         success = false;
         break;
       }
     } else if (section_type == 'D') {
-      if (!ParseSymbolExportSection(line_buffer.get(), line_length)) {
+      if (!ParseSymbolExportSection(line_buffer, line_length)) {
         success = false;
         break;
       }
     } else if (section_type == 'R') {
-      if (!ParseSymbolImportSection(line_buffer.get(), line_length)) {
+      if (!ParseSymbolImportSection(line_buffer, line_length)) {
         success = false;
         break;
       }
     } else if (section_type == 'M') {
-      if (!ParseRelocationSection(line_buffer.get(), line_length)) {
+      if (!ParseRelocationSection(line_buffer, line_length)) {
         success = false;
         break;
       }
@@ -323,71 +422,66 @@ ObjectFile::LoadResult ObjectFile::LoadFile(const char* the_file_name) {
   if (start_section_position != 0 || end_section_position != line - 1) {
     success = false;
   }
-  fclose(file);
 
-  if (success) {
-    return OK;
-  } else {
-    Clear();
-    return INVALID_FORMAT;
-  }
+  return success;
 }
 
 bool ObjectFile::SaveFile(const char* the_file_name) const {
-  FILE* file = fopen(the_file_name, "w");
-  if (file == nullptr) {
+  ObjectFileStream stream;
+  if (!stream.Open(the_file_name)) {
     return false;
   }
   // start section
   assert(program_name_.size() <= 6);
-  fprintf(file, "H%-6.6s%06X%06X\n", program_name_.c_str(),
-                                     start_address_ & 0xfffff,
-                                     code_size_ & 0xfffff);
+  stream.BeginRecord('H');
+  stream.AppendName(program_name_);
+  stream.AppendHex(start_address_ & 0xfffff, 6);
+  stream.AppendHex(code_size_ & 0xfffff, 6);
+  stream.EndRecord();
   // text sections
   for (const auto& section : text_sections_) {
-    int size = static_cast<uint32>(section->size) & 0xff;
-    fprintf(file, "T%06X%02X", section->address & 0xffffff, size);
-    for (int i = 0; i < size; i++) {
-      uint32 byte = section->data[i];
-      fprintf(file, "%02X", byte);
-    }
-    fprintf(file, "\n");
+    stream.BeginRecord('T');
+    stream.AppendHex(section.address & 0xffffff, 6);
+    stream.AppendHex(section.size, 2);
+    stream.AppendHexBytes(section.data, section.size);
+    stream.EndRecord();
   }
   // export symbols
   for (const auto& section : export_sections_) {
-    fprintf(file, "D");
+    stream.BeginRecord('D');
     for (const auto& symbol : section->symbols) {
       assert(symbol.first.size() <= 6);
-      fprintf(file, "%-6.6s%06X", symbol.first.c_str(),
-                                  symbol.second & 0xfffff);
+      stream.AppendName(symbol.first);
+      stream.AppendHex(symbol.second & 0xfffff, 6);
     }
-    fprintf(file, "\n");
+    stream.EndRecord();
   }
   // import symbols
   for (const auto& section : import_sections_) {
-    fprintf(file, "R");
+    stream.BeginRecord('R');
     for (const auto& symbol : section->symbols) {
       assert(symbol.size() <= 6);
-      fprintf(file, "%-6.6s", symbol.c_str());
+      stream.AppendName(symbol);
     }
-    fprintf(file, "\n");
+    stream.EndRecord();
   }
   // relocation sections
   for (const auto& section : relocation_sections_) {
-    fprintf(file, "M");
-    fprintf(file, "%06X%02X", section->address,
-                              static_cast<uint32>(section->nibbles) & 0xff);
+    stream.BeginRecord('M');
+    stream.AppendHex(section->address, 6);
+    stream.AppendHex(section->nibbles, 2);
     if (section->type) {
       assert(section->symbol_name.size() <= 6);
-      fprintf(file, "%c%-6.6s", section->sign ? '+' : '-',
-                                section->symbol_name.c_str());
+      stream.AppendChar(section->sign ? '+' : '-');
+      stream.AppendName(section->symbol_name);
     }
-    fprintf(file, "\n");
+    stream.EndRecord();
   }
   // end section
-  fprintf(file, "E%06X\n", entry_point_ & 0xfffff);
-  fclose(file);
-  return true;
+  stream.BeginRecord('E');
+  stream.AppendHex(entry_point_ & 0xfffff, 6);
+  stream.EndRecord();
+  return stream.Close();
 }
 
 }  // namespace sicxe
@@ -4,11 +4,15 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "common/arena.h"
 #include "common/macros.h"
+#include "common/string_view.h"
 #include "common/types.h"
 
 namespace sicxe {
 
+class MappedFile;
+
 class ObjectFile {
  public:
   DISALLOW_COPY_AND_MOVE(ObjectFile);
@@ -19,10 +23,15 @@ class ObjectFile {
     INVALID_FORMAT
   };
 
+  enum FormatId {
+    TEXT = 0,  // H/T/D/R/M/E records
+    BINARY     // .sobj, see object_file_binary.cc
+  };
+
   struct TextSection {
     uint32 address;
     uint8 size;
-    std::unique_ptr<uint8[]> data;
+    uint8* data;  // owned by the object file, see AllocateText()
   };
 
   struct SymbolExportSection {
@@ -43,10 +52,22 @@ class ObjectFile {
     std::string symbol_name;
   };
 
-  typedef std::vector<std::unique_ptr<TextSection> > TextSectionVector;
+  enum CodeSiteKind {
+    EXTENDED_INSTRUCTION = 0,  // format 4
+    PC_RELATIVE_INSTRUCTION    // format 3 with PC relative addressing
+  };
+
+  // Instruction that link-time relaxation may shorten or has to adjust.
+  struct CodeSite {
+    uint32 address;
+    CodeSiteKind kind;
+  };
+
+  typedef std::vector<TextSection> TextSectionVector;
   typedef std::vector<std::unique_ptr<SymbolExportSection> > SymbolExportSectionVector;
   typedef std::vector<std::unique_ptr<SymbolImportSection> > SymbolImportSectionVector;
   typedef std::vector<std::unique_ptr<RelocationSection> > RelocationSectionVector;
+  typedef std::vector<CodeSite> CodeSiteVector;
 
   static const int kMaxSymbolsPerExportSection;
   static const int kMaxSymbolsPerImportSection;
@@ -56,6 +77,8 @@ class ObjectFile {
   ~ObjectFile();
 
   const std::string& file_name() const;
+  // Format of the last loaded file.
+  FormatId format() const;
   const std::string& program_name() const;
   uint32 start_address() const;
   uint32 code_size() const;
@@ -64,6 +87,9 @@ class ObjectFile {
   const SymbolExportSectionVector& export_sections() const;
   const SymbolImportSectionVector& import_sections() const;
   const RelocationSectionVector& relocation_sections() const;
+  // Recorded by sicasm --link-relax for code that stays correct when
+  // instructions are shortened. Only the binary format keeps code sites.
+  const CodeSiteVector& code_sites() const;
 
   void set_file_name(const std::string& name);
   void set_program_name(const std::string& name);
@@ -74,28 +100,53 @@ class ObjectFile {
   SymbolExportSectionVector* mutable_export_sections();
   SymbolImportSectionVector* mutable_import_sections();
   RelocationSectionVector* mutable_relocation_sections();
+  CodeSiteVector* mutable_code_sites();
+  // Returns storage for text section data, valid until the file is cleared.
+  uint8* AllocateText(size_t size);
 
   void Clear();
+  // Either format is accepted, binary files are recognized by their magic.
   LoadResult LoadFile(const char* the_file_name);
+  // Like LoadFile() for a file that is already open. Binary files keep
+  // |mapped_file| for their text.
+  LoadResult LoadMappedFile(const char* the_file_name,
+                            std::unique_ptr<MappedFile> mapped_file);
+  // Loads text format records from memory, |contents| need not outlive the file.
+  LoadResult LoadText(StringView contents);
+  // Loads either format from memory, binary contents are copied into the file.
+  LoadResult LoadContents(StringView contents);
   bool SaveFile(const char* the_file_name) const;
+  bool SaveBinaryFile(const char* the_file_name) const;
+  // Encodes the file in the binary format.
+  void SaveBinary(std::vector<uint8>* contents) const;
 
  private:
+  static const char kBinaryMagic[];
+
+  bool ParseText(StringView contents);
+  // Text sections point into |data|, which must live as long as the file.
+  bool LoadBinary(uint8* data, size_t file_size);
   bool ParseStartSection(const char* line_buffer, size_t line_length);
   bool ParseEndSection(const char* line_buffer, size_t line_length);
-  bool ParseTextSection(const char* line_buffer, size_t line_length);
+  // Section data is decoded to |*text_data|, which is advanced past it.
+  bool ParseTextSection(const char* line_buffer, size_t line_length, uint8** text_data);
   bool ParseSymbolExportSection(const char* line_buffer, size_t line_length);
   bool ParseSymbolImportSection(const char* line_buffer, size_t line_length);
   bool ParseRelocationSection(const char* line_buffer, size_t line_length);
 
   std::string file_name_;
+  FormatId format_;
   std::string program_name_;
   uint32 start_address_;
   uint32 code_size_;
   uint32 entry_point_;
   TextSectionVector text_sections_;
+  std::unique_ptr<Arena> text_arena_;
+  std::unique_ptr<MappedFile> mapped_file_;
   SymbolExportSectionVector export_sections_;
   SymbolImportSectionVector import_sections_;
   RelocationSectionVector relocation_sections_;
+  CodeSiteVector code_sites_;
 };
 
 }  // namespace sicxe
@@ -0,0 +1,402 @@
+#include "common/object_file.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include "common/little_endian.h"
+#include "common/output_file.h"
+#include "common/string_pool.h"
+
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// The binary format holds the same information as the text format in fixed
+// size little-endian tables, so loading needs no parsing and text section data
+// is used in place. Fields are 32 bits wide unless noted otherwise.
+//
+//   header            see HeaderField
+//   range table       address, size - one entry per text section
+//   text image        data of all text sections, one after another
+//   export table      name offset, name size, address
+//   import table      name offset, name size
+//   relocation table  address, nibbles (8 bits), flags (8 bits), zero (16 bits),
+//                     name offset, name size
+//   code site table   address, kind (8 bits), zero (24 bits) - since version 2
+//   string pool       symbol names, referenced by offset and size
+//
+// Every part starts at a multiple of four bytes, the text image and the string
+// pool are padded with zero bytes. The checksum covers everything after the
+// header, see Checksum().
+
+namespace sicxe {
+
+const char ObjectFile::kBinaryMagic[] = "SOBJ";
+
+namespace {
+
+enum HeaderField {
+  MAGIC = 0,
+  VERSION = 4,
+  PROGRAM_NAME = 8,  // 8 bytes, padded with zero bytes
+  START_ADDRESS = 16,
+  CODE_SIZE = 20,
+  ENTRY_POINT = 24,
+  RANGE_COUNT = 28,
+  TEXT_SIZE = 32,
+  EXPORT_COUNT = 36,
+  IMPORT_COUNT = 40,
+  RELOCATION_COUNT = 44,
+  STRING_POOL_SIZE = 48,
+  BODY_SIZE = 52,
+  CHECKSUM = 56,
+  CODE_SITE_COUNT = 60,  // zero padding in version 1
+  HEADER_SIZE = 64
+};
+
+const uint32 kBinaryVersion = 2;
+const uint32 kRangeEntrySize = 8;
+const uint32 kExportEntrySize = 12;
+const uint32 kImportEntrySize = 8;
+const uint32 kRelocationEntrySize = 16;
+const uint32 kCodeSiteEntrySize = 8;
+const uint8 kRelocationSymbol = 0x1;
+const uint8 kRelocationPlus = 0x2;
+// same limit as for text records
+const uint32 kMaxRangeSize = 31;
+
+// FNV-1a over 32-bit words in four interleaved lanes, so that the multiplies
+// do not wait for each other, the lane hashes are combined at the end. |size|
+// is a multiple of four.
+uint32 Checksum(const uint8* data, size_t size) {
+  const uint32 kOffsetBasis = 2166136261u;
+  const uint32 kPrime = 16777619u;
+  uint32 lanes[4] = {kOffsetBasis, kOffsetBasis, kOffsetBasis, kOffsetBasis};
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    for (int lane = 0; lane < 4; lane++) {
+      lanes[lane] = (lanes[lane] ^ LittleEndian::ReadUint32(data + i + 4 * lane)) * kPrime;
+    }
+  }
+  for (int lane = 0; i < size; i += 4, lane++) {
+    lanes[lane] = (lanes[lane] ^ LittleEndian::ReadUint32(data + i)) * kPrime;
+  }
+  uint32 hash = kOffsetBasis;
+  for (int lane = 0; lane < 4; lane++) {
+    hash = (hash ^ lanes[lane]) * kPrime;
+  }
+  return hash;
+}
+
+// Same characters as accepted by the text format.
+bool IsSymbolName(const char* name, uint32 size) {
+  if (size == 0 || size > 6 || name[size - 1] == ' ') {
+    return false;
+  }
+  for (uint32 i = 0; i < size; i++) {
+    if (!isalnum(name[i]) && name[i] != ' ' && name[i] != '-' &&
+        name[i] != '_' && name[i] != '+') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Collects symbol names, every distinct name is stored once.
+class StringPoolBuilder {
+ public:
+  DISALLOW_COPY_AND_MOVE(StringPoolBuilder);
+
+  StringPoolBuilder() {}
+
+  // Returns the offset of |name| in the pool.
+  uint32 Add(const string& name) {
+    StringPool::Id id = names_.Intern(name);
+    if (id == offsets_.size()) {
+      offsets_.push_back(data_.size());
+      data_ += name;
+    }
+    return offsets_[id];
+  }
+
+  const string& data() const { return data_; }
+
+ private:
+  StringPool names_;
+  vector<uint32> offsets_;
+  string data_;
+};
+
+}  // namespace
+
+bool ObjectFile::LoadBinary(uint8* data, size_t file_size) {
+  uint8* header = data;
+  if (file_size < HEADER_SIZE) {
+    return false;
+  }
+  // version 1 files are the same without code sites
+  uint32 version = LittleEndian::ReadUint32(header + VERSION);
+  if (version < 1 || version > kBinaryVersion ||
+      LittleEndian::ReadUint32(header + BODY_SIZE) != file_size - HEADER_SIZE) {
+    return false;
+  }
+  uint32 range_count = LittleEndian::ReadUint32(header + RANGE_COUNT);
+  uint32 text_size = LittleEndian::ReadUint32(header + TEXT_SIZE);
+  uint32 export_count = LittleEndian::ReadUint32(header + EXPORT_COUNT);
+  uint32 import_count = LittleEndian::ReadUint32(header + IMPORT_COUNT);
+  uint32 relocation_count = LittleEndian::ReadUint32(header + RELOCATION_COUNT);
+  uint32 code_site_count = LittleEndian::ReadUint32(header + CODE_SITE_COUNT);
+  uint32 string_pool_size = LittleEndian::ReadUint32(header + STRING_POOL_SIZE);
+  uint32 body_size = file_size - HEADER_SIZE;
+  if (version == 1 && code_site_count != 0) {
+    return false;
+  }
+  // 64-bit arithmetic, so that no combination of counts can overflow
+  uint64 layout_size = static_cast<uint64>(range_count) * kRangeEntrySize +
+                       LittleEndian::RoundUp4(text_size) +
+                       static_cast<uint64>(export_count) * kExportEntrySize +
+                       static_cast<uint64>(import_count) * kImportEntrySize +
+                       static_cast<uint64>(relocation_count) * kRelocationEntrySize +
+                       static_cast<uint64>(code_site_count) * kCodeSiteEntrySize +
+                       LittleEndian::RoundUp4(string_pool_size);
+  if (layout_size != body_size) {
+    return false;
+  }
+  uint8* body = header + HEADER_SIZE;
+  if (Checksum(body, body_size) != LittleEndian::ReadUint32(header + CHECKSUM)) {
+    return false;
+  }
+
+  const char* name = reinterpret_cast<const char*>(header + PROGRAM_NAME);
+  uint32 name_size = strnlen(name, 8);
+  if (!IsSymbolName(name, name_size)) {
+    return false;
+  }
+  program_name_.assign(name, name_size);
+  start_address_ = LittleEndian::ReadUint32(header + START_ADDRESS);
+  code_size_ = LittleEndian::ReadUint32(header + CODE_SIZE);
+  entry_point_ = LittleEndian::ReadUint32(header + ENTRY_POINT);
+
+  const uint8* ranges = body;
+  uint8* text = body + range_count * kRangeEntrySize;
+  const uint8* exports = text + LittleEndian::RoundUp4(text_size);
+  const uint8* imports = exports + export_count * kExportEntrySize;
+  const uint8* relocations = imports + import_count * kImportEntrySize;
+  const uint8* code_sites = relocations + relocation_count * kRelocationEntrySize;
+  const char* string_pool =
+      reinterpret_cast<const char*>(code_sites + code_site_count * kCodeSiteEntrySize);
+  auto read_name = [&](const uint8* entry, string* result) {
+    uint32 offset = LittleEndian::ReadUint32(entry);
+    uint32 size = LittleEndian::ReadUint32(entry + 4);
+    if (offset > string_pool_size || size > string_pool_size - offset ||
+        !IsSymbolName(string_pool + offset, size)) {
+      return false;
+    }
+    result->assign(string_pool + offset, size);
+    return true;
+  };
+
+  // text sections reference the image, nothing is copied
+  text_sections_.resize(range_count);
+  uint32 text_offset = 0;
+  for (uint32 i = 0; i < range_count; i++) {
+    const uint8* entry = ranges + i * kRangeEntrySize;
+    uint32 size = LittleEndian::ReadUint32(entry + 4);
+    if (size > kMaxRangeSize || size > text_size - text_offset) {
+      return false;
+    }
+    TextSection& section = text_sections_[i];
+    section.address = LittleEndian::ReadUint32(entry);
+    section.size = size;
+    section.data = text + text_offset;
+    text_offset += size;
+  }
+  if (text_offset != text_size) {
+    return false;
+  }
+
+  for (uint32 i = 0; i < export_count; i++) {
+    if (i % kMaxSymbolsPerExportSection == 0) {
+      export_sections_.emplace_back(new SymbolExportSection);
+    }
+    const uint8* entry = exports + i * kExportEntrySize;
+    pair<string, uint32> symbol;
+    if (!read_name(entry, &symbol.first)) {
+      return false;
+    }
+    symbol.second = LittleEndian::ReadUint32(entry + 8);
+    export_sections_.back()->symbols.emplace_back(std::move(symbol));
+  }
+
+  for (uint32 i = 0; i < import_count; i++) {
+    if (i % kMaxSymbolsPerImportSection == 0) {
+      import_sections_.emplace_back(new SymbolImportSection);
+    }
+    string symbol;
+    if (!read_name(imports + i * kImportEntrySize, &symbol)) {
+      return false;
+    }
+    import_sections_.back()->symbols.emplace_back(std::move(symbol));
+  }
+
+  relocation_sections_.reserve(relocation_count);
+  for (uint32 i = 0; i < relocation_count; i++) {
+    const uint8* entry = relocations + i * kRelocationEntrySize;
+    unique_ptr<RelocationSection> section(new RelocationSection);
+    section->address = LittleEndian::ReadUint32(entry);
+    section->nibbles = entry[4];
+    uint8 flags = entry[5];
+    if ((flags & ~(kRelocationSymbol | kRelocationPlus)) != 0) {
+      return false;
+    }
+    section->type = (flags & kRelocationSymbol) != 0;
+    section->sign = (flags & kRelocationPlus) != 0;
+    if (section->type) {
+      if (!read_name(entry + 8, &section->symbol_name)) {
+        return false;
+      }
+    } else if (flags != 0 || LittleEndian::ReadUint32(entry + 12) != 0) {
+      return false;
+    }
+    relocation_sections_.emplace_back(std::move(section));
+  }
+
+  code_sites_.resize(code_site_count);
+  for (uint32 i = 0; i < code_site_count; i++) {
+    const uint8* entry = code_sites + i * kCodeSiteEntrySize;
+    uint32 kind = LittleEndian::ReadUint32(entry + 4);
+    if (kind > PC_RELATIVE_INSTRUCTION) {
+      return false;
+    }
+    code_sites_[i].address = LittleEndian::ReadUint32(entry);
+    code_sites_[i].kind = static_cast<CodeSiteKind>(kind);
+  }
+
+  format_ = BINARY;
+  return true;
+}
+
+void ObjectFile::SaveBinary(vector<uint8>* contents) const {
+  // names are collected first, the pool size decides the file size
+  StringPoolBuilder string_pool;
+  vector<uint32> name_offsets;
+  uint32 text_size = 0;
+  for (const auto& section : text_sections_) {
+    text_size += section.size;
+  }
+  uint32 export_count = 0;
+  for (const auto& section : export_sections_) {
+    for (const auto& symbol : section->symbols) {
+      name_offsets.push_back(string_pool.Add(symbol.first));
+      export_count++;
+    }
+  }
+  uint32 import_count = 0;
+  for (const auto& section : import_sections_) {
+    for (const auto& symbol : section->symbols) {
+      name_offsets.push_back(string_pool.Add(symbol));
+      import_count++;
+    }
+  }
+  for (const auto& section : relocation_sections_) {
+    if (section->type) {
+      name_offsets.push_back(string_pool.Add(section->symbol_name));
+    }
+  }
+  uint32 range_count = text_sections_.size();
+  uint32 relocation_count = relocation_sections_.size();
+  uint32 code_site_count = code_sites_.size();
+  uint32 string_pool_size = string_pool.data().size();
+  uint32 body_size = range_count * kRangeEntrySize + LittleEndian::RoundUp4(text_size) +
+                     export_count * kExportEntrySize + import_count * kImportEntrySize +
+                     relocation_count * kRelocationEntrySize +
+                     code_site_count * kCodeSiteEntrySize +
+                     LittleEndian::RoundUp4(string_pool_size);
+
+  vector<uint8>& buffer = *contents;
+  buffer.assign(HEADER_SIZE + body_size, 0);
+  uint8* header = buffer.data();
+  memcpy(header + MAGIC, kBinaryMagic, 4);
+  LittleEndian::WriteUint32(kBinaryVersion, header + VERSION);
+  assert(program_name_.size() <= 6);
+  memcpy(header + PROGRAM_NAME, program_name_.data(), program_name_.size());
+  LittleEndian::WriteUint32(start_address_, header + START_ADDRESS);
+  LittleEndian::WriteUint32(code_size_, header + CODE_SIZE);
+  LittleEndian::WriteUint32(entry_point_, header + ENTRY_POINT);
+  LittleEndian::WriteUint32(range_count, header + RANGE_COUNT);
+  LittleEndian::WriteUint32(text_size, header + TEXT_SIZE);
+  LittleEndian::WriteUint32(export_count, header + EXPORT_COUNT);
+  LittleEndian::WriteUint32(import_count, header + IMPORT_COUNT);
+  LittleEndian::WriteUint32(relocation_count, header + RELOCATION_COUNT);
+  LittleEndian::WriteUint32(string_pool_size, header + STRING_POOL_SIZE);
+  LittleEndian::WriteUint32(body_size, header + BODY_SIZE);
+  LittleEndian::WriteUint32(code_site_count, header + CODE_SITE_COUNT);
+
+  uint8* body = header + HEADER_SIZE;
+  uint8* out = body;
+  for (const auto& section : text_sections_) {
+    LittleEndian::WriteUint32(section.address, out);
+    LittleEndian::WriteUint32(section.size, out + 4);
+    out += kRangeEntrySize;
+  }
+  for (const auto& section : text_sections_) {
+    memcpy(out, section.data, section.size);
+    out += section.size;
+  }
+  out = body + range_count * kRangeEntrySize + LittleEndian::RoundUp4(text_size);
+  auto name_offset = name_offsets.begin();
+  for (const auto& section : export_sections_) {
+    for (const auto& symbol : section->symbols) {
+      assert(symbol.first.size() <= 6);
+      LittleEndian::WriteUint32(*name_offset++, out);
+      LittleEndian::WriteUint32(symbol.first.size(), out + 4);
+      LittleEndian::WriteUint32(symbol.second, out + 8);
+      out += kExportEntrySize;
+    }
+  }
+  for (const auto& section : import_sections_) {
+    for (const auto& symbol : section->symbols) {
+      assert(symbol.size() <= 6);
+      LittleEndian::WriteUint32(*name_offset++, out);
+      LittleEndian::WriteUint32(symbol.size(), out + 4);
+      out += kImportEntrySize;
+    }
+  }
+  for (const auto& section : relocation_sections_) {
+    LittleEndian::WriteUint32(section->address, out);
+    out[4] = section->nibbles;
+    if (section->type) {
+      assert(section->symbol_name.size() <= 6);
+      out[5] = kRelocationSymbol | (section->sign ? kRelocationPlus : 0);
+      LittleEndian::WriteUint32(*name_offset++, out + 8);
+      LittleEndian::WriteUint32(section->symbol_name.size(), out + 12);
+    }
+    out += kRelocationEntrySize;
+  }
+  for (const auto& site : code_sites_) {
+    LittleEndian::WriteUint32(site.address, out);
+    out[4] = static_cast<uint8>(site.kind);
+    out += kCodeSiteEntrySize;
+  }
+  memcpy(out, string_pool.data().data(), string_pool_size);
+  LittleEndian::WriteUint32(Checksum(body, body_size), header + CHECKSUM);
+}
+
+bool ObjectFile::SaveBinaryFile(const char* the_file_name) const {
+  vector<uint8> buffer;
+  SaveBinary(&buffer);
+  // the file may be mapped by a loaded object file, see OutputFile
+  OutputFile file;
+  if (!file.Open(the_file_name, "wb")) {
+    return false;
+  }
+  if (fwrite(buffer.data(), 1, buffer.size(), file.file()) != buffer.size()) {
+    file.Discard();
+    return false;
+  }
+  return file.Close();
+}
+
+}  // namespace sicxe
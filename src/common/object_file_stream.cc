@@ -0,0 +1,167 @@
+#include "common/object_file_stream.h"
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+namespace sicxe {
+
+const size_t ObjectFileStream::kBufferSize = 256 * 1024;
+
+namespace {
+
+const char kHexDigits[] = "0123456789ABCDEF";
+
+// Two hex digits for every byte value, so bytes are encoded with one lookup.
+char* CreateHexPairs() {
+  char* pairs = new char[2 * 256];
+  for (int i = 0; i < 256; i++) {
+    pairs[2 * i] = kHexDigits[i >> 4];
+    pairs[2 * i + 1] = kHexDigits[i & 0xf];
+  }
+  return pairs;
+}
+
+const char* HexPairs() {
+  static const char* pairs = CreateHexPairs();
+  return pairs;
+}
+
+}  // namespace
+
+ObjectFileStream::ObjectFileStream()
+    : file_(nullptr), write_failed_(false), size_(0), capacity_(0) {}
+
+ObjectFileStream::~ObjectFileStream() {
+  if (file_ != nullptr) {
+    Close();
+  }
+}
+
+bool ObjectFileStream::Open(const char* file_name) {
+  assert(file_ == nullptr && size_ == 0);
+  if (!output_file_.Open(file_name, "w")) {
+    return false;
+  }
+  file_ = output_file_.file();
+  // the buffer is written in large blocks, stdio buffering would only copy it
+  setvbuf(file_, nullptr, _IONBF, 0);
+  if (capacity_ < kBufferSize) {
+    buffer_.reset(new char[kBufferSize]);
+    capacity_ = kBufferSize;
+  }
+  write_failed_ = false;
+  return true;
+}
+
+bool ObjectFileStream::Close() {
+  if (file_ == nullptr) {
+    return !write_failed_;
+  }
+  Flush();
+  if (write_failed_) {
+    output_file_.Discard();
+  } else if (!output_file_.Close()) {
+    write_failed_ = true;
+  }
+  file_ = nullptr;
+  return !write_failed_;
+}
+
+void ObjectFileStream::BeginRecord(char type) {
+  AppendChar(type);
+}
+
+void ObjectFileStream::EndRecord() {
+  AppendChar('\n');
+}
+
+void ObjectFileStream::AppendChar(char c) {
+  Reserve(1);
+  buffer_[size_++] = c;
+}
+
+void ObjectFileStream::AppendHex(uint32 value, int digits) {
+  int count = 1;
+  while (count < 8 && (value >> (4 * count)) != 0) {
+    count++;
+  }
+  count = std::max(count, digits);
+  Reserve(count);
+  char* out = buffer_.get() + size_;
+  for (int i = count - 1; i >= 0; i--) {
+    out[i] = kHexDigits[value & 0xf];
+    value >>= 4;
+  }
+  size_ += count;
+}
+
+void ObjectFileStream::AppendHexBytes(const uint8* data, size_t size) {
+  const char* pairs = HexPairs();
+  while (size > 0) {
+    Reserve(2);
+    size_t count = std::min(size, (capacity_ - size_) / 2);
+    char* out = buffer_.get() + size_;
+    for (size_t i = 0; i < count; i++) {
+      memcpy(out + 2 * i, pairs + 2 * data[i], 2);
+    }
+    size_ += 2 * count;
+    data += count;
+    size -= count;
+  }
+}
+
+void ObjectFileStream::AppendName(StringView name) {
+  Reserve(6);
+  size_t size = std::min<size_t>(name.size(), 6);
+  char* out = buffer_.get() + size_;
+  memcpy(out, name.data(), size);
+  memset(out + size, ' ', 6 - size);
+  size_ += 6;
+}
+
+void ObjectFileStream::AppendStream(const ObjectFileStream& stream) {
+  assert(stream.file_ == nullptr && &stream != this);
+  const char* data = stream.buffer_.get();
+  size_t size = stream.size_;
+  while (size > 0) {
+    Reserve(1);
+    size_t count = std::min(size, capacity_ - size_);
+    memcpy(buffer_.get() + size_, data, count);
+    size_ += count;
+    data += count;
+    size -= count;
+  }
+}
+
+StringView ObjectFileStream::contents() const {
+  assert(file_ == nullptr);
+  return StringView(buffer_.get(), size_);
+}
+
+void ObjectFileStream::Reserve(size_t size) {
+  if (capacity_ - size_ >= size) {
+    return;
+  }
+  if (file_ != nullptr) {
+    assert(size <= capacity_);
+    Flush();
+    return;
+  }
+  size_t new_capacity = std::max(std::max<size_t>(capacity_ * 2, 4096), size_ + size);
+  std::unique_ptr<char[]> new_buffer(new char[new_capacity]);
+  if (size_ > 0) {
+    memcpy(new_buffer.get(), buffer_.get(), size_);
+  }
+  buffer_ = std::move(new_buffer);
+  capacity_ = new_capacity;
+}
+
+void ObjectFileStream::Flush() {
+  if (size_ > 0 && fwrite(buffer_.get(), 1, size_, file_) != size_) {
+    write_failed_ = true;
+  }
+  size_ = 0;
+}
+
+}  // namespace sicxe
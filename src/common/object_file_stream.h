@@ -0,0 +1,61 @@
+#ifndef COMMON_OBJECT_FILE_STREAM_H
+#define COMMON_OBJECT_FILE_STREAM_H
+
+#include <stdio.h>
+#include <memory>
+#include "common/macros.h"
+#include "common/output_file.h"
+#include "common/string_view.h"
+#include "common/types.h"
+
+namespace sicxe {
+
+// Encodes records of the text object file format (see ObjectFile) into a large
+// buffer. An open stream writes the buffer to its file whenever it is full, so
+// records never need to be held in memory all at once. The file replaces its
+// target when the stream is closed, see OutputFile. A stream that was not
+// opened keeps everything in memory and can later be appended to another one.
+class ObjectFileStream {
+ public:
+  DISALLOW_COPY_AND_MOVE(ObjectFileStream);
+
+  static const size_t kBufferSize;
+
+  ObjectFileStream();
+  ~ObjectFileStream();
+
+  bool Open(const char* file_name);
+  // Writes out the rest of the buffer, returns false if any write failed.
+  bool Close();
+
+  void BeginRecord(char type);
+  void EndRecord();
+  void AppendChar(char c);
+  // Upper case hex, zero padded to |digits| but never truncated, like "%0*X".
+  void AppendHex(uint32 value, int digits);
+  // Two hex digits per byte.
+  void AppendHexBytes(const uint8* data, size_t size);
+  // Padded with spaces or truncated to 6 characters, like "%-6.6s".
+  void AppendName(StringView name);
+  // Appends all data of an in-memory |stream|.
+  void AppendStream(const ObjectFileStream& stream);
+
+  // Contents of an in-memory stream.
+  StringView contents() const;
+
+ private:
+  // Makes room for at least |size| more bytes.
+  void Reserve(size_t size);
+  void Flush();
+
+  OutputFile output_file_;
+  FILE* file_;  // of output_file_, nullptr if not open
+  bool write_failed_;
+  std::unique_ptr<char[]> buffer_;
+  size_t size_;
+  size_t capacity_;
+};
+
+}  // namespace sicxe
+
+#endif  // COMMON_OBJECT_FILE_STREAM_H
@@ -0,0 +1,58 @@
+#include "common/output_file.h"
+
+#include <sys/stat.h>
+
+using std::string;
+
+namespace sicxe {
+
+OutputFile::OutputFile() : file_(nullptr) {}
+
+OutputFile::~OutputFile() {
+  Discard();
+}
+
+bool OutputFile::Open(const char* file_name, const char* mode) {
+  Discard();
+  file_name_ = file_name;
+  temp_file_name_.clear();
+  struct stat file_stat;
+  if (stat(file_name, &file_stat) != 0 || S_ISREG(file_stat.st_mode)) {
+    temp_file_name_ = file_name_ + ".tmp";
+  }
+  file_ = fopen(temp_file_name_.empty() ? file_name : temp_file_name_.c_str(), mode);
+  return file_ != nullptr;
+}
+
+bool OutputFile::Close() {
+  if (file_ == nullptr) {
+    return false;
+  }
+  bool success = (fclose(file_) == 0);
+  file_ = nullptr;
+  if (temp_file_name_.empty()) {
+    return success;
+  }
+  if (!success || rename(temp_file_name_.c_str(), file_name_.c_str()) != 0) {
+    remove(temp_file_name_.c_str());
+    return false;
+  }
+  return true;
+}
+
+void OutputFile::Discard() {
+  if (file_ == nullptr) {
+    return;
+  }
+  fclose(file_);
+  file_ = nullptr;
+  if (!temp_file_name_.empty()) {
+    remove(temp_file_name_.c_str());
+  }
+}
+
+FILE* OutputFile::file() const {
+  return file_;
+}
+
+}  // namespace sicxe
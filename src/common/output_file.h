@@ -0,0 +1,41 @@
+#ifndef COMMON_OUTPUT_FILE_H
+#define COMMON_OUTPUT_FILE_H
+
+#include <stdio.h>
+#include <string>
+#include "common/macros.h"
+
+namespace sicxe {
+
+// File that replaces its target only once it is complete. Data goes to a
+// temporary file next to the target, which Close() renames over it, so
+// mappings of the old file stay valid while the output is written, even when
+// an input file is also the output. Targets that exist but are not regular
+// files, like /dev/stdout, are written directly.
+class OutputFile {
+ public:
+  DISALLOW_COPY_AND_MOVE(OutputFile);
+
+  OutputFile();
+  // Discards an output that was not closed.
+  ~OutputFile();
+
+  // |mode| as for fopen.
+  bool Open(const char* file_name, const char* mode);
+  // Moves the output into place, returns false if that failed.
+  bool Close();
+  // Closes and removes the output, the target keeps its old contents.
+  void Discard();
+
+  // nullptr if not open
+  FILE* file() const;
+
+ private:
+  FILE* file_;
+  std::string file_name_;
+  std::string temp_file_name_;  // empty if written directly
+};
+
+}  // namespace sicxe
+
+#endif  // COMMON_OUTPUT_FILE_H
@@ -0,0 +1,57 @@
+#include "common/parallel_util.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "common/error_db.h"
+
+using std::string;
+using std::vector;
+
+namespace sicxe {
+
+const uint32 ParallelUtil::kMaxJobCount = 256;
+
+bool ParallelUtil::ParseJobCount(const string& value, uint32* job_count,
+                                 ErrorDB* error_db) {
+  const char* jobs_str = value.c_str();
+  char* end_ptr;
+  errno = 0;
+  uint64 count = static_cast<uint64>(strtoull(jobs_str, &end_ptr, 0));
+  if (*jobs_str == '\0' || *end_ptr != '\0') {
+    error_db->AddError(ErrorDB::ERROR, "job count must be a number", nullptr);
+    return false;
+  }
+  if (errno == ERANGE || count < 1 || count > kMaxJobCount) {
+    error_db->AddError(ErrorDB::ERROR, "job count out of range", nullptr);
+    return false;
+  }
+  *job_count = static_cast<uint32>(count);
+  return true;
+}
+
+void ParallelUtil::ForEachIndex(size_t count, size_t thread_count,
+                                const std::function<void(size_t)>& function) {
+  if (thread_count > count) {
+    thread_count = count;
+  }
+  std::atomic<size_t> next_index(0);
+  auto run = [count, &function, &next_index]() {
+    size_t index;
+    while ((index = next_index++) < count) {
+      function(index);
+    }
+  };
+  vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; i++) {
+    threads.emplace_back(run);
+  }
+  run();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace sicxe
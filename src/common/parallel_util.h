@@ -0,0 +1,34 @@
+#ifndef COMMON_PARALLEL_UTIL_H
+#define COMMON_PARALLEL_UTIL_H
+
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+
+class ErrorDB;
+
+class ParallelUtil {
+ public:
+  DISALLOW_INSTANTIATE(ParallelUtil);
+
+  static const uint32 kMaxJobCount;
+
+  // Parses the value of a -j option, returns false and reports to |error_db|
+  // if it is not a number from 1 to kMaxJobCount.
+  static bool ParseJobCount(const std::string& value, uint32* job_count,
+                            ErrorDB* error_db);
+
+  // Calls |function| for every index below |count| on up to |thread_count|
+  // threads, the calling one included. Indices are handed out in order to
+  // whichever thread is free, so calls may run concurrently.
+  static void ForEachIndex(size_t count, size_t thread_count,
+                           const std::function<void(size_t)>& function);
+};
+
+}  // namespace sicxe
+
+#endif  // COMMON_PARALLEL_UTIL_H
@@ -0,0 +1,87 @@
+#include "common/string_pool.h"
+
+#include <assert.h>
+#include <string.h>
+
+namespace sicxe {
+
+const StringPool::Id StringPool::kInvalidId = 0xffffffff;
+
+namespace {
+
+const size_t kInitialSlotCount = 64;
+
+}  // namespace
+
+StringPool::StringPool() : slots_(kInitialSlotCount, kInvalidId) {}
+
+StringPool::~StringPool() {}
+
+StringPool::Id StringPool::Intern(StringView str) {
+  uint32 hash = Hash(str);
+  size_t slot = FindSlot(str, hash);
+  if (slots_[slot] != kInvalidId) {
+    return slots_[slot];
+  }
+  char* data = static_cast<char*>(arena_.Allocate(str.size() + 1, 1));
+  memcpy(data, str.data(), str.size());
+  data[str.size()] = '\0';
+  Id id = static_cast<Id>(strings_.size());
+  strings_.push_back(StringView(data, str.size()));
+  hashes_.push_back(hash);
+  slots_[slot] = id;
+  // keep the load factor at most one half
+  if (strings_.size() * 2 > slots_.size()) {
+    Grow();
+  }
+  return id;
+}
+
+StringPool::Id StringPool::Find(StringView str) const {
+  return slots_[FindSlot(str, Hash(str))];
+}
+
+StringView StringPool::Get(Id id) const {
+  assert(id < strings_.size());
+  return strings_[id];
+}
+
+size_t StringPool::size() const {
+  return strings_.size();
+}
+
+uint32 StringPool::Hash(StringView str) {
+  // FNV-1a
+  uint32 hash = 2166136261u;
+  for (char c : str) {
+    hash = (hash ^ static_cast<uint8>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+size_t StringPool::FindSlot(StringView str, uint32 hash) const {
+  size_t mask = slots_.size() - 1;
+  size_t slot = hash & mask;
+  while (slots_[slot] != kInvalidId) {
+    Id id = slots_[slot];
+    if (hashes_[id] == hash && strings_[id] == str) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+void StringPool::Grow() {
+  slots_.assign(slots_.size() * 2, kInvalidId);
+  size_t mask = slots_.size() - 1;
+  for (Id id = 0; id < strings_.size(); id++) {
+    size_t slot = hashes_[id] & mask;
+    while (slots_[slot] != kInvalidId) {
+      slot = (slot + 1) & mask;
+    }
+    slots_[slot] = id;
+  }
+}
+
+}  // namespace sicxe
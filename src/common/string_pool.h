@@ -0,0 +1,47 @@
+#ifndef COMMON_STRING_POOL_H
+#define COMMON_STRING_POOL_H
+
+#include <vector>
+#include "common/arena.h"
+#include "common/macros.h"
+#include "common/string_view.h"
+#include "common/types.h"
+
+namespace sicxe {
+
+// Interns strings and hands out dense ids, numbered from 0 in order of first
+// appearance, so that tables keyed by name can be plain vectors indexed by id.
+// Lookups use an open addressing hash table with linear probing.
+class StringPool {
+ public:
+  DISALLOW_COPY_AND_MOVE(StringPool);
+
+  typedef uint32 Id;
+
+  static const Id kInvalidId;
+
+  StringPool();
+  ~StringPool();
+
+  // Returns the id of |str|, adding it to the pool if needed.
+  Id Intern(StringView str);
+  // Returns kInvalidId if |str| was never interned.
+  Id Find(StringView str) const;
+  // Returned view is valid as long as the pool.
+  StringView Get(Id id) const;
+  size_t size() const;
+
+ private:
+  static uint32 Hash(StringView str);
+  size_t FindSlot(StringView str, uint32 hash) const;
+  void Grow();
+
+  Arena arena_;
+  std::vector<StringView> strings_;
+  std::vector<uint32> hashes_;
+  std::vector<Id> slots_;  // kInvalidId marks an empty slot
+};
+
+}  // namespace sicxe
+
+#endif  // COMMON_STRING_POOL_H
@@ -0,0 +1,60 @@
+#ifndef COMMON_STRING_VIEW_H
+#define COMMON_STRING_VIEW_H
+
+#include <assert.h>
+#include <string.h>
+#include <string>
+
+namespace sicxe {
+
+// Non-owning reference to a sequence of characters, the referenced buffer must
+// outlive the view. Conversion to std::string is explicit, so copies are
+// visible at the call site.
+class StringView {
+ public:
+  StringView() : data_(nullptr), size_(0) {}
+  StringView(const char* the_data, size_t the_size) : data_(the_data), size_(the_size) {}
+  StringView(const char* c_string) : data_(c_string), size_(strlen(c_string)) {}
+  StringView(const std::string& str) : data_(str.data()), size_(str.size()) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+
+  char operator[](size_t index) const {
+    assert(index < size_);
+    return data_[index];
+  }
+
+  StringView substr(size_t position, size_t count) const {
+    assert(position <= size_ && count <= size_ - position);
+    return StringView(data_ + position, count);
+  }
+
+  std::string ToString() const { return std::string(data_, size_); }
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+inline bool operator==(StringView a, StringView b) {
+  return a.size() == b.size() && (a.size() == 0 || memcmp(a.data(), b.data(), a.size()) == 0);
+}
+
+inline bool operator!=(StringView a, StringView b) {
+  return !(a == b);
+}
+
+// Orders like std::string, bytes compare as unsigned.
+inline bool operator<(StringView a, StringView b) {
+  size_t size = a.size() < b.size() ? a.size() : b.size();
+  int result = (size == 0) ? 0 : memcmp(a.data(), b.data(), size);
+  return result < 0 || (result == 0 && a.size() < b.size());
+}
+
+}  // namespace sicxe
+
+#endif  // COMMON_STRING_VIEW_H
@@ -1,21 +1,22 @@
-#include <stdio.h>
-#include <memory>
 #include "common/text_file.h"
 
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
 using std::string;
-using std::unique_ptr;
-using std::vector;
 
 namespace sicxe {
 
-const size_t TextFile::kReadBufferSize = 4096;
+const size_t TextFile::kReadBufferSize = 64 * 1024;
 
 TextFile::Position::Position() : row(0), column(0), size(0) {}
 
 TextFile::Position::Position(int the_row, int the_column, int the_size)
   : row(the_row), column(the_column), size(the_size) {}
 
-TextFile::TextFile() {}
+TextFile::TextFile() : line_offsets_(1, 0) {}
 TextFile::~TextFile() {}
 
 bool TextFile::Open(const std::string& the_file_name) {
@@ -24,24 +25,36 @@ bool TextFile::Open(const std::string& the_file_name) {
     return false;
   }
   file_name_ = the_file_name;
-  lines_.clear();
-  string current_line;
-  unique_ptr<char[]> read_buffer(new char[kReadBufferSize]);
-  size_t read_length = 0;
-  while ((read_length = fread(read_buffer.get(), 1, kReadBufferSize, fp)) > 0) {
-    for (size_t i = 0; i < read_length; i++) {
-      if (read_buffer[i] == '\n') {
-        lines_.emplace_back(std::move(current_line));
-        current_line = string();
-      } else if (read_buffer[i] != '\r') {
-        current_line.push_back(read_buffer[i]);
-      }
+  contents_.clear();
+  // read regular files in one block, one byte more than the size so that the
+  // end of file is noticed without another read
+  size_t read_size = kReadBufferSize;
+  if (fseek(fp, 0, SEEK_END) == 0) {
+    long file_size = ftell(fp);
+    if (file_size > 0) {
+      read_size = static_cast<size_t>(file_size) + 1;
     }
+    rewind(fp);
   }
-  if (!current_line.empty() || lines_.empty()) {
-    lines_.emplace_back(std::move(current_line));
+  while (true) {
+    size_t old_size = contents_.size();
+    contents_.resize(old_size + read_size);
+    size_t read_length = fread(&contents_[old_size], 1, read_size, fp);
+    contents_.resize(old_size + read_length);
+    if (read_length < read_size) {
+      break;
+    }
+    read_size = kReadBufferSize;
   }
   fclose(fp);
+  if (memchr(contents_.data(), '\r', contents_.size()) != nullptr) {
+    contents_.erase(std::remove(contents_.begin(), contents_.end(), '\r'),
+                    contents_.end());
+  }
+  if (contents_.empty() || contents_.back() != '\n') {
+    contents_.push_back('\n');
+  }
+  IndexLines();
   return true;
 }
 
@@ -54,14 +67,10 @@ bool TextFile::Save(const std::string& destination) const {
   if (fp == nullptr) {
     return false;
   }
-  bool success = true;
-  for (const auto& line : lines_) {
-    if (fprintf(fp, "%s\n", line.c_str()) < 0) {
-      success = false;
-      break;
-    }
+  bool success = fwrite(contents_.data(), 1, contents_.size(), fp) == contents_.size();
+  if (fclose(fp) != 0) {
+    success = false;
   }
-  fclose(fp);
   return success;
 }
 
@@ -73,12 +82,39 @@ void TextFile::set_file_name(const string& new_file_name) {
   file_name_ = new_file_name;
 }
 
-const vector<string>& TextFile::lines() const {
-  return lines_;
+size_t TextFile::line_count() const {
+  return line_offsets_.size() - 1;
 }
 
-vector<string>* TextFile::mutable_lines() {
-  return &lines_;
+StringView TextFile::line(size_t row) const {
+  assert(row + 1 < line_offsets_.size());
+  size_t begin = line_offsets_[row];
+  return StringView(contents_.data() + begin, line_offsets_[row + 1] - 1 - begin);
+}
+
+void TextFile::AppendLine(StringView line) {
+  contents_.append(line.data(), line.size());
+  contents_.push_back('\n');
+  line_offsets_.push_back(contents_.size());
+}
+
+void TextFile::Clear() {
+  contents_.clear();
+  line_offsets_.assign(1, 0);
+}
+
+void TextFile::IndexLines() {
+  line_offsets_.assign(1, 0);
+  const char* data = contents_.data();
+  const char* end = data + contents_.size();
+  // memchr is vectorized by the C library
+  for (const char* p = data; p < end; p++) {
+    p = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (p == nullptr) {
+      break;
+    }
+    line_offsets_.push_back(p - data + 1);
+  }
 }
 
 }  // namespace sicxe
@@ -4,9 +4,12 @@
 #include <string>
 #include <vector>
 #include "common/macros.h"
+#include "common/string_view.h"
 
 namespace sicxe {
 
+// Text file held in a single buffer with an index of line start offsets.
+// Lines are returned as views into the buffer, line terminators excluded.
 class TextFile {
  public:
   DISALLOW_COPY_AND_MOVE(TextFile);
@@ -31,12 +34,21 @@ class TextFile {
 
   const std::string& file_name() const;
   void set_file_name(const std::string& new_file_name);
-  const std::vector<std::string>& lines() const;
-  std::vector<std::string>* mutable_lines();
+
+  size_t line_count() const;
+  // Returned view is invalidated by AppendLine and Clear.
+  StringView line(size_t row) const;
+  void AppendLine(StringView line);
+  void Clear();
 
  private:
+  void IndexLines();
+
   std::string file_name_;
-  std::vector<std::string> lines_;
+  // Every line, including the last one, is terminated by '\n'. Line i spans
+  // [line_offsets_[i], line_offsets_[i + 1] - 1).
+  std::string contents_;
+  std::vector<size_t> line_offsets_;
 };
 
 }  // namespace sicxe
@@ -16,7 +16,7 @@ bool FpgaLoader::LoadObjectFile(const ObjectFile& object_file,
     return false;
   }
   for (const auto& section : object_file.text_sections()) {
-    if (!connection->WriteMemory(section->address, section->size, section->data.get())) {
+    if (!connection->WriteMemory(section.address, section.size, section.data)) {
       return false;
     }
   }
@@ -0,0 +1,59 @@
+#include "fuzzer/fuzz_device.h"
+
+namespace sicxe {
+namespace fuzzer {
+
+// FuzzInputDevice implementation
+FuzzInputDevice::FuzzInputDevice()
+  : data_(nullptr), size_(0), position_(0), has_input_(false),
+    read_requested_(false) {}
+
+FuzzInputDevice::~FuzzInputDevice() {}
+
+void FuzzInputDevice::SetInput(const uint8* data, size_t size) {
+  data_ = data;
+  size_ = size;
+  position_ = 0;
+  has_input_ = true;
+}
+
+bool FuzzInputDevice::read_requested() const {
+  return read_requested_;
+}
+
+bool FuzzInputDevice::Test() {
+  return true;
+}
+
+bool FuzzInputDevice::Read(uint8* result) {
+  if (!has_input_) {
+    read_requested_ = true;
+    return false;
+  }
+  *result = (position_ < size_) ? data_[position_++] : 0;
+  return true;
+}
+
+bool FuzzInputDevice::Write(uint8) {
+  return true;
+}
+
+// NullDevice implementation
+NullDevice::NullDevice() {}
+NullDevice::~NullDevice() {}
+
+bool NullDevice::Test() {
+  return true;
+}
+
+bool NullDevice::Read(uint8* result) {
+  *result = 0;
+  return true;
+}
+
+bool NullDevice::Write(uint8) {
+  return true;
+}
+
+}  // namespace fuzzer
+}  // namespace sicxe
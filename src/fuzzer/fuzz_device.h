@@ -0,0 +1,49 @@
+#ifndef FUZZER_FUZZ_DEVICE_H
+#define FUZZER_FUZZ_DEVICE_H
+
+#include <stddef.h>
+#include "common/types.h"
+#include "machine/device.h"
+
+namespace sicxe {
+namespace fuzzer {
+
+// Device that serves the current fuzz input, reading past its end returns zero
+// bytes and writes are discarded. Until an input is set reads fail, which stops
+// the machine at the instruction of its first input read.
+class FuzzInputDevice : public machine::Device {
+ public:
+  FuzzInputDevice();
+  virtual ~FuzzInputDevice();
+
+  // Does not take ownership of |data|.
+  void SetInput(const uint8* data, size_t size);
+  bool read_requested() const;
+
+  virtual bool Test();
+  virtual bool Read(uint8* result);
+  virtual bool Write(uint8 value);
+
+ private:
+  const uint8* data_;
+  size_t size_;
+  size_t position_;
+  bool has_input_;
+  bool read_requested_;
+};
+
+// Device that accepts all writes and reads zero bytes.
+class NullDevice : public machine::Device {
+ public:
+  NullDevice();
+  virtual ~NullDevice();
+
+  virtual bool Test();
+  virtual bool Read(uint8* result);
+  virtual bool Write(uint8 value);
+};
+
+}  // namespace fuzzer
+}  // namespace sicxe
+
+#endif  // FUZZER_FUZZ_DEVICE_H
@@ -0,0 +1,361 @@
+#include "fuzzer/fuzzer.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <thread>
+#include "common/error_db.h"
+#include "common/object_file.h"
+#include "fuzzer/fuzz_device.h"
+#include "fuzzer/mutator.h"
+#include "machine/execute_result.h"
+#include "machine/loader.h"
+#include "machine/machine.h"
+#include "machine/snapshot.h"
+
+using sicxe::machine::CoverageMap;
+using sicxe::machine::ExecuteResult;
+using sicxe::machine::Machine;
+using sicxe::machine::MachineLoader;
+using sicxe::machine::MachineSnapshot;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace sicxe {
+namespace fuzzer {
+
+namespace {
+
+// Installs null devices and the fuzz input device, returns the latter.
+FuzzInputDevice* SetUpDevices(uint8 device_id, Machine* machine) {
+  for (int i = 0; i < 256; i++) {
+    machine->SetDevice(i, new NullDevice);
+  }
+  FuzzInputDevice* device = new FuzzInputDevice;
+  machine->SetDevice(device_id, device);
+  return device;
+}
+
+// Hit counts are compared in buckets, so only significant changes in how often
+// an edge is taken count as new coverage.
+uint8 CountClass(uint8 count) {
+  if (count <= 2) {
+    return count;
+  } else if (count == 3) {
+    return 1 << 2;
+  } else if (count < 8) {
+    return 1 << 3;
+  } else if (count < 16) {
+    return 1 << 4;
+  } else if (count < 32) {
+    return 1 << 5;
+  } else if (count < 128) {
+    return 1 << 6;
+  }
+  return 1 << 7;
+}
+
+// Most of the map is zero, so it is scanned in blocks of 8 bytes.
+bool IsZeroBlock(const uint8* data) {
+  uint64 block;
+  memcpy(&block, data, sizeof(block));
+  return block == 0;
+}
+
+// Clears the bits of |trace| in |virgin|, returns true if any of them were
+// still set. If |new_edge_count| is given it is increased by the number of
+// edges that were never seen before.
+bool MergeNewBits(const uint8* trace, uint8* virgin, uint32* new_edge_count) {
+  bool found = false;
+  for (uint32 i = 0; i < CoverageMap::kMapSize; i += 8) {
+    if (IsZeroBlock(trace + i)) {
+      continue;
+    }
+    for (uint32 j = i; j < i + 8; j++) {
+      if ((trace[j] & virgin[j]) != 0) {
+        if (new_edge_count != nullptr && virgin[j] == 0xff) {
+          (*new_edge_count)++;
+        }
+        virgin[j] &= ~trace[j];
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+}  // namespace
+
+const int Fuzzer::kMutationsPerInput = 64;
+
+class Fuzzer::Worker {
+ public:
+  DISALLOW_COPY_AND_MOVE(Worker);
+
+  Worker(const Machine& initial_machine, const Config& config, uint32 seed,
+         const uint8* global_virgin_bits)
+    : mutator(seed, config.max_input_size), max_instructions_(config.max_instructions) {
+    device_ = SetUpDevices(config.device_id, &machine_);
+    snapshot_.Capture(initial_machine);
+    machine_.set_snapshot(&snapshot_);
+    machine_.set_coverage_map(&coverage_);
+    memcpy(virgin_bits, global_virgin_bits, CoverageMap::kMapSize);
+  }
+
+  OutcomeId Execute(const Input& input) {
+    snapshot_.Restore(&machine_);
+    device_->SetInput(input.data(), input.size());
+    coverage_.Clear();
+    ExecuteResult::ResultId result = ExecuteResult::OK;
+    for (uint32 i = 0; i < max_instructions_ && result == ExecuteResult::OK; i++) {
+      result = machine_.Execute();
+    }
+    if (result == ExecuteResult::OK) {
+      return HANG;
+    } else if (result == ExecuteResult::ENDLESS_LOOP) {
+      return NORMAL;
+    }
+    return CRASH;
+  }
+
+  // Returns the hit counts of the last execution, converted to buckets.
+  const uint8* ClassifyCoverage() {
+    const uint8* counters = coverage_.counters();
+    for (uint32 i = 0; i < CoverageMap::kMapSize; i += 8) {
+      if (IsZeroBlock(counters + i)) {
+        memset(trace_ + i, 0x00, 8);
+        continue;
+      }
+      for (uint32 j = i; j < i + 8; j++) {
+        trace_[j] = CountClass(counters[j]);
+      }
+    }
+    return trace_;
+  }
+
+  Mutator mutator;
+  uint8 virgin_bits[CoverageMap::kMapSize];  // local copy of the global bits
+  std::thread thread;
+
+ private:
+  Machine machine_;
+  MachineSnapshot snapshot_;
+  CoverageMap coverage_;
+  FuzzInputDevice* device_;
+  uint32 max_instructions_;
+  uint8 trace_[CoverageMap::kMapSize];
+};
+
+Fuzzer::Fuzzer(const Config& config)
+  : config_(config), edge_count_(0), unique_crash_count_(0),
+    unique_hang_count_(0), stop_(false), running_worker_count_(0),
+    execution_count_(0), crash_count_(0), hang_count_(0) {
+  assert(config_.thread_count > 0);
+  assert(config_.max_input_size > 0);
+  memset(virgin_bits_, 0xff, sizeof(virgin_bits_));
+  memset(virgin_crash_bits_, 0xff, sizeof(virgin_crash_bits_));
+  memset(virgin_hang_bits_, 0xff, sizeof(virgin_hang_bits_));
+}
+
+Fuzzer::~Fuzzer() {}
+
+bool Fuzzer::Initialize(const ObjectFile& object_file, ErrorDB* error_db) {
+  initial_machine_.reset(new Machine);
+  FuzzInputDevice* device = SetUpDevices(config_.device_id, initial_machine_.get());
+  if (!MachineLoader::LoadObjectFile(object_file, initial_machine_.get())) {
+    error_db->AddError(ErrorDB::ERROR, "object file loading failed", nullptr);
+    return false;
+  }
+
+  ExecuteResult::ResultId result = ExecuteResult::OK;
+  for (uint32 i = 0; i < config_.max_instructions && result == ExecuteResult::OK; i++) {
+    result = initial_machine_->Execute();
+  }
+  if (result == ExecuteResult::DEVICE_ERROR && device->read_requested()) {
+    return true;
+  }
+
+  char error_buffer[100];
+  if (result == ExecuteResult::OK) {
+    snprintf(error_buffer, 100, "no read from device %02X in the first %u instructions",
+             config_.device_id, config_.max_instructions);
+  } else if (result == ExecuteResult::ENDLESS_LOOP) {
+    snprintf(error_buffer, 100, "program ended without reading from device %02X",
+             config_.device_id);
+  } else {
+    snprintf(error_buffer, 100, "machine error at 0x%06X before the first input read",
+             initial_machine_->cpu_state().program_counter);
+  }
+  error_db->AddError(ErrorDB::ERROR, error_buffer, nullptr);
+  return false;
+}
+
+void Fuzzer::AddInput(const Input& input) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  corpus_.push_back(input);
+  if (corpus_.back().size() > config_.max_input_size) {
+    corpus_.back().resize(config_.max_input_size);
+  }
+}
+
+bool Fuzzer::Run(const volatile bool* stop, ErrorDB* error_db) {
+  assert(initial_machine_ != nullptr);
+  if (mkdir(config_.output_directory.c_str(), 0777) != 0 && errno != EEXIST) {
+    string message = "cannot create directory '" + config_.output_directory + "'";
+    error_db->AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+    return false;
+  }
+  if (corpus_.empty()) {
+    corpus_.push_back(Input());
+  }
+
+  vector<unique_ptr<Worker>> workers;
+  for (int i = 0; i < config_.thread_count; i++) {
+    workers.emplace_back(new Worker(*initial_machine_, config_, config_.seed + i,
+                                    virgin_bits_));
+  }
+
+  // initial corpus only marks the coverage it reaches
+  vector<Input> initial_corpus = corpus_;
+  for (const auto& input : initial_corpus) {
+    OutcomeId outcome = workers.front()->Execute(input);
+    ProcessExecution(workers.front().get(), input, outcome, false);
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  running_worker_count_ = config_.thread_count;
+  for (auto& worker : workers) {
+    worker->thread = std::thread(&Fuzzer::WorkerMain, this, worker.get());
+  }
+
+  auto last_status_time = start_time;
+  while (running_worker_count_ > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if (*stop) {
+      stop_ = true;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_status_time >= std::chrono::seconds(1)) {
+      last_status_time = now;
+      PrintStatus(std::chrono::duration<double>(now - start_time).count());
+    }
+  }
+  for (auto& worker : workers) {
+    worker->thread.join();
+  }
+  PrintStatus(std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start_time).count());
+
+  if (!save_failed_file_name_.empty()) {
+    string message = "cannot write file '" + save_failed_file_name_ + "'";
+    error_db->AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+    return false;
+  }
+  return true;
+}
+
+void Fuzzer::WorkerMain(Worker* worker) {
+  Input base;
+  Input other;
+  Input input;
+  while (!stop_) {
+    uint64 first = execution_count_.fetch_add(kMutationsPerInput);
+    if (config_.max_executions != 0 && first >= config_.max_executions) {
+      break;
+    }
+    uint64 count = kMutationsPerInput;
+    if (config_.max_executions != 0 && config_.max_executions - first < count) {
+      count = config_.max_executions - first;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      base = corpus_[worker->mutator.Random(corpus_.size())];
+      other = corpus_[worker->mutator.Random(corpus_.size())];
+    }
+    for (uint64 i = 0; i < count && !stop_; i++) {
+      input = base;
+      worker->mutator.Mutate(other, &input);
+      OutcomeId outcome = worker->Execute(input);
+      ProcessExecution(worker, input, outcome, true);
+    }
+  }
+  running_worker_count_--;
+}
+
+void Fuzzer::ProcessExecution(Worker* worker, const Input& input,
+                              OutcomeId outcome, bool add_to_corpus) {
+  const uint8* trace = worker->ClassifyCoverage();
+  if (outcome == NORMAL) {
+    // the local copy filters out most executions without taking the lock
+    if (!MergeNewBits(trace, worker->virgin_bits, nullptr)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32 new_edge_count = 0;
+    bool found = MergeNewBits(trace, virgin_bits_, &new_edge_count);
+    memcpy(worker->virgin_bits, virgin_bits_, CoverageMap::kMapSize);
+    if (!found) {
+      return;
+    }
+    edge_count_ += new_edge_count;
+    if (add_to_corpus) {
+      corpus_.push_back(input);
+      SaveInput("queue", corpus_.size() - 1, input);
+    }
+    return;
+  }
+
+  if (outcome == CRASH) {
+    crash_count_++;
+  } else {
+    hang_count_++;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (outcome == CRASH && MergeNewBits(trace, virgin_crash_bits_, nullptr)) {
+    SaveInput("crash", unique_crash_count_++, input);
+  } else if (outcome == HANG && MergeNewBits(trace, virgin_hang_bits_, nullptr)) {
+    SaveInput("hang", unique_hang_count_++, input);
+  }
+}
+
+void Fuzzer::SaveInput(const char* prefix, uint64 id, const Input& input) {
+  char name_buffer[32];
+  snprintf(name_buffer, 32, "/%s-%06llu", prefix,
+           static_cast<unsigned long long>(id));
+  string file_name = config_.output_directory + name_buffer;
+  FILE* file = fopen(file_name.c_str(), "wb");
+  bool success = (file != nullptr);
+  if (success) {
+    success = (fwrite(input.data(), 1, input.size(), file) == input.size());
+    success = (fclose(file) == 0) && success;
+  }
+  if (!success && save_failed_file_name_.empty()) {
+    save_failed_file_name_ = file_name;
+  }
+}
+
+void Fuzzer::PrintStatus(double elapsed) {
+  uint64 executions = execution_count_;
+  if (config_.max_executions != 0 && executions > config_.max_executions) {
+    executions = config_.max_executions;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  printf("[%6.0fs] execs: %llu (%.0f/s), corpus: %u, edges: %u, "
+         "crashes: %llu (%llu unique), hangs: %llu (%llu unique)\n",
+         elapsed, static_cast<unsigned long long>(executions),
+         elapsed > 0 ? executions / elapsed : 0.0,
+         static_cast<uint32>(corpus_.size()), edge_count_,
+         static_cast<unsigned long long>(crash_count_),
+         static_cast<unsigned long long>(unique_crash_count_),
+         static_cast<unsigned long long>(hang_count_),
+         static_cast<unsigned long long>(unique_hang_count_));
+  fflush(stdout);
+}
+
+}  // namespace fuzzer
+}  // namespace sicxe
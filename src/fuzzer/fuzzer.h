@@ -0,0 +1,99 @@
+#ifndef FUZZER_FUZZER_H
+#define FUZZER_FUZZER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "common/macros.h"
+#include "common/types.h"
+#include "machine/coverage_map.h"
+
+namespace sicxe {
+
+class ErrorDB;
+class ObjectFile;
+
+namespace machine { class Machine; }
+
+namespace fuzzer {
+
+// Coverage guided fuzzer for SIC/XE programs. The program is loaded and run up
+// to its first read from the fuzz input device, a snapshot of the machine is
+// taken at that point and every execution restores the snapshot, feeds a
+// mutated input through the device and records the taken jumps. Inputs that
+// reach new edges (or new hit count buckets) are added to the shared corpus.
+// Worker threads run their own machines and share the corpus and the global
+// coverage bits.
+class Fuzzer {
+ public:
+  DISALLOW_COPY_AND_MOVE(Fuzzer);
+
+  typedef std::vector<uint8> Input;
+
+  struct Config {
+    uint8 device_id;
+    int thread_count;
+    uint64 max_executions;  // 0 for no limit
+    uint32 max_instructions;  // per execution, more is reported as a hang
+    size_t max_input_size;
+    uint32 seed;
+    std::string output_directory;
+  };
+
+  explicit Fuzzer(const Config& config);
+  ~Fuzzer();
+
+  // Loads the program and runs it up to its first input read, returns false
+  // and adds an error to |error_db| if this fails.
+  bool Initialize(const ObjectFile& object_file, ErrorDB* error_db);
+  void AddInput(const Input& input);
+
+  // Fuzzes until the execution limit is reached or |stop| is set, status is
+  // printed once per second.
+  bool Run(const volatile bool* stop, ErrorDB* error_db);
+
+ private:
+  class Worker;
+
+  enum OutcomeId {
+    NORMAL,
+    CRASH,
+    HANG
+  };
+
+  static const int kMutationsPerInput;
+
+  void WorkerMain(Worker* worker);
+  // Merges the coverage of the last execution of |worker| into the global
+  // bits, saves the input if it reached something new.
+  void ProcessExecution(Worker* worker, const Input& input, OutcomeId outcome,
+                        bool add_to_corpus);
+  void SaveInput(const char* prefix, uint64 id, const Input& input);
+  void PrintStatus(double elapsed);
+
+  Config config_;
+  std::unique_ptr<machine::Machine> initial_machine_;
+
+  std::mutex mutex_;  // guards everything below up to the counters
+  std::vector<Input> corpus_;
+  uint8 virgin_bits_[machine::CoverageMap::kMapSize];
+  uint8 virgin_crash_bits_[machine::CoverageMap::kMapSize];
+  uint8 virgin_hang_bits_[machine::CoverageMap::kMapSize];
+  uint32 edge_count_;
+  uint64 unique_crash_count_;
+  uint64 unique_hang_count_;
+  std::string save_failed_file_name_;
+
+  std::atomic<bool> stop_;
+  std::atomic<int> running_worker_count_;
+  std::atomic<uint64> execution_count_;
+  std::atomic<uint64> crash_count_;
+  std::atomic<uint64> hang_count_;
+};
+
+}  // namespace fuzzer
+}  // namespace sicxe
+
+#endif  // FUZZER_FUZZER_H
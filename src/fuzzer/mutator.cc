@@ -0,0 +1,101 @@
+#include "fuzzer/mutator.h"
+
+#include <assert.h>
+#include <algorithm>
+
+using std::vector;
+
+namespace sicxe {
+namespace fuzzer {
+
+const int Mutator::kMaxStackedOperations = 16;
+
+// boundary values and characters that are significant for text parsers
+const uint8 Mutator::kInterestingBytes[] = {
+  0x00, 0x01, 0x7f, 0x80, 0xff, '\n', '\r', '\t', ' ', '0', '9', 'A', 'Z',
+  'a', 'z', '-', '+', '.', ',', '#', '@'
+};
+
+Mutator::Mutator(uint32 seed, size_t max_size)
+  : random_(seed), max_size_(max_size) {
+  assert(max_size_ > 0);
+}
+
+Mutator::~Mutator() {}
+
+uint32 Mutator::Random(uint32 limit) {
+  assert(limit > 0);
+  return static_cast<uint32>(random_() % limit);
+}
+
+void Mutator::Mutate(const vector<uint8>& other, vector<uint8>* data) {
+  int operation_count = 1 + Random(kMaxStackedOperations);
+  for (int i = 0; i < operation_count; i++) {
+    if (data->empty()) {
+      InsertBlock(other, data);
+      continue;
+    }
+    uint32 position = Random(data->size());
+    switch (Random(8)) {
+      case 0:
+        (*data)[position] ^= static_cast<uint8>(1 << Random(8));
+        break;
+      case 1:
+        (*data)[position] = static_cast<uint8>(Random(256));
+        break;
+      case 2:
+        (*data)[position] =
+          kInterestingBytes[Random(sizeof(kInterestingBytes))];
+        break;
+      case 3:
+        (*data)[position] += static_cast<uint8>(Random(35) - 17);
+        break;
+      case 4:
+      case 5:
+        InsertBlock(other, data);
+        break;
+      case 6: {
+        uint32 length = 1 + Random(std::min<size_t>(data->size() - position, 16));
+        data->erase(data->begin() + position, data->begin() + position + length);
+        break;
+      }
+      case 7:
+        if (!other.empty()) {
+          // overwrite a block with a block from the other input
+          uint32 source = Random(other.size());
+          uint32 length = 1 + Random(std::min(other.size() - source,
+                                              data->size() - position));
+          std::copy(other.begin() + source, other.begin() + source + length,
+                    data->begin() + position);
+        }
+        break;
+    }
+  }
+}
+
+void Mutator::InsertBlock(const vector<uint8>& other, vector<uint8>* data) {
+  if (data->size() >= max_size_) {
+    return;
+  }
+  uint32 position = Random(data->size() + 1);
+  uint32 length = 1 + Random(std::min<size_t>(max_size_ - data->size(), 16));
+  vector<uint8> block;
+  uint32 kind = Random(3);
+  if (kind == 0 && !data->empty()) {
+    // duplicate a block of the input itself
+    uint32 source = Random(data->size());
+    length = std::min<uint32>(length, data->size() - source);
+    block.assign(data->begin() + source, data->begin() + source + length);
+  } else if (kind == 1 && !other.empty()) {
+    uint32 source = Random(other.size());
+    length = std::min<uint32>(length, other.size() - source);
+    block.assign(other.begin() + source, other.begin() + source + length);
+  } else {
+    uint8 value = kInterestingBytes[Random(sizeof(kInterestingBytes))];
+    block.assign(length, value);
+  }
+  data->insert(data->begin() + position, block.begin(), block.end());
+}
+
+}  // namespace fuzzer
+}  // namespace sicxe
@@ -0,0 +1,42 @@
+#ifndef FUZZER_MUTATOR_H
+#define FUZZER_MUTATOR_H
+
+#include <random>
+#include <vector>
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+namespace fuzzer {
+
+// Random input mutations in the style of the AFL havoc stage. Every mutation
+// stacks a random number of bit flips, byte replacements, small additions,
+// block insertions, deletions, duplications and splices with another input.
+class Mutator {
+ public:
+  DISALLOW_COPY_AND_MOVE(Mutator);
+
+  static const int kMaxStackedOperations;
+
+  Mutator(uint32 seed, size_t max_size);
+  ~Mutator();
+
+  // Mutates |data| in place, |other| is used as the source for splicing.
+  void Mutate(const std::vector<uint8>& other, std::vector<uint8>* data);
+
+  // Returns a random number in [0, limit), |limit| must not be zero.
+  uint32 Random(uint32 limit);
+
+ private:
+  static const uint8 kInterestingBytes[];
+
+  void InsertBlock(const std::vector<uint8>& other, std::vector<uint8>* data);
+
+  std::mt19937 random_;
+  size_t max_size_;
+};
+
+}  // namespace fuzzer
+}  // namespace sicxe
+
+#endif  // FUZZER_MUTATOR_H
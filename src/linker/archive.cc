@@ -0,0 +1,267 @@
+#include "linker/archive.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "common/little_endian.h"
+#include "common/mapped_file.h"
+#include "common/output_file.h"
+
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// Archives use the conventions of the binary object file format, all fields
+// are 32-bit little-endian and every part starts at a multiple of four bytes.
+//
+//   header        see HeaderField
+//   member table  name offset, name size, data offset, data size
+//   symbol index  name offset, name size, member index - ordered by name
+//   string pool   member and symbol names, padded with zero bytes
+//   member data   contents of all members, each padded with zero bytes
+//
+// Name offsets point into the string pool, data offsets into the member data.
+// The symbol index is searched in place, so opening an archive does not read
+// more than its header and tables.
+
+namespace sicxe {
+namespace linker {
+
+const int Archive::kNotFound = -1;
+const char Archive::kMagic[] = "SLIB";
+
+namespace {
+
+enum HeaderField {
+  MAGIC = 0,
+  VERSION = 4,
+  MEMBER_COUNT = 8,
+  SYMBOL_COUNT = 12,
+  STRING_POOL_SIZE = 16,
+  BODY_SIZE = 20,
+  HEADER_SIZE = 24
+};
+
+const uint32 kArchiveVersion = 1;
+const uint32 kMemberEntrySize = 16;
+const uint32 kSymbolEntrySize = 12;
+
+}  // namespace
+
+Archive::Archive()
+    : member_count_(0), symbol_count_(0), member_table_(nullptr),
+      symbol_table_(nullptr), string_pool_(nullptr), member_data_(nullptr) {}
+Archive::~Archive() {}
+
+bool Archive::IsArchive(StringView contents) {
+  return contents.size() >= 4 && memcmp(contents.data(), kMagic, 4) == 0;
+}
+
+bool Archive::SaveFile(const char* file_name, const MemberVector& members) {
+  vector<pair<const string*, uint32> > symbols;
+  for (size_t i = 0; i < members.size(); i++) {
+    for (const string& symbol : members[i]->symbols) {
+      symbols.push_back(std::make_pair(&symbol, static_cast<uint32>(i)));
+    }
+  }
+  std::sort(symbols.begin(), symbols.end(),
+            [](const pair<const string*, uint32>& a, const pair<const string*, uint32>& b) {
+              return *a.first < *b.first;
+            });
+
+  string string_pool;
+  uint64 data_size = 0;
+  for (const auto& member : members) {
+    string_pool += member->name;
+    data_size += LittleEndian::RoundUp4(member->contents.size());
+  }
+  for (const auto& symbol : symbols) {
+    string_pool += *symbol.first;
+  }
+  uint64 body_size = members.size() * kMemberEntrySize + symbols.size() * kSymbolEntrySize +
+                     LittleEndian::RoundUp4(string_pool.size()) + data_size;
+  if (body_size > 0xffffffffu) {
+    return false;
+  }
+
+  vector<uint8> buffer(HEADER_SIZE + body_size, 0);
+  uint8* header = buffer.data();
+  memcpy(header + MAGIC, kMagic, 4);
+  LittleEndian::WriteUint32(kArchiveVersion, header + VERSION);
+  LittleEndian::WriteUint32(members.size(), header + MEMBER_COUNT);
+  LittleEndian::WriteUint32(symbols.size(), header + SYMBOL_COUNT);
+  LittleEndian::WriteUint32(string_pool.size(), header + STRING_POOL_SIZE);
+  LittleEndian::WriteUint32(body_size, header + BODY_SIZE);
+
+  uint8* out = header + HEADER_SIZE;
+  uint32 name_offset = 0;
+  uint32 data_offset = 0;
+  for (const auto& member : members) {
+    LittleEndian::WriteUint32(name_offset, out);
+    LittleEndian::WriteUint32(member->name.size(), out + 4);
+    LittleEndian::WriteUint32(data_offset, out + 8);
+    LittleEndian::WriteUint32(member->contents.size(), out + 12);
+    name_offset += member->name.size();
+    data_offset += LittleEndian::RoundUp4(member->contents.size());
+    out += kMemberEntrySize;
+  }
+  for (size_t i = 0; i < symbols.size(); i++) {
+    assert(i == 0 || *symbols[i - 1].first != *symbols[i].first);
+    LittleEndian::WriteUint32(name_offset, out);
+    LittleEndian::WriteUint32(symbols[i].first->size(), out + 4);
+    LittleEndian::WriteUint32(symbols[i].second, out + 8);
+    name_offset += symbols[i].first->size();
+    out += kSymbolEntrySize;
+  }
+  memcpy(out, string_pool.data(), string_pool.size());
+  out += LittleEndian::RoundUp4(string_pool.size());
+  for (const auto& member : members) {
+    memcpy(out, member->contents.data(), member->contents.size());
+    out += LittleEndian::RoundUp4(member->contents.size());
+  }
+
+  OutputFile file;
+  if (!file.Open(file_name, "wb")) {
+    return false;
+  }
+  if (fwrite(buffer.data(), 1, buffer.size(), file.file()) != buffer.size()) {
+    file.Discard();
+    return false;
+  }
+  return file.Close();
+}
+
+ObjectFile::LoadResult Archive::LoadFile(const char* the_file_name) {
+  unique_ptr<MappedFile> mapped_file(new MappedFile);
+  if (!mapped_file->Open(the_file_name)) {
+    mapped_file_.reset();
+    return ObjectFile::OPEN_FAILED;
+  }
+  return LoadMappedFile(the_file_name, std::move(mapped_file));
+}
+
+ObjectFile::LoadResult Archive::LoadMappedFile(const char* the_file_name,
+                                               unique_ptr<MappedFile> mapped_file) {
+  mapped_file_ = std::move(mapped_file);
+  if (!Load()) {
+    mapped_file_.reset();
+    member_count_ = 0;
+    symbol_count_ = 0;
+    return ObjectFile::INVALID_FORMAT;
+  }
+  file_name_ = string(the_file_name);
+  return ObjectFile::OK;
+}
+
+bool Archive::Load() {
+  size_t file_size = mapped_file_->size();
+  const uint8* header = reinterpret_cast<const uint8*>(mapped_file_->data());
+  if (file_size < HEADER_SIZE || memcmp(header + MAGIC, kMagic, 4) != 0 ||
+      LittleEndian::ReadUint32(header + VERSION) != kArchiveVersion ||
+      LittleEndian::ReadUint32(header + BODY_SIZE) != file_size - HEADER_SIZE) {
+    return false;
+  }
+  member_count_ = LittleEndian::ReadUint32(header + MEMBER_COUNT);
+  symbol_count_ = LittleEndian::ReadUint32(header + SYMBOL_COUNT);
+  uint32 string_pool_size = LittleEndian::ReadUint32(header + STRING_POOL_SIZE);
+  uint64 body_size = file_size - HEADER_SIZE;
+  uint64 tables_size = static_cast<uint64>(member_count_) * kMemberEntrySize +
+                       static_cast<uint64>(symbol_count_) * kSymbolEntrySize +
+                       LittleEndian::RoundUp4(string_pool_size);
+  if (tables_size > body_size) {
+    return false;
+  }
+  uint64 data_size = body_size - tables_size;
+  member_table_ = header + HEADER_SIZE;
+  symbol_table_ = member_table_ + member_count_ * kMemberEntrySize;
+  string_pool_ = reinterpret_cast<const char*>(symbol_table_ +
+                                                symbol_count_ * kSymbolEntrySize);
+  member_data_ = string_pool_ + LittleEndian::RoundUp4(string_pool_size);
+
+  // every reference is checked once here, so accessors need no checks
+  auto valid_range = [](uint32 offset, uint32 size, uint64 limit) {
+    return offset <= limit && size <= limit - offset;
+  };
+  for (uint32 i = 0; i < member_count_; i++) {
+    const uint8* entry = member_table_ + i * kMemberEntrySize;
+    if (!valid_range(LittleEndian::ReadUint32(entry), LittleEndian::ReadUint32(entry + 4),
+                     string_pool_size) ||
+        !valid_range(LittleEndian::ReadUint32(entry + 8), LittleEndian::ReadUint32(entry + 12),
+                     data_size)) {
+      return false;
+    }
+  }
+  for (uint32 i = 0; i < symbol_count_; i++) {
+    const uint8* entry = symbol_table_ + i * kSymbolEntrySize;
+    if (!valid_range(LittleEndian::ReadUint32(entry), LittleEndian::ReadUint32(entry + 4),
+                     string_pool_size) ||
+        LittleEndian::ReadUint32(entry + 8) >= member_count_) {
+      return false;
+    }
+    // binary search needs strictly ordered names
+    if (i > 0 && !(symbol_name(i - 1) < symbol_name(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const string& Archive::file_name() const {
+  return file_name_;
+}
+
+uint32 Archive::member_count() const {
+  return member_count_;
+}
+
+StringView Archive::member_name(uint32 index) const {
+  assert(index < member_count_);
+  const uint8* entry = member_table_ + index * kMemberEntrySize;
+  return StringView(string_pool_ + LittleEndian::ReadUint32(entry),
+                    LittleEndian::ReadUint32(entry + 4));
+}
+
+StringView Archive::member_contents(uint32 index) const {
+  assert(index < member_count_);
+  const uint8* entry = member_table_ + index * kMemberEntrySize;
+  return StringView(member_data_ + LittleEndian::ReadUint32(entry + 8),
+                    LittleEndian::ReadUint32(entry + 12));
+}
+
+uint32 Archive::symbol_count() const {
+  return symbol_count_;
+}
+
+StringView Archive::symbol_name(uint32 index) const {
+  assert(index < symbol_count_);
+  const uint8* entry = symbol_table_ + index * kSymbolEntrySize;
+  return StringView(string_pool_ + LittleEndian::ReadUint32(entry),
+                    LittleEndian::ReadUint32(entry + 4));
+}
+
+uint32 Archive::symbol_member(uint32 index) const {
+  assert(index < symbol_count_);
+  return LittleEndian::ReadUint32(symbol_table_ + index * kSymbolEntrySize + 8);
+}
+
+int Archive::FindSymbol(StringView name) const {
+  uint32 low = 0;
+  uint32 high = symbol_count_;
+  while (low < high) {
+    uint32 middle = low + (high - low) / 2;
+    if (symbol_name(middle) < name) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low < symbol_count_ && symbol_name(low) == name) {
+    return static_cast<int>(symbol_member(low));
+  }
+  return kNotFound;
+}
+
+}  // namespace linker
+}  // namespace sicxe
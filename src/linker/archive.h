@@ -0,0 +1,77 @@
+#ifndef LINKER_ARCHIVE_H
+#define LINKER_ARCHIVE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/macros.h"
+#include "common/object_file.h"
+#include "common/string_view.h"
+#include "common/types.h"
+
+namespace sicxe {
+
+class MappedFile;
+
+namespace linker {
+
+// Library archive, a bundle of object files (members) with an index of the
+// symbols they export. Members are kept as they were written, in either
+// object file format, and are only parsed when the linker needs them.
+class Archive {
+ public:
+  DISALLOW_COPY_AND_MOVE(Archive);
+
+  struct Member {
+    std::string name;
+    std::string contents;
+    std::vector<std::string> symbols;  // exported symbol names
+  };
+
+  typedef std::vector<std::unique_ptr<Member> > MemberVector;
+
+  static const int kNotFound;
+
+  Archive();
+  ~Archive();
+
+  // Returns true if |contents| start with the archive magic.
+  static bool IsArchive(StringView contents);
+  // Symbol names must be unique across all |members|.
+  static bool SaveFile(const char* file_name, const MemberVector& members);
+
+  ObjectFile::LoadResult LoadFile(const char* the_file_name);
+  // Like LoadFile() for a file that is already open.
+  ObjectFile::LoadResult LoadMappedFile(const char* the_file_name,
+                                        std::unique_ptr<MappedFile> mapped_file);
+
+  const std::string& file_name() const;
+  uint32 member_count() const;
+  StringView member_name(uint32 index) const;
+  StringView member_contents(uint32 index) const;
+  // Symbols are ordered by name.
+  uint32 symbol_count() const;
+  StringView symbol_name(uint32 index) const;
+  uint32 symbol_member(uint32 index) const;
+  // Index of the member exporting |name|, kNotFound if there is none.
+  int FindSymbol(StringView name) const;
+
+ private:
+  static const char kMagic[];
+
+  bool Load();
+
+  std::string file_name_;
+  std::unique_ptr<MappedFile> mapped_file_;
+  uint32 member_count_;
+  uint32 symbol_count_;
+  const uint8* member_table_;
+  const uint8* symbol_table_;
+  const char* string_pool_;
+  const char* member_data_;
+};
+
+}  // namespace linker
+}  // namespace sicxe
+
+#endif  // LINKER_ARCHIVE_H
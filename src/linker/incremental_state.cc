@@ -0,0 +1,436 @@
+#include "linker/incremental_state.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "common/little_endian.h"
+#include "common/mapped_file.h"
+#include "common/output_file.h"
+
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+// State files use the conventions of archives, fields are 32-bit little-endian
+// unless noted otherwise and every part starts at a multiple of four bytes.
+//
+//   header        see HeaderField
+//   options       options of the link, padded with zero bytes
+//   file table    one entry per linked file, see FileEntryField
+//   string pool   file names, padded with zero bytes
+//   data          cached object files, then the output, each padded with
+//                 zero bytes
+//
+// Cached object files and the output are in the binary object file format, so
+// loading them checks their checksums.
+
+namespace sicxe {
+namespace linker {
+
+namespace {
+
+enum HeaderField {
+  MAGIC = 0,
+  VERSION = 4,
+  FILE_COUNT = 8,
+  OPTIONS_SIZE = 12,
+  STRING_POOL_SIZE = 16,
+  OUTPUT_SIZE = 20,
+  BODY_SIZE = 24,
+  HEADER_SIZE = 28
+};
+
+enum FileEntryField {
+  NAME_OFFSET = 0,
+  NAME_SIZE = 4,
+  FILE_SIZE = 8,  // 64 bits
+  SECONDS = 16,  // 64 bits
+  NANOSECONDS = 24,
+  HASH = 28,  // 64 bits
+  DATA_OFFSET = 36,
+  DATA_SIZE = 40,
+  START_ADDRESS = 44,
+  FIRST_TEXT_SECTION = 48,
+  TEXT_SECTION_COUNT = 52,
+  FIRST_RELOCATION = 56,
+  RELOCATION_COUNT = 60,
+  FILE_ENTRY_SIZE = 64
+};
+
+const char kMagic[] = "SLST";
+const uint32 kStateVersion = 1;
+
+}  // namespace
+
+IncrementalState::Stamp::Stamp() : size(0), seconds(0), nanoseconds(0) {}
+
+bool IncrementalState::Stamp::operator==(const Stamp& other) const {
+  return size == other.size && seconds == other.seconds &&
+         nanoseconds == other.nanoseconds;
+}
+
+IncrementalState::Input::Input()
+    : file(nullptr), hash(0), entry(nullptr), skipped(false) {}
+
+IncrementalState::IncrementalState() {}
+IncrementalState::~IncrementalState() {}
+
+uint64 IncrementalState::Hash(StringView data) {
+  // 64-bit FNV-1a
+  uint64 hash = 14695981039346656037ull;
+  for (char c : data) {
+    hash ^= static_cast<uint8>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+void IncrementalState::LoadFile(const char* the_file_name, const string& options,
+                                size_t input_count) {
+  entries_.clear();
+  entry_names_.reset(new StringPool);
+  first_entries_.clear();
+  output_contents_ = StringView();
+  inputs_.clear();
+  inputs_.resize(input_count);
+  mapped_file_.reset(new MappedFile);
+  if (!mapped_file_->Open(the_file_name) || !Load(options)) {
+    mapped_file_.reset();
+    entries_.clear();
+    output_contents_ = StringView();
+  }
+}
+
+bool IncrementalState::Load(const string& options) {
+  size_t file_size = mapped_file_->size();
+  const uint8* header = reinterpret_cast<const uint8*>(mapped_file_->data());
+  if (file_size < HEADER_SIZE || memcmp(header + MAGIC, kMagic, 4) != 0 ||
+      LittleEndian::ReadUint32(header + VERSION) != kStateVersion ||
+      LittleEndian::ReadUint32(header + BODY_SIZE) != file_size - HEADER_SIZE) {
+    return false;
+  }
+  uint32 file_count = LittleEndian::ReadUint32(header + FILE_COUNT);
+  uint32 options_size = LittleEndian::ReadUint32(header + OPTIONS_SIZE);
+  uint32 string_pool_size = LittleEndian::ReadUint32(header + STRING_POOL_SIZE);
+  uint32 output_size = LittleEndian::ReadUint32(header + OUTPUT_SIZE);
+  uint64 body_size = file_size - HEADER_SIZE;
+  uint64 tables_size = LittleEndian::RoundUp4(options_size) +
+                       static_cast<uint64>(file_count) * FILE_ENTRY_SIZE +
+                       LittleEndian::RoundUp4(string_pool_size);
+  if (tables_size > body_size) {
+    return false;
+  }
+  const char* options_data = reinterpret_cast<const char*>(header + HEADER_SIZE);
+  if (StringView(options_data, options_size) != StringView(options)) {
+    return false;
+  }
+  const uint8* file_table = header + HEADER_SIZE + LittleEndian::RoundUp4(options_size);
+  const char* string_pool =
+      reinterpret_cast<const char*>(file_table + file_count * FILE_ENTRY_SIZE);
+  const char* data = string_pool + LittleEndian::RoundUp4(string_pool_size);
+  uint64 data_size = body_size - tables_size;
+
+  auto valid_range = [](uint32 offset, uint32 size, uint64 limit) {
+    return offset <= limit && size <= limit - offset;
+  };
+  for (uint32 i = 0; i < file_count; i++) {
+    const uint8* entry_data = file_table + i * FILE_ENTRY_SIZE;
+    uint32 name_offset = LittleEndian::ReadUint32(entry_data + NAME_OFFSET);
+    uint32 name_size = LittleEndian::ReadUint32(entry_data + NAME_SIZE);
+    uint32 data_offset = LittleEndian::ReadUint32(entry_data + DATA_OFFSET);
+    uint32 entry_data_size = LittleEndian::ReadUint32(entry_data + DATA_SIZE);
+    if (!valid_range(name_offset, name_size, string_pool_size) ||
+        !valid_range(data_offset, entry_data_size, data_size)) {
+      return false;
+    }
+    Entry entry;
+    entry.name = StringView(string_pool + name_offset, name_size);
+    entry.stamp.size = LittleEndian::ReadUint64(entry_data + FILE_SIZE);
+    entry.stamp.seconds = static_cast<int64>(LittleEndian::ReadUint64(entry_data + SECONDS));
+    entry.stamp.nanoseconds = LittleEndian::ReadUint32(entry_data + NANOSECONDS);
+    entry.hash = LittleEndian::ReadUint64(entry_data + HASH);
+    entry.contents = StringView(data + data_offset, entry_data_size);
+    entry.range.start_address = LittleEndian::ReadUint32(entry_data + START_ADDRESS);
+    entry.range.first_text_section = LittleEndian::ReadUint32(entry_data + FIRST_TEXT_SECTION);
+    entry.range.text_section_count = LittleEndian::ReadUint32(entry_data + TEXT_SECTION_COUNT);
+    entry.range.first_relocation = LittleEndian::ReadUint32(entry_data + FIRST_RELOCATION);
+    entry.range.relocation_count = LittleEndian::ReadUint32(entry_data + RELOCATION_COUNT);
+    entries_.push_back(entry);
+    if (entry_names_->Intern(entry.name) == first_entries_.size()) {
+      first_entries_.push_back(i);
+    }
+  }
+  // the output follows the cached files
+  uint64 padded_output_size = LittleEndian::RoundUp4(output_size);
+  if (padded_output_size > data_size) {
+    return false;
+  }
+  output_contents_ = StringView(data + (data_size - padded_output_size), output_size);
+  return true;
+}
+
+bool IncrementalState::ReadStamp(const char* file_name, Stamp* stamp) {
+  struct stat file_stat;
+  // streams have no stable contents to compare
+  if (stat(file_name, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+    return false;
+  }
+  stamp->size = file_stat.st_size;
+  stamp->seconds = file_stat.st_mtim.tv_sec;
+  stamp->nanoseconds = file_stat.st_mtim.tv_nsec;
+  return true;
+}
+
+const IncrementalState::Entry* IncrementalState::FindEntry(StringView name) const {
+  if (mapped_file_ == nullptr) {
+    return nullptr;
+  }
+  StringPool::Id id = entry_names_->Find(name);
+  if (id == StringPool::kInvalidId) {
+    return nullptr;
+  }
+  return &entries_[first_entries_[id]];
+}
+
+bool IncrementalState::IsUnchanged(const Input& input, const Entry* entry) {
+  // an equal hash means equal contents, whichever way the file was loaded
+  return entry != nullptr && input.hash == entry->hash && !entry->contents.empty();
+}
+
+bool IncrementalState::LoadCachedInput(const Input& input, ObjectFile* file) {
+  if (!IsUnchanged(input, input.entry) ||
+      file->LoadContents(input.entry->contents) != ObjectFile::OK) {
+    return false;
+  }
+  file->set_file_name(input.file_name);
+  return true;
+}
+
+ObjectFile::LoadResult IncrementalState::LoadInput(size_t index,
+                                                   const char* input_file_name,
+                                                   const MappedFile& mapped_file,
+                                                   ObjectFile* file) {
+  assert(index < inputs_.size());
+  Input* input = &inputs_[index];
+  input->file = file;
+  input->file_name = input_file_name;
+  input->entry = FindEntry(input_file_name);
+  // a file with the old size and modification time is not even read
+  if (ReadStamp(input_file_name, &input->stamp) && input->entry != nullptr &&
+      input->entry->stamp == input->stamp && !input->entry->contents.empty()) {
+    input->hash = input->entry->hash;
+    input->skipped = true;
+    file->set_file_name(input_file_name);
+    return ObjectFile::OK;
+  }
+
+  StringView contents(mapped_file.data(), mapped_file.size());
+  input->hash = Hash(contents);
+  if (LoadCachedInput(*input, file)) {
+    return ObjectFile::OK;
+  }
+  ObjectFile::LoadResult result = file->LoadContents(contents);
+  if (result == ObjectFile::OK) {
+    file->set_file_name(input_file_name);
+  }
+  return result;
+}
+
+bool IncrementalState::input_skipped(size_t index) const {
+  return inputs_[index].skipped;
+}
+
+ObjectFile::LoadResult IncrementalState::LoadSkippedInput(size_t index) {
+  assert(inputs_[index].skipped);
+  Input* input = &inputs_[index];
+  input->skipped = false;
+  if (LoadCachedInput(*input, input->file)) {
+    return ObjectFile::OK;
+  }
+  ObjectFile::LoadResult result = input->file->LoadFile(input->file_name.c_str());
+  if (result == ObjectFile::OK) {
+    // the contents are unknown, so the state does not keep them
+    input->entry = nullptr;
+  }
+  return result;
+}
+
+void IncrementalState::GetInputs(unordered_map<const ObjectFile*, const Input*>* inputs) const {
+  for (const Input& input : inputs_) {
+    if (input.file != nullptr) {
+      (*inputs)[input.file] = &input;
+    }
+  }
+}
+
+bool IncrementalState::SameInterface(const ObjectFile& a, const ObjectFile& b) {
+  if (a.start_address() != b.start_address() || a.code_size() != b.code_size() ||
+      a.export_sections().size() != b.export_sections().size() ||
+      a.import_sections().size() != b.import_sections().size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.export_sections().size(); i++) {
+    if (a.export_sections()[i]->symbols != b.export_sections()[i]->symbols) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < a.import_sections().size(); i++) {
+    if (a.import_sections()[i]->symbols != b.import_sections()[i]->symbols) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IncrementalState::PrepareRelink(const Linker::ObjectFileVector& files,
+                                     Linker::FileOutputRangeVector* ranges,
+                                     Linker::ChangedFileVector* changed_files,
+                                     ObjectFile* output_file) {
+  ranges->clear();
+  changed_files->clear();
+  if (mapped_file_ == nullptr || files.size() != entries_.size()) {
+    return false;
+  }
+  unordered_map<const ObjectFile*, const Input*> inputs;
+  GetInputs(&inputs);
+  for (size_t i = 0; i < files.size(); i++) {
+    const Entry& entry = entries_[i];
+    auto it = inputs.find(files[i]);
+    if (it == inputs.end() || entry.name != StringView(files[i]->file_name())) {
+      return false;
+    }
+    ranges->push_back(entry.range);
+    if (IsUnchanged(*it->second, &entry)) {
+      continue;
+    }
+    // the output was linked with the old contents of the file
+    ObjectFile old_file;
+    if (entry.contents.empty() || it->second->skipped ||
+        old_file.LoadContents(entry.contents) != ObjectFile::OK ||
+        !SameInterface(old_file, *files[i])) {
+      return false;
+    }
+    Linker::ChangedFile changed_file;
+    changed_file.index = i;
+    changed_file.file = files[i];
+    changed_files->push_back(changed_file);
+  }
+
+  if (output_file->LoadContents(output_contents_) != ObjectFile::OK) {
+    return false;
+  }
+  uint64 text_section_count = output_file->text_sections().size();
+  uint64 relocation_count = output_file->relocation_sections().size();
+  for (const Linker::FileOutputRange& range : *ranges) {
+    if (static_cast<uint64>(range.first_text_section) + range.text_section_count >
+            text_section_count ||
+        static_cast<uint64>(range.first_relocation) + range.relocation_count >
+            relocation_count) {
+      output_file->Clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IncrementalState::SaveFile(const char* the_file_name, const string& options,
+                                const Linker::ObjectFileVector& files,
+                                const Linker::FileOutputRangeVector& ranges,
+                                const ObjectFile& output) const {
+  unordered_map<const ObjectFile*, const Input*> inputs;
+  GetInputs(&inputs);
+  // cached contents of unchanged inputs are copied from the loaded state
+  vector<vector<uint8> > encoded_files(files.size());
+  vector<StringView> contents(files.size());
+  string string_pool;
+  uint64 data_size = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    string_pool += files[i]->file_name();
+    auto it = inputs.find(files[i]);
+    if (it == inputs.end()) {
+      continue;
+    }
+    const Input& input = *it->second;
+    if (IsUnchanged(input, input.entry)) {
+      contents[i] = input.entry->contents;
+    } else {
+      files[i]->SaveBinary(&encoded_files[i]);
+      contents[i] = StringView(reinterpret_cast<const char*>(encoded_files[i].data()),
+                               encoded_files[i].size());
+    }
+    data_size += LittleEndian::RoundUp4(contents[i].size());
+  }
+  vector<uint8> encoded_output;
+  output.SaveBinary(&encoded_output);
+  data_size += LittleEndian::RoundUp4(encoded_output.size());
+  uint64 body_size = LittleEndian::RoundUp4(options.size()) + files.size() * FILE_ENTRY_SIZE +
+                     LittleEndian::RoundUp4(string_pool.size()) + data_size;
+  if (body_size > 0xffffffffu) {
+    return false;
+  }
+
+  vector<uint8> buffer(HEADER_SIZE + body_size, 0);
+  uint8* header = buffer.data();
+  memcpy(header + MAGIC, kMagic, 4);
+  LittleEndian::WriteUint32(kStateVersion, header + VERSION);
+  LittleEndian::WriteUint32(files.size(), header + FILE_COUNT);
+  LittleEndian::WriteUint32(options.size(), header + OPTIONS_SIZE);
+  LittleEndian::WriteUint32(string_pool.size(), header + STRING_POOL_SIZE);
+  LittleEndian::WriteUint32(encoded_output.size(), header + OUTPUT_SIZE);
+  LittleEndian::WriteUint32(body_size, header + BODY_SIZE);
+
+  uint8* out = header + HEADER_SIZE;
+  memcpy(out, options.data(), options.size());
+  out += LittleEndian::RoundUp4(options.size());
+  uint32 name_offset = 0;
+  uint32 data_offset = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    const string& name = files[i]->file_name();
+    LittleEndian::WriteUint32(name_offset, out + NAME_OFFSET);
+    LittleEndian::WriteUint32(name.size(), out + NAME_SIZE);
+    auto it = inputs.find(files[i]);
+    if (it != inputs.end()) {
+      const Input& input = *it->second;
+      LittleEndian::WriteUint64(input.stamp.size, out + FILE_SIZE);
+      LittleEndian::WriteUint64(static_cast<uint64>(input.stamp.seconds), out + SECONDS);
+      LittleEndian::WriteUint32(input.stamp.nanoseconds, out + NANOSECONDS);
+      LittleEndian::WriteUint64(input.hash, out + HASH);
+    }
+    LittleEndian::WriteUint32(data_offset, out + DATA_OFFSET);
+    LittleEndian::WriteUint32(contents[i].size(), out + DATA_SIZE);
+    if (ranges.size() == files.size()) {
+      LittleEndian::WriteUint32(ranges[i].start_address, out + START_ADDRESS);
+      LittleEndian::WriteUint32(ranges[i].first_text_section, out + FIRST_TEXT_SECTION);
+      LittleEndian::WriteUint32(ranges[i].text_section_count, out + TEXT_SECTION_COUNT);
+      LittleEndian::WriteUint32(ranges[i].first_relocation, out + FIRST_RELOCATION);
+      LittleEndian::WriteUint32(ranges[i].relocation_count, out + RELOCATION_COUNT);
+    }
+    name_offset += name.size();
+    data_offset += LittleEndian::RoundUp4(contents[i].size());
+    out += FILE_ENTRY_SIZE;
+  }
+  memcpy(out, string_pool.data(), string_pool.size());
+  out += LittleEndian::RoundUp4(string_pool.size());
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!contents[i].empty()) {
+      memcpy(out, contents[i].data(), contents[i].size());
+    }
+    out += LittleEndian::RoundUp4(contents[i].size());
+  }
+  memcpy(out, encoded_output.data(), encoded_output.size());
+
+  // the loaded state stays mapped, so the new one replaces it only when complete
+  OutputFile file;
+  if (!file.Open(the_file_name, "wb")) {
+    return false;
+  }
+  if (fwrite(buffer.data(), 1, buffer.size(), file.file()) != buffer.size()) {
+    file.Discard();
+    return false;
+  }
+  return file.Close();
+}
+
+}  // namespace linker
+}  // namespace sicxe
@@ -0,0 +1,121 @@
+#ifndef LINKER_INCREMENTAL_STATE_H
+#define LINKER_INCREMENTAL_STATE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/macros.h"
+#include "common/object_file.h"
+#include "common/string_pool.h"
+#include "common/string_view.h"
+#include "common/types.h"
+#include "linker/linker.h"
+
+namespace sicxe {
+
+class MappedFile;
+
+namespace linker {
+
+// Link state that sicld --incremental keeps between links: for every linked
+// file its size, modification time and contents hash, its parsed contents in
+// the binary object format and its place in the output, and the output itself.
+// Inputs with the saved size and modification time are not read. If the
+// changed inputs keep their layout and symbols, the linker patches only them
+// into the saved output (see Linker::RelinkFiles), otherwise the unchanged
+// inputs are loaded from the state and all files are linked anew.
+class IncrementalState {
+ public:
+  DISALLOW_COPY_AND_MOVE(IncrementalState);
+
+  IncrementalState();
+  ~IncrementalState();
+
+  static uint64 Hash(StringView data);
+
+  // Loads the state saved by a link with the same |options|. A missing or
+  // invalid state, or one saved with other options, is ignored, so the next
+  // link is done anew. There are |input_count| input files.
+  void LoadFile(const char* the_file_name, const std::string& options,
+                size_t input_count);
+  // Loads input file |index| named |input_file_name| and opened as
+  // |mapped_file|, from the state if it did not change. A regular file with
+  // the saved size and modification time is skipped, only its name is set.
+  // Different inputs can be loaded on several threads.
+  ObjectFile::LoadResult LoadInput(size_t index, const char* input_file_name,
+                                   const MappedFile& mapped_file, ObjectFile* file);
+  bool input_skipped(size_t index) const;
+  // Loads a skipped input from the state.
+  ObjectFile::LoadResult LoadSkippedInput(size_t index);
+
+  // Loads the output of the saved link to |output_file| and finds the files
+  // that changed since, for relinking |files|. Returns false if a full link
+  // is needed: the files are not the same as in the saved link, or a changed
+  // file has another layout or other symbols than before.
+  bool PrepareRelink(const Linker::ObjectFileVector& files,
+                     Linker::FileOutputRangeVector* ranges,
+                     Linker::ChangedFileVector* changed_files, ObjectFile* output_file);
+
+  // Saves the state of a link of |files| into |output| with output |ranges|.
+  // Archive members are not cached, they are parsed again by every link.
+  bool SaveFile(const char* the_file_name, const std::string& options,
+                const Linker::ObjectFileVector& files,
+                const Linker::FileOutputRangeVector& ranges,
+                const ObjectFile& output) const;
+
+ private:
+  struct Stamp {
+    Stamp();
+    bool operator==(const Stamp& other) const;
+
+    uint64 size;
+    int64 seconds;
+    uint32 nanoseconds;
+  };
+
+  struct Entry {
+    StringView name;
+    Stamp stamp;
+    uint64 hash;
+    StringView contents;  // binary object file, empty if not cached
+    Linker::FileOutputRange range;
+  };
+
+  struct Input {
+    Input();
+
+    ObjectFile* file;
+    std::string file_name;
+    Stamp stamp;
+    uint64 hash;
+    const Entry* entry;  // first entry with the same name, nullptr if none
+    bool skipped;
+  };
+
+  static bool ReadStamp(const char* file_name, Stamp* stamp);
+
+  bool Load(const std::string& options);
+  // Returns the first entry named |name|, nullptr if there is none.
+  const Entry* FindEntry(StringView name) const;
+  // Inputs by the object file they were loaded into.
+  void GetInputs(std::unordered_map<const ObjectFile*, const Input*>* inputs) const;
+  // Returns true if |input| has the contents of |entry|.
+  static bool IsUnchanged(const Input& input, const Entry* entry);
+  static bool LoadCachedInput(const Input& input, ObjectFile* file);
+  // Returns true if a link cannot tell |a| and |b| apart by their layout and
+  // symbols.
+  static bool SameInterface(const ObjectFile& a, const ObjectFile& b);
+
+  std::unique_ptr<MappedFile> mapped_file_;
+  std::vector<Entry> entries_;
+  std::unique_ptr<StringPool> entry_names_;
+  std::vector<size_t> first_entries_;  // by name id
+  StringView output_contents_;
+  std::vector<Input> inputs_;
+};
+
+}  // namespace linker
+}  // namespace sicxe
+
+#endif  // LINKER_INCREMENTAL_STATE_H
@@ -0,0 +1,78 @@
+#include "linker/library_search.h"
+
+#include <string>
+#include "common/error_db.h"
+#include "common/string_pool.h"
+
+using std::string;
+using std::vector;
+
+namespace sicxe {
+namespace linker {
+
+LibrarySearch::LibrarySearch() {}
+LibrarySearch::~LibrarySearch() {}
+
+bool LibrarySearch::AddMembers(const ArchiveVector& archives,
+                               Linker::ObjectFileVector* files, ErrorDB* error_db) {
+  // symbols exported by linked files or already searched for
+  StringPool known;
+  auto add_exports = [&known](const ObjectFile& file) {
+    for (const auto& section : file.export_sections()) {
+      for (const auto& symbol : section->symbols) {
+        known.Intern(symbol.first);
+      }
+    }
+  };
+  for (const ObjectFile* file : *files) {
+    add_exports(*file);
+  }
+
+  vector<vector<bool> > loaded(archives.size());
+  for (size_t i = 0; i < archives.size(); i++) {
+    loaded[i].resize(archives[i]->member_count(), false);
+  }
+  bool success = true;
+  // files appended while searching are searched too
+  for (size_t file_index = 0; file_index < files->size(); file_index++) {
+    const ObjectFile& file = *(*files)[file_index];
+    for (const auto& section : file.import_sections()) {
+      for (const auto& symbol : section->symbols) {
+        if (known.Find(symbol) != StringPool::kInvalidId) {
+          continue;
+        }
+        for (size_t i = 0; i < archives.size(); i++) {
+          const Archive& archive = *archives[i];
+          int member = archive.FindSymbol(symbol);
+          if (member == Archive::kNotFound) {
+            continue;
+          }
+          if (!loaded[i][member]) {
+            loaded[i][member] = true;
+            string member_file_name = archive.file_name() + "(" +
+                                      archive.member_name(member).ToString() + ")";
+            std::unique_ptr<ObjectFile> object_file(new ObjectFile);
+            if (object_file->LoadContents(archive.member_contents(member)) !=
+                ObjectFile::OK) {
+              string message = "invalid object file '" + member_file_name + "'";
+              error_db->AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+              success = false;
+              break;
+            }
+            object_file->set_file_name(member_file_name);
+            add_exports(*object_file);
+            files->push_back(object_file.get());
+            members_.emplace_back(std::move(object_file));
+          }
+          break;
+        }
+        // undefined symbols are reported by the linker
+        known.Intern(symbol);
+      }
+    }
+  }
+  return success;
+}
+
+}  // namespace linker
+}  // namespace sicxe
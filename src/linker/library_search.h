@@ -0,0 +1,42 @@
+#ifndef LINKER_LIBRARY_SEARCH_H
+#define LINKER_LIBRARY_SEARCH_H
+
+#include <memory>
+#include <vector>
+#include "common/macros.h"
+#include "common/object_file.h"
+#include "linker/archive.h"
+#include "linker/linker.h"
+
+namespace sicxe {
+
+class ErrorDB;
+
+namespace linker {
+
+// Selects the archive members a link needs. Every symbol imported and not
+// exported by the files already linked is looked up in the archives in order,
+// and the member defining it is loaded and searched in turn, until no new
+// member is needed. Members that are not needed are never parsed.
+class LibrarySearch {
+ public:
+  DISALLOW_COPY_AND_MOVE(LibrarySearch);
+
+  typedef std::vector<const Archive*> ArchiveVector;
+
+  LibrarySearch();
+  ~LibrarySearch();
+
+  // Appends the needed members to |files|, in the order they were needed.
+  // Loaded members are owned by this object.
+  bool AddMembers(const ArchiveVector& archives, Linker::ObjectFileVector* files,
+                  ErrorDB* error_db);
+
+ private:
+  std::vector<std::unique_ptr<ObjectFile> > members_;
+};
+
+}  // namespace linker
+}  // namespace sicxe
+
+#endif  // LINKER_LIBRARY_SEARCH_H
@@ -2,15 +2,22 @@
 
 #include <assert.h>
 #include <string.h>
+#include <iterator>
 #include "common/error_db.h"
+#include "common/parallel_util.h"
+#include "common/string_pool.h"
+#include "linker/relaxer.h"
 
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 namespace sicxe {
 namespace linker {
 
-Linker::Config::Config() : compatibility_mode(false) {}
+Linker::Config::Config()
+    : compatibility_mode(false), thread_count(1), gc_sections(false),
+      relax(false) {}
 
 Linker::Linker(const Config* config) : config_(config) {}
 Linker::~Linker() {}
@@ -24,6 +31,7 @@ bool Linker::LinkFiles(bool partial_link, uint32 start_address,
   output_file_ = output_file;
   error_db_ = error_db;
   error_db_->SetCurrentFile(nullptr);
+  file_output_ranges_.clear();
 
   if (config_->compatibility_mode && partial_link) {
     error_db_->AddError(ErrorDB::ERROR,
@@ -41,6 +49,31 @@ bool Linker::LinkFiles(bool partial_link, uint32 start_address,
     return false;
   }
 
+  if (config_->gc_sections) {
+    if (partial_link) {
+      error_db_->AddError(ErrorDB::ERROR,
+                          "removing unused files not supported in partial linking");
+      return false;
+    }
+    if (!RemoveUnusedFiles()) {
+      return false;
+    }
+  }
+
+  if (config_->relax) {
+    if (config_->compatibility_mode) {
+      error_db_->AddError(ErrorDB::ERROR,
+                          "relaxation not supported in compatibility mode");
+      return false;
+    }
+    if (files_ != &live_files_) {
+      live_files_ = *files_;
+      files_ = &live_files_;
+    }
+    relaxer_.reset(new Relaxer);
+    relaxer_->RelaxFiles(start_address_, &live_files_);
+  }
+
   files_start_address_.reset(new uint32[files_->size()]);
   files_address_adjustment_.reset(new int32[files_->size()]);
   if (!OrderInputFiles()) {
@@ -57,14 +90,203 @@ bool Linker::LinkFiles(bool partial_link, uint32 start_address,
   if (!BuildSymbolTable()) {
     return false;
   }
-  relocation_table_.reset(new RelocationTable);
-  if (!BuildRelocationTable()) {
+  if (!BuildRelocationTables()) {
     return false;
   }
   if (!CopyAndPatchCode()) {
+    file_output_ranges_.clear();
     return false;
   }
   WriteOutputSymbols();
+  if (config_->gc_sections || config_->relax) {
+    // ranges are kept by input file
+    file_output_ranges_.clear();
+  }
+  return true;
+}
+
+bool Linker::RelinkFiles(bool partial_link, const FileOutputRangeVector& ranges,
+                         const ChangedFileVector& changed_files, ObjectFile* output_file,
+                         ErrorDB* error_db) {
+  partial_link_ = partial_link;
+  output_file_ = output_file;
+  error_db_ = error_db;
+  error_db_->SetCurrentFile(nullptr);
+  file_output_ranges_ = ranges;
+
+  // only the changed files are linked, at the addresses of the files they
+  // replace, into the copied output
+  live_files_.clear();
+  for (size_t i = 0; i < changed_files.size(); i++) {
+    // ordered by index
+    assert(changed_files[i].index < ranges.size());
+    assert(i == 0 || changed_files[i].index > changed_files[i - 1].index);
+    live_files_.push_back(changed_files[i].file);
+  }
+  files_ = &live_files_;
+  files_start_address_.reset(new uint32[files_->size()]);
+  files_address_adjustment_.reset(new int32[files_->size()]);
+  for (size_t i = 0; i < files_->size(); i++) {
+    files_start_address_[i] = ranges[changed_files[i].index].start_address;
+    files_address_adjustment_[i] = static_cast<int32>(files_start_address_[i]) -
+                                   static_cast<int32>((*files_)[i]->start_address());
+  }
+  if (!changed_files.empty() && changed_files[0].index == 0) {
+    const ObjectFile& first_file = *changed_files[0].file;
+    if (first_file.entry_point() < first_file.start_address() ||
+        first_file.entry_point() >= (first_file.start_address() + first_file.code_size())) {
+      string message = "invalid entry point in file '";
+      message += first_file.file_name();
+      message += "'";
+      error_db_->AddError(ErrorDB::ERROR, message.c_str());
+      return false;
+    }
+    output_file_->set_program_name(first_file.program_name());
+    output_file_->set_entry_point(static_cast<int32>(first_file.entry_point()) +
+                                  files_address_adjustment_[0]);
+  }
+
+  symbol_table_.reset(new SymbolTable);
+  BuildOutputSymbolTable();
+  if (!BuildRelocationTables()) {
+    return false;
+  }
+
+  // the output of every changed file is replaced, last file first so the
+  // ranges of the files before it stay valid
+  ObjectFile::TextSectionVector* text_sections = output_file_->mutable_text_sections();
+  for (size_t i = files_->size(); i-- > 0;) {
+    const ObjectFile& file = *(*files_)[i];
+    FileOutputRange& range = file_output_ranges_[changed_files[i].index];
+    ObjectFile::TextSectionVector patched_sections;
+    for (const auto& section : file.text_sections()) {
+      ObjectFile::TextSection patched_section;
+      patched_section.address = static_cast<int32>(section.address) +
+                                files_address_adjustment_[i];
+      patched_section.size = section.size;
+      patched_section.data = output_file_->AllocateText(patched_section.size);
+      patched_sections.push_back(patched_section);
+    }
+    auto first = text_sections->begin() + range.first_text_section;
+    first = text_sections->erase(first, first + range.text_section_count);
+    text_sections->insert(first, patched_sections.begin(), patched_sections.end());
+    int32 difference = static_cast<int32>(patched_sections.size()) -
+                       static_cast<int32>(range.text_section_count);
+    range.text_section_count = patched_sections.size();
+    for (size_t j = changed_files[i].index + 1; j < file_output_ranges_.size(); j++) {
+      file_output_ranges_[j].first_text_section += difference;
+    }
+  }
+
+  vector<unique_ptr<ErrorDB> > error_dbs(files_->size());
+  vector<ObjectFile::RelocationSectionVector> relocation_sections(files_->size());
+  unique_ptr<bool[]> results(new bool[files_->size()]);
+  ForEachFile([&](size_t index) {
+    error_dbs[index].reset(new ErrorDB);
+    const FileOutputRange& range = file_output_ranges_[changed_files[index].index];
+    results[index] = PatchFile(index, range.first_text_section, error_dbs[index].get(),
+                               &relocation_sections[index]);
+  });
+  bool success = true;
+  for (size_t i = 0; i < files_->size(); i++) {
+    error_db_->Append(error_dbs[i].get());
+    success = success && results[i];
+  }
+  if (!success) {
+    return false;
+  }
+
+  ObjectFile::RelocationSectionVector* output_sections =
+      output_file_->mutable_relocation_sections();
+  for (size_t i = files_->size(); i-- > 0;) {
+    FileOutputRange& range = file_output_ranges_[changed_files[i].index];
+    auto first = output_sections->begin() + range.first_relocation;
+    first = output_sections->erase(first, first + range.relocation_count);
+    output_sections->insert(first, std::make_move_iterator(relocation_sections[i].begin()),
+                            std::make_move_iterator(relocation_sections[i].end()));
+    int32 difference = static_cast<int32>(relocation_sections[i].size()) -
+                       static_cast<int32>(range.relocation_count);
+    range.relocation_count = relocation_sections[i].size();
+    for (size_t j = changed_files[i].index + 1; j < file_output_ranges_.size(); j++) {
+      file_output_ranges_[j].first_relocation += difference;
+    }
+  }
+  return true;
+}
+
+const Linker::FileOutputRangeVector& Linker::file_output_ranges() const {
+  return file_output_ranges_;
+}
+
+void Linker::ForEachFile(const std::function<void(size_t)>& function) {
+  size_t thread_count = (config_->thread_count > 1) ? config_->thread_count : 1;
+  ParallelUtil::ForEachIndex(files_->size(), thread_count, function);
+}
+
+bool Linker::RemoveUnusedFiles() {
+  // file defining every symbol, duplicates are reported here because the
+  // symbol table only sees the files that stay
+  StringPool names;
+  vector<size_t> definitions;
+  bool success = true;
+  for (size_t i = 0; i < files_->size(); i++) {
+    const ObjectFile& file = *(*files_)[i];
+    for (const auto& section : file.export_sections()) {
+      for (const auto& symbol : section->symbols) {
+        StringPool::Id id = names.Intern(symbol.first);
+        if (id == definitions.size()) {
+          definitions.push_back(i);
+          continue;
+        }
+        string message = "duplicate symbol '" + symbol.first;
+        message += "' in file '";
+        message += file.file_name();
+        message += "', first defined in file '";
+        message += (*files_)[definitions[id]]->file_name();
+        message += "'";
+        error_db_->AddError(ErrorDB::ERROR, message.c_str());
+        success = false;
+      }
+    }
+  }
+  if (!success) {
+    return false;
+  }
+
+  vector<bool> live(files_->size(), false);
+  vector<size_t> pending;
+  auto reach = [&](const string& symbol_name) {
+    StringPool::Id id = names.Find(symbol_name);
+    if (id != StringPool::kInvalidId && !live[definitions[id]]) {
+      live[definitions[id]] = true;
+      pending.push_back(definitions[id]);
+    }
+  };
+  live[0] = true;
+  pending.push_back(0);
+  while (!pending.empty()) {
+    const ObjectFile& file = *(*files_)[pending.back()];
+    pending.pop_back();
+    for (const auto& section : file.import_sections()) {
+      for (const auto& symbol : section->symbols) {
+        reach(symbol);
+      }
+    }
+    // relocation records may name symbols that are not imported
+    for (const auto& section : file.relocation_sections()) {
+      if (section->type) {
+        reach(section->symbol_name);
+      }
+    }
+  }
+
+  live_files_.clear();
+  for (size_t i = 0; i < files_->size(); i++) {
+    if (live[i]) {
+      live_files_.push_back((*files_)[i]);
+    }
+  }
+  files_ = &live_files_;
   return true;
 }
 
@@ -144,10 +366,12 @@ bool Linker::BuildSymbolTable() {
   }
 
   if (!partial_link_) {
-    for (const auto& entry_pair : symbol_table_->entry_map()) {
-      const SymbolTable::Entry& entry = entry_pair.second;
+    SymbolTable::IdList ids;
+    symbol_table_->GetSortedIds(&ids);
+    for (StringPool::Id id : ids) {
+      const SymbolTable::Entry& entry = *symbol_table_->Get(id);
       if (entry.type == SymbolTable::UNDEFINED) {
-        string message = "undefined symbol '" + entry_pair.first;
+        string message = "undefined symbol '" + symbol_table_->name(id).ToString();
         message += "' referenced from files: ";
         bool first = true;
         for (const ObjectFile* file : entry.files_referenced) {
@@ -167,43 +391,94 @@ bool Linker::BuildSymbolTable() {
   return success;
 }
 
-bool Linker::BuildRelocationTable() {
-  for (size_t i = 0; i < files_->size(); i++) {
-    const ObjectFile& file = *(*files_)[i];
-    uint32 file_end_address = file.start_address() + file.code_size();
-
-    for (const auto& section : file.relocation_sections()) {
-      if (section->address < file.start_address() ||
-          section->address >= file_end_address ||
-          section->nibbles == 0 || section->nibbles > 10) {
-        InvalidRelocationError(file);
-        return false;
+void Linker::BuildOutputSymbolTable() {
+  // the output lists every symbol of the earlier link, the input files keep
+  // the ones they refer to
+  StringPool names;
+  for (const ObjectFile* file : *files_) {
+    for (const auto& section : file->import_sections()) {
+      for (const auto& symbol : section->symbols) {
+        names.Intern(symbol);
+      }
+    }
+    for (const auto& section : file->export_sections()) {
+      for (const auto& symbol : section->symbols) {
+        names.Intern(symbol.first);
       }
-      uint32 address = static_cast<int32>(section->address) +
-                       files_address_adjustment_[i];
-      bool success = true;
-      if (!section->type) {
-        success = relocation_table_->AddRelocationSimple(address, section->nibbles);
-      } else {
-        success = relocation_table_->AddRelocationSymbol(
-            address, section->nibbles, section->sign, section->symbol_name);
+    }
+    for (const auto& section : file->relocation_sections()) {
+      if (section->type) {
+        names.Intern(section->symbol_name);
+      }
+    }
+  }
+  for (const auto& section : output_file_->export_sections()) {
+    for (const auto& symbol : section->symbols) {
+      if (names.Find(symbol.first) != StringPool::kInvalidId) {
+        SymbolTable::Entry* entry = symbol_table_->FindOrCreateNew(symbol.first);
+        entry->type = SymbolTable::DEFINED;
+        entry->address = symbol.second;
       }
-      if (!success) {
-        InvalidRelocationError(file);
-        return false;
+    }
+  }
+  for (const auto& section : output_file_->import_sections()) {
+    for (const auto& symbol : section->symbols) {
+      if (names.Find(symbol) != StringPool::kInvalidId) {
+        symbol_table_->FindOrCreateNew(symbol);
       }
     }
   }
+}
+
+bool Linker::BuildRelocationTables() {
+  relocation_tables_.clear();
+  for (size_t i = 0; i < files_->size(); i++) {
+    relocation_tables_.emplace_back(new RelocationTable);
+  }
+  unique_ptr<bool[]> results(new bool[files_->size()]);
+  ForEachFile([this, &results](size_t index) {
+    results[index] = BuildRelocationTable(index, relocation_tables_[index].get());
+  });
+  // only the first invalid file is reported, as if files were read in order
+  for (size_t i = 0; i < files_->size(); i++) {
+    if (!results[i]) {
+      InvalidRelocationError(*(*files_)[i], error_db_);
+      return false;
+    }
+  }
   return true;
 }
 
-void Linker::InvalidRelocationError(const ObjectFile& file) {
+bool Linker::BuildRelocationTable(size_t index, RelocationTable* table) {
+  const ObjectFile& file = *(*files_)[index];
+  uint32 file_end_address = file.start_address() + file.code_size();
+
+  for (const auto& section : file.relocation_sections()) {
+    if (section->address < file.start_address() ||
+        section->address >= file_end_address ||
+        section->nibbles == 0 || section->nibbles > 10) {
+      return false;
+    }
+    uint32 address = static_cast<int32>(section->address) +
+                     files_address_adjustment_[index];
+    if (!section->type) {
+      table->AddRelocationSimple(address, section->nibbles);
+    } else {
+      table->AddRelocationSymbol(address, section->nibbles, section->sign,
+                                 symbol_table_->FindId(section->symbol_name));
+    }
+  }
+  return table->Finish();
+}
+
+void Linker::InvalidRelocationError(const ObjectFile& file, ErrorDB* error_db) {
   string message = "invalid relocation in file '" + file.file_name() + "'";
-  error_db_->AddError(ErrorDB::ERROR, message.c_str());
+  error_db->AddError(ErrorDB::ERROR, message.c_str());
 }
 
 bool Linker::PatchTextSection(const ObjectFile& file, uint32 address, uint8 nibbles,
-                              int32 adjustment, ObjectFile::TextSection* text_section) {
+                              int32 adjustment, ObjectFile::TextSection* text_section,
+                              ErrorDB* error_db) {
   assert(nibbles > 0 && nibbles <= 10);
   assert(address >= text_section->address);
   uint32 position = address - text_section->address;
@@ -211,10 +486,10 @@ bool Linker::PatchTextSection(const ObjectFile& file, uint32 address, uint8 nibb
   const size_t size = (nibbles + 1) / 2;  // ceil divide by two
   const int64 limit = (1 << (nibbles * 4)) - 1;
   if (size > space_left) {
-    InvalidRelocationError(file);
+    InvalidRelocationError(file, error_db);
     return false;
   }
-  uint8* data = text_section->data.get() + position;
+  uint8* data = text_section->data + position;
   uint8 upper_half_byte = 0;
   int64 result = 0;
   size_t i = 0;
@@ -230,11 +505,11 @@ bool Linker::PatchTextSection(const ObjectFile& file, uint32 address, uint8 nibb
   result += adjustment;
   if (result < 0) {
     string message = "relocation underflow in file '" + file.file_name() + "'";
-    error_db_->AddError(ErrorDB::ERROR, message.c_str());
+    error_db->AddError(ErrorDB::ERROR, message.c_str());
     return false;
   } else if (result > limit) {
     string message = "relocation overflow in file '" + file.file_name() + "'";
-    error_db_->AddError(ErrorDB::ERROR, message.c_str());
+    error_db->AddError(ErrorDB::ERROR, message.c_str());
     return false;
   }
   for (int j = size - 1; j >= 0; j--) {
@@ -247,38 +522,43 @@ bool Linker::PatchTextSection(const ObjectFile& file, uint32 address, uint8 nibb
   return true;
 }
 
-void Linker::WriteRelocationSimple(uint32 address, uint8 nibbles) {
+void Linker::WriteRelocationSimple(uint32 address, uint8 nibbles,
+                                   ObjectFile::RelocationSectionVector* sections) {
   unique_ptr<ObjectFile::RelocationSection> section(new ObjectFile::RelocationSection);
   section->address = address;
   section->nibbles = nibbles;
   section->type = false;
-  output_file_->mutable_relocation_sections()->emplace_back(std::move(section));
+  sections->emplace_back(std::move(section));
 }
 
 void Linker::WriteRelocationSymbol(uint32 address, uint8 nibbles, bool sign,
-                                   const std::string& symbol_name) {
+                                   StringView symbol_name,
+                                   ObjectFile::RelocationSectionVector* sections) {
   unique_ptr<ObjectFile::RelocationSection> section(new ObjectFile::RelocationSection);
   section->address = address;
   section->nibbles = nibbles;
   section->type = true;
   section->sign = sign;
-  section->symbol_name = symbol_name;
-  output_file_->mutable_relocation_sections()->emplace_back(std::move(section));
+  section->symbol_name = symbol_name.ToString();
+  sections->emplace_back(std::move(section));
 }
 
-bool Linker::SolveSymbolRelocation(const ObjectFile& file,
+bool Linker::SolveSymbolRelocation(const ObjectFile& file, const RelocationTable& table,
                                    const RelocationTable::Entry& entry, int32* result,
-                                   bool* relative, bool* all_symbols_known) {
+                                   bool* relative, bool* all_symbols_known,
+                                   ErrorDB* error_db) {
   int32 value = 0;
   int relative_count = 0;
   bool all_known = true;
-  for (const auto& symbol : entry.symbols) {
-    const SymbolTable::Entry* symbol_entry = symbol_table_->Find(symbol.second);
-    if (symbol_entry == nullptr) {
-      InvalidRelocationError(file);
+  const RelocationTable::Symbol* symbols = table.symbols().data() + entry.first_symbol;
+  for (uint32 i = 0; i < entry.symbol_count; i++) {
+    const RelocationTable::Symbol& symbol = symbols[i];
+    if (symbol.id == StringPool::kInvalidId) {
+      InvalidRelocationError(file, error_db);
       return false;
     }
-    if (symbol.first) {
+    const SymbolTable::Entry* symbol_entry = symbol_table_->Get(symbol.id);
+    if (symbol.sign) {
       relative_count++;
     } else {
       relative_count--;
@@ -287,7 +567,7 @@ bool Linker::SolveSymbolRelocation(const ObjectFile& file,
       all_known = false;
       continue;
     }
-    if (symbol.first) {
+    if (symbol.sign) {
       value += static_cast<int32>(symbol_entry->address);
     } else {
       value -= static_cast<int32>(symbol_entry->address);
@@ -299,7 +579,7 @@ bool Linker::SolveSymbolRelocation(const ObjectFile& file,
     } else if (relative_count == 1) {
       *relative = true;
     } else {
-      InvalidRelocationError(file);
+      InvalidRelocationError(file, error_db);
       return false;
     }
   } else {
@@ -312,65 +592,111 @@ bool Linker::SolveSymbolRelocation(const ObjectFile& file,
   return true;
 }
 
-bool Linker::CopyAndPatchCode() {
+bool Linker::PatchFile(size_t index, size_t first_section, ErrorDB* error_db,
+                       ObjectFile::RelocationSectionVector* sections) {
+  const ObjectFile& file = *(*files_)[index];
+  const RelocationTable& table = *relocation_tables_[index];
+  const RelocationTable::EntryVector& entries = table.entries();
   bool success = true;
-  for (size_t i = 0; i < files_->size(); i++) {
-    const ObjectFile& file = *(*files_)[i];
-    for (const auto& section : file.text_sections()) {
-      unique_ptr<ObjectFile::TextSection> patched_section(new ObjectFile::TextSection);
-      patched_section->address = static_cast<int32>(section->address) +
-                                 files_address_adjustment_[i];
-      patched_section->size = section->size;
-      patched_section->data.reset(new uint8[patched_section->size]);
-      memcpy(patched_section->data.get(), section->data.get(), patched_section->size);
-
-      // go through relocations whose address is in this text section
-      uint32 range_start = patched_section->address;
-      uint32 range_end = patched_section->address + patched_section->size;
-      auto it = relocation_table_->entry_map().lower_bound(range_start);
-      for (; it != relocation_table_->entry_map().end() && it->first < range_end; ++it) {
-        uint32 address = it->first;
-        const RelocationTable::Entry& entry = it->second;
-        int32 adjustment = 0;
-        bool relative = false;
-        bool all_symbols_known = false;
+  for (size_t i = 0; i < file.text_sections().size(); i++) {
+    const ObjectFile::TextSection& section = file.text_sections()[i];
+    ObjectFile::TextSection* patched_section =
+        &(*output_file_->mutable_text_sections())[first_section + i];
+    memcpy(patched_section->data, section.data, patched_section->size);
 
-        if (entry.type == RelocationTable::SIMPLE) {
-          adjustment = files_address_adjustment_[i];
-        } else if (entry.type == RelocationTable::SYMBOL) {
-          if (!SolveSymbolRelocation(file, entry, &adjustment, &relative,
-                                     &all_symbols_known)) {
-            success = false;
-            break;
-          }
+    // go through relocations whose address is in this text section
+    uint32 range_start = patched_section->address;
+    uint32 range_end = patched_section->address + patched_section->size;
+    auto it = table.LowerBound(range_start);
+    for (; it != entries.end() && it->address < range_end; ++it) {
+      const RelocationTable::Entry& entry = *it;
+      int32 adjustment = 0;
+      bool relative = false;
+      bool all_symbols_known = false;
+
+      if (entry.type == RelocationTable::SIMPLE) {
+        adjustment = files_address_adjustment_[index];
+      } else if (entry.type == RelocationTable::SYMBOL) {
+        if (!SolveSymbolRelocation(file, table, entry, &adjustment, &relative,
+                                   &all_symbols_known, error_db)) {
+          success = false;
+          break;
         }
+      }
 
-        if (config_->compatibility_mode || entry.type == RelocationTable::SIMPLE ||
-            (entry.type == RelocationTable::SYMBOL && all_symbols_known)) {
-          if (!PatchTextSection(file, address, entry.nibbles, adjustment,
-                                patched_section.get())) {
-            success = false;
-            continue;
-          }
+      if (config_->compatibility_mode || entry.type == RelocationTable::SIMPLE ||
+          (entry.type == RelocationTable::SYMBOL && all_symbols_known)) {
+        if (!PatchTextSection(file, entry.address, entry.nibbles, adjustment,
+                              patched_section, error_db)) {
+          success = false;
+          continue;
         }
+      }
 
-        if (!config_->compatibility_mode) {
-          // write output relocation records (only in normal mode)
-          if (entry.type == RelocationTable::SIMPLE) {
-            WriteRelocationSimple(address, entry.nibbles);
-          } else if (entry.type == RelocationTable::SYMBOL) {
-            if (!all_symbols_known) {
-              for (const auto& symbol : entry.symbols) {
-                WriteRelocationSymbol(address, entry.nibbles, symbol.first,
-                                      symbol.second);
-              }
-            } else if (relative) {
-              WriteRelocationSimple(address, entry.nibbles);
+      if (!config_->compatibility_mode) {
+        // write output relocation records (only in normal mode)
+        if (entry.type == RelocationTable::SIMPLE) {
+          WriteRelocationSimple(entry.address, entry.nibbles, sections);
+        } else if (entry.type == RelocationTable::SYMBOL) {
+          if (!all_symbols_known) {
+            const RelocationTable::Symbol* symbols =
+                table.symbols().data() + entry.first_symbol;
+            for (uint32 j = 0; j < entry.symbol_count; j++) {
+              WriteRelocationSymbol(entry.address, entry.nibbles, symbols[j].sign,
+                                    symbol_table_->name(symbols[j].id), sections);
             }
+          } else if (relative) {
+            WriteRelocationSimple(entry.address, entry.nibbles, sections);
           }
         }
       }
-      output_file_->mutable_text_sections()->emplace_back(std::move(patched_section));
+    }
+  }
+  return success;
+}
+
+bool Linker::CopyAndPatchCode() {
+  // the output arena is not thread safe, so all text is allocated up front
+  unique_ptr<size_t[]> first_sections(new size_t[files_->size()]);
+  ObjectFile::TextSectionVector* text_sections = output_file_->mutable_text_sections();
+  file_output_ranges_.resize(files_->size());
+  for (size_t i = 0; i < files_->size(); i++) {
+    const ObjectFile& file = *(*files_)[i];
+    first_sections[i] = text_sections->size();
+    for (const auto& section : file.text_sections()) {
+      ObjectFile::TextSection patched_section;
+      patched_section.address = static_cast<int32>(section.address) +
+                                files_address_adjustment_[i];
+      patched_section.size = section.size;
+      patched_section.data = output_file_->AllocateText(patched_section.size);
+      text_sections->push_back(patched_section);
+    }
+    FileOutputRange& output_range = file_output_ranges_[i];
+    output_range.start_address = files_start_address_[i];
+    output_range.first_text_section = first_sections[i];
+    output_range.text_section_count = text_sections->size() - first_sections[i];
+  }
+
+  vector<unique_ptr<ErrorDB> > error_dbs(files_->size());
+  vector<ObjectFile::RelocationSectionVector> relocation_sections(files_->size());
+  unique_ptr<bool[]> results(new bool[files_->size()]);
+  ForEachFile([&](size_t index) {
+    error_dbs[index].reset(new ErrorDB);
+    results[index] = PatchFile(index, first_sections[index], error_dbs[index].get(),
+                               &relocation_sections[index]);
+  });
+
+  // merge in file order, which is also address order
+  bool success = true;
+  ObjectFile::RelocationSectionVector* output_sections =
+      output_file_->mutable_relocation_sections();
+  for (size_t i = 0; i < files_->size(); i++) {
+    error_db_->Append(error_dbs[i].get());
+    success = success && results[i];
+    file_output_ranges_[i].first_relocation = output_sections->size();
+    file_output_ranges_[i].relocation_count = relocation_sections[i].size();
+    for (auto& section : relocation_sections[i]) {
+      output_sections->emplace_back(std::move(section));
     }
   }
   return success;
@@ -379,13 +705,15 @@ bool Linker::CopyAndPatchCode() {
 void Linker::WriteOutputSymbols() {
   unique_ptr<ObjectFile::SymbolImportSection> import_section;
   unique_ptr<ObjectFile::SymbolExportSection> export_section;
-  for (const auto& entry_pair : symbol_table_->entry_map()) {
-    const SymbolTable::Entry& entry = entry_pair.second;
+  SymbolTable::IdList ids;
+  symbol_table_->GetSortedIds(&ids);
+  for (StringPool::Id id : ids) {
+    const SymbolTable::Entry& entry = *symbol_table_->Get(id);
     if (entry.type == SymbolTable::UNDEFINED) {
       if (import_section.get() == nullptr) {
         import_section.reset(new ObjectFile::SymbolImportSection);
       }
-      import_section->symbols.push_back(entry_pair.first);
+      import_section->symbols.push_back(symbol_table_->name(id).ToString());
       if (static_cast<int>(import_section->symbols.size()) >=
           ObjectFile::kMaxSymbolsPerImportSection) {
         output_file_->mutable_import_sections()->emplace_back(std::move(import_section));
@@ -394,7 +722,7 @@ void Linker::WriteOutputSymbols() {
       if (export_section.get() == nullptr) {
         export_section.reset(new ObjectFile::SymbolExportSection);
       }
-      export_section->symbols.push_back(make_pair(entry_pair.first,
+      export_section->symbols.push_back(make_pair(symbol_table_->name(id).ToString(),
                                                   entry.address));
       if (static_cast<int>(export_section->symbols.size()) >=
           ObjectFile::kMaxSymbolsPerExportSection) {
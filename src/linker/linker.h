@@ -1,11 +1,12 @@
 #ifndef LINKER_LINKER_H
 #define LINKER_LINKER_H
 
+#include <functional>
 #include <memory>
-#include <string>
 #include <vector>
 #include "common/macros.h"
 #include "common/object_file.h"
+#include "common/string_view.h"
 #include "common/types.h"
 #include "linker/relocation_table.h"
 #include "linker/symbol_table.h"
@@ -16,6 +17,8 @@ class ErrorDB;
 
 namespace linker {
 
+class Relaxer;
+
 class Linker {
  public:
   DISALLOW_COPY_AND_MOVE(Linker);
@@ -24,10 +27,37 @@ class Linker {
     Config();
 
     bool compatibility_mode;
+    // Input files are checked and patched by up to this many threads.
+    int thread_count;
+    // Drop input files that the first file does not reach through symbol
+    // references, directly or through other files.
+    bool gc_sections;
+    // Shorten format 4 instructions whose operands end up in PC relative
+    // range, in files that list their code sites (see Relaxer).
+    bool relax;
   };
 
   typedef std::vector<const ObjectFile*> ObjectFileVector;
 
+  // Output text sections and relocation records of one input file.
+  struct FileOutputRange {
+    uint32 start_address;
+    uint32 first_text_section;
+    uint32 text_section_count;
+    uint32 first_relocation;
+    uint32 relocation_count;
+  };
+
+  typedef std::vector<FileOutputRange> FileOutputRangeVector;
+
+  // Input file that changed since an earlier link.
+  struct ChangedFile {
+    size_t index;  // of the file it replaces
+    const ObjectFile* file;
+  };
+
+  typedef std::vector<ChangedFile> ChangedFileVector;
+
   Linker(const Config* config);
   ~Linker();
 
@@ -35,18 +65,53 @@ class Linker {
                  const ObjectFileVector& files, ObjectFile* output_file,
                  ErrorDB* error_db);
 
+  // Updates |output_file|, the output of an earlier link with output
+  // |ranges|, for |changed_files|. Each changed file must keep the start
+  // address, code size, exported symbol offsets and imported symbols of the
+  // file it replaces, so the layout and the symbols stay the same. Only the
+  // changed files are checked and patched.
+  bool RelinkFiles(bool partial_link, const FileOutputRangeVector& ranges,
+                   const ChangedFileVector& changed_files, ObjectFile* output_file,
+                   ErrorDB* error_db);
+
+  // One per input file of the last successful link, empty with
+  // Config::gc_sections and Config::relax.
+  const FileOutputRangeVector& file_output_ranges() const;
+
  private:
+  typedef std::vector<std::unique_ptr<RelocationTable> > RelocationTableVector;
+
+  // Calls |function| for every input file index on up to
+  // Config::thread_count threads.
+  void ForEachFile(const std::function<void(size_t)>& function);
+  // Keeps the files reachable from the first one in |live_files_| and
+  // links only those. Fails on symbols defined by more than one input file,
+  // used or not, so the result does not depend on the file order.
+  bool RemoveUnusedFiles();
   bool OrderInputFiles();
   bool BuildSymbolTable();
-  bool BuildRelocationTable();
-  void InvalidRelocationError(const ObjectFile& file);
+  // Symbols of the output file that the input files refer to.
+  void BuildOutputSymbolTable();
+  bool BuildRelocationTables();
+  bool BuildRelocationTable(size_t index, RelocationTable* table);
+  void InvalidRelocationError(const ObjectFile& file, ErrorDB* error_db);
   bool PatchTextSection(const ObjectFile& file, uint32 address, uint8 nibbles,
-                        int32 adjustment, ObjectFile::TextSection* text_section);
-  void WriteRelocationSimple(uint32 address, uint8 nibbles);
+                        int32 adjustment, ObjectFile::TextSection* text_section,
+                        ErrorDB* error_db);
+  void WriteRelocationSimple(uint32 address, uint8 nibbles,
+                             ObjectFile::RelocationSectionVector* sections);
   void WriteRelocationSymbol(uint32 address, uint8 nibbles, bool sign,
-                             const std::string& symbol_name);
-  bool SolveSymbolRelocation(const ObjectFile& file, const RelocationTable::Entry& entry,
-                             int32* result, bool* relative, bool* all_symbols_known);
+                             StringView symbol_name,
+                             ObjectFile::RelocationSectionVector* sections);
+  bool SolveSymbolRelocation(const ObjectFile& file, const RelocationTable& table,
+                             const RelocationTable::Entry& entry, int32* result,
+                             bool* relative, bool* all_symbols_known, ErrorDB* error_db);
+  // Patches the text sections of file |index|, which were already copied to
+  // the output starting at |first_section|. Address ranges of input files do
+  // not overlap, so files are patched in parallel into their own |error_db|
+  // and relocation |sections|.
+  bool PatchFile(size_t index, size_t first_section, ErrorDB* error_db,
+                 ObjectFile::RelocationSectionVector* sections);
   bool CopyAndPatchCode();
   void WriteOutputSymbols();
 
@@ -54,6 +119,8 @@ class Linker {
   bool partial_link_;
   uint32 start_address_;
   const ObjectFileVector* files_;
+  ObjectFileVector live_files_;
+  std::unique_ptr<Relaxer> relaxer_;
   ObjectFile* output_file_;
   ErrorDB* error_db_;
 
@@ -61,7 +128,8 @@ class Linker {
   std::unique_ptr<int32[]> files_address_adjustment_;
   uint32 end_address_;
   std::unique_ptr<SymbolTable> symbol_table_;
-  std::unique_ptr<RelocationTable> relocation_table_;
+  RelocationTableVector relocation_tables_;  // one per input file
+  FileOutputRangeVector file_output_ranges_;
 };
 
 }  // namespace linker
@@ -0,0 +1,391 @@
+#include "linker/relaxer.h"
+
+#include <assert.h>
+#include <algorithm>
+
+using std::pair;
+using std::unique_ptr;
+using std::vector;
+
+namespace sicxe {
+namespace linker {
+
+namespace {
+
+// flags in the second byte of format 3 and 4 instructions
+const uint8 kFlagBase = 0x40;
+const uint8 kFlagPCRelative = 0x20;
+const uint8 kFlagExtended = 0x10;
+
+const int32 kMinDisplacement = -2048;
+const int32 kMaxDisplacement = 2047;
+
+// file index of symbols that are defined more than once
+const size_t kDuplicate = static_cast<size_t>(-1);
+
+bool HasAddressIn(const vector<uint32>& addresses, uint32 first, uint32 last) {
+  auto it = std::lower_bound(addresses.begin(), addresses.end(), first);
+  return it != addresses.end() && *it <= last;
+}
+
+}  // namespace
+
+Relaxer::FileState::FileState() : file(nullptr), start_address(0) {}
+
+Relaxer::Relaxer() : relaxed_count_(0) {}
+Relaxer::~Relaxer() {}
+
+void Relaxer::RelaxFiles(uint32 start_address, Linker::ObjectFileVector* files) {
+  states_.clear();
+  states_.resize(files->size());
+  for (size_t i = 0; i < files->size(); i++) {
+    const ObjectFile& file = *(*files)[i];
+    states_[i].file = &file;
+    for (const auto& section : file.export_sections()) {
+      for (const auto& symbol : section->symbols) {
+        StringPool::Id id = names_.Intern(symbol.first);
+        if (id == definitions_.size()) {
+          definitions_.push_back(pair<size_t, uint32>(i, symbol.second));
+        } else {
+          definitions_[id].first = kDuplicate;
+        }
+      }
+    }
+  }
+
+  bool has_candidates = false;
+  for (auto& state : states_) {
+    FindCandidates(&state);
+    has_candidates = has_candidates || !state.candidates.empty();
+  }
+  if (!has_candidates) {
+    return;
+  }
+
+  // relaxing one instruction can bring others in range
+  Layout(start_address);
+  while (RelaxPass()) {
+    Layout(start_address);
+  }
+
+  for (size_t i = 0; i < states_.size(); i++) {
+    if (!states_[i].removed.empty()) {
+      (*files)[i] = RewriteFile(&states_[i]);
+    }
+  }
+}
+
+int Relaxer::relaxed_count() const {
+  return relaxed_count_;
+}
+
+bool Relaxer::ReadField(const FileState& state, uint32 address, uint8 nibbles,
+                        uint32* value) {
+  uint32 offset = address - state.file->start_address();
+  const size_t size = (nibbles + 1) / 2;
+  if (address < state.file->start_address() || nibbles == 0 || nibbles > 8 ||
+      offset + size > state.image.size()) {
+    return false;
+  }
+  const uint8* data = state.image.data() + offset;
+  uint32 result = 0;
+  size_t i = 0;
+  if (nibbles % 2 == 1) {
+    result = data[0] & 0xf;
+    i = 1;
+  }
+  for (; i < size; i++) {
+    result = (result << 8) | data[i];
+  }
+  *value = result;
+  return true;
+}
+
+void Relaxer::WriteField(uint32 address, uint8 nibbles, uint32 value, FileState* state) {
+  uint8* data = state->image.data() + (address - state->file->start_address());
+  const size_t size = (nibbles + 1) / 2;
+  uint8 upper_half_byte = (nibbles % 2 == 1) ? (data[0] & 0xf0) : 0;
+  for (int j = size - 1; j >= 0; j--) {
+    data[j] = value & 0xff;
+    value >>= 8;
+  }
+  if (nibbles % 2 == 1) {
+    data[0] = (data[0] & 0xf) | upper_half_byte;
+  }
+}
+
+bool Relaxer::ReadPCRelativeTarget(const FileState& state, uint32 address,
+                                   uint32* target) {
+  uint32 offset = address - state.file->start_address();
+  if (address < state.file->start_address() || offset + 3 > state.image.size()) {
+    return false;
+  }
+  const uint8* data = state.image.data() + offset;
+  if ((data[0] & 0x3) == 0 ||
+      (data[1] & (kFlagBase | kFlagPCRelative | kFlagExtended)) != kFlagPCRelative) {
+    return false;
+  }
+  int32 displacement = ((data[1] & 0xf) << 8) | data[2];
+  if (displacement > kMaxDisplacement) {
+    displacement -= 4096;
+  }
+  *target = static_cast<uint32>(static_cast<int32>(address + 3) + displacement);
+  return true;
+}
+
+void Relaxer::WriteDisplacement(uint32 address, int32 displacement, FileState* state) {
+  assert(displacement >= kMinDisplacement && displacement <= kMaxDisplacement);
+  uint8* data = state->image.data() + (address - state->file->start_address());
+  data[1] = (data[1] & 0xf0) | ((displacement >> 8) & 0xf);
+  data[2] = displacement & 0xff;
+}
+
+uint32 Relaxer::MapAddress(const FileState& state, uint32 address) {
+  auto it = std::lower_bound(state.removed.begin(), state.removed.end(), address);
+  return address - static_cast<uint32>(it - state.removed.begin());
+}
+
+void Relaxer::FindCandidates(FileState* state) {
+  const ObjectFile& file = *state->file;
+  if (file.code_sites().empty()) {
+    return;
+  }
+  uint32 start = file.start_address();
+  state->image.assign(file.code_size(), 0);
+  for (const auto& section : file.text_sections()) {
+    if (section.address < start ||
+        section.address - start + section.size > file.code_size()) {
+      state->image.clear();
+      return;
+    }
+    std::copy(section.data, section.data + section.size,
+              state->image.begin() + (section.address - start));
+  }
+
+  // addresses the code refers to, a removed byte must not be one of them
+  vector<uint32> targets;
+  typedef pair<uint32, const ObjectFile::RelocationSection*> RelocationRef;
+  vector<RelocationRef> relocations;
+  for (const auto& site : file.code_sites()) {
+    if (site.kind == ObjectFile::PC_RELATIVE_INSTRUCTION) {
+      uint32 target = 0;
+      if (!ReadPCRelativeTarget(*state, site.address, &target)) {
+        state->image.clear();
+        return;
+      }
+      targets.push_back(target);
+      state->pc_relative_sites.push_back(site.address);
+    }
+  }
+  for (const auto& section : file.relocation_sections()) {
+    relocations.push_back(RelocationRef(section->address, section.get()));
+    if (!section->type) {
+      uint32 value = 0;
+      if (!ReadField(*state, section->address, section->nibbles, &value)) {
+        state->image.clear();
+        state->pc_relative_sites.clear();
+        return;
+      }
+      targets.push_back(value);
+    }
+  }
+  for (const auto& section : file.export_sections()) {
+    for (const auto& symbol : section->symbols) {
+      targets.push_back(symbol.second);
+    }
+  }
+  targets.push_back(file.entry_point());
+  std::sort(targets.begin(), targets.end());
+  auto compare_address = [](const RelocationRef& a, const RelocationRef& b) {
+    return a.first < b.first;
+  };
+  std::stable_sort(relocations.begin(), relocations.end(), compare_address);
+
+  for (const auto& site : file.code_sites()) {
+    if (site.kind != ObjectFile::EXTENDED_INSTRUCTION) {
+      continue;
+    }
+    uint32 offset = site.address - start;
+    if (site.address < start || offset + 4 > state->image.size()) {
+      continue;
+    }
+    const uint8* data = state->image.data() + offset;
+    if ((data[0] & 0x3) == 0 ||
+        (data[1] & (kFlagBase | kFlagPCRelative | kFlagExtended)) != kFlagExtended) {
+      continue;
+    }
+    // the address field must have exactly one relocation, to an address in
+    // the file or to a symbol, and nothing may refer inside the instruction
+    uint32 field_address = site.address + 1;
+    auto first = std::lower_bound(relocations.begin(), relocations.end(),
+                                  RelocationRef(field_address, nullptr), compare_address);
+    if (first == relocations.end() || first->first != field_address ||
+        (first + 1 != relocations.end() && (first + 1)->first <= site.address + 3) ||
+        HasAddressIn(targets, site.address + 1, site.address + 3)) {
+      continue;
+    }
+    const ObjectFile::RelocationSection* relocation = first->second;
+    if (relocation->nibbles != 5 || (relocation->type && !relocation->sign)) {
+      continue;
+    }
+    Candidate candidate;
+    candidate.address = site.address;
+    candidate.symbol = StringPool::kInvalidId;
+    if (relocation->type) {
+      candidate.symbol = names_.Find(relocation->symbol_name);
+      if (candidate.symbol == StringPool::kInvalidId ||
+          candidate.symbol >= definitions_.size() ||
+          definitions_[candidate.symbol].first == kDuplicate) {
+        continue;
+      }
+    }
+    ReadField(*state, field_address, 5, &candidate.operand);
+    candidate.relaxed = false;
+    state->candidates.push_back(candidate);
+  }
+  std::sort(state->candidates.begin(), state->candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.address < b.address; });
+}
+
+void Relaxer::Layout(uint32 start_address) {
+  uint32 address = start_address;
+  for (auto& state : states_) {
+    state.removed.clear();
+    for (const auto& candidate : state.candidates) {
+      if (candidate.relaxed) {
+        state.removed.push_back(candidate.address + 3);
+      }
+    }
+    state.start_address = address;
+    address += state.file->code_size() - static_cast<uint32>(state.removed.size());
+  }
+}
+
+uint32 Relaxer::FinalAddress(const FileState& state, uint32 address) const {
+  return state.start_address + MapAddress(state, address) - state.file->start_address();
+}
+
+int64 Relaxer::FindTarget(const FileState& state, const Candidate& candidate) const {
+  if (candidate.symbol == StringPool::kInvalidId) {
+    return FinalAddress(state, candidate.operand);
+  }
+  const pair<size_t, uint32>& definition = definitions_[candidate.symbol];
+  return static_cast<int64>(FinalAddress(states_[definition.first], definition.second)) +
+         candidate.operand;
+}
+
+bool Relaxer::RelaxPass() {
+  bool changed = false;
+  for (auto& state : states_) {
+    for (auto& candidate : state.candidates) {
+      if (candidate.relaxed) {
+        continue;
+      }
+      int64 displacement = FindTarget(state, candidate) -
+                           (FinalAddress(state, candidate.address) + 3);
+      if (displacement >= kMinDisplacement && displacement <= kMaxDisplacement) {
+        candidate.relaxed = true;
+        changed = true;
+      }
+    }
+  }
+  return changed;
+}
+
+ObjectFile* Relaxer::RewriteFile(FileState* state) {
+  const ObjectFile& file = *state->file;
+  uint32 start = file.start_address();
+
+  // PC relative displacements and relocated addresses are read before any
+  // instruction is rewritten
+  vector<pair<uint32, uint32> > pc_relative_targets;
+  for (uint32 address : state->pc_relative_sites) {
+    uint32 target = 0;
+    ReadPCRelativeTarget(*state, address, &target);
+    pc_relative_targets.push_back(pair<uint32, uint32>(address, target));
+  }
+  vector<uint32> relaxed_fields;
+  for (const auto& candidate : state->candidates) {
+    if (candidate.relaxed) {
+      relaxed_fields.push_back(candidate.address + 1);
+    }
+  }
+
+  for (const auto& site : pc_relative_targets) {
+    int32 displacement = static_cast<int32>(MapAddress(*state, site.second)) -
+                         static_cast<int32>(MapAddress(*state, site.first) + 3);
+    WriteDisplacement(site.first, displacement, state);
+  }
+  for (const auto& section : file.relocation_sections()) {
+    if (!section->type &&
+        !std::binary_search(relaxed_fields.begin(), relaxed_fields.end(),
+                            section->address)) {
+      uint32 value = 0;
+      ReadField(*state, section->address, section->nibbles, &value);
+      WriteField(section->address, section->nibbles, MapAddress(*state, value), state);
+    }
+  }
+  for (const auto& candidate : state->candidates) {
+    if (!candidate.relaxed) {
+      continue;
+    }
+    int32 displacement = static_cast<int32>(
+        FindTarget(*state, candidate) - (FinalAddress(*state, candidate.address) + 3));
+    uint8* data = state->image.data() + (candidate.address - start);
+    data[1] = (data[1] & 0x80) | kFlagPCRelative;
+    WriteDisplacement(candidate.address, displacement, state);
+    relaxed_count_++;
+  }
+
+  unique_ptr<ObjectFile> relaxed(new ObjectFile);
+  relaxed->set_file_name(file.file_name());
+  relaxed->set_program_name(file.program_name());
+  relaxed->set_start_address(start);
+  relaxed->set_code_size(file.code_size() - static_cast<uint32>(state->removed.size()));
+  relaxed->set_entry_point(MapAddress(*state, file.entry_point()));
+
+  for (const auto& section : file.text_sections()) {
+    ObjectFile::TextSection text_section;
+    text_section.address = MapAddress(*state, section.address);
+    text_section.data = relaxed->AllocateText(section.size);
+    text_section.size = 0;
+    for (uint32 address = section.address; address < section.address + section.size;
+         address++) {
+      if (!std::binary_search(state->removed.begin(), state->removed.end(), address)) {
+        text_section.data[text_section.size++] = state->image[address - start];
+      }
+    }
+    if (text_section.size > 0) {
+      relaxed->mutable_text_sections()->push_back(text_section);
+    }
+  }
+  for (const auto& section : file.export_sections()) {
+    unique_ptr<ObjectFile::SymbolExportSection> export_section(
+        new ObjectFile::SymbolExportSection);
+    for (const auto& symbol : section->symbols) {
+      export_section->symbols.push_back(
+          std::make_pair(symbol.first, MapAddress(*state, symbol.second)));
+    }
+    relaxed->mutable_export_sections()->push_back(std::move(export_section));
+  }
+  for (const auto& section : file.import_sections()) {
+    relaxed->mutable_import_sections()->emplace_back(
+        new ObjectFile::SymbolImportSection(*section));
+  }
+  for (const auto& section : file.relocation_sections()) {
+    if (std::binary_search(relaxed_fields.begin(), relaxed_fields.end(),
+                           section->address)) {
+      continue;
+    }
+    unique_ptr<ObjectFile::RelocationSection> relocation(
+        new ObjectFile::RelocationSection(*section));
+    relocation->address = MapAddress(*state, section->address);
+    relaxed->mutable_relocation_sections()->push_back(std::move(relocation));
+  }
+
+  relaxed_files_.push_back(std::move(relaxed));
+  return relaxed_files_.back().get();
+}
+
+}  // namespace linker
+}  // namespace sicxe
@@ -0,0 +1,86 @@
+#ifndef LINKER_RELAXER_H
+#define LINKER_RELAXER_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+#include "common/macros.h"
+#include "common/object_file.h"
+#include "common/string_pool.h"
+#include "common/types.h"
+#include "linker/linker.h"
+
+namespace sicxe {
+namespace linker {
+
+// Link-time relaxation of format 4 instructions. Files assembled with
+// sicasm --link-relax list their format 4 and PC relative instructions as
+// code sites. A format 4 instruction with a relocated operand whose final
+// address is in PC relative range becomes format 3, and the code after it
+// moves up by one byte. Removing bytes only brings addresses closer together,
+// so instructions are relaxed until no more fit, then the files are rewritten:
+// PC relative displacements, relocated fields and records, exported symbols
+// and the entry point follow the moved code.
+class Relaxer {
+ public:
+  DISALLOW_COPY_AND_MOVE(Relaxer);
+
+  Relaxer();
+  ~Relaxer();
+
+  // Replaces files in |files| with relaxed copies owned by the relaxer, for
+  // files laid out in order from |start_address|. Symbols that are undefined
+  // or defined twice are left to the linker, references to them are not
+  // relaxed, and neither are files that are not consistent with their sites.
+  void RelaxFiles(uint32 start_address, Linker::ObjectFileVector* files);
+
+  int relaxed_count() const;
+
+ private:
+  struct Candidate {
+    uint32 address;  // of the format 4 instruction
+    StringPool::Id symbol;  // StringPool::kInvalidId for an address in the file
+    uint32 operand;  // address in the file or value added to the symbol
+    bool relaxed;
+  };
+
+  struct FileState {
+    FileState();
+
+    const ObjectFile* file;
+    std::vector<uint8> image;  // code, indexed by address - start address
+    std::vector<Candidate> candidates;  // ordered by address
+    std::vector<uint32> pc_relative_sites;
+    std::vector<uint32> removed;  // addresses of removed bytes, ordered
+    uint32 start_address;  // after relaxation
+  };
+
+  static bool ReadField(const FileState& state, uint32 address, uint8 nibbles,
+                        uint32* value);
+  static void WriteField(uint32 address, uint8 nibbles, uint32 value, FileState* state);
+  // Target of the PC relative instruction at |address|.
+  static bool ReadPCRelativeTarget(const FileState& state, uint32 address,
+                                   uint32* target);
+  static void WriteDisplacement(uint32 address, int32 displacement, FileState* state);
+  // Address in the file after relaxation, the start address is unchanged.
+  static uint32 MapAddress(const FileState& state, uint32 address);
+
+  void FindCandidates(FileState* state);
+  void Layout(uint32 start_address);
+  uint32 FinalAddress(const FileState& state, uint32 address) const;
+  // Final address the candidate refers to.
+  int64 FindTarget(const FileState& state, const Candidate& candidate) const;
+  bool RelaxPass();
+  ObjectFile* RewriteFile(FileState* state);
+
+  StringPool names_;
+  std::vector<std::pair<size_t, uint32> > definitions_;  // file and address by name id
+  std::vector<FileState> states_;
+  std::vector<std::unique_ptr<ObjectFile> > relaxed_files_;
+  int relaxed_count_;
+};
+
+}  // namespace linker
+}  // namespace sicxe
+
+#endif  // LINKER_RELAXER_H
@@ -1,58 +1,97 @@
 #include "linker/relocation_table.h"
 
-using std::make_pair;
-using std::pair;
+#include <algorithm>
+
+using std::vector;
 
 namespace sicxe {
 namespace linker {
 
-RelocationTable::Entry::Entry() : type(SIMPLE), nibbles(0) {}
+RelocationTable::Entry::Entry()
+    : address(0), type(SIMPLE), nibbles(0), first_symbol(0), symbol_count(0) {}
 
 RelocationTable::RelocationTable() {}
 RelocationTable::~RelocationTable() {}
 
-const RelocationTable::Entry* RelocationTable::FindRelocation(uint32 address) const {
-  auto it = entry_map_.find(address);
-  if (it == entry_map_.end()) {
-    return nullptr;
-  }
-  return &it->second;
+void RelocationTable::AddRelocationSimple(uint32 address, uint8 nibbles) {
+  entries_.emplace_back();
+  Entry* entry = &entries_.back();
+  entry->address = address;
+  entry->type = SIMPLE;
+  entry->nibbles = nibbles;
+  entry->first_symbol = symbols_.size();
 }
 
-bool RelocationTable::AddRelocationSimple(uint32 address, uint8 nibbles) {
-  auto rv = entry_map_.insert(make_pair(address, Entry()));
-  if (!rv.second) {
-    // already exists
-    return false;
-  }
-  Entry* entry = &rv.first->second;
-  entry->type = SIMPLE;
+void RelocationTable::AddRelocationSymbol(uint32 address, uint8 nibbles, bool sign,
+                                          StringPool::Id symbol_id) {
+  entries_.emplace_back();
+  Entry* entry = &entries_.back();
+  entry->address = address;
+  entry->type = SYMBOL;
   entry->nibbles = nibbles;
-  return true;
+  entry->first_symbol = symbols_.size();
+  entry->symbol_count = 1;
+  Symbol symbol;
+  symbol.sign = sign;
+  symbol.id = symbol_id;
+  symbols_.push_back(symbol);
 }
 
-bool RelocationTable::AddRelocationSymbol(uint32 address, uint8 nibbles, bool sign,
-                                          const std::string& symbol_name) {
-  auto rv = entry_map_.insert(make_pair(address, Entry()));
-  Entry* entry = &rv.first->second;
-  if (rv.second) {
-    entry->type = SYMBOL;
-    entry->nibbles = nibbles;
-  } else if (entry->type != SYMBOL || entry->nibbles != nibbles) {
-    return false;
+bool RelocationTable::Finish() {
+  // stable, so symbols at one address keep their order from the file
+  auto by_address = [](const Entry& a, const Entry& b) { return a.address < b.address; };
+  if (!std::is_sorted(entries_.begin(), entries_.end(), by_address)) {
+    std::stable_sort(entries_.begin(), entries_.end(), by_address);
   }
-  entry->symbols.push_back(make_pair(sign, symbol_name));
+
+  EntryVector merged;
+  vector<Symbol> merged_symbols;
+  merged.reserve(entries_.size());
+  merged_symbols.reserve(symbols_.size());
+  for (const Entry& entry : entries_) {
+    if (!merged.empty() && merged.back().address == entry.address) {
+      Entry* last = &merged.back();
+      if (last->type != SYMBOL || entry.type != SYMBOL ||
+          last->nibbles != entry.nibbles) {
+        return false;
+      }
+      last->symbol_count += entry.symbol_count;
+    } else {
+      merged.push_back(entry);
+      merged.back().first_symbol = merged_symbols.size();
+    }
+    merged_symbols.insert(merged_symbols.end(),
+                          symbols_.begin() + entry.first_symbol,
+                          symbols_.begin() + entry.first_symbol + entry.symbol_count);
+  }
+  entries_.swap(merged);
+  symbols_.swap(merged_symbols);
   return true;
 }
 
-const RelocationTable::EntryMap& RelocationTable::entry_map() const {
-  return entry_map_;
+const RelocationTable::Entry* RelocationTable::FindRelocation(uint32 address) const {
+  auto it = LowerBound(address);
+  if (it == entries_.end() || it->address != address) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+RelocationTable::EntryVector::const_iterator RelocationTable::LowerBound(
+    uint32 address) const {
+  return std::lower_bound(entries_.begin(), entries_.end(), address,
+                          [](const Entry& entry, uint32 value) {
+                            return entry.address < value;
+                          });
 }
 
-RelocationTable::EntryMap* RelocationTable::mutable_entry_map() {
-  return &entry_map_;
+const RelocationTable::EntryVector& RelocationTable::entries() const {
+  return entries_;
 }
 
+const vector<RelocationTable::Symbol>& RelocationTable::symbols() const {
+  return symbols_;
+}
 
 }  // namespace linker
 }  // namespace sicxe
@@ -1,15 +1,16 @@
 #ifndef LINKER_RELOCATION_TABLE_H
 #define LINKER_RELOCATION_TABLE_H
 
-#include <map>
-#include <string>
 #include <vector>
 #include "common/macros.h"
+#include "common/string_pool.h"
 #include "common/types.h"
 
 namespace sicxe {
 namespace linker {
 
+// Relocations of one input file. Entries are collected in file order and then
+// sorted by address, symbol references of all entries share one flat vector.
 class RelocationTable {
  public:
   DISALLOW_COPY_AND_MOVE(RelocationTable);
@@ -19,30 +20,43 @@ class RelocationTable {
     SYMBOL,
   };
 
+  struct Symbol {
+    bool sign;
+    StringPool::Id id;  // StringPool::kInvalidId if not in the symbol table
+  };
+
   struct Entry {
     Entry();
 
+    uint32 address;
     TypeId type;
     uint8 nibbles;
-    std::vector<std::pair<bool, std::string> > symbols;  // sign and symbol name
+    uint32 first_symbol;  // index into symbols()
+    uint32 symbol_count;
   };
 
-  typedef std::map<uint32, Entry> EntryMap;
+  typedef std::vector<Entry> EntryVector;
 
   RelocationTable();
   ~RelocationTable();
 
-  const Entry* FindRelocation(uint32 address) const;
+  void AddRelocationSimple(uint32 address, uint8 nibbles);
+  void AddRelocationSymbol(uint32 address, uint8 nibbles, bool sign,
+                           StringPool::Id symbol_id);
+  // Sorts entries by address and merges symbol relocations at the same
+  // address. Returns false if relocations at one address do not match.
+  bool Finish();
 
-  bool AddRelocationSimple(uint32 address, uint8 nibbles);
-  bool AddRelocationSymbol(uint32 address, uint8 nibbles, bool sign,
-                           const std::string& symbol_name);
+  const Entry* FindRelocation(uint32 address) const;
+  // First entry with address not less than |address|, only after Finish().
+  EntryVector::const_iterator LowerBound(uint32 address) const;
 
-  const EntryMap& entry_map() const;
-  EntryMap* mutable_entry_map();
+  const EntryVector& entries() const;
+  const std::vector<Symbol>& symbols() const;
 
  private:
-  EntryMap entry_map_;
+  EntryVector entries_;
+  std::vector<Symbol> symbols_;
 };
 
 }  // namespace linker
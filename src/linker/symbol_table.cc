@@ -1,6 +1,6 @@
 #include "linker/symbol_table.h"
 
-using std::string;
+#include <algorithm>
 
 namespace sicxe {
 namespace linker {
@@ -10,24 +10,54 @@ SymbolTable::Entry::Entry() : type(UNDEFINED), address(0), file_defined(nullptr)
 SymbolTable::SymbolTable() {}
 SymbolTable::~SymbolTable() {}
 
-const SymbolTable::Entry* SymbolTable::Find(const string& symbol_name) const  {
-  auto it = entry_map_.find(symbol_name);
-  if (it == entry_map_.end()) {
+const SymbolTable::Entry* SymbolTable::Find(StringView symbol_name) const {
+  StringPool::Id id = names_.Find(symbol_name);
+  if (id == StringPool::kInvalidId) {
     return nullptr;
   }
-  return &it->second;
+  return &entries_[id];
 }
 
-SymbolTable::Entry* SymbolTable::FindOrCreateNew(const string& symbol_name) {
-  return &entry_map_[symbol_name];
+SymbolTable::Entry* SymbolTable::FindOrCreateNew(StringView symbol_name) {
+  return &entries_[Intern(symbol_name)];
 }
 
-const SymbolTable::EntryMap& SymbolTable::entry_map() const {
-  return entry_map_;
+StringPool::Id SymbolTable::FindId(StringView symbol_name) const {
+  return names_.Find(symbol_name);
 }
 
-SymbolTable::EntryMap* SymbolTable::mutable_entry_map() {
-  return &entry_map_;
+StringPool::Id SymbolTable::Intern(StringView symbol_name) {
+  StringPool::Id id = names_.Intern(symbol_name);
+  if (id >= entries_.size()) {
+    entries_.resize(id + 1);
+  }
+  return id;
+}
+
+const SymbolTable::Entry* SymbolTable::Get(StringPool::Id id) const {
+  return &entries_[id];
+}
+
+SymbolTable::Entry* SymbolTable::Get(StringPool::Id id) {
+  return &entries_[id];
+}
+
+StringView SymbolTable::name(StringPool::Id id) const {
+  return names_.Get(id);
+}
+
+size_t SymbolTable::size() const {
+  return entries_.size();
+}
+
+void SymbolTable::GetSortedIds(IdList* ids) const {
+  ids->resize(entries_.size());
+  for (size_t i = 0; i < ids->size(); i++) {
+    (*ids)[i] = i;
+  }
+  std::sort(ids->begin(), ids->end(), [this](StringPool::Id a, StringPool::Id b) {
+    return names_.Get(a) < names_.Get(b);
+  });
 }
 
 }  // namespace linker
@@ -1,10 +1,10 @@
 #ifndef LINKER_SYMBOL_TABLE_H
 #define LINKER_SYMBOL_TABLE_H
 
-#include <list>
-#include <map>
-#include <string>
+#include <vector>
 #include "common/macros.h"
+#include "common/string_pool.h"
+#include "common/string_view.h"
 #include "common/types.h"
 
 namespace sicxe {
@@ -13,6 +13,8 @@ class ObjectFile;
 
 namespace linker {
 
+// Symbols are interned in a string pool and their entries kept in a vector
+// indexed by name id, so resolving a name is one hash lookup.
 class SymbolTable {
  public:
   DISALLOW_COPY_AND_MOVE(SymbolTable);
@@ -28,22 +30,30 @@ class SymbolTable {
     TypeId type;
     uint32 address;
     const ObjectFile* file_defined;
-    std::list<const ObjectFile*> files_referenced;
+    std::vector<const ObjectFile*> files_referenced;
   };
 
-  typedef std::map<std::string, Entry> EntryMap;
+  typedef std::vector<StringPool::Id> IdList;
 
   SymbolTable();
   ~SymbolTable();
 
-  const Entry* Find(const std::string& symbol_name) const;
-  Entry* FindOrCreateNew(const std::string& symbol_name);
-
-  const EntryMap& entry_map() const;
-  EntryMap* mutable_entry_map();
+  const Entry* Find(StringView symbol_name) const;
+  Entry* FindOrCreateNew(StringView symbol_name);
+  // Returns StringPool::kInvalidId if |symbol_name| is not in the table.
+  StringPool::Id FindId(StringView symbol_name) const;
+  // Returns the id of |symbol_name|, creating its entry if needed.
+  StringPool::Id Intern(StringView symbol_name);
+  const Entry* Get(StringPool::Id id) const;
+  Entry* Get(StringPool::Id id);
+  StringView name(StringPool::Id id) const;
+  size_t size() const;
+  // Ids of all symbols ordered by name, for deterministic output.
+  void GetSortedIds(IdList* ids) const;
 
  private:
-  EntryMap entry_map_;
+  StringPool names_;
+  std::vector<Entry> entries_;  // indexed by name id
 };
 
 }  // namespace linker
@@ -0,0 +1,23 @@
+#include "machine/coverage_map.h"
+
+#include <string.h>
+
+namespace sicxe {
+namespace machine {
+
+CoverageMap::CoverageMap() {
+  Clear();
+}
+
+CoverageMap::~CoverageMap() {}
+
+void CoverageMap::Clear() {
+  memset(counters_, 0x00, sizeof(counters_));
+}
+
+const uint8* CoverageMap::counters() const {
+  return counters_;
+}
+
+}  // namespace machine
+}  // namespace sicxe
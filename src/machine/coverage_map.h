@@ -0,0 +1,37 @@
+#ifndef MACHINE_COVERAGE_MAP_H
+#define MACHINE_COVERAGE_MAP_H
+
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+namespace machine {
+
+// AFL style edge coverage map. Every taken jump is hashed by its source and
+// target address into a fixed size table of 8-bit hit counters.
+class CoverageMap {
+ public:
+  DISALLOW_COPY_AND_MOVE(CoverageMap);
+
+  static const uint32 kMapSize = 1 << 16;
+
+  CoverageMap();
+  ~CoverageMap();
+
+  void Clear();
+
+  void RecordJump(uint32 source, uint32 target) {
+    uint32 index = ((source * 0x9E3779B1) ^ target) & (kMapSize - 1);
+    counters_[index]++;
+  }
+
+  const uint8* counters() const;
+
+ private:
+  uint8 counters_[kMapSize];
+};
+
+}  // namespace machine
+}  // namespace sicxe
+
+#endif  // MACHINE_COVERAGE_MAP_H
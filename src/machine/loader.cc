@@ -14,7 +14,7 @@ bool MachineLoader::LoadObjectFile(const ObjectFile& object_file, Machine* machi
     return false;
   }
   for (const auto& section : object_file.text_sections()) {
-    machine->WriteMemory(section->address, section->size, section->data.get());
+    machine->WriteMemory(section.address, section.size, section.data);
   }
   machine->mutable_cpu_state()->program_counter =
       Machine::TrimAddress(object_file.entry_point());
@@ -33,6 +33,7 @@ ExecuteResult::ResultId Jump::Execute(const InstructionInstance& instance,
     machine->mutable_cpu_state()->registers[CpuState::REG_L] =
       machine->cpu_state().program_counter;
   }
+  machine->RecordJump(machine->cpu_state().program_counter, address);
   machine->mutable_cpu_state()->program_counter = address;
   return ExecuteResult::OK;
 }
@@ -51,6 +52,7 @@ ExecuteResult::ResultId JumpConditional::Execute(const InstructionInstance& inst
   }
   uint32 address = Machine::TrimAddress(machine->cpu_state().target_address);
   if (machine->cpu_state().condition_code == condition_) {
+    machine->RecordJump(machine->cpu_state().program_counter, address);
     machine->mutable_cpu_state()->program_counter = address;
   }
   return ExecuteResult::OK;
@@ -64,8 +66,9 @@ ExecuteResult::ResultId Return::Execute(const InstructionInstance& instance,
                                         Machine* machine) const {
   assert(instance.format == Format::FS34);
   unused(instance);
-  machine->mutable_cpu_state()->program_counter =
-    Machine::TrimAddress(machine->cpu_state().registers[CpuState::REG_L]);
+  uint32 address = Machine::TrimAddress(machine->cpu_state().registers[CpuState::REG_L]);
+  machine->RecordJump(machine->cpu_state().program_counter, address);
+  machine->mutable_cpu_state()->program_counter = address;
   return ExecuteResult::OK;
 }
 
@@ -54,7 +54,7 @@ ExecuteResult::ResultId StoreFlags::Execute(const InstructionInstance& instance,
   uint8 icc = static_cast<uint8>(machine->cpu_state().interrupt_condition_code);
   uint8 i = machine->cpu_state().interrupt_enabled ? 1 : 0;
 
-  uint8 sw = (i << 4) || (icc << 2) || cc;
+  uint8 sw = (i << 4) | (icc << 2) | cc;
   uint32 address = machine->cpu_state().target_address;
   machine->WriteMemoryByte(address, sw);
   return ExecuteResult::OK;
@@ -6,9 +6,13 @@
 #include "common/instruction.h"
 #include "common/instruction_db.h"
 #include "common/instruction_instance.h"
+#include "machine/coverage_map.h"
 #include "machine/device.h"
 #include "machine/logic.h"
 #include "machine/logic_db.h"
+#include "machine/snapshot.h"
+#include "machine/undo_log.h"
+#include "machine/watch_table.h"
 
 namespace sicxe {
 namespace machine {
@@ -36,7 +40,8 @@ Machine::Machine() : Machine(InstructionDB::Default(), LogicDB::Default()) {}
 
 Machine::Machine(const InstructionDB* instruction_db, const LogicDB* logic_db)
   : instruction_db_(instruction_db), logic_db_(logic_db), cpu_state_(),
-    memory_(new uint8[kMemorySize]) {
+    memory_(new uint8[kMemorySize]), undo_log_(nullptr),
+    watch_table_(nullptr), coverage_map_(nullptr), snapshot_(nullptr) {
   Reset();
 }
 
@@ -117,6 +122,16 @@ bool Machine::CalculateTargetAddress(const InstructionInstance& instance) {
 }
 
 ExecuteResult::ResultId Machine::Execute() {
+  if (undo_log_ == nullptr) {
+    return ExecuteInstruction();
+  }
+  undo_log_->BeginStep(cpu_state_);
+  ExecuteResult::ResultId result = ExecuteInstruction();
+  undo_log_->EndStep();
+  return result;
+}
+
+ExecuteResult::ResultId Machine::ExecuteInstruction() {
   uint32 program_counter = cpu_state_.program_counter;
 
   // delayed interrupt enable
@@ -125,9 +140,11 @@ ExecuteResult::ResultId Machine::Execute() {
     cpu_state_.interrupt_enable_next = false;
   }
 
-  // read instruction from memory
+  // read instruction from memory (not reported to the watch table)
   uint8 instruction_buffer[4];
-  ReadMemory(program_counter, 4, instruction_buffer);
+  for (int i = 0; i < 4; i++) {
+    instruction_buffer[i] = memory_[TrimAddress(program_counter + i)];
+  }
 
   // decode instruction
   InstructionInstance instance;
@@ -165,74 +182,90 @@ void Machine::Interrupt() {
   if (!cpu_state_.interrupt_enabled) {
     return;
   }
+  if (undo_log_ != nullptr) {
+    undo_log_->BeginStep(cpu_state_);
+  }
   cpu_state_.interrupt_enabled = false;
   cpu_state_.interrupt_enable_next = false;
   cpu_state_.interrupt_link = cpu_state_.program_counter;
   cpu_state_.interrupt_condition_code = cpu_state_.condition_code;
   cpu_state_.program_counter = TrimAddress(ReadMemoryWord(0xffffd));
+  if (undo_log_ != nullptr) {
+    undo_log_->EndStep();
+  }
+}
+
+uint8 Machine::LoadByte(uint32 address) const {
+  if (watch_table_ != nullptr) {
+    watch_table_->CheckRead(address);
+  }
+  return memory_[address];
 }
 
 void Machine::ReadMemory(uint32 address, int read_size, uint8* buffer) const {
   for (int i = 0; i < read_size; i++, address++) {
-    address = TrimAddress(address);
-    buffer[i] = memory_[address];
+    buffer[i] = LoadByte(TrimAddress(address));
   }
 }
 
 uint8 Machine::ReadMemoryByte(uint32 address) const {
-  address = TrimAddress(address);
-  return memory_[address];
+  return LoadByte(TrimAddress(address));
 }
 
 uint32 Machine::ReadMemoryWord(uint32 address) const {
   uint32 result = 0;
   address = TrimAddress(address);
-  result = static_cast<uint32>(memory_[address]);
+  result = static_cast<uint32>(LoadByte(address));
   result <<= 8;
   address = TrimAddress(address + 1);
-  result |= static_cast<uint32>(memory_[address]);
+  result |= static_cast<uint32>(LoadByte(address));
   result <<= 8;
   address = TrimAddress(address + 1);
-  result |= static_cast<uint32>(memory_[address]);
+  result |= static_cast<uint32>(LoadByte(address));
   return result;
 }
 
 void Machine::ReadMemoryFloat(uint32 address, uint8* result) const {
   for (int i = 0; i < 6; i++, address++) {
-    address = TrimAddress(address);
-    result[i] = memory_[address];
+    result[i] = LoadByte(TrimAddress(address));
   }
 }
 
+void Machine::StoreByte(uint32 address, uint8 value) {
+  if (undo_log_ != nullptr) {
+    undo_log_->RecordWrite(address, memory_[address]);
+  }
+  if (watch_table_ != nullptr) {
+    watch_table_->CheckWrite(address);
+  }
+  if (snapshot_ != nullptr) {
+    snapshot_->MarkDirty(address);
+  }
+  memory_[address] = value;
+}
+
 void Machine::WriteMemory(uint32 address, int write_size, const uint8* buffer) {
   for (int i = 0; i < write_size; i++, address++) {
-    address = TrimAddress(address);
-    memory_[address] = buffer[i];
+    StoreByte(TrimAddress(address), buffer[i]);
   }
 }
 
 void Machine::WriteMemoryByte(uint32 address, uint8 value) {
-  address = TrimAddress(address);
-  memory_[address] = value;
+  StoreByte(TrimAddress(address), value);
 }
 
 void Machine::WriteMemoryWord(uint32 address, uint32 value) {
-  uint8 byte = 0;
   address = TrimAddress(address);
-  byte = (value >> 16) & 0xff;
-  memory_[address] = byte;
+  StoreByte(address, (value >> 16) & 0xff);
   address = TrimAddress(address + 1);
-  byte = (value >> 8) & 0xff;
-  memory_[address] = byte;
+  StoreByte(address, (value >> 8) & 0xff);
   address = TrimAddress(address + 1);
-  byte = value & 0xff;
-  memory_[address] = byte;
+  StoreByte(address, value & 0xff);
 }
 
 void Machine::WriteMemoryFloat(uint32 address, const uint8* value) {
   for (int i = 0; i < 6; i++, address++) {
-    address = TrimAddress(address);
-    memory_[address] = value[i];
+    StoreByte(TrimAddress(address), value[i]);
   }
 }
 
@@ -248,6 +281,28 @@ Device* Machine::ReleaseDevice(uint8 device_id) {
   return devices_[device_id].release();
 }
 
+void Machine::set_undo_log(UndoLog* undo_log) {
+  undo_log_ = undo_log;
+}
+
+void Machine::set_watch_table(WatchTable* watch_table) {
+  watch_table_ = watch_table;
+}
+
+void Machine::set_coverage_map(CoverageMap* coverage_map) {
+  coverage_map_ = coverage_map;
+}
+
+void Machine::set_snapshot(MachineSnapshot* snapshot) {
+  snapshot_ = snapshot;
+}
+
+void Machine::RecordJump(uint32 source, uint32 target) {
+  if (coverage_map_ != nullptr) {
+    coverage_map_->RecordJump(source, target);
+  }
+}
+
 const CpuState& Machine::cpu_state() const {
   return cpu_state_;
 }
@@ -260,5 +315,9 @@ const uint8* Machine::memory() const {
   return memory_.get();
 }
 
+uint8* Machine::mutable_memory() {
+  return memory_.get();
+}
+
 }  // namespace machine
 }  // namespace sicxe
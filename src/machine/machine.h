@@ -14,8 +14,12 @@ struct InstructionInstance;
 
 namespace machine {
 
+class CoverageMap;
 class Device;
 class LogicDB;
+class MachineSnapshot;
+class UndoLog;
+class WatchTable;
 
 class Machine {
  public:
@@ -47,13 +51,33 @@ class Machine {
   void SetDevice(uint8 device_id, Device* device);  // take ownership of device
   Device* ReleaseDevice(uint8 device_id);  // release ownership of device
 
+  // Record executed instructions to |undo_log| (does not take ownership), can
+  // be nullptr to stop recording.
+  void set_undo_log(UndoLog* undo_log);
+  // Report memory accesses made by instructions to |watch_table| (does not take
+  // ownership), can be nullptr to disable watching.
+  void set_watch_table(WatchTable* watch_table);
+  // Record taken jumps to |coverage_map| (does not take ownership), can be
+  // nullptr to disable recording.
+  void set_coverage_map(CoverageMap* coverage_map);
+  // Report written memory pages to |snapshot| (does not take ownership), can
+  // be nullptr to disable tracking.
+  void set_snapshot(MachineSnapshot* snapshot);
+
+  // Called by jump instructions before the program counter is changed.
+  void RecordJump(uint32 source, uint32 target);
+
   const CpuState& cpu_state() const;
   CpuState* mutable_cpu_state();
   const uint8* memory() const;
+  uint8* mutable_memory();  // direct access, bypasses all hooks
 
  private:
   // for FS34 instructions, returns false if invalid addressing
   bool CalculateTargetAddress(const InstructionInstance& instance);
+  ExecuteResult::ResultId ExecuteInstruction();
+  uint8 LoadByte(uint32 address) const;
+  void StoreByte(uint32 address, uint8 value);
 
   const InstructionDB* instruction_db_;
   const LogicDB* logic_db_;
@@ -61,6 +85,10 @@ class Machine {
   CpuState cpu_state_;
   std::unique_ptr<uint8[]> memory_;
   std::unique_ptr<Device> devices_[1 << 8];
+  UndoLog* undo_log_;
+  WatchTable* watch_table_;
+  CoverageMap* coverage_map_;
+  MachineSnapshot* snapshot_;
 };
 
 }  // namespace machine
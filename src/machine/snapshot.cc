@@ -0,0 +1,39 @@
+#include "machine/snapshot.h"
+
+#include <string.h>
+#include "machine/machine.h"
+
+namespace sicxe {
+namespace machine {
+
+MachineSnapshot::MachineSnapshot()
+  : cpu_state_(), memory_(new uint8[Machine::kMemorySize]) {
+  memset(memory_.get(), 0x00, Machine::kMemorySize);
+  memset(dirty_, 0x00, sizeof(dirty_));
+}
+
+MachineSnapshot::~MachineSnapshot() {}
+
+void MachineSnapshot::Capture(const Machine& machine) {
+  cpu_state_ = machine.cpu_state();
+  memcpy(memory_.get(), machine.memory(), Machine::kMemorySize);
+  dirty_pages_.clear();
+  for (uint32 page = 0; page < kPageCount; page++) {
+    dirty_[page] = true;
+    dirty_pages_.push_back(page);
+  }
+}
+
+void MachineSnapshot::Restore(Machine* machine) {
+  uint8* memory = machine->mutable_memory();
+  for (uint32 page : dirty_pages_) {
+    uint32 offset = page << kPageBits;
+    memcpy(memory + offset, memory_.get() + offset, 1 << kPageBits);
+    dirty_[page] = false;
+  }
+  dirty_pages_.clear();
+  *machine->mutable_cpu_state() = cpu_state_;
+}
+
+}  // namespace machine
+}  // namespace sicxe
@@ -0,0 +1,51 @@
+#ifndef MACHINE_SNAPSHOT_H
+#define MACHINE_SNAPSHOT_H
+
+#include <memory>
+#include <vector>
+#include "common/cpu_state.h"
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+namespace machine {
+
+class Machine;
+
+// Copy of the CPU state and memory of a machine. While the snapshot is
+// attached to a machine (see Machine::set_snapshot) written memory pages are
+// tracked, so restoring only copies back the pages that were changed.
+class MachineSnapshot {
+ public:
+  DISALLOW_COPY_AND_MOVE(MachineSnapshot);
+
+  static const int kPageBits = 12;
+  static const uint32 kPageCount = (1 << 20) >> kPageBits;
+
+  MachineSnapshot();
+  ~MachineSnapshot();
+
+  // Copies the state of |machine|. All pages are marked as changed, so the
+  // first restore copies all of memory.
+  void Capture(const Machine& machine);
+  void Restore(Machine* machine);
+
+  void MarkDirty(uint32 address) {
+    uint32 page = address >> kPageBits;
+    if (!dirty_[page]) {
+      dirty_[page] = true;
+      dirty_pages_.push_back(page);
+    }
+  }
+
+ private:
+  CpuState cpu_state_;
+  std::unique_ptr<uint8[]> memory_;
+  bool dirty_[kPageCount];
+  std::vector<uint32> dirty_pages_;
+};
+
+}  // namespace machine
+}  // namespace sicxe
+
+#endif  // MACHINE_SNAPSHOT_H
@@ -0,0 +1,102 @@
+#include "machine/undo_log.h"
+
+#include <assert.h>
+#include "machine/machine.h"
+
+namespace sicxe {
+namespace machine {
+
+const size_t UndoLog::kDefaultMaxSteps = 200000;
+const size_t UndoLog::kDefaultMaxWrites = 600000;
+
+UndoLog::UndoLog() : UndoLog(kDefaultMaxSteps, kDefaultMaxWrites) {}
+
+UndoLog::UndoLog(size_t max_steps, size_t max_writes)
+  : max_steps_(max_steps), max_writes_(max_writes), step_open_(false) {
+  assert(max_steps_ > 0);
+}
+
+UndoLog::~UndoLog() {}
+
+void UndoLog::Clear() {
+  step_open_ = false;
+  steps_.clear();
+  writes_.clear();
+}
+
+void UndoLog::BeginStep(const CpuState& cpu_state) {
+  assert(!step_open_);
+  steps_.push_back(Step());
+  steps_.back().cpu_state = cpu_state;
+  steps_.back().write_count = 0;
+  step_open_ = true;
+}
+
+void UndoLog::EndStep() {
+  assert(step_open_);
+  step_open_ = false;
+  while (steps_.size() > max_steps_ || writes_.size() > max_writes_) {
+    DiscardOldest();
+  }
+}
+
+void UndoLog::RecordWrite(uint32 address, uint8 old_value) {
+  if (!step_open_) {
+    return;
+  }
+  writes_.push_back(Write());
+  writes_.back().address = address;
+  writes_.back().old_value = old_value;
+  steps_.back().write_count++;
+}
+
+bool UndoLog::UndoStep(Machine* machine) {
+  assert(!step_open_);
+  if (steps_.empty()) {
+    return false;
+  }
+  const Step& step = steps_.back();
+  for (uint32 i = 0; i < step.write_count; i++) {
+    machine->WriteMemoryByte(writes_.back().address, writes_.back().old_value);
+    writes_.pop_back();
+  }
+  *machine->mutable_cpu_state() = step.cpu_state;
+  steps_.pop_back();
+  return true;
+}
+
+bool UndoLog::FindLastWrite(uint32 address, size_t* steps_ago,
+                            uint32* program_counter) const {
+  size_t write_index = writes_.size();
+  for (size_t i = steps_.size(); i > 0; i--) {
+    const Step& step = steps_[i - 1];
+    for (uint32 j = 0; j < step.write_count; j++) {
+      write_index--;
+      if (writes_[write_index].address == address) {
+        *steps_ago = steps_.size() - i + 1;
+        *program_counter = step.cpu_state.program_counter;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+size_t UndoLog::size() const {
+  return steps_.size();
+}
+
+bool UndoLog::empty() const {
+  return steps_.empty();
+}
+
+void UndoLog::DiscardOldest() {
+  assert(!steps_.empty());
+  for (uint32 i = 0; i < steps_.front().write_count; i++) {
+    writes_.pop_front();
+  }
+  steps_.pop_front();
+}
+
+}  // namespace machine
+}  // namespace sicxe
@@ -0,0 +1,74 @@
+#ifndef MACHINE_UNDO_LOG_H
+#define MACHINE_UNDO_LOG_H
+
+#include <deque>
+#include "common/cpu_state.h"
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+namespace machine {
+
+class Machine;
+
+// Bounded log of executed instructions that allows the machine state to be
+// rolled back. For every step the CPU state before the instruction and the old
+// values of all overwritten memory bytes are recorded. When one of the limits
+// is reached the oldest steps are discarded. Devices are not part of the
+// machine state, so undoing RD or WD does not revert the device I/O.
+class UndoLog {
+ public:
+  DISALLOW_COPY_AND_MOVE(UndoLog);
+
+  static const size_t kDefaultMaxSteps;
+  static const size_t kDefaultMaxWrites;
+
+  UndoLog();
+  UndoLog(size_t max_steps, size_t max_writes);
+  ~UndoLog();
+
+  void Clear();
+
+  // Called by the machine around every executed instruction. Memory writes
+  // are only recorded while a step is open.
+  void BeginStep(const CpuState& cpu_state);
+  void EndStep();
+  void RecordWrite(uint32 address, uint8 old_value);
+
+  // Restores the machine state from before the last recorded step, returns
+  // false if the log is empty.
+  bool UndoStep(Machine* machine);
+
+  // Searches the log for the most recent step that wrote to |address|. On
+  // success |steps_ago| is set to the number of steps executed since (1 for
+  // the last step) and |program_counter| to the address of the instruction.
+  bool FindLastWrite(uint32 address, size_t* steps_ago,
+                     uint32* program_counter) const;
+
+  size_t size() const;
+  bool empty() const;
+
+ private:
+  struct Step {
+    CpuState cpu_state;
+    uint32 write_count;
+  };
+
+  struct Write {
+    uint32 address;
+    uint8 old_value;
+  };
+
+  void DiscardOldest();
+
+  size_t max_steps_;
+  size_t max_writes_;
+  bool step_open_;
+  std::deque<Step> steps_;
+  std::deque<Write> writes_;
+};
+
+}  // namespace machine
+}  // namespace sicxe
+
+#endif  // MACHINE_UNDO_LOG_H
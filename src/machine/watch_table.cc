@@ -0,0 +1,79 @@
+#include "machine/watch_table.h"
+
+#include <assert.h>
+#include <string.h>
+
+namespace sicxe {
+namespace machine {
+
+WatchTable::WatchTable() {
+  Clear();
+}
+
+WatchTable::~WatchTable() {}
+
+void WatchTable::Clear() {
+  ranges_.clear();
+  memset(page_flags_, 0x00, sizeof(page_flags_));
+  ResetHit();
+}
+
+void WatchTable::Add(int id, uint32 address, uint32 size, int access) {
+  assert(size > 0);
+  assert(address + size <= (kPageCount << kPageBits));
+  Range range;
+  range.id = id;
+  range.begin = address;
+  range.end = address + size;
+  range.access = access;
+  ranges_.push_back(range);
+  for (uint32 page = range.begin >> kPageBits;
+       page <= (range.end - 1) >> kPageBits; page++) {
+    page_flags_[page] |= static_cast<uint8>(access);
+  }
+}
+
+bool WatchTable::empty() const {
+  return ranges_.empty();
+}
+
+void WatchTable::ResetHit() {
+  hit_ = false;
+  hit_id_ = 0;
+  hit_address_ = 0;
+  hit_access_ = READ;
+}
+
+bool WatchTable::hit() const {
+  return hit_;
+}
+
+int WatchTable::hit_id() const {
+  return hit_id_;
+}
+
+uint32 WatchTable::hit_address() const {
+  return hit_address_;
+}
+
+WatchTable::AccessFlags WatchTable::hit_access() const {
+  return hit_access_;
+}
+
+void WatchTable::CheckAccess(uint32 address, AccessFlags access) {
+  if (hit_) {
+    return;
+  }
+  for (const auto& range : ranges_) {
+    if ((range.access & access) && address >= range.begin && address < range.end) {
+      hit_ = true;
+      hit_id_ = range.id;
+      hit_address_ = address;
+      hit_access_ = access;
+      return;
+    }
+  }
+}
+
+}  // namespace machine
+}  // namespace sicxe
@@ -0,0 +1,76 @@
+#ifndef MACHINE_WATCH_TABLE_H
+#define MACHINE_WATCH_TABLE_H
+
+#include <vector>
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+namespace machine {
+
+// Table of memory ranges watched for reads or writes. Every memory access goes
+// through a per-page flag lookup first, so the exact range check is only done
+// for accesses to pages that contain a watched range. Only the first hit is
+// recorded until the hit is reset.
+class WatchTable {
+ public:
+  DISALLOW_COPY_AND_MOVE(WatchTable);
+
+  enum AccessFlags {
+    READ = 1 << 0,
+    WRITE = 1 << 1
+  };
+
+  static const int kPageBits = 8;
+  static const uint32 kPageCount = (1 << 20) >> kPageBits;
+
+  WatchTable();
+  ~WatchTable();
+
+  void Clear();
+  // Watch |size| bytes at |address| for accesses in |access| (AccessFlags),
+  // the range must not wrap around the end of memory.
+  void Add(int id, uint32 address, uint32 size, int access);
+  bool empty() const;
+
+  void CheckRead(uint32 address) {
+    if (page_flags_[address >> kPageBits] & READ) {
+      CheckAccess(address, READ);
+    }
+  }
+
+  void CheckWrite(uint32 address) {
+    if (page_flags_[address >> kPageBits] & WRITE) {
+      CheckAccess(address, WRITE);
+    }
+  }
+
+  void ResetHit();
+  bool hit() const;
+  int hit_id() const;
+  uint32 hit_address() const;
+  AccessFlags hit_access() const;
+
+ private:
+  struct Range {
+    int id;
+    uint32 begin;
+    uint32 end;
+    int access;
+  };
+
+  void CheckAccess(uint32 address, AccessFlags access);
+
+  std::vector<Range> ranges_;
+  uint8 page_flags_[kPageCount];
+
+  bool hit_;
+  int hit_id_;
+  uint32 hit_address_;
+  AccessFlags hit_access_;
+};
+
+}  // namespace machine
+}  // namespace sicxe
+
+#endif  // MACHINE_WATCH_TABLE_H
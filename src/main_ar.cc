@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/error_db.h"
+#include "common/error_formatter.h"
+#include "common/flags_parser.h"
+#include "common/mapped_file.h"
+#include "common/object_file.h"
+#include "common/string_pool.h"
+#include "linker/archive.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace sicxe {
+namespace linker {
+
+const char* kHelpMessage =
+"SIC/XE Archiver v1.0.0 by Klemen Kloboves\n"
+"\n"
+"Usage:    sicar [-h] -o archive files...\n"
+"          sicar -t archive\n"
+"\n"
+"Bundles object files into an archive for sicld, together with an index of\n"
+"the symbols they export. The linker only loads members that define symbols\n"
+"which are still undefined.\n"
+"\n"
+"Options:\n"
+"\n"
+"    -o, --output  archive\n"
+"        Write an archive of the given object files, which may be in either\n"
+"        format. Members are named after the file names without directories.\n"
+"\n"
+"    -t, --list\n"
+"        List the members of an archive and the symbols they export.\n"
+"\n"
+"    -h, --help\n"
+"        Display help.\n"
+"\n"
+;
+
+class ArchiverDriver {
+ public:
+  DISALLOW_COPY_AND_MOVE(ArchiverDriver);
+
+  ArchiverDriver() {
+    error_formatter_.set_application_name("sicar");
+    flag_output_file_ = flags_parser_.AddFlagString("o", "output");
+    flag_list_ = flags_parser_.AddFlagBool("t", "list");
+    flag_help_ = flags_parser_.AddFlagBool("h", "help");
+  }
+
+  int Main(int argc, char* argv[]) {
+    bool success = RealMain(argc, argv);
+    error_formatter_.PrintErrors(error_db_);
+    return success ? 0 : 1;
+  }
+
+ private:
+  bool RealMain(int argc, char* argv[]) {
+    if (!flags_parser_.ParseFlags(argc, argv, &error_db_)) {
+      return false;
+    }
+
+    if (argc == 1 || flag_help_->value_bool) {
+      PrintHelp();
+      return true;
+    }
+
+    if (flags_parser_.args().empty()) {
+      error_db_.AddError(ErrorDB::ERROR, "no input files", nullptr);
+      return false;
+    }
+    if (flag_list_->value_bool) {
+      if (flag_output_file_->is_set) {
+        error_db_.AddError(ErrorDB::ERROR, "options -o and -t exclude each other",
+                           nullptr);
+        return false;
+      }
+      if (flags_parser_.args().size() > 1) {
+        error_db_.AddError(ErrorDB::ERROR, "expected one archive", nullptr);
+        return false;
+      }
+      return ListArchive(flags_parser_.args().front());
+    }
+    if (!flag_output_file_->is_set) {
+      error_db_.AddError(ErrorDB::ERROR, "output file not specified", nullptr);
+      return false;
+    }
+    return CreateArchive();
+  }
+
+  bool CreateArchive() {
+    Archive::MemberVector members;
+    // symbol names and the index of the member defining them
+    StringPool symbols;
+    vector<size_t> symbol_members;
+    bool success = true;
+    for (const string& file_name : flags_parser_.args()) {
+      MappedFile mapped_file;
+      if (!mapped_file.Open(file_name.c_str())) {
+        string message = "cannot open file '" + file_name + "'";
+        error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+        success = false;
+        continue;
+      }
+      StringView contents(mapped_file.data(), mapped_file.size());
+      ObjectFile object_file;
+      if (object_file.LoadContents(contents) != ObjectFile::OK) {
+        string message = "invalid object file '" + file_name + "'";
+        error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+        success = false;
+        continue;
+      }
+
+      unique_ptr<Archive::Member> member(new Archive::Member);
+      size_t separator = file_name.find_last_of('/');
+      member->name = (separator == string::npos) ? file_name
+                                                 : file_name.substr(separator + 1);
+      member->contents = contents.ToString();
+      for (const auto& section : object_file.export_sections()) {
+        for (const auto& symbol : section->symbols) {
+          StringPool::Id id = symbols.Intern(symbol.first);
+          if (id < symbol_members.size()) {
+            string message = "duplicate symbol '" + symbol.first;
+            message += "' in file '";
+            message += file_name;
+            message += "', first defined in file '";
+            message += flags_parser_.args()[symbol_members[id]];
+            message += "'";
+            error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+            success = false;
+            continue;
+          }
+          symbol_members.push_back(members.size());
+          member->symbols.push_back(symbol.first);
+        }
+      }
+      members.emplace_back(std::move(member));
+    }
+    if (!success) {
+      return false;
+    }
+
+    if (!Archive::SaveFile(flag_output_file_->value_string.c_str(), members)) {
+      string message = "cannot write file '" + flag_output_file_->value_string + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
+    return true;
+  }
+
+  bool ListArchive(const string& file_name) {
+    Archive archive;
+    ObjectFile::LoadResult result = archive.LoadFile(file_name.c_str());
+    if (result == ObjectFile::OPEN_FAILED) {
+      string message = "cannot open file '" + file_name + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    } else if (result == ObjectFile::INVALID_FORMAT) {
+      string message = "invalid archive '" + file_name + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
+
+    vector<vector<StringView> > member_symbols(archive.member_count());
+    for (uint32 i = 0; i < archive.symbol_count(); i++) {
+      member_symbols[archive.symbol_member(i)].push_back(archive.symbol_name(i));
+    }
+    for (uint32 i = 0; i < archive.member_count(); i++) {
+      StringView name = archive.member_name(i);
+      printf("%.*s\n", static_cast<int>(name.size()), name.data());
+      for (StringView symbol : member_symbols[i]) {
+        printf("    %.*s\n", static_cast<int>(symbol.size()), symbol.data());
+      }
+    }
+    return true;
+  }
+
+  void PrintHelp() {
+    printf("%s\n", kHelpMessage);
+  }
+
+  ErrorDB error_db_;
+  ErrorFormatter error_formatter_;
+  FlagsParser flags_parser_;
+  const FlagsParser::Flag* flag_output_file_;
+  const FlagsParser::Flag* flag_list_;
+  const FlagsParser::Flag* flag_help_;
+};
+
+}  // namespace linker
+}  // namespace sicxe
+
+int main(int argc, char* argv[]) {
+  return sicxe::linker::ArchiverDriver().Main(argc, argv);
+}
@@ -1,18 +1,23 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <memory>
 #include <string>
 #include <vector>
 #include "assembler/code.h"
 #include "assembler/code_generator.h"
+#include "assembler/code_site_writer.h"
 #include "assembler/log_file_writer.h"
 #include "assembler/object_file_writer.h"
 #include "assembler/parser.h"
+#include "assembler/peephole_optimizer.h"
 #include "assembler/table_builder.h"
 #include "common/error_db.h"
 #include "common/error_formatter.h"
 #include "common/flags_parser.h"
 #include "common/instruction_db.h"
 #include "common/object_file.h"
+#include "common/object_file_stream.h"
+#include "common/parallel_util.h"
 #include "common/text_file.h"
 
 using std::string;
@@ -25,19 +30,33 @@ namespace assembler {
 const char* kHelpMessage =
 "SIC/XE Assembler v1.0.0 by Klemen Kloboves\n"
 "\n"
-"Usage:    sicasm [-h] [-l log_file] [-o output_file] [-i insn_db] file\n"
+"Usage:    sicasm [-h] [-b] [-O] [-l log_file] [-o output_file] [-i insn_db] file\n"
+"          sicasm [-h] [-b] [-O] [-j jobs] [-i insn_db] files...\n"
 "\n"
 "Options:\n"
 "\n"
 "    -o, --output  output_file\n"
-"        Write output to output_file.\n"
+"        Write output to output_file. Only with a single input file.\n"
 "\n"
 "    -l, --log  log_file\n"
-"        Generate log file and write it to log_file.\n"
+"        Generate log file and write it to log_file. Only with a single input\n"
+"        file.\n"
+"\n"
+"    -b, --binary\n"
+"        Write object files in the binary .sobj format instead of text.\n"
+"\n"
+"    -j, --jobs  jobs\n"
+"        Assemble up to jobs files at the same time. Errors are reported in\n"
+"        the order of the input files. A single large input file is\n"
+"        tokenized and parsed on up to jobs threads instead.\n"
 "\n"
 "    -i, --instruction-db  insn_db\n"
 "        Read instruction database from insn_db.\n"
 "\n"
+"    -O, --optimize\n"
+"        Remove redundant loads and compares, redirect jumps to jumps and merge\n"
+"        CLEAR and ADDR. Rewrites are noted in the log file.\n"
+"\n"
 "    -h, --help\n"
 "        Display help.\n"
 "\n"
@@ -47,29 +66,80 @@ const char* kHelpMessage =
 "    --no-brackets\n"
 "        Disable bracket syntax extension.\n"
 "\n"
+"    --relax\n"
+"        Use format 4 for instructions written without '+' where format 3\n"
+"        cannot address the operand, instead of failing.\n"
+"\n"
+"    --place-literals\n"
+"        Also insert literal pools after J and RSUB, close to the instructions\n"
+"        using them, and reuse literals of earlier pools that are in reach.\n"
+"\n"
+"    --suggest-base\n"
+"        List code regions where loading the base register would let format 4\n"
+"        instructions use format 3, with the expected savings, in the log file.\n"
+"\n"
+"    --insert-base\n"
+"        Insert LDB and BASE for the regions of --suggest-base, so instructions\n"
+"        written without '+' can use format 3 there. Implies --relax.\n"
+"\n"
+"    --link-relax\n"
+"        Record format 4 and PC relative instructions in binary object files,\n"
+"        so that sicld --relax can shorten format 4 instructions whose operands\n"
+"        end up close enough. Nothing is recorded for code that depends on\n"
+"        distances between labels or uses ORG or base relative addressing.\n"
+"        Requires -b.\n"
+"\n"
 ;
 
 class AssemblerDriver {
  public:
   DISALLOW_COPY_AND_MOVE(AssemblerDriver);
 
-  AssemblerDriver() {
+  AssemblerDriver() : parse_thread_count_(1) {
     error_formatter_.set_application_name("sicasm");
     flag_instruction_db_ = flags_parser_.AddFlagString("i", "instruction-db");
     flag_output_file_ = flags_parser_.AddFlagString("o", "output");
     flag_log_file_ = flags_parser_.AddFlagString("l", "log");
+    flag_jobs_ = flags_parser_.AddFlagString("j", "jobs");
+    flag_binary_ = flags_parser_.AddFlagBool("b", "binary");
+    flag_optimize_ = flags_parser_.AddFlagBool("O", "optimize");
     flag_help_ = flags_parser_.AddFlagBool("h", "help");
     flag_case_sensitive_ = flags_parser_.AddFlagBool("", "case-sensitive");
     flag_no_brackets_ = flags_parser_.AddFlagBool("", "no-brackets");
+    flag_relax_ = flags_parser_.AddFlagBool("", "relax");
+    flag_place_literals_ = flags_parser_.AddFlagBool("", "place-literals");
+    flag_suggest_base_ = flags_parser_.AddFlagBool("", "suggest-base");
+    flag_insert_base_ = flags_parser_.AddFlagBool("", "insert-base");
+    flag_link_relax_ = flags_parser_.AddFlagBool("", "link-relax");
   }
 
   int Main(int argc, char* argv[]) {
     bool success = RealMain(argc, argv);
     error_formatter_.PrintErrors(error_db_);
+    for (const auto& job : jobs_) {
+      error_formatter_.PrintErrors(job->error_db);
+    }
     return success ? 0 : 1;
   }
 
  private:
+  // State of assembling one input file. Every job has its own error database
+  // and files, so jobs can run in parallel and their errors can be printed in
+  // order afterwards.
+  struct Job {
+    DISALLOW_COPY_AND_MOVE(Job);
+
+    Job() : success(false) {}
+
+    string input_file_name;
+    string output_file_name;
+    string log_file_name;  // empty if no log file is generated
+    TextFile input_file;
+    TextFile log_file;
+    ErrorDB error_db;
+    bool success;
+  };
+
   bool RealMain(int argc, char* argv[]) {
     if (!flags_parser_.ParseFlags(argc, argv, &error_db_)) {
       return false;
@@ -83,14 +153,26 @@ class AssemblerDriver {
     if (flags_parser_.args().empty()) {
       error_db_.AddError(ErrorDB::ERROR, "no input file", nullptr);
       return false;
-    } else if (flags_parser_.args().size() > 1) {
-      error_db_.AddError(ErrorDB::ERROR, "expected one input file", nullptr);
+    } else if (flags_parser_.args().size() > 1 &&
+               (flag_output_file_->is_set || flag_log_file_->is_set)) {
+      error_db_.AddError(ErrorDB::ERROR,
+                         "output and log file require a single input file", nullptr);
+      return false;
+    }
+    if (flag_link_relax_->value_bool && !flag_binary_->value_bool) {
+      error_db_.AddError(ErrorDB::ERROR, "option --link-relax requires -b", nullptr);
+      return false;
+    }
+
+    uint32 job_count = 1;
+    if (flag_jobs_->is_set &&
+        !ParallelUtil::ParseJobCount(flag_jobs_->value_string, &job_count, &error_db_)) {
       return false;
     }
 
     const InstructionDB* instruction_db = nullptr;
     if (flag_instruction_db_->is_set) {
-      if (!OpenFile(flag_instruction_db_->value_string, &custom_db_file_)) {
+      if (!OpenFile(flag_instruction_db_->value_string, &custom_db_file_, &error_db_)) {
         return false;
       }
       custom_db_.reset(new InstructionDB);
@@ -102,7 +184,47 @@ class AssemblerDriver {
       instruction_db = InstructionDB::Default();
     }
 
-    if (!OpenFile(flags_parser_.args().front(), &input_file_)) {
+    for (const string& file_name : flags_parser_.args()) {
+      unique_ptr<Job> job(new Job);
+      job->input_file_name = file_name;
+      if (flag_output_file_->is_set) {
+        job->output_file_name = flag_output_file_->value_string;
+      } else {
+        job->output_file_name = file_name;
+        size_t dot = job->output_file_name.find_last_of('.');
+        if (dot != string::npos) {
+          string extension = job->output_file_name.substr(dot + 1, string::npos);
+          if (extension == "asm") {
+            job->output_file_name.resize(dot);
+          }
+        }
+        job->output_file_name += flag_binary_->value_bool ? ".sobj" : ".obj";
+      }
+      if (flag_log_file_->is_set) {
+        job->log_file_name = flag_log_file_->value_string;
+      }
+      jobs_.emplace_back(std::move(job));
+    }
+
+    // the instruction database is shared read-only, everything else is per job
+    parse_thread_count_ = (jobs_.size() == 1) ? job_count : 1;
+    if (job_count > jobs_.size()) {
+      job_count = jobs_.size();
+    }
+    ParallelUtil::ForEachIndex(jobs_.size(), job_count, [&](size_t index) {
+      jobs_[index]->success = AssembleFile(instruction_db, jobs_[index].get());
+    });
+
+    bool success = true;
+    for (const auto& job : jobs_) {
+      success = success && job->success;
+    }
+    return success;
+  }
+
+  bool AssembleFile(const InstructionDB* instruction_db, Job* job) {
+    ErrorDB* error_db = &job->error_db;
+    if (!OpenFile(job->input_file_name, &job->input_file, error_db)) {
       return false;
     }
 
@@ -112,53 +234,77 @@ class AssemblerDriver {
     parser_config.instruction_db = instruction_db;
     parser_config.case_sensitive = flag_case_sensitive_->value_bool;
     parser_config.allow_brackets = !flag_no_brackets_->value_bool;
+    parser_config.thread_count = parse_thread_count_;
     Parser parser(&parser_config);
-    if (!parser.ParseFile(input_file_, &code, &error_db_)) {
+    if (!parser.ParseFile(job->input_file, &code, error_db)) {
+      return false;
+    }
+
+    TableBuilder::Config table_builder_config;
+    table_builder_config.relax = flag_relax_->value_bool;
+    table_builder_config.place_literals = flag_place_literals_->value_bool;
+    if (flag_insert_base_->value_bool) {
+      table_builder_config.base_placement = TableBuilder::Config::INSERT_BASE;
+    } else if (flag_suggest_base_->value_bool) {
+      table_builder_config.base_placement = TableBuilder::Config::SUGGEST_BASE;
+    }
+    TableBuilder table_builder(&table_builder_config);
+    if (!table_builder.BuildTables(&code, error_db)) {
       return false;
     }
+    if (flag_optimize_->value_bool) {
+      PeepholeOptimizer optimizer(&table_builder_config);
+      if (!optimizer.Optimize(&code, error_db)) {
+        return false;
+      }
+    }
 
-    TableBuilder table_builder;
-    if (!table_builder.BuildTables(&code, &error_db_)) {
+    // the text object file is written while code is generated, the binary
+    // one is converted from text records kept in memory
+    const char* output_file_name = job->output_file_name.c_str();
+    bool binary = flag_binary_->value_bool;
+    ObjectFileStream output_stream;
+    if (!binary && !output_stream.Open(output_file_name)) {
+      FileWriteError(job->output_file_name, error_db);
       return false;
     }
 
-    bool log_enabled = flag_log_file_->is_set;
-    ObjectFileWriter object_writer(&output_file_);
-    LogFileWriter log_writer(instruction_db, &log_file_);
+    bool log_enabled = !job->log_file_name.empty();
+    ObjectFileWriter object_writer(&output_stream);
+    LogFileWriter log_writer(instruction_db, &job->log_file);
+    CodeSiteWriter code_site_writer;
     CodeGenerator::OutputWriterVector writers;
     writers.push_back(&object_writer);
     if (log_enabled) {
       writers.push_back(&log_writer);
     }
+    if (flag_link_relax_->value_bool) {
+      writers.push_back(&code_site_writer);
+    }
 
     CodeGenerator code_generator;
-    if (!code_generator.GenerateCode(code, &writers, &error_db_)) {
+    if (!code_generator.GenerateCode(code, &writers, error_db)) {
+      output_stream.Close();
+      remove(output_file_name);
       return false;
     }
 
     bool success = true;
-    string output_file_name;
-    if (flag_output_file_->is_set) {
-      output_file_name = flag_output_file_->value_string;
-    } else {
-      output_file_name = flags_parser_.args().front();
-      size_t dot = output_file_name.find_last_of('.');
-      if (dot != string::npos) {
-        string extension = output_file_name.substr(dot + 1, string::npos);
-        if (extension == "asm") {
-          output_file_name.resize(dot);
-        }
+    if (binary) {
+      ObjectFile object_file;
+      bool loaded = (object_file.LoadText(output_stream.contents()) == ObjectFile::OK);
+      *object_file.mutable_code_sites() = code_site_writer.code_sites();
+      if (!loaded || !object_file.SaveBinaryFile(output_file_name)) {
+        FileWriteError(job->output_file_name, error_db);
+        success = false;
       }
-      output_file_name += ".obj";
-    }
-
-    if (!output_file_.SaveFile(output_file_name.c_str())) {
-      FileWriteError(output_file_name);
+    } else if (!output_stream.Close()) {
+      FileWriteError(job->output_file_name, error_db);
       success = false;
     }
     if (log_enabled) {
-      if (!log_file_.Save(flag_log_file_->value_string)) {
-        FileWriteError(flag_log_file_->value_string);
+      if (!job->log_file.Save(job->log_file_name)) {
+        FileWriteError(job->log_file_name, error_db);
         success = false;
       }
     }
@@ -166,18 +312,18 @@ class AssemblerDriver {
     return success;
   }
 
-  bool OpenFile(const string& file_name, TextFile* file) {
+  bool OpenFile(const string& file_name, TextFile* file, ErrorDB* error_db) {
     if (!file->Open(file_name)) {
       string message = "cannot open file '" + file_name + "'";
-      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      error_db->AddError(ErrorDB::ERROR, message.c_str(), nullptr);
       return false;
     }
     return true;
   }
 
-  void FileWriteError(const string& file_name) {
+  void FileWriteError(const string& file_name, ErrorDB* error_db) {
     string message = "cannot write file '" + file_name + "'";
-    error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+    error_db->AddError(ErrorDB::ERROR, message.c_str(), nullptr);
   }
 
   void PrintHelp() {
@@ -190,14 +336,21 @@ class AssemblerDriver {
   const FlagsParser::Flag* flag_instruction_db_;
   const FlagsParser::Flag* flag_output_file_;
   const FlagsParser::Flag* flag_log_file_;
+  const FlagsParser::Flag* flag_jobs_;
+  const FlagsParser::Flag* flag_binary_;
+  const FlagsParser::Flag* flag_optimize_;
   const FlagsParser::Flag* flag_help_;
   const FlagsParser::Flag* flag_case_sensitive_;
   const FlagsParser::Flag* flag_no_brackets_;
+  const FlagsParser::Flag* flag_relax_;
+  const FlagsParser::Flag* flag_place_literals_;
+  const FlagsParser::Flag* flag_suggest_base_;
+  const FlagsParser::Flag* flag_insert_base_;
+  const FlagsParser::Flag* flag_link_relax_;
   TextFile custom_db_file_;
-  TextFile input_file_;
-  TextFile log_file_;
-  ObjectFile output_file_;
   unique_ptr<InstructionDB> custom_db_;
+  vector<unique_ptr<Job>> jobs_;
+  uint32 parse_thread_count_;  // threads per file when parsing
 };
 
 }  // namespace assembler
@@ -0,0 +1,262 @@
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <string>
+#include <thread>
+#include "common/error_db.h"
+#include "common/error_formatter.h"
+#include "common/flags_parser.h"
+#include "common/object_file.h"
+#include "fuzzer/fuzzer.h"
+
+using std::string;
+
+namespace sicxe {
+namespace fuzzer {
+
+const char* kHelpMessage =
+"SIC/XE Fuzzer v1.0.0 by Klemen Kloboves\n"
+"\n"
+"Usage:    sicfuzz [-h] [-d device] [-j threads] [-i input_dir] [-o output_dir]\n"
+"                  [-n executions] [-t instructions] [-l length] [-s seed]\n"
+"                  object_file\n"
+"\n"
+"Runs the program with mutated inputs on its input device and keeps inputs\n"
+"that reach new jumps. The program runs up to its first input read once, all\n"
+"executions start from a snapshot taken at that point. Inputs that end with\n"
+"a machine error are saved as crash-N, inputs that exceed the instruction\n"
+"limit as hang-N and new corpus entries as queue-N in the output directory.\n"
+"Other devices read zero bytes and discard writes. Press Ctrl+C to stop.\n"
+"\n"
+"Options:\n"
+"\n"
+"    -d, --device  device\n"
+"        Device the program reads its input from, 0 by default.\n"
+"\n"
+"    -j, --threads  threads\n"
+"        Number of fuzzing threads, 0 for one per CPU. Default is 1.\n"
+"\n"
+"    -i, --input  input_dir\n"
+"        Start with the files in input_dir as the corpus.\n"
+"\n"
+"    -o, --output  output_dir\n"
+"        Save results to output_dir, fuzz_output by default.\n"
+"\n"
+"    -n, --executions  executions\n"
+"        Stop after the given number of executions.\n"
+"\n"
+"    -t, --max-instructions  instructions\n"
+"        Instruction limit per execution, 1000000 by default.\n"
+"\n"
+"    -l, --max-length  length\n"
+"        Maximum input length in bytes, 4096 by default.\n"
+"\n"
+"    -s, --seed  seed\n"
+"        Seed of the random number generators.\n"
+"\n"
+"    -h, --help\n"
+"        Display help.\n"
+"\n"
+;
+
+namespace {
+
+volatile bool stop_requested = false;
+
+void IntSignalHandler(int) {
+  stop_requested = true;
+}
+
+}  // namespace
+
+class FuzzDriver {
+ public:
+  DISALLOW_COPY_AND_MOVE(FuzzDriver);
+
+  FuzzDriver() {
+    error_formatter_.set_application_name("sicfuzz");
+    flag_device_ = flags_parser_.AddFlagString("d", "device");
+    flag_threads_ = flags_parser_.AddFlagString("j", "threads");
+    flag_input_ = flags_parser_.AddFlagString("i", "input");
+    flag_output_ = flags_parser_.AddFlagString("o", "output");
+    flag_executions_ = flags_parser_.AddFlagString("n", "executions");
+    flag_max_instructions_ = flags_parser_.AddFlagString("t", "max-instructions");
+    flag_max_length_ = flags_parser_.AddFlagString("l", "max-length");
+    flag_seed_ = flags_parser_.AddFlagString("s", "seed");
+    flag_help_ = flags_parser_.AddFlagBool("h", "help");
+    struct sigaction sa;
+    sa.sa_handler = &IntSignalHandler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    bool success = (sigaction(SIGINT, &sa, nullptr) == 0);
+    assert(success);
+    unused(success);
+  }
+
+  int Main(int argc, char* argv[]) {
+    bool success = RealMain(argc, argv);
+    error_formatter_.PrintErrors(error_db_);
+    return success ? 0 : 1;
+  }
+
+ private:
+  bool RealMain(int argc, char* argv[]) {
+    if (!flags_parser_.ParseFlags(argc, argv, &error_db_)) {
+      return false;
+    }
+
+    if (argc == 1 || flag_help_->value_bool) {
+      PrintHelp();
+      return true;
+    }
+
+    if (flags_parser_.args().empty()) {
+      error_db_.AddError(ErrorDB::ERROR, "no input object file", nullptr);
+      return false;
+    } else if (flags_parser_.args().size() > 1) {
+      error_db_.AddError(ErrorDB::ERROR, "expected one input object file", nullptr);
+      return false;
+    }
+
+    uint64 device_id = 0;
+    uint64 thread_count = 1;
+    uint64 max_executions = 0;
+    uint64 max_instructions = 1000000;
+    uint64 max_length = 4096;
+    uint64 seed = 1;
+    if (!ParseNumberFlag(flag_device_, "device", 0, 0xff, &device_id) ||
+        !ParseNumberFlag(flag_threads_, "thread count", 0, 256, &thread_count) ||
+        !ParseNumberFlag(flag_executions_, "execution count", 0, ~0ull,
+                         &max_executions) ||
+        !ParseNumberFlag(flag_max_instructions_, "instruction limit", 1,
+                         0xffffffff, &max_instructions) ||
+        !ParseNumberFlag(flag_max_length_, "input length", 1, 1 << 20,
+                         &max_length) ||
+        !ParseNumberFlag(flag_seed_, "seed", 0, 0xffffffff, &seed)) {
+      return false;
+    }
+    if (thread_count == 0) {
+      thread_count = std::thread::hardware_concurrency();
+      if (thread_count == 0) {
+        thread_count = 1;
+      }
+    }
+
+    // open object file
+    const string& object_file_name = flags_parser_.args().front();
+    auto open_result = object_file_.LoadFile(object_file_name.c_str());
+    if (open_result == ObjectFile::OPEN_FAILED) {
+      string message = "cannot open file '" + object_file_name + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    } else if (open_result == ObjectFile::INVALID_FORMAT) {
+      string message = "invalid object file '" + object_file_name + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
+
+    Fuzzer::Config config;
+    config.device_id = static_cast<uint8>(device_id);
+    config.thread_count = static_cast<int>(thread_count);
+    config.max_executions = max_executions;
+    config.max_instructions = static_cast<uint32>(max_instructions);
+    config.max_input_size = static_cast<size_t>(max_length);
+    config.seed = static_cast<uint32>(seed);
+    config.output_directory =
+      flag_output_->is_set ? flag_output_->value_string : "fuzz_output";
+    Fuzzer fuzzer(config);
+    if (!fuzzer.Initialize(object_file_, &error_db_)) {
+      return false;
+    }
+    if (flag_input_->is_set && !LoadCorpus(flag_input_->value_string, &fuzzer)) {
+      return false;
+    }
+    return fuzzer.Run(&stop_requested, &error_db_);
+  }
+
+  bool ParseNumberFlag(const FlagsParser::Flag* flag, const char* name,
+                       uint64 min_value, uint64 max_value, uint64* value) {
+    if (!flag->is_set) {
+      return true;
+    }
+    const char* value_str = flag->value_string.c_str();
+    char* end_ptr;
+    errno = 0;
+    uint64 result = static_cast<uint64>(strtoull(value_str, &end_ptr, 0));
+    if (*value_str == '\0' || *end_ptr != '\0') {
+      string message = string(name) + " must be a number";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
+    if (errno == ERANGE || result < min_value || result > max_value) {
+      string message = string(name) + " out of range";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
+    *value = result;
+    return true;
+  }
+
+  bool LoadCorpus(const string& directory_name, Fuzzer* fuzzer) {
+    DIR* directory = opendir(directory_name.c_str());
+    if (directory == nullptr) {
+      string message = "cannot open directory '" + directory_name + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
+    bool success = true;
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != nullptr) {
+      string file_name = directory_name + "/" + entry->d_name;
+      struct stat file_stat;
+      if (stat(file_name.c_str(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+        continue;
+      }
+      FILE* file = fopen(file_name.c_str(), "rb");
+      if (file == nullptr) {
+        string message = "cannot open file '" + file_name + "'";
+        error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+        success = false;
+        continue;
+      }
+      Fuzzer::Input input;
+      uint8 buffer[4096];
+      size_t read_size;
+      while ((read_size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        input.insert(input.end(), buffer, buffer + read_size);
+      }
+      fclose(file);
+      fuzzer->AddInput(input);
+    }
+    closedir(directory);
+    return success;
+  }
+
+  void PrintHelp() {
+    printf("%s\n", kHelpMessage);
+  }
+
+  ErrorDB error_db_;
+  ErrorFormatter error_formatter_;
+  FlagsParser flags_parser_;
+  const FlagsParser::Flag* flag_device_;
+  const FlagsParser::Flag* flag_threads_;
+  const FlagsParser::Flag* flag_input_;
+  const FlagsParser::Flag* flag_output_;
+  const FlagsParser::Flag* flag_executions_;
+  const FlagsParser::Flag* flag_max_instructions_;
+  const FlagsParser::Flag* flag_max_length_;
+  const FlagsParser::Flag* flag_seed_;
+  const FlagsParser::Flag* flag_help_;
+  ObjectFile object_file_;
+};
+
+}  // namespace fuzzer
+}  // namespace sicxe
+
+int main(int argc, char* argv[]) {
+  return sicxe::fuzzer::FuzzDriver().Main(argc, argv);
+}
@@ -8,7 +8,12 @@
 #include "common/error_db.h"
 #include "common/error_formatter.h"
 #include "common/flags_parser.h"
+#include "common/mapped_file.h"
 #include "common/object_file.h"
+#include "common/parallel_util.h"
+#include "linker/archive.h"
+#include "linker/incremental_state.h"
+#include "linker/library_search.h"
 #include "linker/linker.h"
 
 using std::pair;
@@ -22,13 +27,26 @@ namespace linker {
 const char* kHelpMessage =
 "SIC/XE Linker v1.0.0 by Klemen Kloboves\n"
 "\n"
-"Usage:    sicld [-h] [-p] [-c] [-a start_address] -o output_file files...\n"
+"Usage:    sicld [-h] [-p] [-c] [-b] [-j jobs] [-a start_address] [--gc-sections]\n"
+"                 [--relax] [--incremental state_file] -o output_file files...\n"
+"\n"
+"Input files are object files in either format or archives created by sicar.\n"
+"All object files are linked, archive members only if they define a symbol\n"
+"that is still undefined. Archives are searched in the given order.\n"
 "\n"
 "Options:\n"
 "\n"
 "    -o, --output  output_file\n"
 "        Write output to output_file.\n"
 "\n"
+"    -b, --binary\n"
+"        Write output in the binary .sobj format instead of text. Input files\n"
+"        may be in either format.\n"
+"\n"
+"    -j, --jobs  jobs\n"
+"        Load and patch up to jobs input files at the same time. Errors are\n"
+"        reported in the order of the input files.\n"
+"\n"
 "    -a, --start-address  start_address\n"
 "        Specify output object file start address.\n"
 "\n"
@@ -40,6 +58,24 @@ const char* kHelpMessage =
 "        Less strict on input file modification records, but output file will\n"
 "        not be relocatable - without modification records.\n"
 "\n"
+"    --gc-sections\n"
+"        Link only the input files that the first file reaches through\n"
+"        imported symbols and modification records, directly or through other\n"
+"        linked files. Not supported with -p.\n"
+"\n"
+"    --relax\n"
+"        Shorten format 4 instructions to PC relative format 3 where their\n"
+"        operand is in range after linking. Only binary object files assembled\n"
+"        with sicasm --link-relax are relaxed. Not supported with -c.\n"
+"\n"
+"    --incremental  state_file\n"
+"        Keep the parsed input files and the patched output in state_file and\n"
+"        reuse them in the next link with the same options. Inputs that did\n"
+"        not change are not parsed, and while all files keep their addresses\n"
+"        and the linked symbols stay the same, only changed files are patched.\n"
+"        Otherwise the link is done anew and the state is replaced. Links with\n"
+"        archives or options -c, --gc-sections or --relax are always done anew.\n"
+"\n"
 "    -h, --help\n"
 "        Display help.\n"
 "\n"
@@ -53,9 +89,14 @@ class LinkerDriver {
     error_formatter_.set_application_name("sicld");
     flag_output_file_ = flags_parser_.AddFlagString("o", "output");
     flag_help_ = flags_parser_.AddFlagBool("h", "help");
+    flag_binary_ = flags_parser_.AddFlagBool("b", "binary");
+    flag_jobs_ = flags_parser_.AddFlagString("j", "jobs");
     flag_address_ = flags_parser_.AddFlagString("a", "start-address");
     flag_partial_link_ = flags_parser_.AddFlagBool("p", "partial-link");
     flag_comptibility_mode_ = flags_parser_.AddFlagBool("c", "compatibility-mode");
+    flag_gc_sections_ = flags_parser_.AddFlagBool("", "gc-sections");
+    flag_relax_ = flags_parser_.AddFlagBool("", "relax");
+    flag_incremental_ = flags_parser_.AddFlagString("", "incremental");
   }
 
   int Main(int argc, char* argv[]) {
@@ -101,42 +142,145 @@ class LinkerDriver {
       start_address = value;
     }
 
+    uint32 job_count = 1;
+    if (flag_jobs_->is_set &&
+        !ParallelUtil::ParseJobCount(flag_jobs_->value_string, &job_count, &error_db_)) {
+      return false;
+    }
+
+    // the state can only be reused by links with the same options
+    bool incremental = flag_incremental_->is_set;
+    string options = "a=" + std::to_string(start_address) +
+                     " p=" + std::to_string(flag_partial_link_->value_bool) +
+                     " c=" + std::to_string(flag_comptibility_mode_->value_bool) +
+                     " gc=" + std::to_string(flag_gc_sections_->value_bool) +
+                     " relax=" + std::to_string(flag_relax_->value_bool);
+    const char* state_file_name = flag_incremental_->value_string.c_str();
+    if (incremental) {
+      incremental_state_.LoadFile(state_file_name, options, flags_parser_.args().size());
+    }
+
+    // files are loaded independently, so they can be parsed in parallel
+    const vector<string>& file_names = flags_parser_.args();
+    vector<ObjectFile::LoadResult> results(file_names.size());
+    for (size_t i = 0; i < file_names.size(); i++) {
+      input_files_.emplace_back(new ObjectFile);
+    }
+    archives_.resize(file_names.size());
+    ParallelUtil::ForEachIndex(file_names.size(), job_count, [&](size_t index) {
+      // every input is opened once, so pipes can be inputs too
+      const char* file_name = file_names[index].c_str();
+      unique_ptr<MappedFile> mapped_file(new MappedFile);
+      if (!mapped_file->Open(file_name)) {
+        results[index] = ObjectFile::OPEN_FAILED;
+      } else if (Archive::IsArchive(StringView(mapped_file->data(), mapped_file->size()))) {
+        archives_[index].reset(new Archive);
+        results[index] = archives_[index]->LoadMappedFile(file_name, std::move(mapped_file));
+      } else if (incremental) {
+        results[index] = incremental_state_.LoadInput(index, file_name, *mapped_file,
+                                                       input_files_[index].get());
+      } else {
+        results[index] = input_files_[index]->LoadMappedFile(file_name,
+                                                             std::move(mapped_file));
+      }
+    });
+
     Linker::ObjectFileVector input_ptrs;
+    LibrarySearch::ArchiveVector archive_ptrs;
     bool success = true;
-    for (const string& file_name : flags_parser_.args()) {
-      unique_ptr<ObjectFile> file(new ObjectFile);
-      ObjectFile::LoadResult result = file->LoadFile(file_name.c_str());
-      if (result == ObjectFile::OPEN_FAILED) {
-        string message = "cannot open file '" + file_name + "'";
-        error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
-        success = false;
-        continue;
-      } else if (result == ObjectFile::INVALID_FORMAT) {
-        string message = "invalid object file '" + file_name + "'";
-        error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+    for (size_t i = 0; i < file_names.size(); i++) {
+      if (!CheckLoadResult(i, results[i])) {
         success = false;
         continue;
       }
-      input_ptrs.push_back(file.get());
-      input_files_.emplace_back(std::move(file));
+      if (archives_[i]) {
+        archive_ptrs.push_back(archives_[i].get());
+      } else {
+        input_ptrs.push_back(input_files_[i].get());
+      }
     }
     if (!success) {
       return false;
     }
+    if (input_ptrs.empty()) {
+      error_db_.AddError(ErrorDB::ERROR, "no input object files", nullptr);
+      return false;
+    }
 
     Linker::Config config;
     config.compatibility_mode = flag_comptibility_mode_->value_bool;
+    config.thread_count = job_count;
+    config.gc_sections = flag_gc_sections_->value_bool;
+    config.relax = flag_relax_->value_bool;
     Linker linker(&config);
-    if (!linker.LinkFiles(flag_partial_link_->value_bool, start_address,
-                          input_ptrs, &output_file_, &error_db_)) {
-      return false;
+    // when only code changed, the changed files are patched into the last output
+    Linker::FileOutputRangeVector ranges;
+    Linker::ChangedFileVector changed_files;
+    bool relink = incremental && archive_ptrs.empty() && !config.compatibility_mode &&
+                  !config.gc_sections && !config.relax &&
+                  incremental_state_.PrepareRelink(input_ptrs, &ranges, &changed_files,
+                                                   &output_file_);
+    if (relink) {
+      if (!linker.RelinkFiles(flag_partial_link_->value_bool, ranges, changed_files,
+                              &output_file_, &error_db_)) {
+        return false;
+      }
+    } else {
+      if (incremental) {
+        ParallelUtil::ForEachIndex(file_names.size(), job_count, [&](size_t index) {
+          if (!archives_[index] && incremental_state_.input_skipped(index)) {
+            results[index] = incremental_state_.LoadSkippedInput(index);
+          }
+        });
+        for (size_t i = 0; i < file_names.size(); i++) {
+          if (!CheckLoadResult(i, results[i])) {
+            success = false;
+          }
+        }
+        if (!success) {
+          return false;
+        }
+      }
+      if (!library_search_.AddMembers(archive_ptrs, &input_ptrs, &error_db_)) {
+        return false;
+      }
+      if (!linker.LinkFiles(flag_partial_link_->value_bool, start_address,
+                            input_ptrs, &output_file_, &error_db_)) {
+        return false;
+      }
     }
 
-    if (!output_file_.SaveFile(flag_output_file_->value_string.c_str())) {
+    const char* output_file_name = flag_output_file_->value_string.c_str();
+    bool saved = flag_binary_->value_bool ? output_file_.SaveBinaryFile(output_file_name)
+                                          : output_file_.SaveFile(output_file_name);
+    if (!saved) {
       string message = "cannot write file '" + flag_output_file_->value_string + "'";
       error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
       return false;
     }
+    if (incremental &&
+        !incremental_state_.SaveFile(state_file_name, options, input_ptrs,
+                                     linker.file_output_ranges(), output_file_)) {
+      string message = "cannot write file '" + flag_incremental_->value_string + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
+    return true;
+  }
+
+  // Reports |result| of loading input file |index|, returns false on failure.
+  bool CheckLoadResult(size_t index, ObjectFile::LoadResult result) {
+    const string& file_name = flags_parser_.args()[index];
+    if (result == ObjectFile::OPEN_FAILED) {
+      string message = "cannot open file '" + file_name + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    } else if (result == ObjectFile::INVALID_FORMAT) {
+      string message = archives_[index] ? "invalid archive '" : "invalid object file '";
+      message += file_name + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
     return true;
   }
 
@@ -149,10 +293,18 @@ class LinkerDriver {
   FlagsParser flags_parser_;
   const FlagsParser::Flag* flag_output_file_;
   const FlagsParser::Flag* flag_help_;
+  const FlagsParser::Flag* flag_binary_;
+  const FlagsParser::Flag* flag_jobs_;
   const FlagsParser::Flag* flag_address_;
   const FlagsParser::Flag* flag_partial_link_;
   const FlagsParser::Flag* flag_comptibility_mode_;
+  const FlagsParser::Flag* flag_gc_sections_;
+  const FlagsParser::Flag* flag_relax_;
+  const FlagsParser::Flag* flag_incremental_;
   vector<unique_ptr<ObjectFile> > input_files_;
+  vector<unique_ptr<Archive> > archives_;  // nullptr for object files
+  LibrarySearch library_search_;
+  IncrementalState incremental_state_;
   ObjectFile output_file_;
 };
 
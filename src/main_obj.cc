@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <string>
+#include "common/error_db.h"
+#include "common/error_formatter.h"
+#include "common/flags_parser.h"
+#include "common/object_file.h"
+
+using std::string;
+
+namespace sicxe {
+
+const char* kHelpMessage =
+"SIC/XE Object File Converter v1.0.0 by Klemen Kloboves\n"
+"\n"
+"Usage:    sicobj [-h] [-b | -t] -o output_file file\n"
+"\n"
+"Converts between the text and the binary .sobj object file format. Without\n"
+"-b or -t the output is in the other format than the input.\n"
+"\n"
+"Options:\n"
+"\n"
+"    -o, --output  output_file\n"
+"        Write output to output_file.\n"
+"\n"
+"    -b, --binary\n"
+"        Write output in the binary .sobj format.\n"
+"\n"
+"    -t, --text\n"
+"        Write output in the text format.\n"
+"\n"
+"    -h, --help\n"
+"        Display help.\n"
+"\n"
+;
+
+class ConverterDriver {
+ public:
+  DISALLOW_COPY_AND_MOVE(ConverterDriver);
+
+  ConverterDriver() {
+    error_formatter_.set_application_name("sicobj");
+    flag_output_file_ = flags_parser_.AddFlagString("o", "output");
+    flag_binary_ = flags_parser_.AddFlagBool("b", "binary");
+    flag_text_ = flags_parser_.AddFlagBool("t", "text");
+    flag_help_ = flags_parser_.AddFlagBool("h", "help");
+  }
+
+  int Main(int argc, char* argv[]) {
+    bool success = RealMain(argc, argv);
+    error_formatter_.PrintErrors(error_db_);
+    return success ? 0 : 1;
+  }
+
+ private:
+  bool RealMain(int argc, char* argv[]) {
+    if (!flags_parser_.ParseFlags(argc, argv, &error_db_)) {
+      return false;
+    }
+
+    if (argc == 1 || flag_help_->value_bool) {
+      PrintHelp();
+      return true;
+    }
+
+    if (flags_parser_.args().empty()) {
+      error_db_.AddError(ErrorDB::ERROR, "no input file", nullptr);
+      return false;
+    } else if (flags_parser_.args().size() > 1) {
+      error_db_.AddError(ErrorDB::ERROR, "expected one input file", nullptr);
+      return false;
+    }
+    if (!flag_output_file_->is_set) {
+      error_db_.AddError(ErrorDB::ERROR, "output file not specified", nullptr);
+      return false;
+    }
+    if (flag_binary_->value_bool && flag_text_->value_bool) {
+      error_db_.AddError(ErrorDB::ERROR, "options -b and -t exclude each other", nullptr);
+      return false;
+    }
+
+    const string& input_file_name = flags_parser_.args().front();
+    ObjectFile::LoadResult result = object_file_.LoadFile(input_file_name.c_str());
+    if (result == ObjectFile::OPEN_FAILED) {
+      string message = "cannot open file '" + input_file_name + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    } else if (result == ObjectFile::INVALID_FORMAT) {
+      string message = "invalid object file '" + input_file_name + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
+
+    bool binary = (object_file_.format() == ObjectFile::TEXT);
+    if (flag_binary_->value_bool || flag_text_->value_bool) {
+      binary = flag_binary_->value_bool;
+    }
+    const char* output_file_name = flag_output_file_->value_string.c_str();
+    bool saved = binary ? object_file_.SaveBinaryFile(output_file_name)
+                        : object_file_.SaveFile(output_file_name);
+    if (!saved) {
+      string message = "cannot write file '" + flag_output_file_->value_string + "'";
+      error_db_.AddError(ErrorDB::ERROR, message.c_str(), nullptr);
+      return false;
+    }
+    return true;
+  }
+
+  void PrintHelp() {
+    printf("%s\n", kHelpMessage);
+  }
+
+  ErrorDB error_db_;
+  ErrorFormatter error_formatter_;
+  FlagsParser flags_parser_;
+  const FlagsParser::Flag* flag_output_file_;
+  const FlagsParser::Flag* flag_binary_;
+  const FlagsParser::Flag* flag_text_;
+  const FlagsParser::Flag* flag_help_;
+  ObjectFile object_file_;
+};
+
+}  // namespace sicxe
+
+int main(int argc, char* argv[]) {
+  return sicxe::ConverterDriver().Main(argc, argv);
+}
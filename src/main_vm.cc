@@ -24,6 +24,8 @@ const char* kHelpMessage =
 "\n"
 "Usage:    sicvm [-h] object_file\n"
 "\n"
+"The object file may be in the text or the binary .sobj format.\n"
+"\n"
 "Options:\n"
 "\n"
 "    -h, --help\n"
@@ -0,0 +1,365 @@
+#include "simulator/condition.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <string.h>
+#include "common/command_interface.h"
+#include "common/cpu_state.h"
+#include "machine/machine.h"
+
+using sicxe::machine::Machine;
+using std::string;
+using std::vector;
+
+namespace sicxe {
+namespace simulator {
+
+const int Condition::kMaxStackDepth = 32;
+
+// Recursive descent compiler, emits operations in postfix order.
+class Condition::Compiler {
+ public:
+  DISALLOW_COPY_AND_MOVE(Compiler);
+
+  Compiler(const string& text, const NameResolver& resolver,
+           vector<Operation>* program, string* error)
+    : text_(text), resolver_(resolver), program_(program), error_(error),
+      position_(0), depth_(0) {}
+
+  bool Compile() {
+    if (!NextToken() || !ParseOr()) {
+      return false;
+    }
+    if (!token_.empty()) {
+      return Fail("unexpected '" + token_ + "'");
+    }
+    assert(depth_ == 1);
+    return true;
+  }
+
+ private:
+  static const char* const kOperators[];
+
+  bool Fail(const string& message) {
+    *error_ = message;
+    return false;
+  }
+
+  // Reads the next token into |token_|, empty token marks the end of input.
+  bool NextToken() {
+    while (position_ < text_.size() && isspace(text_[position_])) {
+      position_++;
+    }
+    token_.clear();
+    if (position_ >= text_.size()) {
+      return true;
+    }
+    char c = text_[position_];
+    if (isalnum(c) || c == '_') {
+      size_t begin = position_;
+      while (position_ < text_.size() &&
+             (isalnum(text_[position_]) || text_[position_] == '_' ||
+              text_[position_] == '.')) {
+        position_++;
+      }
+      token_ = text_.substr(begin, position_ - begin);
+      return true;
+    }
+    for (int i = 0; kOperators[i] != nullptr; i++) {
+      size_t length = strlen(kOperators[i]);
+      if (text_.compare(position_, length, kOperators[i]) == 0) {
+        token_ = kOperators[i];
+        position_ += length;
+        return true;
+      }
+    }
+    return Fail(string("unexpected character '") + c + "'");
+  }
+
+  bool Expect(const char* token) {
+    if (token_ != token) {
+      return Fail(string("expected '") + token + "'");
+    }
+    return NextToken();
+  }
+
+  bool Emit(OpcodeId opcode, int32 operand, int stack_change) {
+    depth_ += stack_change;
+    if (depth_ > kMaxStackDepth) {
+      return Fail("expression is too complex");
+    }
+    Operation operation;
+    operation.opcode = opcode;
+    operation.operand = operand;
+    program_->push_back(operation);
+    return true;
+  }
+
+  // Parses a chain of left associative binary operators.
+  bool ParseBinary(bool (Compiler::*parse_operand)(),
+                   const char* const* operators, const OpcodeId* opcodes) {
+    if (!(this->*parse_operand)()) {
+      return false;
+    }
+    while (true) {
+      int index = -1;
+      for (int i = 0; operators[i] != nullptr; i++) {
+        if (token_ == operators[i]) {
+          index = i;
+          break;
+        }
+      }
+      if (index < 0) {
+        return true;
+      }
+      if (!NextToken() || !(this->*parse_operand)() ||
+          !Emit(opcodes[index], 0, -1)) {
+        return false;
+      }
+    }
+  }
+
+  bool ParseOr() {
+    static const char* const operators[] = {"||", nullptr};
+    static const OpcodeId opcodes[] = {LOGICAL_OR};
+    return ParseBinary(&Compiler::ParseAnd, operators, opcodes);
+  }
+
+  bool ParseAnd() {
+    static const char* const operators[] = {"&&", nullptr};
+    static const OpcodeId opcodes[] = {LOGICAL_AND};
+    return ParseBinary(&Compiler::ParseEquality, operators, opcodes);
+  }
+
+  bool ParseEquality() {
+    static const char* const operators[] = {"==", "!=", nullptr};
+    static const OpcodeId opcodes[] = {EQUAL, NOT_EQUAL};
+    return ParseBinary(&Compiler::ParseRelational, operators, opcodes);
+  }
+
+  bool ParseRelational() {
+    static const char* const operators[] = {"<=", ">=", "<", ">", nullptr};
+    static const OpcodeId opcodes[] = {LESS_EQUAL, GREATER_EQUAL, LESS, GREATER};
+    return ParseBinary(&Compiler::ParseAdditive, operators, opcodes);
+  }
+
+  bool ParseAdditive() {
+    static const char* const operators[] = {"+", "-", nullptr};
+    static const OpcodeId opcodes[] = {ADD, SUBTRACT};
+    return ParseBinary(&Compiler::ParseMultiplicative, operators, opcodes);
+  }
+
+  bool ParseMultiplicative() {
+    static const char* const operators[] = {"*", "/", "%", nullptr};
+    static const OpcodeId opcodes[] = {MULTIPLY, DIVIDE, MODULO};
+    return ParseBinary(&Compiler::ParseUnary, operators, opcodes);
+  }
+
+  bool ParseUnary() {
+    if (token_ == "-" || token_ == "!") {
+      OpcodeId opcode = (token_ == "-") ? NEGATE : LOGICAL_NOT;
+      return NextToken() && ParseUnary() && Emit(opcode, 0, 0);
+    }
+    return ParsePrimary();
+  }
+
+  bool ParsePrimary() {
+    if (token_.empty()) {
+      return Fail("unexpected end of expression");
+    }
+    if (token_ == "(") {
+      return NextToken() && ParseOr() && Expect(")");
+    }
+    if (isdigit(token_[0])) {
+      uint32 value = 0;
+      if (!CommandInterface::ParseWord(token_, &value)) {
+        return Fail("invalid number '" + token_ + "'");
+      }
+      return Emit(PUSH_CONSTANT, Machine::SignExtendWord(value), 1) && NextToken();
+    }
+    if (!isalpha(token_[0]) && token_[0] != '_') {
+      return Fail("unexpected '" + token_ + "'");
+    }
+
+    string name = token_;
+    string upper_name = name;
+    for (size_t i = 0; i < upper_name.size(); i++) {
+      upper_name[i] = static_cast<char>(toupper(upper_name[i]));
+    }
+    if (upper_name == "MEM.B" || upper_name == "MEM.W") {
+      OpcodeId opcode = (upper_name == "MEM.B") ? LOAD_BYTE : LOAD_WORD;
+      return NextToken() && Expect("[") && ParseOr() && Expect("]") &&
+             Emit(opcode, 0, 0);
+    }
+
+    bool success = true;
+    CpuState::RegisterId register_id;
+    uint32 address = 0;
+    if (CpuState::RegisterNameToId(upper_name, &register_id)) {
+      success = Emit(PUSH_REGISTER, register_id, 1);
+    } else if (upper_name == "PC") {
+      success = Emit(PUSH_PROGRAM_COUNTER, 0, 1);
+    } else if (upper_name == "CC") {
+      success = Emit(PUSH_CONDITION_CODE, 0, 1);
+    } else if (upper_name == "LT") {
+      success = Emit(PUSH_CONSTANT, CpuState::LESS, 1);
+    } else if (upper_name == "EQ") {
+      success = Emit(PUSH_CONSTANT, CpuState::EQUAL, 1);
+    } else if (upper_name == "GT") {
+      success = Emit(PUSH_CONSTANT, CpuState::GREATER, 1);
+    } else if (upper_name == "HITCOUNT") {
+      success = Emit(PUSH_HIT_COUNT, 0, 1);
+    } else if (resolver_ && resolver_(name, &address)) {
+      success = Emit(PUSH_CONSTANT, static_cast<int32>(address), 1);
+    } else {
+      return Fail("unknown name '" + name + "'");
+    }
+    return success && NextToken();
+  }
+
+  const string& text_;
+  const NameResolver& resolver_;
+  vector<Operation>* program_;
+  string* error_;
+
+  size_t position_;
+  string token_;
+  int depth_;
+};
+
+// longer operators must come first
+const char* const Condition::Compiler::kOperators[] = {
+  "&&", "||", "==", "!=", "<=", ">=",
+  "<", ">", "+", "-", "*", "/", "%", "!", "(", ")", "[", "]",
+  nullptr
+};
+
+Condition::Condition() {}
+
+Condition::~Condition() {}
+
+bool Condition::Compile(const string& text, const NameResolver& resolver,
+                        string* error) {
+  vector<Operation> program;
+  Compiler compiler(text, resolver, &program, error);
+  if (!compiler.Compile()) {
+    return false;
+  }
+  text_ = text;
+  program_.swap(program);
+  return true;
+}
+
+namespace {
+
+int32 ReadMemoryWordDirect(const uint8* memory, int32 address) {
+  uint32 word = 0;
+  for (int i = 0; i < 3; i++) {
+    word = (word << 8) | memory[Machine::TrimAddress(address + i)];
+  }
+  return Machine::SignExtendWord(word);
+}
+
+// Wraps an arithmetic result to a signed word.
+int32 WrapWord(uint32 value) {
+  return Machine::SignExtendWord(Machine::TrimWord(value));
+}
+
+}  // namespace
+
+bool Condition::Evaluate(const Machine& machine, uint32 hit_count) const {
+  const CpuState& cpu_state = machine.cpu_state();
+  const uint8* memory = machine.memory();
+  int32 stack[kMaxStackDepth];
+  int top = -1;
+  for (const auto& operation : program_) {
+    switch (operation.opcode) {
+      case PUSH_CONSTANT:
+        stack[++top] = operation.operand;
+        break;
+      case PUSH_REGISTER:
+        stack[++top] = Machine::SignExtendWord(cpu_state.registers[operation.operand]);
+        break;
+      case PUSH_PROGRAM_COUNTER:
+        stack[++top] = static_cast<int32>(cpu_state.program_counter);
+        break;
+      case PUSH_CONDITION_CODE:
+        stack[++top] = static_cast<int32>(cpu_state.condition_code);
+        break;
+      case PUSH_HIT_COUNT:
+        stack[++top] = WrapWord(hit_count);
+        break;
+      case LOAD_BYTE:
+        stack[top] = memory[Machine::TrimAddress(stack[top])];
+        break;
+      case LOAD_WORD:
+        stack[top] = ReadMemoryWordDirect(memory, stack[top]);
+        break;
+      case NEGATE:
+        stack[top] = WrapWord(0u - static_cast<uint32>(stack[top]));
+        break;
+      case LOGICAL_NOT:
+        stack[top] = !stack[top];
+        break;
+      default: {
+        int32 right = stack[top--];
+        int32& left = stack[top];
+        switch (operation.opcode) {
+          case MULTIPLY:
+            left = WrapWord(static_cast<uint32>(left) * static_cast<uint32>(right));
+            break;
+          // operands are signed words, so only the minimum word divided by
+          // -1 leaves the range, which WrapWord turns back into the minimum
+          case DIVIDE:
+            left = (right != 0) ? WrapWord(static_cast<uint32>(left / right)) : 0;
+            break;
+          case MODULO:
+            left = (right != 0) ? left % right : 0;
+            break;
+          case ADD:
+            left = WrapWord(static_cast<uint32>(left) + static_cast<uint32>(right));
+            break;
+          case SUBTRACT:
+            left = WrapWord(static_cast<uint32>(left) - static_cast<uint32>(right));
+            break;
+          case LESS:
+            left = left < right;
+            break;
+          case LESS_EQUAL:
+            left = left <= right;
+            break;
+          case GREATER:
+            left = left > right;
+            break;
+          case GREATER_EQUAL:
+            left = left >= right;
+            break;
+          case EQUAL:
+            left = left == right;
+            break;
+          case NOT_EQUAL:
+            left = left != right;
+            break;
+          case LOGICAL_AND:
+            left = left && right;
+            break;
+          case LOGICAL_OR:
+            left = left || right;
+            break;
+          default:
+            assert(false);
+            break;
+        }
+        break;
+      }
+    }
+  }
+  return top < 0 || stack[top] != 0;
+}
+
+const string& Condition::text() const {
+  return text_;
+}
+
+}  // namespace simulator
+}  // namespace sicxe
@@ -0,0 +1,89 @@
+#ifndef SIMULATOR_CONDITION_H
+#define SIMULATOR_CONDITION_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "common/macros.h"
+#include "common/types.h"
+
+namespace sicxe {
+
+namespace machine { class Machine; }
+
+namespace simulator {
+
+// Breakpoint condition compiled to a small stack based program. Syntax is
+// similar to C expressions over 24-bit signed integers, arithmetic wraps like
+// the machine's:
+//
+//   operands:   numbers (decimal or 0x hex), registers A, X, L, B, S, T, PC,
+//               condition code CC and its values LT, EQ, GT, hitcount,
+//               names of watch list variables (their address),
+//               memory accesses mem.b[address] and mem.w[address]
+//   operators:  ( ) unary - !, * / %, + -, < <= > >=, == !=, &&, ||
+//
+// Example: "A == 0x10 && mem.w[BUF + 3] > 5"
+class Condition {
+ public:
+  DISALLOW_COPY_AND_MOVE(Condition);
+
+  // Resolves a name to an address, returns false if the name is unknown.
+  typedef std::function<bool(const std::string&, uint32*)> NameResolver;
+
+  static const int kMaxStackDepth;
+
+  Condition();
+  ~Condition();
+
+  // Returns false and sets |error| if the expression is invalid.
+  bool Compile(const std::string& text, const NameResolver& resolver,
+               std::string* error);
+
+  // Returns true if the condition holds. Memory is read directly, so
+  // evaluation does not trigger watchpoints.
+  bool Evaluate(const machine::Machine& machine, uint32 hit_count) const;
+
+  const std::string& text() const;
+
+ private:
+  enum OpcodeId {
+    PUSH_CONSTANT,
+    PUSH_REGISTER,
+    PUSH_PROGRAM_COUNTER,
+    PUSH_CONDITION_CODE,
+    PUSH_HIT_COUNT,
+    LOAD_BYTE,
+    LOAD_WORD,
+    NEGATE,
+    LOGICAL_NOT,
+    MULTIPLY,
+    DIVIDE,
+    MODULO,
+    ADD,
+    SUBTRACT,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    EQUAL,
+    NOT_EQUAL,
+    LOGICAL_AND,
+    LOGICAL_OR
+  };
+
+  struct Operation {
+    OpcodeId opcode;
+    int32 operand;
+  };
+
+  class Compiler;
+
+  std::string text_;
+  std::vector<Operation> program_;
+};
+
+}  // namespace simulator
+}  // namespace sicxe
+
+#endif  // SIMULATOR_CONDITION_H
@@ -13,6 +13,7 @@
 
 using sicxe::machine::FileDevice;
 using sicxe::machine::LogicDB;
+using sicxe::machine::Machine;
 using std::make_pair;
 using std::pair;
 using std::string;
@@ -27,10 +28,13 @@ Simulator::Simulator() : Simulator(InstructionDB::Default(), LogicDB::Default())
 Simulator::Simulator(const InstructionDB* instruction_db, const LogicDB* logic_db)
   : instruction_db_(instruction_db), logic_db_(logic_db),
     machine_(instruction_db_, logic_db_), command_interface_("sicsim"),
-    auto_disassemble_(false), breakpoints_enable_(false),
+    auto_disassemble_(false), reverse_enable_(true), undo_log_(),
+    breakpoints_enable_(false),
+    breakpoint_address_bits_(Machine::kMemorySize, false),
     breakpoint_next_number_(0), breakpoint_last_hit_address_(0xFFFFFF),
-    variable_next_number_(0) {
+    watchpoint_next_number_(0), variable_next_number_(0) {
   RegisterCommands();
+  machine_.set_undo_log(&undo_log_);
   // set up devices
   unique_ptr<char[]> device_name_buffer(new char[PATH_MAX]);
   for (int i = 0; i < 256; i++) {
@@ -130,7 +134,8 @@ void Simulator::RegisterCommands() {
 
   command_interface_.RegisterCommand(
       vector<string>{"load"},
-      "Reset the machine and load an object file to the specified address.",
+      "Reset the machine and load a text or binary (.sobj) object file to the\n"
+      "specified address.",
       vector<pair<string, bool> >{
         make_pair("file", true),
         make_pair("address", false),
@@ -158,16 +163,17 @@ void Simulator::RegisterCommands() {
 
   command_interface_.RegisterCommand(
       vector<string>{"start"},
-      "Run the machine until an error or breakpoint is encountered (only\n"
-      "if breakpoints are enabled). Can also be stopped by pressing Ctrl+C.",
+      "Run the machine until an error, breakpoint or watchpoint is\n"
+      "encountered (only if breakpoints are enabled). Can also be stopped\n"
+      "by pressing Ctrl+C.",
       vector<pair<string, bool> >{},
       std::bind(&Simulator::CommandStart, this, _1));
   command_interface_.RegisterCommand(
       vector<string>{"step"},
       "Execute up to count instructions (default is 1). The machine\n"
-      "stops if an error or breakpoint is encountered (if enabled). Also\n"
-      "shows disassembly of executed instructions if enabled in the\n"
-      "disassembly menu.",
+      "stops if an error, breakpoint or watchpoint is encountered (if\n"
+      "enabled). Also shows disassembly of executed instructions if\n"
+      "enabled in the disassembly menu.",
       vector<pair<string, bool> >{
         make_pair("count", false),
       },
@@ -178,14 +184,51 @@ void Simulator::RegisterCommands() {
       vector<pair<string, bool> >{},
       std::bind(&Simulator::CommandInterrupt, this, _1));
 
+  command_interface_.RegisterCommand(
+      vector<string>{"reverse", "on"},
+      "Enable recording of execution history (enabled by default).",
+      vector<pair<string, bool> >{},
+      std::bind(&Simulator::CommandReverseOn, this, _1));
+  command_interface_.RegisterCommand(
+      vector<string>{"reverse", "off"},
+      "Disable recording of execution history and discard it.",
+      vector<pair<string, bool> >{},
+      std::bind(&Simulator::CommandReverseOff, this, _1));
+  command_interface_.RegisterCommand(
+      vector<string>{"reverse", "step"},
+      "Undo up to count instructions (default is 1) using the recorded\n"
+      "execution history. Only registers and memory are restored, device\n"
+      "input and output (RD, WD) is not reverted. History is discarded when\n"
+      "the machine state is changed by hand (reset, load, cpu set, memory\n"
+      "write ...).",
+      vector<pair<string, bool> >{
+        make_pair("count", false),
+      },
+      std::bind(&Simulator::CommandReverseStep, this, _1));
+  command_interface_.RegisterCommand(
+      vector<string>{"reverse", "start"},
+      "Run the machine backwards until a breakpoint or a write to a\n"
+      "watchpoint is encountered (only if breakpoints are enabled) or the\n"
+      "recorded history is exhausted.",
+      vector<pair<string, bool> >{},
+      std::bind(&Simulator::CommandReverseStart, this, _1));
+  command_interface_.RegisterCommand(
+      vector<string>{"reverse", "lastwrite"},
+      "Find the last instruction in the recorded history that wrote to the\n"
+      "specified memory address.",
+      vector<pair<string, bool> >{
+        make_pair("address", true),
+      },
+      std::bind(&Simulator::CommandReverseLastWrite, this, _1));
+
   command_interface_.RegisterCommand(
       vector<string>{"breakpoint", "on"},
-      "Enable breakpoints.",
+      "Enable breakpoints and watchpoints.",
       vector<pair<string, bool> >{},
       std::bind(&Simulator::CommandBreakpointOn, this, _1));
   command_interface_.RegisterCommand(
       vector<string>{"breakpoint", "off"},
-      "Disable breakpoints.",
+      "Disable breakpoints and watchpoints.",
       vector<pair<string, bool> >{},
       std::bind(&Simulator::CommandBreakpointOff, this, _1));
   command_interface_.RegisterCommand(
@@ -200,10 +243,17 @@ void Simulator::RegisterCommands() {
       std::bind(&Simulator::CommandBreakpointPrint, this, _1));
   command_interface_.RegisterCommand(
       vector<string>{"breakpoint", "add"},
-      "Add a breakpoint.",
+      "Add a breakpoint. The machine only stops if the optional condition\n"
+      "holds, for example condition=\"A == 0x10 && mem.w[BUF + 3] > 5\".\n"
+      "Conditions can use registers (A, X, L, B, S, T, PC, CC), constants\n"
+      "LT, EQ and GT, hitcount, watch list variable names (resolved to\n"
+      "their address when the breakpoint is added), memory accesses\n"
+      "mem.b[addr] and mem.w[addr] and C operators (* / % + - < <= > >=\n"
+      "== != && || !). Values are signed words, arithmetic wraps.",
       vector<pair<string, bool> >{
         make_pair("address", true),
         make_pair("name", false),
+        make_pair("condition", false),
       },
       std::bind(&Simulator::CommandBreakpointAdd, this, _1));
   command_interface_.RegisterCommand(
@@ -216,6 +266,38 @@ void Simulator::RegisterCommands() {
       },
       std::bind(&Simulator::CommandBreakpointRemove, this, _1));
 
+  command_interface_.RegisterCommand(
+      vector<string>{"watchpoint", "clear"},
+      "Remove all watchpoints.",
+      vector<pair<string, bool> >{},
+      std::bind(&Simulator::CommandWatchpointClear, this, _1));
+  command_interface_.RegisterCommand(
+      vector<string>{"watchpoint", "print"},
+      "Print list of watchpoints.",
+      vector<pair<string, bool> >{},
+      std::bind(&Simulator::CommandWatchpointPrint, this, _1));
+  command_interface_.RegisterCommand(
+      vector<string>{"watchpoint", "add"},
+      "Add a watchpoint on size bytes at address (default is 1). The\n"
+      "machine stops after an instruction accesses the range. Parameter\n"
+      "'access' should be read, write (default) or rw. Watchpoints are\n"
+      "active only if breakpoints are enabled.",
+      vector<pair<string, bool> >{
+        make_pair("address", true),
+        make_pair("size", false),
+        make_pair("access", false),
+        make_pair("name", false),
+      },
+      std::bind(&Simulator::CommandWatchpointAdd, this, _1));
+  command_interface_.RegisterCommand(
+      vector<string>{"watchpoint", "remove"},
+      "Remove a watchpoint (specify either 'number' or 'name').",
+      vector<pair<string, bool> >{
+        make_pair("number", false),
+        make_pair("name", false),
+      },
+      std::bind(&Simulator::CommandWatchpointRemove, this, _1));
+
   command_interface_.RegisterCommand(
       vector<string>{"watchlist", "print"},
       "Print variable watch list.",
@@ -274,6 +356,7 @@ string Simulator::ConvertToUppercase(const string& str) const {
 
 void Simulator::CommandReset(const CommandInterface::ParsedArgumentMap&) {
   machine_.Reset();
+  undo_log_.Clear();
 }
 
 }  // namespace simulator
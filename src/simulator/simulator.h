@@ -4,11 +4,15 @@
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 #include "common/command_interface.h"
 #include "common/cpu_state.h"
 #include "common/macros.h"
 #include "common/types.h"
 #include "machine/machine.h"
+#include "machine/undo_log.h"
+#include "machine/watch_table.h"
+#include "simulator/condition.h"
 
 namespace sicxe {
 
@@ -32,6 +36,8 @@ class Simulator {
     int number;
     uint32 address;
     std::string name;
+    std::unique_ptr<Condition> condition;  // nullptr if unconditional
+    uint32 hit_count;
 
     std::list<std::unique_ptr<Breakpoint> >::iterator list_iter;
     std::map<int, Breakpoint*>::iterator number_map_iter;
@@ -39,6 +45,18 @@ class Simulator {
     std::map<std::string, Breakpoint*>::iterator name_map_iter;
   };
 
+  struct Watchpoint {
+    int number;
+    uint32 address;
+    uint32 size;
+    int access;  // machine::WatchTable::AccessFlags
+    std::string name;
+
+    std::list<std::unique_ptr<Watchpoint> >::iterator list_iter;
+    std::map<int, Watchpoint*>::iterator number_map_iter;
+    std::map<std::string, Watchpoint*>::iterator name_map_iter;
+  };
+
   struct Variable {
     enum TypeId {
       BYTE = 0,
@@ -66,7 +84,10 @@ class Simulator {
   static const int kDisassembleDefaultCount;
   static const int kDisassembleMaxCount;
   static const int kStepMaxCount;
+  static const int kStartBatchSize;
+  static const int kReverseStepMaxCount;
   static const int kVariableNameMaxLength;
+  static const uint32 kWatchpointMaxSize;
 
   void RegisterCommands();
 
@@ -74,6 +95,15 @@ class Simulator {
   // returns 0 if disassembly failed, otherwise returns parsed instruction length
   int DisassembleInstruction(uint32 address);
   Variable* FindVariable(const CommandInterface::ParsedArgumentMap& arguments);
+  Watchpoint* FindWatchpoint(const CommandInterface::ParsedArgumentMap& arguments);
+  // rebuilds the machine watch table from the list of watchpoints
+  void UpdateWatchTable();
+  void PrintWatchpointHit();
+  // returns the breakpoint at |program_counter| unless it was just hit or
+  // its condition does not hold
+  Breakpoint* CheckBreakpoint(uint32 program_counter);
+  // executes one instruction with the watch hit state reset
+  machine::ExecuteResult::ResultId ExecuteStep();
 
   void CommandReset(const CommandInterface::ParsedArgumentMap& arguments);
 
@@ -103,6 +133,13 @@ class Simulator {
   void CommandStart(const CommandInterface::ParsedArgumentMap& arguments);
   void CommandInterrupt(const CommandInterface::ParsedArgumentMap& arguments);
 
+  // reverse execution commands
+  void CommandReverseOn(const CommandInterface::ParsedArgumentMap& arguments);
+  void CommandReverseOff(const CommandInterface::ParsedArgumentMap& arguments);
+  void CommandReverseStep(const CommandInterface::ParsedArgumentMap& arguments);
+  void CommandReverseStart(const CommandInterface::ParsedArgumentMap& arguments);
+  void CommandReverseLastWrite(const CommandInterface::ParsedArgumentMap& arguments);
+
   // breakpoint commands
   void CommandBreakpointOn(const CommandInterface::ParsedArgumentMap& arguments);
   void CommandBreakpointOff(const CommandInterface::ParsedArgumentMap& arguments);
@@ -111,6 +148,12 @@ class Simulator {
   void CommandBreakpointAdd(const CommandInterface::ParsedArgumentMap& arguments);
   void CommandBreakpointRemove(const CommandInterface::ParsedArgumentMap& arguments);
 
+  // watchpoint commands
+  void CommandWatchpointClear(const CommandInterface::ParsedArgumentMap& arguments);
+  void CommandWatchpointPrint(const CommandInterface::ParsedArgumentMap& arguments);
+  void CommandWatchpointAdd(const CommandInterface::ParsedArgumentMap& arguments);
+  void CommandWatchpointRemove(const CommandInterface::ParsedArgumentMap& arguments);
+
   // variable watchlist commands
   void CommandWatchlistPrint(const CommandInterface::ParsedArgumentMap& arguments);
   void CommandWatchlistClear(const CommandInterface::ParsedArgumentMap& arguments);
@@ -127,14 +170,24 @@ class Simulator {
   CommandInterface command_interface_;
   bool auto_disassemble_;
 
+  bool reverse_enable_;
+  machine::UndoLog undo_log_;
+
   bool breakpoints_enable_;
   std::list<std::unique_ptr<Breakpoint> > breakpoints_;
   std::map<int, Breakpoint*> breakpoint_number_map_;
   std::map<uint32, Breakpoint*> breakpoint_address_map_;
+  std::vector<bool> breakpoint_address_bits_;  // one bit per memory address
   std::map<std::string, Breakpoint*> breakpoint_name_map_;
   int breakpoint_next_number_;
   uint32 breakpoint_last_hit_address_;
 
+  std::list<std::unique_ptr<Watchpoint> > watchpoints_;
+  std::map<int, Watchpoint*> watchpoint_number_map_;
+  std::map<std::string, Watchpoint*> watchpoint_name_map_;
+  int watchpoint_next_number_;
+  machine::WatchTable watch_table_;
+
   std::list<std::unique_ptr<Variable> > variables_;
   std::map<int, Variable*> variable_number_map_;
   std::map<std::string, Variable*> variable_name_map_;
@@ -10,17 +10,39 @@ using std::unique_ptr;
 namespace sicxe {
 namespace simulator {
 
+Simulator::Breakpoint* Simulator::CheckBreakpoint(uint32 program_counter) {
+  if (!breakpoint_address_bits_[program_counter] ||
+      breakpoint_last_hit_address_ == program_counter) {
+    breakpoint_last_hit_address_ = 0xFFFFFF;
+    return nullptr;
+  }
+  Breakpoint* breakpoint = breakpoint_address_map_.find(program_counter)->second;
+  breakpoint->hit_count++;
+  if (breakpoint->condition != nullptr &&
+      !breakpoint->condition->Evaluate(machine_, breakpoint->hit_count)) {
+    breakpoint_last_hit_address_ = 0xFFFFFF;
+    return nullptr;
+  }
+  breakpoint_last_hit_address_ = program_counter;
+  return breakpoint;
+}
+
 void Simulator::CommandBreakpointOn(
     const CommandInterface::ParsedArgumentMap&) {
   breakpoints_enable_ = true;
+  UpdateWatchTable();
 }
 
 void Simulator::CommandBreakpointOff(
     const CommandInterface::ParsedArgumentMap&) {
   breakpoints_enable_ = false;
+  UpdateWatchTable();
 }
 
 void Simulator::CommandBreakpointClear(const CommandInterface::ParsedArgumentMap&) {
+  for (const auto& breakpoint : breakpoints_) {
+    breakpoint_address_bits_[breakpoint->address] = false;
+  }
   breakpoint_number_map_.clear();
   breakpoint_address_map_.clear();
   breakpoint_name_map_.clear();
@@ -43,13 +65,14 @@ void Simulator::CommandBreakpointPrint(const CommandInterface::ParsedArgumentMap
   if (breakpoints_.empty()) {
     return;
   }
-  printf(" %-8s %-12s %-12s\n", "NUMBER", "ADDRESS", "NAME");
+  printf(" %-8s %-12s %-12s %-12s %s\n", "NUMBER", "ADDRESS", "NAME", "HITS",
+         "CONDITION");
   for (const auto& breakpoint : breakpoints_) {
-    printf(" %-8d %06x%-6s ", breakpoint->number, breakpoint->address, "");
-    if (!breakpoint->name.empty()) {
-      printf("%s", breakpoint->name.c_str());
-    } else {
-      printf("[no name]");
+    printf(" %-8d %06x%-6s %-12s %-12u ", breakpoint->number, breakpoint->address, "",
+           breakpoint->name.empty() ? "[no name]" : breakpoint->name.c_str(),
+           breakpoint->hit_count);
+    if (breakpoint->condition != nullptr) {
+      printf("%s", breakpoint->condition->text().c_str());
     }
     printf("\n");
   }
@@ -82,17 +105,40 @@ void Simulator::CommandBreakpointAdd(
     printf("Error: A breakpoint with this name already exists!\n");
     return;
   }
+  unique_ptr<Condition> condition;
+  {
+    auto it = arguments.find("condition");
+    if (it != arguments.end()) {
+      auto resolver = [this](const string& variable_name, uint32* variable_address) {
+        auto variable_it = variable_name_map_.find(variable_name);
+        if (variable_it == variable_name_map_.end()) {
+          return false;
+        }
+        *variable_address = variable_it->second->address;
+        return true;
+      };
+      condition.reset(new Condition);
+      string error;
+      if (!condition->Compile(it->second.value_str, resolver, &error)) {
+        printf("Error: Invalid condition: %s!\n", error.c_str());
+        return;
+      }
+    }
+  }
 
   breakpoints_.emplace_back(unique_ptr<Breakpoint>(new Breakpoint));
   Breakpoint* breakpoint = breakpoints_.back().get();
   breakpoint->number = breakpoint_next_number_++;
   breakpoint->address = address;
   breakpoint->name = name;
+  breakpoint->condition = std::move(condition);
+  breakpoint->hit_count = 0;
   breakpoint->list_iter = --breakpoints_.end();
   breakpoint->number_map_iter =
     breakpoint_number_map_.insert(make_pair(breakpoint->number, breakpoint)).first;
   breakpoint->address_map_iter =
     breakpoint_address_map_.insert(make_pair(breakpoint->address, breakpoint)).first;
+  breakpoint_address_bits_[breakpoint->address] = true;
   if (!name.empty()) {
     breakpoint->name_map_iter =
       breakpoint_name_map_.insert(make_pair(breakpoint->name, breakpoint)).first;
@@ -169,6 +215,7 @@ void Simulator::CommandBreakpointRemove(
 
   breakpoint_number_map_.erase(breakpoint->number_map_iter);
   breakpoint_address_map_.erase(breakpoint->address_map_iter);
+  breakpoint_address_bits_[breakpoint->address] = false;
   if (!breakpoint->name.empty()) {
     breakpoint_name_map_.erase(breakpoint->name_map_iter);
   }
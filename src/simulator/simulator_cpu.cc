@@ -189,6 +189,8 @@ void Simulator::CommandCpuSet(const CommandInterface::ParsedArgumentMap& argumen
           Machine::TrimWord(value_arg.value_word);
     }
   }
+  // manual changes invalidate recorded history
+  undo_log_.Clear();
 }
 
 }  // namespace simulator
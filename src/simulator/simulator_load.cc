@@ -36,6 +36,7 @@ void Simulator::CommandLoad(const CommandInterface::ParsedArgumentMap& arguments
   if (it == arguments.end()) {
     // load object file
     machine_.Reset();
+    undo_log_.Clear();
     if (!MachineLoader::LoadObjectFile(object_file, &machine_)) {
       printf("Error: Failed to load object file!\n");
       return;
@@ -59,6 +60,7 @@ void Simulator::CommandLoad(const CommandInterface::ParsedArgumentMap& arguments
     }
     // load relocated object file
     machine_.Reset();
+    undo_log_.Clear();
     if (!MachineLoader::LoadObjectFile(relocated_file, &machine_)) {
       printf("Error: Failed to load object file!\n");
       return;
@@ -40,6 +40,7 @@ void Simulator::CommandMemoryWriteByte(
     value = value_arg.value_word & 0xFF;
   }
   machine_.WriteMemoryByte(address, value);
+  undo_log_.Clear();
 }
 
 void Simulator::CommandMemoryWriteWord(
@@ -57,6 +58,7 @@ void Simulator::CommandMemoryWriteWord(
   uint32 address = address_arg.value_word & 0x0FFFFF;
   uint32 value = value_arg.value_word;
   machine_.WriteMemoryWord(address, value);
+  undo_log_.Clear();
 }
 
 void Simulator::CommandMemoryWriteFloat(
@@ -78,6 +80,7 @@ void Simulator::CommandMemoryWriteFloat(
   uint8 float_data[6];
   FloatUtil::EncodeFloatData(value, float_data);
   machine_.WriteMemoryFloat(address, float_data);
+  undo_log_.Clear();
 }
 
 void Simulator::CommandMemoryWriteAscii(
@@ -108,6 +111,7 @@ void Simulator::CommandMemoryWriteAscii(
     machine_.WriteMemory(address, value_arg.value_str.size(),
         reinterpret_cast<const uint8*>(value_arg.value_str.data()));
   }
+  undo_log_.Clear();
 }
 
 void Simulator::CommandMemoryPrintBytes(
@@ -0,0 +1,155 @@
+#include "simulator/simulator.h"
+
+#include <stdio.h>
+#include <string>
+
+using sicxe::machine::Machine;
+using sicxe::machine::WatchTable;
+using std::string;
+
+namespace sicxe {
+namespace simulator {
+
+const int Simulator::kReverseStepMaxCount = 10000;
+
+void Simulator::CommandReverseOn(const CommandInterface::ParsedArgumentMap&) {
+  if (reverse_enable_) {
+    return;
+  }
+  reverse_enable_ = true;
+  undo_log_.Clear();
+  machine_.set_undo_log(&undo_log_);
+}
+
+void Simulator::CommandReverseOff(const CommandInterface::ParsedArgumentMap&) {
+  reverse_enable_ = false;
+  undo_log_.Clear();
+  machine_.set_undo_log(nullptr);
+}
+
+void Simulator::CommandReverseStep(
+    const CommandInterface::ParsedArgumentMap& arguments) {
+  if (!reverse_enable_) {
+    printf("Error: Recording of execution history is disabled!\n");
+    return;
+  }
+  int count = 1;
+  {
+    auto it = arguments.find("count");
+    if (it != arguments.end()) {
+      const CommandInterface::ParsedArgument& count_arg = it->second;
+      if (!count_arg.is_word) {
+        printf("Error: Count must be a number!\n");
+        return;
+      }
+      count = count_arg.value_word;
+    }
+  }
+  if (count > kReverseStepMaxCount) {
+    printf("Error: Count must be less than equal to %d!\n", kReverseStepMaxCount);
+    return;
+  }
+
+  int undone = 0;
+  while (undone < count && undo_log_.UndoStep(&machine_)) {
+    undone++;
+  }
+  // do not stop on a breakpoint at the current address when stepping forward
+  breakpoint_last_hit_address_ = machine_.cpu_state().program_counter;
+
+  if (auto_disassemble_) {
+    DisassembleInstruction(machine_.cpu_state().program_counter);
+  }
+  if (undone < count) {
+    printf(" %06x  %-11s  Beginning of recorded history\n",
+           machine_.cpu_state().program_counter, "");
+  }
+}
+
+void Simulator::CommandReverseStart(const CommandInterface::ParsedArgumentMap&) {
+  if (!reverse_enable_) {
+    printf("Error: Recording of execution history is disabled!\n");
+    return;
+  }
+  uint64 instruction_count = 0;
+  bool cancelled = false;
+  bool breakpoint = false;
+  bool watchpoint = false;
+  string breakpoint_name;
+  command_interface_.StartCancellableAction();
+  while (true) {
+    watch_table_.ResetHit();
+    if (!undo_log_.UndoStep(&machine_)) {
+      break;
+    }
+    instruction_count++;
+    if (command_interface_.ActionIsCancelled()) {
+      cancelled = true;
+      break;
+    }
+    // undoing a step rewrites the memory the instruction has written
+    if (watch_table_.hit() && watch_table_.hit_access() == WatchTable::WRITE) {
+      watchpoint = true;
+      break;
+    }
+    uint32 program_counter = machine_.cpu_state().program_counter;
+    if (breakpoints_enable_ && breakpoint_address_bits_[program_counter]) {
+      const Breakpoint* hit = breakpoint_address_map_.find(program_counter)->second;
+      if (hit->condition == nullptr ||
+          hit->condition->Evaluate(machine_, hit->hit_count)) {
+        breakpoint = true;
+        breakpoint_name = hit->name;
+        break;
+      }
+    }
+  }
+  command_interface_.EndCancellableAction();
+  breakpoint_last_hit_address_ = machine_.cpu_state().program_counter;
+
+  if (cancelled) {
+    printf("\n");
+  }
+  printf(" %06x  %-11s  ", machine_.cpu_state().program_counter, "");
+  if (cancelled) {
+    printf("Stopped by user\n");
+  } else if (breakpoint) {
+    printf("Breakpoint ");
+    if (!breakpoint_name.empty()) {
+      printf("%s", breakpoint_name.c_str());
+    } else {
+      printf("[no name]");
+    }
+    printf("\n");
+  } else if (watchpoint) {
+    PrintWatchpointHit();
+  } else {
+    printf("Beginning of recorded history\n");
+  }
+  printf(" Number of instructions reverted: %llu\n", instruction_count);
+}
+
+void Simulator::CommandReverseLastWrite(
+    const CommandInterface::ParsedArgumentMap& arguments) {
+  const CommandInterface::ParsedArgument& address_arg = arguments.find("address")->second;
+  if (!address_arg.is_word) {
+    printf("Error: Address must be a number!\n");
+    return;
+  }
+  if (!reverse_enable_) {
+    printf("Error: Recording of execution history is disabled!\n");
+    return;
+  }
+  uint32 address = Machine::TrimAddress(address_arg.value_word);
+  size_t steps_ago = 0;
+  uint32 program_counter = 0;
+  if (!undo_log_.FindLastWrite(address, &steps_ago, &program_counter)) {
+    printf("No writes to %06x in the last %zu instructions.\n", address,
+           undo_log_.size());
+    return;
+  }
+  printf(" %06x  %-11s  Written %zu instruction(s) ago\n", program_counter, "",
+         steps_ago);
+}
+
+}  // namespace simulator
+}  // namespace sicxe
@@ -10,6 +10,7 @@ namespace sicxe {
 namespace simulator {
 
 const int Simulator::kStepMaxCount = 10000;
+const int Simulator::kStartBatchSize = 4096;
 
 namespace {
 
@@ -38,42 +39,54 @@ void PrintExecuteResultError(ExecuteResult::ResultId result) {
 
 }  // namespace
 
+ExecuteResult::ResultId Simulator::ExecuteStep() {
+  watch_table_.ResetHit();
+  // a failed instruction is left as it is, with or without history, and
+  // can be undone like any other step
+  return machine_.Execute();
+}
+
 void Simulator::CommandStart(const CommandInterface::ParsedArgumentMap&) {
   uint64 instruction_count = 0;
   bool instruction_count_overflow = false;
   bool cancelled = false;
   bool breakpoint = false;
+  bool watchpoint = false;
+  bool stopped = false;
   string breakpoint_name;
   ExecuteResult::ResultId result = ExecuteResult::OK;
   command_interface_.StartCancellableAction();
-  while (true) {
+  while (!stopped) {
     if (command_interface_.ActionIsCancelled()) {
       cancelled = true;
       break;
     }
 
-    if (breakpoints_enable_) {
-      uint32 program_counter = machine_.cpu_state().program_counter;
-      auto it = breakpoint_address_map_.find(program_counter);
-      bool ignore = false;
-      if (breakpoint_last_hit_address_ == program_counter) {
-        ignore = true;
+    // cancellation is only checked between batches of instructions
+    for (int i = 0; i < kStartBatchSize; i++) {
+      if (breakpoints_enable_) {
+        Breakpoint* hit = CheckBreakpoint(machine_.cpu_state().program_counter);
+        if (hit != nullptr) {
+          breakpoint = true;
+          breakpoint_name = hit->name;
+          stopped = true;
+          break;
+        }
       }
-      breakpoint_last_hit_address_ = 0xFFFFFF;
-      if (!ignore && it != breakpoint_address_map_.end()) {
-        breakpoint = true;
-        breakpoint_name = it->second->name;
-        breakpoint_last_hit_address_ = program_counter;
+
+      if ((result = ExecuteStep()) != ExecuteResult::OK) {
+        stopped = true;
+        break;
+      }
+      instruction_count++;
+      if (instruction_count == 0) {
+        instruction_count_overflow = true;
+      }
+      if (watch_table_.hit()) {
+        watchpoint = true;
+        stopped = true;
         break;
       }
-    }
-
-    if ((result = machine_.Execute()) != ExecuteResult::OK) {
-      break;
-    }
-    instruction_count++;
-    if (instruction_count == 0) {
-      instruction_count_overflow = true;
     }
   }
   command_interface_.EndCancellableAction();
@@ -91,6 +104,8 @@ void Simulator::CommandStart(const CommandInterface::ParsedArgumentMap&) {
       printf("[no name]");
     }
     printf("\n");
+  } else if (watchpoint) {
+    PrintWatchpointHit();
   } else {
     PrintExecuteResultError(result);
   }
@@ -121,21 +136,15 @@ void Simulator::CommandStep(const CommandInterface::ParsedArgumentMap& arguments
   }
 
   bool breakpoint = false;
+  bool watchpoint = false;
   string breakpoint_name;
   ExecuteResult::ResultId result = ExecuteResult::OK;
   for (int i = 0; i < count; i++) {
     if (breakpoints_enable_) {
-      uint32 program_counter = machine_.cpu_state().program_counter;
-      auto it = breakpoint_address_map_.find(program_counter);
-      bool ignore = false;
-      if (breakpoint_last_hit_address_ == program_counter) {
-        ignore = true;
-      }
-      breakpoint_last_hit_address_ = 0xFFFFFF;
-      if (!ignore && it != breakpoint_address_map_.end()) {
+      Breakpoint* hit = CheckBreakpoint(machine_.cpu_state().program_counter);
+      if (hit != nullptr) {
         breakpoint = true;
-        breakpoint_name = it->second->name;
-        breakpoint_last_hit_address_ = program_counter;
+        breakpoint_name = hit->name;
         break;
       }
     }
@@ -144,12 +153,16 @@ void Simulator::CommandStep(const CommandInterface::ParsedArgumentMap& arguments
       DisassembleInstruction(machine_.cpu_state().program_counter);
     }
 
-    if ((result = machine_.Execute()) != ExecuteResult::OK) {
+    if ((result = ExecuteStep()) != ExecuteResult::OK) {
+      break;
+    }
+    if (watch_table_.hit()) {
+      watchpoint = true;
       break;
     }
   }
 
-  if (breakpoint || result != ExecuteResult::OK) {
+  if (breakpoint || watchpoint || result != ExecuteResult::OK) {
     printf(" %06x  %-11s  ", machine_.cpu_state().program_counter, "");
     if (breakpoint) {
       printf("Breakpoint ");
@@ -159,6 +172,8 @@ void Simulator::CommandStep(const CommandInterface::ParsedArgumentMap& arguments
         printf("[no name]");
       }
       printf("\n");
+    } else if (watchpoint) {
+      PrintWatchpointHit();
     } else {
       PrintExecuteResultError(result);
     }
@@ -241,6 +241,7 @@ void Simulator::CommandWatchlistWrite(
     FloatUtil::EncodeFloatData(value, float_data);
     machine_.WriteMemoryFloat(variable->address, float_data);
   }
+  undo_log_.Clear();
 }
 
 }  // namespace simulator
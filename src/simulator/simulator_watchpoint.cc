@@ -0,0 +1,220 @@
+#include "simulator/simulator.h"
+
+#include <stdio.h>
+#include <memory>
+#include <utility>
+
+using sicxe::machine::Machine;
+using sicxe::machine::WatchTable;
+using std::make_pair;
+using std::string;
+using std::unique_ptr;
+
+namespace sicxe {
+namespace simulator {
+
+const uint32 Simulator::kWatchpointMaxSize = 0x10000;
+
+namespace {
+
+const char* AccessToString(int access) {
+  if (access == (WatchTable::READ | WatchTable::WRITE)) {
+    return "rw";
+  } else if (access == WatchTable::READ) {
+    return "read";
+  }
+  return "write";
+}
+
+}  // namespace
+
+void Simulator::UpdateWatchTable() {
+  watch_table_.Clear();
+  for (const auto& watchpoint : watchpoints_) {
+    watch_table_.Add(watchpoint->number, watchpoint->address, watchpoint->size,
+                     watchpoint->access);
+  }
+  if (breakpoints_enable_ && !watch_table_.empty()) {
+    machine_.set_watch_table(&watch_table_);
+  } else {
+    machine_.set_watch_table(nullptr);
+  }
+}
+
+void Simulator::PrintWatchpointHit() {
+  auto it = watchpoint_number_map_.find(watch_table_.hit_id());
+  printf("Watchpoint ");
+  if (it != watchpoint_number_map_.end() && !it->second->name.empty()) {
+    printf("%s", it->second->name.c_str());
+  } else {
+    printf("[no name]");
+  }
+  printf(" (%s %06x)\n",
+         watch_table_.hit_access() == WatchTable::READ ? "read" : "write",
+         watch_table_.hit_address());
+}
+
+void Simulator::CommandWatchpointClear(const CommandInterface::ParsedArgumentMap&) {
+  watchpoint_number_map_.clear();
+  watchpoint_name_map_.clear();
+  watchpoints_.clear();
+  watchpoint_next_number_ = 0;
+  UpdateWatchTable();
+}
+
+void Simulator::CommandWatchpointPrint(const CommandInterface::ParsedArgumentMap&) {
+  // renumber list
+  if (watchpoint_next_number_ != static_cast<int>(watchpoints_.size())) {
+    watchpoint_next_number_ = 0;
+    watchpoint_number_map_.clear();
+    for (auto& watchpoint : watchpoints_) {
+      watchpoint->number = watchpoint_next_number_++;
+      watchpoint->number_map_iter = watchpoint_number_map_.insert(
+          make_pair(watchpoint->number, watchpoint.get())).first;
+    }
+    UpdateWatchTable();
+  }
+
+  if (watchpoints_.empty()) {
+    return;
+  }
+  printf(" %-8s %-12s %-8s %-8s %-12s\n", "NUMBER", "ADDRESS", "SIZE", "ACCESS",
+         "NAME");
+  for (const auto& watchpoint : watchpoints_) {
+    printf(" %-8d %06x%-6s %-8u %-8s ", watchpoint->number, watchpoint->address, "",
+           watchpoint->size, AccessToString(watchpoint->access));
+    if (!watchpoint->name.empty()) {
+      printf("%s", watchpoint->name.c_str());
+    } else {
+      printf("[no name]");
+    }
+    printf("\n");
+  }
+}
+
+void Simulator::CommandWatchpointAdd(
+    const CommandInterface::ParsedArgumentMap& arguments) {
+  const CommandInterface::ParsedArgument& address_arg = arguments.find("address")->second;
+  if (!address_arg.is_word) {
+    printf("Error: Address must be a number!\n");
+    return;
+  }
+  uint32 address = Machine::TrimAddress(address_arg.value_word);
+  uint32 size = 1;
+  {
+    auto it = arguments.find("size");
+    if (it != arguments.end()) {
+      const CommandInterface::ParsedArgument& size_arg = it->second;
+      if (!size_arg.is_word) {
+        printf("Error: Size must be a number!\n");
+        return;
+      }
+      size = size_arg.value_word;
+    }
+  }
+  if (size == 0 || size > kWatchpointMaxSize) {
+    printf("Error: Size must be between 1 and %u!\n", kWatchpointMaxSize);
+    return;
+  }
+  if (address + size > Machine::kMemorySize) {
+    printf("Error: Watchpoint must not extend past the end of memory!\n");
+    return;
+  }
+  int access = WatchTable::WRITE;
+  {
+    auto it = arguments.find("access");
+    if (it != arguments.end()) {
+      const string& access_str = it->second.value_str;
+      if (access_str == "read") {
+        access = WatchTable::READ;
+      } else if (access_str == "write") {
+        access = WatchTable::WRITE;
+      } else if (access_str == "rw") {
+        access = WatchTable::READ | WatchTable::WRITE;
+      } else {
+        printf("Error: Access must be 'read', 'write' or 'rw'!\n");
+        return;
+      }
+    }
+  }
+  string name;
+  {
+    auto it = arguments.find("name");
+    if (it != arguments.end()) {
+      name = it->second.value_str;
+    }
+  }
+
+  if (!name.empty() &&
+      watchpoint_name_map_.find(name) != watchpoint_name_map_.end()) {
+    printf("Error: A watchpoint with this name already exists!\n");
+    return;
+  }
+
+  watchpoints_.emplace_back(unique_ptr<Watchpoint>(new Watchpoint));
+  Watchpoint* watchpoint = watchpoints_.back().get();
+  watchpoint->number = watchpoint_next_number_++;
+  watchpoint->address = address;
+  watchpoint->size = size;
+  watchpoint->access = access;
+  watchpoint->name = name;
+  watchpoint->list_iter = --watchpoints_.end();
+  watchpoint->number_map_iter =
+    watchpoint_number_map_.insert(make_pair(watchpoint->number, watchpoint)).first;
+  if (!name.empty()) {
+    watchpoint->name_map_iter =
+      watchpoint_name_map_.insert(make_pair(watchpoint->name, watchpoint)).first;
+  }
+  UpdateWatchTable();
+}
+
+Simulator::Watchpoint* Simulator::FindWatchpoint(
+    const CommandInterface::ParsedArgumentMap& arguments) {
+  auto number_it = arguments.find("number");
+  auto name_it = arguments.find("name");
+  if (number_it == arguments.end() && name_it == arguments.end()) {
+    printf("Error: Please specify 'number' or 'name'!\n");
+    return nullptr;
+  }
+  if (number_it != arguments.end() && name_it != arguments.end()) {
+    printf("Error: Please specify only one of 'number' or 'name'!\n");
+    return nullptr;
+  }
+
+  if (number_it != arguments.end()) {
+    if (!number_it->second.is_word) {
+      printf("Error: Argument 'number' must be a number!\n");
+      return nullptr;
+    }
+    auto it = watchpoint_number_map_.find(number_it->second.value_word);
+    if (it == watchpoint_number_map_.end()) {
+      printf("Error: No watchpoint with such number!\n");
+      return nullptr;
+    }
+    return it->second;
+  }
+  auto it = watchpoint_name_map_.find(name_it->second.value_str);
+  if (it == watchpoint_name_map_.end()) {
+    printf("Error: No watchpoint with such name!\n");
+    return nullptr;
+  }
+  return it->second;
+}
+
+void Simulator::CommandWatchpointRemove(
+    const CommandInterface::ParsedArgumentMap& arguments) {
+  Watchpoint* watchpoint = FindWatchpoint(arguments);
+  if (watchpoint == nullptr) {
+    return;
+  }
+
+  watchpoint_number_map_.erase(watchpoint->number_map_iter);
+  if (!watchpoint->name.empty()) {
+    watchpoint_name_map_.erase(watchpoint->name_map_iter);
+  }
+  watchpoints_.erase(watchpoint->list_iter);
+  UpdateWatchTable();
+}
+
+}  // namespace simulator
+}  // namespace sicxe
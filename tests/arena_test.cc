@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "common/arena.h"
+
+using std::string;
+using std::vector;
+
+namespace sicxe {
+namespace tests {
+
+namespace {
+
+struct Tracked {
+  Tracked(int the_id, vector<int>* the_destroyed)
+    : id(the_id), destroyed(the_destroyed) {}
+  ~Tracked() {
+    destroyed->push_back(id);
+  }
+
+  int id;
+  vector<int>* destroyed;
+};
+
+}  // namespace
+
+TEST(ArenaTest, Alignment) {
+  Arena arena;
+  for (int i = 0; i < 100; i++) {
+    arena.New<char>('a');
+    double* value = arena.New<double>(1.5);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(value) % alignof(double));
+    EXPECT_EQ(1.5, *value);
+  }
+}
+
+TEST(ArenaTest, Blocks) {
+  Arena arena;
+  EXPECT_EQ(0u, arena.block_count());
+  for (int i = 0; i < 1000; i++) {
+    arena.Allocate(16, 8);
+  }
+  EXPECT_EQ(1u, arena.block_count());
+  EXPECT_EQ(16000u, arena.allocated_size());
+  // large allocations get their own block
+  char* large = static_cast<char*>(arena.Allocate(Arena::kBlockSize * 2, 1));
+  large[Arena::kBlockSize * 2 - 1] = 0;
+  EXPECT_EQ(2u, arena.block_count());
+  arena.Allocate(16, 8);
+  EXPECT_EQ(2u, arena.block_count());
+}
+
+TEST(ArenaTest, Destructors) {
+  vector<int> destroyed;
+  {
+    Arena arena;
+    arena.New<Tracked>(1, &destroyed);
+    string* str = arena.New<string>(100, 'x');
+    arena.New<Tracked>(2, &destroyed);
+    EXPECT_EQ(100u, str->size());
+    EXPECT_TRUE(destroyed.empty());
+  }
+  ASSERT_EQ(2u, destroyed.size());
+  EXPECT_EQ(2, destroyed[0]);
+  EXPECT_EQ(1, destroyed[1]);
+}
+
+TEST(ArenaTest, Absorb) {
+  vector<int> destroyed;
+  {
+    Arena arena;
+    arena.New<Tracked>(1, &destroyed);
+    {
+      Arena other;
+      other.New<Tracked>(2, &destroyed);
+      other.Allocate(100, 1);
+      arena.Absorb(&other);
+      EXPECT_EQ(0u, other.block_count());
+      EXPECT_EQ(0u, other.allocated_size());
+    }
+    EXPECT_TRUE(destroyed.empty());
+    EXPECT_EQ(2u, arena.block_count());
+    arena.New<Tracked>(3, &destroyed);
+    EXPECT_EQ(2u, arena.block_count());
+  }
+  ASSERT_EQ(3u, destroyed.size());
+  EXPECT_EQ(3, destroyed[0]);
+  EXPECT_EQ(2, destroyed[1]);
+  EXPECT_EQ(1, destroyed[2]);
+}
+
+}  // namespace tests
+}  // namespace sicxe
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include "assembler/base_plan.h"
+#include "assembler/code.h"
+#include "assembler/table_builder.h"
+#include "common/error_db.h"
+#include "common/opcode.h"
+#include "common/text_file.h"
+#include "test_util.h"
+
+using namespace sicxe::assembler;
+
+namespace sicxe {
+namespace tests {
+
+TEST(BasePlannerTest, InsertsBaseLoad) {
+  TableBuilder::Config config;
+  config.base_placement = TableBuilder::Config::INSERT_BASE;
+  TextFile input_file;
+  Code code;
+  ErrorDB error_db;
+  ASSERT_TRUE(TestUtil::BuildTestCode({
+    "prog    START   0",
+    "first   LDA     data1",
+    "        ADD     data2",
+    "        STA     data3",
+    "        LDX     data4",
+    "        J       next",
+    "next    LDA     data5",
+    "        STA     data1",
+    "        RSUB",
+    "        RESB    5000",
+    "data1   WORD    1",
+    "data2   WORD    2",
+    "data3   WORD    3",
+    "data4   WORD    4",
+    "data5   WORD    5",
+    "        END     first",
+  }, config, &input_file, &code, &error_db));
+  ASSERT_EQ(1u, error_db.entries().size());
+  EXPECT_EQ("relaxation: 0 of 7 instructions extended to format 4, 7 bytes saved "
+            "over extending all",
+            error_db.entries().front()->message);
+
+  const BasePlan* plan = code.base_plan();
+  ASSERT_NE(nullptr, plan);
+  EXPECT_TRUE(plan->inserted());
+  ASSERT_EQ(1u, plan->regions().size());
+  EXPECT_EQ(6, plan->regions().front().instruction_count);
+  EXPECT_EQ(4, plan->regions().front().load_size);
+
+  // the label of the region moves to LDB, which is the only format 4 instruction
+  const node::Node* load = code.nodes()[1];
+  ASSERT_TRUE(isa<node::InstructionFS34>(*load));
+  EXPECT_EQ(Opcode::LDB, cast<node::InstructionFS34>(*load).opcode());
+  EXPECT_TRUE(cast<node::InstructionFS34>(*load).extended());
+  ASSERT_NE(nullptr, load->label());
+  EXPECT_EQ("first", load->label()->value().ToString());
+  EXPECT_TRUE(isa<node::DirectiveBase>(*code.nodes()[2]));
+  int extended_count = 0;
+  for (const node::Node* node : code.nodes()) {
+    if (isa<node::InstructionFS34>(*node) && cast<node::InstructionFS34>(*node).extended()) {
+      extended_count++;
+    }
+  }
+  EXPECT_EQ(1, extended_count);
+  EXPECT_TRUE(isa<node::DirectiveNobase>(*code.nodes()[11]));
+  EXPECT_TRUE(TestUtil::GenerateTestCode(code, &error_db));
+}
+
+TEST(BasePlannerTest, KeepsProgramsUsingBase) {
+  TableBuilder::Config config;
+  config.base_placement = TableBuilder::Config::SUGGEST_BASE;
+  TextFile input_file;
+  Code code;
+  ErrorDB error_db;
+  ASSERT_TRUE(TestUtil::BuildTestCode({
+    "prog    START   0",
+    "        +LDA    data1",
+    "        +ADD    data2",
+    "        +STA    data1",
+    "        +LDX    data2",
+    "        +STX    data1",
+    "        CLEAR   B",
+    "        RSUB",
+    "        RESB    5000",
+    "data1   WORD    1",
+    "data2   WORD    2",
+    "        END     prog",
+  }, config, &input_file, &code, &error_db));
+  ASSERT_NE(nullptr, code.base_plan());
+  EXPECT_TRUE(code.base_plan()->register_b_used());
+  EXPECT_TRUE(code.base_plan()->regions().empty());
+}
+
+}  // namespace tests
+}  // namespace sicxe
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "assembler/char_scan_util.h"
+
+using sicxe::assembler::CharScanUtil;
+using std::string;
+
+namespace sicxe {
+namespace tests {
+
+namespace {
+
+const CharScanUtil::ClassId kClasses[] = {
+  CharScanUtil::BLANK, CharScanUtil::NAME, CharScanUtil::DECIMAL,
+  CharScanUtil::HEX, CharScanUtil::PRINTABLE
+};
+
+}  // namespace
+
+TEST(CharScanUtilTest, Classes) {
+  string input = " \tA_z09fG.'\x7f\x80";
+  EXPECT_EQ(2u, CharScanUtil::SkipRun(CharScanUtil::BLANK, input.data(), 0, input.size()));
+  EXPECT_EQ(9u, CharScanUtil::SkipRun(CharScanUtil::NAME, input.data(), 2, input.size()));
+  EXPECT_EQ(7u, CharScanUtil::SkipRun(CharScanUtil::DECIMAL, input.data(), 5, input.size()));
+  EXPECT_EQ(8u, CharScanUtil::SkipRun(CharScanUtil::HEX, input.data(), 5, input.size()));
+  EXPECT_EQ(11u, CharScanUtil::SkipRun(CharScanUtil::PRINTABLE, input.data(), 2,
+                                       input.size()));
+  EXPECT_EQ(3u, CharScanUtil::SkipRun(CharScanUtil::NAME, input.data(), 3, 3));
+}
+
+// Every byte value is placed after runs of all lengths up to 80, so that it
+// falls in every position of the vector blocks and the scalar tail.
+TEST(CharScanUtilTest, MatchesScalar) {
+  const char kRunCharacters[] = " 9a";
+  for (auto class_id : kClasses) {
+    for (const char* run_char = kRunCharacters; *run_char != '\0'; run_char++) {
+      for (size_t length = 0; length < 80; length++) {
+        for (int c = 0; c < 256; c++) {
+          string input(length, *run_char);
+          input.push_back(static_cast<char>(c));
+          input.append(40, *run_char);
+          for (size_t end = length; end <= input.size(); end += 13) {
+            EXPECT_EQ(CharScanUtil::SkipRunScalar(class_id, input.data(), 0, end),
+                      CharScanUtil::SkipRun(class_id, input.data(), 0, end));
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace tests
+}  // namespace sicxe
@@ -82,7 +82,7 @@ class TestOutputWriter : public CodeOutputWriter {
 
  private:
   void WriteLine() {
-    text_file_->mutable_lines()->emplace_back(std::move(line_));
+    text_file_->AppendLine(line_);
     line_ = string();
   }
 
@@ -134,7 +134,8 @@ TEST_P(CodeGeneratorTest, GenerateCode) {
   ASSERT_TRUE(TestUtil::LoadTestTextFile(buffer, &input_file_));
   Parser p(&config_);
   ASSERT_TRUE(p.ParseFile(input_file_, &code_, &error_db_));
-  TableBuilder tb;
+  TableBuilder::Config tb_config;
+  TableBuilder tb(&tb_config);
   ASSERT_TRUE(tb.BuildTables(&code_, &error_db_));
   CodeGenerator::OutputWriterVector writers;
   LogFileWriter log_writer(InstructionDB::Default(), &log_file_);
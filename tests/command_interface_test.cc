@@ -51,5 +51,21 @@ TEST_F(CommandInterfaceTest, Parser) {
   TestParse("test foo=\"a b c d e\" \"bar\"=\"test\"", "test", "bar:test|foo:a b c d e");
 }
 
+TEST_F(CommandInterfaceTest, ParseWord) {
+  uint32 value = 0;
+  EXPECT_TRUE(CommandInterface::ParseWord("0xFFFFFF", &value));
+  EXPECT_EQ(0xFFFFFFu, value);
+  EXPECT_TRUE(CommandInterface::ParseWord("16777215", &value));
+  EXPECT_EQ(0xFFFFFFu, value);
+  EXPECT_TRUE(CommandInterface::ParseWord("-8388608", &value));
+  EXPECT_EQ(0x800000u, value);
+  EXPECT_FALSE(CommandInterface::ParseWord("0x1000000", &value));
+  EXPECT_FALSE(CommandInterface::ParseWord("16777216", &value));
+  EXPECT_FALSE(CommandInterface::ParseWord("-8388609", &value));
+  EXPECT_FALSE(CommandInterface::ParseWord("99999999999999999999", &value));
+  EXPECT_FALSE(CommandInterface::ParseWord("0x", &value));
+  EXPECT_FALSE(CommandInterface::ParseWord("12ab", &value));
+}
+
 }  // namespace tests
 }  // namespace sicxe
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "machine/machine.h"
+#include "simulator/condition.h"
+
+using sicxe::machine::Machine;
+using std::string;
+
+namespace sicxe {
+namespace tests {
+
+namespace {
+
+bool ResolveName(const string& name, uint32* address) {
+  if (name == "BUF") {
+    *address = 0x100;
+    return true;
+  }
+  return false;
+}
+
+// Compiles |text| and evaluates it on |machine|, fails the test on errors.
+bool Evaluate(const Machine& machine, const string& text, uint32 hit_count = 0) {
+  simulator::Condition condition;
+  string error;
+  EXPECT_TRUE(condition.Compile(text, ResolveName, &error)) << text << ": " << error;
+  return condition.Evaluate(machine, hit_count);
+}
+
+// Returns the compile error for |text|, empty if it compiles.
+string CompileError(const string& text) {
+  simulator::Condition condition;
+  string error;
+  if (condition.Compile(text, ResolveName, &error)) {
+    return string();
+  }
+  return error;
+}
+
+}  // namespace
+
+TEST(ConditionTest, Precedence) {
+  Machine machine;
+  EXPECT_TRUE(Evaluate(machine, "1 + 2 * 3 == 7"));
+  EXPECT_TRUE(Evaluate(machine, "(1 + 2) * 3 == 9"));
+  EXPECT_TRUE(Evaluate(machine, "10 - 4 - 3 == 3"));
+  EXPECT_TRUE(Evaluate(machine, "12 / 2 / 3 == 2"));
+  EXPECT_TRUE(Evaluate(machine, "-2 * -3 == 6"));
+  EXPECT_TRUE(Evaluate(machine, "1 < 2 == 1"));
+  EXPECT_TRUE(Evaluate(machine, "0 && 0 || 1"));
+  EXPECT_FALSE(Evaluate(machine, "0 && (0 || 1)"));
+  EXPECT_TRUE(Evaluate(machine, "!0 + 1 == 2"));
+  EXPECT_TRUE(Evaluate(machine, "7 % 3 + 1 == 2"));
+}
+
+TEST(ConditionTest, Operands) {
+  Machine machine;
+  machine.mutable_cpu_state()->registers[CpuState::REG_A] = 0xFFFFFF;
+  machine.mutable_cpu_state()->program_counter = 0x30;
+  machine.mutable_cpu_state()->condition_code = CpuState::GREATER;
+  machine.WriteMemoryWord(0x103, 0x000105);
+  EXPECT_TRUE(Evaluate(machine, "A == -1"));
+  EXPECT_TRUE(Evaluate(machine, "pc == 0x30 && CC == GT"));
+  EXPECT_TRUE(Evaluate(machine, "mem.w[BUF + 3] == 0x105"));
+  EXPECT_TRUE(Evaluate(machine, "mem.b[BUF + 5] == 5"));
+  EXPECT_TRUE(Evaluate(machine, "hitcount == 3", 3));
+}
+
+TEST(ConditionTest, Arithmetic) {
+  Machine machine;
+  EXPECT_TRUE(Evaluate(machine, "7 / -1 == -7"));
+  EXPECT_TRUE(Evaluate(machine, "7 % -1 == 0"));
+  EXPECT_TRUE(Evaluate(machine, "0x800000 / -1 == 0x800000"));
+  EXPECT_TRUE(Evaluate(machine, "0x800000 % -1 == 0"));
+  EXPECT_TRUE(Evaluate(machine, "-0x800000 == 0x800000"));
+  EXPECT_TRUE(Evaluate(machine, "5 / 0 == 0 && 5 % 0 == 0"));
+  EXPECT_TRUE(Evaluate(machine, "-7 / 2 == -3 && -7 % 2 == -1"));
+  EXPECT_TRUE(Evaluate(machine, "0x7FFFFF + 1 == -0x800000"));
+  EXPECT_TRUE(Evaluate(machine, "0x7FFFFF * 2 == -2"));
+  EXPECT_TRUE(Evaluate(machine, "0xFFFFFF < 0"));
+}
+
+TEST(ConditionTest, StackDepth) {
+  string text = "1";
+  for (int i = 1; i < simulator::Condition::kMaxStackDepth; i++) {
+    text = "1 + (" + text + ")";
+  }
+  EXPECT_EQ("", CompileError(text));
+  EXPECT_EQ("expression is too complex", CompileError("1 + (" + text + ")"));
+  // left associative chains need no extra depth
+  string chain = "1";
+  for (int i = 0; i < 100; i++) {
+    chain += " + 1";
+  }
+  EXPECT_EQ("", CompileError(chain));
+}
+
+TEST(ConditionTest, SyntaxErrors) {
+  EXPECT_EQ("unexpected end of expression", CompileError("1 +"));
+  EXPECT_EQ("expected ')'", CompileError("(1 + 2"));
+  EXPECT_EQ("expected ']'", CompileError("mem.b[1"));
+  EXPECT_EQ("unexpected '2'", CompileError("1 2"));
+  EXPECT_EQ("unexpected ')'", CompileError("1)"));
+  EXPECT_EQ("unexpected character '$'", CompileError("A == $"));
+  EXPECT_EQ("unknown name 'FOO'", CompileError("FOO == 1"));
+  EXPECT_EQ("invalid number '0x1000000'", CompileError("0x1000000"));
+  EXPECT_EQ("invalid number '12ab'", CompileError("12ab"));
+}
+
+}  // namespace tests
+}  // namespace sicxe
@@ -5,6 +5,7 @@
 #include "assembler/symbol_table.h"
 #include "assembler/token.h"
 #include "assembler/tokenizer.h"
+#include "common/arena.h"
 #include "common/error_db.h"
 #include "common/text_file.h"
 #include "test_util.h"
@@ -17,7 +18,7 @@ namespace tests {
 
 class ExpressionUtilTest : public testing::Test {
  protected:
-  ExpressionUtilTest() : result_(0), relative_(false) {
+  ExpressionUtilTest() : symbol_table_(&names_), result_(0), relative_(false) {
     // internal symbols:
     CreateSymbolInternal("a", 21, false, false);
     CreateSymbolInternal("b", 32, false, false);
@@ -84,8 +85,8 @@ class ExpressionUtilTest : public testing::Test {
 
   bool Solve(const string& expression_str, bool allow_external) {
     input_file_.set_file_name("test.txt");
-    input_file_.mutable_lines()->push_back(expression_str);
-    Tokenizer tokenizer;
+    input_file_.AppendLine(expression_str);
+    Tokenizer tokenizer(&arena_, &names_);
     if (!tokenizer.TokenizeLine(input_file_, 0, &expression_, &error_db_)) {
       ADD_FAILURE() << "Can't tokenize expression!";
       return false;
@@ -110,9 +111,11 @@ class ExpressionUtilTest : public testing::Test {
     return rv;
   }
 
+  StringPool names_;
   SymbolTable symbol_table_;
 
   TextFile input_file_;
+  Arena arena_;
   Tokenizer::TokenList expression_;
   ErrorDB error_db_;
   int32 result_;
@@ -243,5 +246,19 @@ TEST_F(ExpressionUtilTest, Solve19Good) {
   ASSERT_TRUE(external_symbols_.empty());
 }
 
+TEST_F(ExpressionUtilTest, CompileEvaluateTwice) {
+  ASSERT_TRUE(Solve("2 * a + f - m", true));
+  ExpressionUtil::Program program;
+  ExpressionUtil::Compile(expression_, &program);
+  ASSERT_EQ(5u, program.operations.size());
+  symbol_table_.FindOrCreateNew("a")->address = 100;
+  external_symbols_.clear();
+  ASSERT_TRUE(ExpressionUtil::Evaluate(program, symbol_table_, true, &result_,
+                                       &relative_, &external_symbols_, &error_db_));
+  ASSERT_FALSE(relative_);
+  ASSERT_EQ(200, result_);
+  ASSERT_EQ("+f-m", ExternalSymStr());
+}
+
 }  // namespace tests
 }  // namespace sicxe
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "fuzzer/mutator.h"
+#include "machine/coverage_map.h"
+#include "machine/machine.h"
+
+using sicxe::fuzzer::Mutator;
+using sicxe::machine::CoverageMap;
+using sicxe::machine::Machine;
+using std::vector;
+
+namespace sicxe {
+namespace tests {
+
+namespace {
+
+uint32 CountCoveredEdges(const CoverageMap& coverage_map) {
+  uint32 count = 0;
+  for (uint32 i = 0; i < CoverageMap::kMapSize; i++) {
+    count += (coverage_map.counters()[i] != 0);
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(CoverageMapTest, RecordJump) {
+  CoverageMap coverage_map;
+  EXPECT_EQ(0u, CountCoveredEdges(coverage_map));
+  coverage_map.RecordJump(0x10, 0x20);
+  coverage_map.RecordJump(0x10, 0x20);
+  coverage_map.RecordJump(0x20, 0x10);
+  EXPECT_EQ(2u, CountCoveredEdges(coverage_map));
+  coverage_map.Clear();
+  EXPECT_EQ(0u, CountCoveredEdges(coverage_map));
+}
+
+TEST(CoverageMapTest, Machine) {
+  Machine machine;
+  // J 9 at 0 and J 0 at 9, the first edge is taken twice
+  const uint8 kProgram[] = {0x3F, 0x00, 0x09, 0, 0, 0, 0, 0, 0, 0x3F, 0x00, 0x00};
+  machine.WriteMemory(0, sizeof(kProgram), kProgram);
+  CoverageMap coverage_map;
+  machine.set_coverage_map(&coverage_map);
+  for (int i = 0; i < 3; i++) {
+    machine.Execute();
+  }
+  EXPECT_EQ(9u, machine.cpu_state().program_counter);
+  EXPECT_EQ(2u, CountCoveredEdges(coverage_map));
+}
+
+TEST(MutatorTest, Deterministic) {
+  const vector<uint8> other = {'L', 'D', 'A', ' ', '#', '5', '\n'};
+  Mutator first(42, 64);
+  Mutator second(42, 64);
+  vector<uint8> first_data = other;
+  vector<uint8> second_data = other;
+  for (int i = 0; i < 100; i++) {
+    first.Mutate(other, &first_data);
+    second.Mutate(other, &second_data);
+    EXPECT_EQ(first_data, second_data);
+  }
+}
+
+TEST(MutatorTest, Bounds) {
+  const size_t kMaxSize = 32;
+  const vector<uint8> other(20, 'x');
+  Mutator mutator(7, kMaxSize);
+  vector<uint8> data;
+  bool changed = false;
+  for (int i = 0; i < 10000; i++) {
+    vector<uint8> old_data = data;
+    mutator.Mutate((i % 2) ? other : vector<uint8>(), &data);
+    EXPECT_LE(data.size(), kMaxSize);
+    changed = changed || (data != old_data);
+  }
+  EXPECT_TRUE(changed);
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_LT(mutator.Random(5), 5u);
+  }
+  EXPECT_EQ(0u, mutator.Random(1));
+}
+
+}  // namespace tests
+}  // namespace sicxe
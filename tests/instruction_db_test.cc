@@ -20,7 +20,9 @@ class InstructionDBTest : public testing::Test {
                         InstructionDB* instruction_db) {
     TextFile file;
     file.set_file_name("test.txt");
-    *file.mutable_lines() = lines;
+    for (const auto& line : lines) {
+      file.AppendLine(line);
+    }
     ErrorDB error_db;
     InstructionDB temp;
     InstructionDB* db_ptr = instruction_db == nullptr ? &temp : instruction_db;
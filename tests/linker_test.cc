@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <stdio.h>
 #include <algorithm>
 #include <string>
 #include <vector>
@@ -7,7 +8,11 @@
 #include "common/object_file.h"
 #include "common/text_file.h"
 #include "common/types.h"
+#include "linker/archive.h"
+#include "linker/library_search.h"
 #include "linker/linker.h"
+#include "linker/relocation_table.h"
+#include "linker/symbol_table.h"
 #include "test_util.h"
 
 using std::string;
@@ -135,5 +140,211 @@ vector<LinkerTestParams> GetBadInputs() {
 INSTANTIATE_TEST_CASE_P(Good, LinkerTest, ::testing::ValuesIn(GetGoodInputs()));
 INSTANTIATE_TEST_CASE_P(Bad, LinkerTest, ::testing::ValuesIn(GetBadInputs()));
 
+TEST(LinkerSymbolTableTest, SortedIds) {
+  SymbolTable table;
+  table.FindOrCreateNew("main")->type = SymbolTable::DEFINED;
+  StringPool::Id id = table.Intern("buf");
+  table.FindOrCreateNew("alpha");
+  EXPECT_EQ(id, table.Intern("buf"));
+  EXPECT_EQ(3u, table.size());
+  ASSERT_NE(nullptr, table.Find("main"));
+  EXPECT_EQ(SymbolTable::DEFINED, table.Find("main")->type);
+  EXPECT_EQ(nullptr, table.Find("exit"));
+
+  SymbolTable::IdList ids;
+  table.GetSortedIds(&ids);
+  vector<string> names;
+  for (StringPool::Id sorted_id : ids) {
+    names.push_back(table.name(sorted_id).ToString());
+  }
+  EXPECT_EQ((vector<string>{"alpha", "buf", "main"}), names);
+}
+
+TEST(LinkerRelocationTableTest, SortsAndMerges) {
+  RelocationTable table;
+  table.AddRelocationSymbol(0x30, 5, true, 2);
+  table.AddRelocationSimple(0x10, 5);
+  table.AddRelocationSymbol(0x30, 5, false, 1);
+  ASSERT_TRUE(table.Finish());
+  ASSERT_EQ(2u, table.entries().size());
+  EXPECT_EQ(0x10u, table.entries()[0].address);
+  EXPECT_EQ(RelocationTable::SIMPLE, table.entries()[0].type);
+
+  const RelocationTable::Entry* entry = table.FindRelocation(0x30);
+  ASSERT_NE(nullptr, entry);
+  ASSERT_EQ(2u, entry->symbol_count);
+  const RelocationTable::Symbol* symbols = &table.symbols()[entry->first_symbol];
+  EXPECT_TRUE(symbols[0].sign);
+  EXPECT_EQ(2u, symbols[0].id);
+  EXPECT_FALSE(symbols[1].sign);
+  EXPECT_EQ(1u, symbols[1].id);
+  EXPECT_EQ(nullptr, table.FindRelocation(0x20));
+  EXPECT_EQ(table.entries().begin() + 1, table.LowerBound(0x20));
+
+  RelocationTable conflicting;
+  conflicting.AddRelocationSymbol(0x30, 5, true, 0);
+  conflicting.AddRelocationSymbol(0x30, 6, true, 1);
+  EXPECT_FALSE(conflicting.Finish());
+}
+
+TEST(LinkerArchiveTest, PullsNeededMembers) {
+  const char* kArchiveFileName = "testtemp-linker-archive.slib";
+  Archive::MemberVector members;
+  auto add_member = [&members](const char* name, const char* contents,
+                               vector<string> symbols) {
+    members.emplace_back(new Archive::Member);
+    members.back()->name = name;
+    members.back()->contents = contents;
+    members.back()->symbols = symbols;
+  };
+  // b uses c, d is never needed
+  add_member("b.obj", "Hb     000000000004\nDfuncb 000000\nRfuncc \n"
+                      "T0000000400000000\nM00000105+funcc \nE000000\n",
+             {"funcb"});
+  add_member("c.obj", "Hc     000000000003\nDfuncc 000000\nT00000003000000\nE000000\n",
+             {"funcc"});
+  add_member("d.obj", "invalid", {"funcd"});
+  ASSERT_TRUE(Archive::SaveFile(kArchiveFileName, members));
+
+  Archive archive;
+  ASSERT_EQ(ObjectFile::OK, archive.LoadFile(kArchiveFileName));
+  EXPECT_EQ(3u, archive.member_count());
+  EXPECT_EQ("c.obj", archive.member_name(1).ToString());
+  EXPECT_EQ(0, archive.FindSymbol("funcb"));
+  EXPECT_EQ(2, archive.FindSymbol("funcd"));
+  EXPECT_EQ(Archive::kNotFound, archive.FindSymbol("funca"));
+
+  ObjectFile main_file;
+  ASSERT_EQ(ObjectFile::OK,
+            main_file.LoadText("Hmain  000000000004\nRfuncb \nT0000000400000000\n"
+                               "M00000105+funcb \nE000000\n"));
+  Linker::ObjectFileVector files{&main_file};
+  LibrarySearch library_search;
+  ErrorDB error_db;
+  ASSERT_TRUE(library_search.AddMembers({&archive}, &files, &error_db));
+  ASSERT_EQ(3u, files.size());
+  EXPECT_EQ(string(kArchiveFileName) + "(b.obj)", files[1]->file_name());
+  EXPECT_EQ(string(kArchiveFileName) + "(c.obj)", files[2]->file_name());
+
+  Linker::Config config;
+  Linker linker(&config);
+  ObjectFile output_file;
+  EXPECT_TRUE(linker.LinkFiles(false, 0, files, &output_file, &error_db));
+  EXPECT_EQ(11u, output_file.code_size());
+  remove(kArchiveFileName);
+}
+
+TEST(LinkerGcSectionsTest, RemovesUnusedFiles) {
+  ObjectFile files[3];
+  ASSERT_EQ(ObjectFile::OK,
+            files[0].LoadText("Hmain  000000000004\nRfuncc \nT0000000400000000\n"
+                              "M00000105+funcc \nE000000\n"));
+  ASSERT_EQ(ObjectFile::OK,
+            files[1].LoadText("Hb     000000000003\nDfuncb 000000\n"
+                              "T00000003000000\nE000000\n"));
+  ASSERT_EQ(ObjectFile::OK,
+            files[2].LoadText("Hc     000000000005\nDfuncc 000002\n"
+                              "T0000000500000000FF\nE000000\n"));
+  Linker::ObjectFileVector input{&files[0], &files[1], &files[2]};
+
+  Linker::Config config;
+  config.gc_sections = true;
+  Linker linker(&config);
+  ObjectFile output_file;
+  ErrorDB error_db;
+  ASSERT_TRUE(linker.LinkFiles(false, 0, input, &output_file, &error_db));
+  EXPECT_EQ(9u, output_file.code_size());
+  ASSERT_EQ(2u, output_file.text_sections().size());
+  EXPECT_EQ(4u, output_file.text_sections()[1].address);
+  // funcc moved from 0x9 to 0x6
+  EXPECT_EQ(0x06, output_file.text_sections()[0].data[3]);
+
+  EXPECT_FALSE(linker.LinkFiles(true, 0, input, &output_file, &error_db));
+
+  // an unused duplicate definition is still an error
+  ObjectFile duplicate_file;
+  ASSERT_EQ(ObjectFile::OK,
+            duplicate_file.LoadText("Hd     000000000003\nDfuncc 000000\n"
+                                    "T00000003000000\nE000000\n"));
+  input.push_back(&duplicate_file);
+  ErrorDB duplicate_error_db;
+  EXPECT_FALSE(linker.LinkFiles(false, 0, input, &output_file, &duplicate_error_db));
+  EXPECT_EQ("E;", TestUtil::ErrorDBToStringSimple(duplicate_error_db));
+}
+
+TEST(LinkerRelaxTest, ShortensExtendedInstructions) {
+  ObjectFile files[2];
+  // +JSUB funcb, +LDA DATA, DATA WORD 5
+  ASSERT_EQ(ObjectFile::OK,
+            files[0].LoadText("Hmain  00000000000B\nRfuncb \n"
+                              "T0000000B4B10000003100008000005\n"
+                              "M00000105+funcb \nM00000505\nE000000\n"));
+  files[0].mutable_code_sites()->push_back({0, ObjectFile::EXTENDED_INSTRUCTION});
+  files[0].mutable_code_sites()->push_back({4, ObjectFile::EXTENDED_INSTRUCTION});
+  ASSERT_EQ(ObjectFile::OK,
+            files[1].LoadText("Hb     000000000003\nDfuncb 000000\n"
+                              "T000000034C0000\nE000000\n"));
+  Linker::ObjectFileVector input{&files[0], &files[1]};
+
+  Linker::Config config;
+  config.relax = true;
+  Linker linker(&config);
+  ObjectFile output_file;
+  ErrorDB error_db;
+  ASSERT_TRUE(linker.LinkFiles(false, 0, input, &output_file, &error_db));
+  EXPECT_EQ(12u, output_file.code_size());
+  ASSERT_EQ(2u, output_file.text_sections().size());
+  const uint8 kExpected[] = {0x4B, 0x20, 0x06, 0x03, 0x20, 0x00, 0x00, 0x00, 0x05};
+  ASSERT_EQ(9u, output_file.text_sections()[0].size);
+  EXPECT_TRUE(std::equal(kExpected, kExpected + 9, output_file.text_sections()[0].data));
+  EXPECT_EQ(9u, output_file.text_sections()[1].address);
+  EXPECT_TRUE(output_file.relocation_sections().empty());
+}
+
+TEST(LinkerRelinkTest, MatchesFullLink) {
+  const char* kMain = "Hmain  000000000004\nRfuncc \nT0000000400000000\n"
+                      "M00000105+funcc \nE000000\n";
+  const char* kOldFiles[] = {"Hb     000000000003\nDfuncb 000000\n"
+                             "T00000003000000\nE000000\n",
+                             "Hc     000000000005\nDfuncc 000002\n"
+                             "T0000000500000000FF\nM00000105\nE000000\n"};
+  // same layout and symbols, other code and relocations
+  const char* kNewFiles[] = {"Hb     000000000003\nDfuncb 000000\n"
+                             "T000000034B0001\nM00000103\nE000000\n",
+                             "Hc     000000000005\nDfuncc 000002\n"
+                             "T00000005000000EEEE\nE000000\n"};
+  for (bool partial_link : {false, true}) {
+    ObjectFile old_files[3];
+    ObjectFile new_files[3];
+    ASSERT_EQ(ObjectFile::OK, old_files[0].LoadText(kMain));
+    ASSERT_EQ(ObjectFile::OK, new_files[0].LoadText(kMain));
+    for (int i = 0; i < 2; i++) {
+      ASSERT_EQ(ObjectFile::OK, old_files[i + 1].LoadText(kOldFiles[i]));
+      ASSERT_EQ(ObjectFile::OK, new_files[i + 1].LoadText(kNewFiles[i]));
+    }
+    Linker::ObjectFileVector old_input{&old_files[0], &old_files[1], &old_files[2]};
+    Linker::ObjectFileVector new_input{&new_files[0], &new_files[1], &new_files[2]};
+
+    Linker::Config config;
+    Linker linker(&config);
+    ObjectFile relinked_file;
+    ErrorDB error_db;
+    ASSERT_TRUE(linker.LinkFiles(partial_link, 0x100, old_input, &relinked_file, &error_db));
+    Linker::FileOutputRangeVector ranges = linker.file_output_ranges();
+    ASSERT_EQ(3u, ranges.size());
+    Linker::ChangedFileVector changed_files{{1, &new_files[1]}, {2, &new_files[2]}};
+    ASSERT_TRUE(linker.RelinkFiles(partial_link, ranges, changed_files, &relinked_file,
+                                   &error_db));
+
+    ObjectFile linked_file;
+    ASSERT_TRUE(linker.LinkFiles(partial_link, 0x100, new_input, &linked_file, &error_db));
+    vector<uint8> relinked_contents;
+    vector<uint8> linked_contents;
+    relinked_file.SaveBinary(&relinked_contents);
+    linked_file.SaveBinary(&linked_contents);
+    EXPECT_EQ(linked_contents, relinked_contents);
+  }
+}
+
 }  // namespace tests
 }  // namespace sicxe
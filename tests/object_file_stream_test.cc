@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "common/object_file_stream.h"
+
+using std::string;
+
+namespace sicxe {
+namespace tests {
+
+TEST(ObjectFileStreamTest, Records) {
+  ObjectFileStream stream;
+  stream.BeginRecord('H');
+  stream.AppendName("PROG");
+  stream.AppendHex(0x1a, 6);
+  stream.AppendHex(0x1234567, 6);
+  stream.EndRecord();
+  const uint8 data[] = { 0x00, 0x0f, 0xa5, 0xff };
+  stream.BeginRecord('T');
+  stream.AppendHexBytes(data, sizeof(data));
+  stream.AppendName("TOOLONGNAME");
+  stream.EndRecord();
+  EXPECT_EQ("HPROG  00001A1234567\nT000FA5FFTOOLON\n", stream.contents().ToString());
+
+  ObjectFileStream other;
+  other.BeginRecord('E');
+  other.AppendHex(0, 6);
+  other.EndRecord();
+  stream.AppendStream(other);
+  EXPECT_EQ("HPROG  00001A1234567\nT000FA5FFTOOLON\nE000000\n",
+            stream.contents().ToString());
+}
+
+TEST(ObjectFileStreamTest, Grow) {
+  ObjectFileStream stream;
+  string expected;
+  for (int i = 0; i < 100000; i++) {
+    uint8 byte = static_cast<uint8>(i);
+    stream.AppendHexBytes(&byte, 1);
+    char buffer[3];
+    snprintf(buffer, sizeof(buffer), "%02X", byte);
+    expected += buffer;
+  }
+  EXPECT_EQ(expected, stream.contents().ToString());
+}
+
+}  // namespace tests
+}  // namespace sicxe
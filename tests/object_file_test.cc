@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string>
+#include "common/object_file.h"
+#include "test_util.h"
+
+using std::string;
+
+namespace sicxe {
+namespace tests {
+
+namespace {
+
+const char* kTempFileName = "testtemp-object-file.obj";
+
+ObjectFile::LoadResult LoadString(const string& contents, ObjectFile* file) {
+  FILE* temp_file = fopen(kTempFileName, "w");
+  fwrite(contents.data(), 1, contents.size(), temp_file);
+  fclose(temp_file);
+  return file->LoadFile(kTempFileName);
+}
+
+}  // namespace
+
+TEST(ObjectFileTest, LoadSave) {
+  const string contents =
+      "Hprog  00100000000A\n"
+      "T00100003A1b2C3\n"
+      "T0010060400000000\n"
+      "Dprog  001000x     001003\n"
+      "Rext1  ext2  \n"
+      "M00100105\n"
+      "M00100705+ext1  \n"
+      "E001000\n";
+  ObjectFile file;
+  ASSERT_EQ(ObjectFile::OK, LoadString(contents, &file));
+  EXPECT_EQ("prog", file.program_name());
+  EXPECT_EQ(0x1000u, file.start_address());
+  EXPECT_EQ(0xau, file.code_size());
+  ASSERT_EQ(2u, file.text_sections().size());
+  const ObjectFile::TextSection& section = file.text_sections()[0];
+  EXPECT_EQ(0x1000u, section.address);
+  ASSERT_EQ(3, section.size);
+  EXPECT_EQ(0xa1, section.data[0]);
+  EXPECT_EQ(0xb2, section.data[1]);
+  EXPECT_EQ(0xc3, section.data[2]);
+  EXPECT_EQ(0x1006u, file.text_sections()[1].address);
+  ASSERT_EQ(1u, file.export_sections().size());
+  EXPECT_EQ(2u, file.export_sections()[0]->symbols.size());
+  ASSERT_EQ(2u, file.relocation_sections().size());
+  EXPECT_EQ("ext1", file.relocation_sections()[1]->symbol_name);
+
+  ASSERT_TRUE(file.SaveFile(kTempFileName));
+  string saved;
+  ASSERT_TRUE(TestUtil::LoadFileToString(kTempFileName, &saved));
+  EXPECT_EQ(
+      "Hprog  00100000000A\n"
+      "T00100003A1B2C3\n"
+      "T0010060400000000\n"
+      "Dprog  001000x     001003\n"
+      "Rext1  ext2  \n"
+      "M00100105\n"
+      "M00100705+ext1  \n"
+      "E001000\n", saved);
+  remove(kTempFileName);
+}
+
+TEST(ObjectFileTest, LoadInvalid) {
+  ObjectFile file;
+  const char* const kInvalid[] = {
+    "",
+    "E001000\n",
+    "Hprog  00100000000A\n",
+    "T00100001AA\nHprog  00100000000A\nE001000\n",
+    "Hprog  00100000000A\nE001000\nT00100001AA\n",
+    "Hprog  00100000000A\nT00100002AA\nE001000\n",
+    "Hprog  00100000000A\nT00100001AG\nE001000\n",
+    "Hprog  00100000000A\nT0010G001AA\nE001000\n",
+    "Hprog  00100000000A\n\nE001000\n",
+    "Hprog  00100000000A\nM00100105*ext1  \nE001000\n",
+    "Hprog  00100000000A\nE001000\nE001000\n",
+  };
+  for (const char* contents : kInvalid) {
+    EXPECT_EQ(ObjectFile::INVALID_FORMAT, LoadString(contents, &file)) << contents;
+  }
+  EXPECT_EQ(ObjectFile::OK, LoadString("Hprog  00100000000A\nE001000", &file));
+  EXPECT_EQ(ObjectFile::OPEN_FAILED, file.LoadFile("testtemp-does-not-exist.obj"));
+  remove(kTempFileName);
+}
+
+TEST(ObjectFileTest, BinaryRoundTrip) {
+  const string contents =
+      "Hprog  00100000000A\n"
+      "T00100003A1B2C3\n"
+      "T0010060400000000\n"
+      "Dprog  001000x     001003\n"
+      "Rext1  ext2  \n"
+      "M00100105\n"
+      "M00100705+ext1  \n"
+      "M00100805-ext2  \n"
+      "E001000\n";
+  const char* kBinaryFileName = "testtemp-object-file.sobj";
+  ObjectFile file;
+  ASSERT_EQ(ObjectFile::OK, LoadString(contents, &file));
+  EXPECT_EQ(ObjectFile::TEXT, file.format());
+  file.mutable_code_sites()->push_back({0x1006, ObjectFile::EXTENDED_INSTRUCTION});
+  ASSERT_TRUE(file.SaveBinaryFile(kBinaryFileName));
+
+  ObjectFile binary_file;
+  ASSERT_EQ(ObjectFile::OK, binary_file.LoadFile(kBinaryFileName));
+  EXPECT_EQ(ObjectFile::BINARY, binary_file.format());
+  EXPECT_EQ("prog", binary_file.program_name());
+  EXPECT_EQ(0x1000u, binary_file.entry_point());
+  ASSERT_EQ(2u, binary_file.text_sections().size());
+  EXPECT_EQ(0xb2, binary_file.text_sections()[0].data[1]);
+  ASSERT_EQ(1u, binary_file.code_sites().size());
+  EXPECT_EQ(0x1006u, binary_file.code_sites()[0].address);
+  EXPECT_EQ(ObjectFile::EXTENDED_INSTRUCTION, binary_file.code_sites()[0].kind);
+  ASSERT_TRUE(binary_file.SaveFile(kTempFileName));
+  string saved;
+  ASSERT_TRUE(TestUtil::LoadFileToString(kTempFileName, &saved));
+  EXPECT_EQ(contents, saved);
+
+  // any changed byte after the header fails the checksum
+  string binary;
+  ASSERT_TRUE(TestUtil::LoadFileToString(kBinaryFileName, &binary));
+  binary[binary.size() - 1] ^= 1;
+  EXPECT_EQ(ObjectFile::INVALID_FORMAT, LoadString(binary, &file));
+  EXPECT_EQ(ObjectFile::INVALID_FORMAT, LoadString(binary.substr(0, 40), &file));
+  remove(kBinaryFileName);
+  remove(kTempFileName);
+}
+
+TEST(ObjectFileTest, SaveOverLoadedFile) {
+  const string contents =
+      "Hprog  000000000003\n"
+      "T00000003A1B2C3\n"
+      "E000000\n";
+  ObjectFile file;
+  ASSERT_EQ(ObjectFile::OK, LoadString(contents, &file));
+  ASSERT_TRUE(file.SaveBinaryFile(kTempFileName));
+  // the binary file keeps its text in the mapping of the file it replaces
+  ASSERT_EQ(ObjectFile::OK, file.LoadFile(kTempFileName));
+  ASSERT_TRUE(file.SaveFile(kTempFileName));
+  string saved;
+  ASSERT_TRUE(TestUtil::LoadFileToString(kTempFileName, &saved));
+  EXPECT_EQ(contents, saved);
+  remove(kTempFileName);
+}
+
+}  // namespace tests
+}  // namespace sicxe
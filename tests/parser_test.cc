@@ -101,5 +101,52 @@ vector<ParserTestParams> GetBadInputs() {
 INSTANTIATE_TEST_CASE_P(Good, ParserTest, ::testing::ValuesIn(GetGoodInputs()));
 INSTANTIATE_TEST_CASE_P(Bad, ParserTest, ::testing::ValuesIn(GetBadInputs()));
 
+// Parsing on several threads must give the same nodes, names and errors.
+TEST(ParserThreadsTest, SameAsSequential) {
+  TextFile input_file;
+  input_file.set_file_name("threads.asm");
+  input_file.AppendLine("prog    START   0");
+  char buffer[100];
+  for (int i = 0; i < 40000; i++) {
+    snprintf(buffer, sizeof(buffer), "lbl%d   LDA     #[lbl%d + %d * 3]", i, i / 2, i);
+    input_file.AppendLine(buffer);
+    if (i % 9999 == 5) {
+      input_file.AppendLine("        STA     x +");
+    }
+  }
+  input_file.AppendLine("        END     prog");
+
+  TextFile outputs[2];
+  for (int i = 0; i < 2; i++) {
+    Parser::Config config;
+    config.instruction_db = InstructionDB::Default();
+    config.thread_count = (i == 0) ? 1 : 4;
+    Code code;
+    ErrorDB error_db;
+    Parser parser(&config);
+    ASSERT_FALSE(parser.ParseFile(input_file, &code, &error_db));
+    EXPECT_EQ(4, error_db.error_count());
+    TestNodeVisitor::DumpCode(code, &outputs[i]);
+    TestUtil::ErrorDBToTextFile(error_db, &outputs[i]);
+    for (StringPool::Id id = 0; id < code.names()->size(); id++) {
+      outputs[i].AppendLine(code.names()->Get(id));
+    }
+    // symbols of compiled expressions refer to the names of the code
+    for (const node::Node* node : code.nodes()) {
+      if (!isa<node::InstructionFS34>(*node)) {
+        continue;
+      }
+      const ExpressionUtil::Program& program =
+          cast<node::InstructionFS34>(*node).compiled_expression();
+      for (const auto& operation : program.operations) {
+        if (operation.opcode == ExpressionUtil::Program::ADD_SYMBOL) {
+          EXPECT_EQ(operation.token->value(), code.names()->Get(operation.operand));
+        }
+      }
+    }
+  }
+  ASSERT_PRED_FORMAT2(TestUtil::FilesEqual, outputs[0], outputs[1]);
+}
+
 }  // namespace tests
 }  // namespace sicxe
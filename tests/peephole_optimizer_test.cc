@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+#include "assembler/code.h"
+#include "assembler/peephole_optimizer.h"
+#include "assembler/peephole_report.h"
+#include "assembler/table_builder.h"
+#include "common/error_db.h"
+#include "common/opcode.h"
+#include "common/text_file.h"
+#include "test_util.h"
+
+using std::vector;
+using namespace sicxe::assembler;
+
+namespace sicxe {
+namespace tests {
+
+TEST(PeepholeOptimizerTest, RewritesSequences) {
+  TableBuilder::Config config;
+  TextFile input_file;
+  Code code;
+  ErrorDB error_db;
+  ASSERT_TRUE(TestUtil::BuildTestCode({
+    "prog    START   0",
+    "first   STA     val",
+    "        LDA     val",
+    "        COMP    #0",
+    "        JEQ     hop",
+    "        COMP    #0",
+    "        CLEAR   S",
+    "        ADDR    A,S",
+    "loop    LDA     val",
+    "        J       loop",
+    "hop     J       done",
+    "done    RSUB",
+    "val     RESW    1",
+    "        END     first",
+  }, config, &input_file, &code, &error_db));
+  PeepholeOptimizer optimizer(&config);
+  ASSERT_TRUE(optimizer.Optimize(&code, &error_db));
+  ASSERT_NE(nullptr, code.peephole_report());
+  EXPECT_EQ(4, code.peephole_report()->rewrite_count());
+
+  // the labeled load after the RMO stays
+  vector<uint8> opcodes;
+  for (const node::Node* node : code.nodes()) {
+    if (isa<node::Instruction>(*node)) {
+      opcodes.push_back(cast<node::Instruction>(*node).opcode());
+    }
+  }
+  EXPECT_EQ((vector<uint8>{Opcode::STA, Opcode::COMP, Opcode::JEQ, Opcode::RMO,
+                           Opcode::LDA, Opcode::J, Opcode::J, Opcode::RSUB}),
+            opcodes);
+  const node::InstructionFS34& jump = cast<node::InstructionFS34>(*code.nodes()[3]);
+  ASSERT_EQ(1u, jump.expression().size());
+  EXPECT_EQ("done", jump.expression().front()->value().ToString());
+  EXPECT_TRUE(TestUtil::GenerateTestCode(code, &error_db));
+}
+
+TEST(PeepholeOptimizerTest, KeepsCompareAfterTix) {
+  TableBuilder::Config config;
+  TextFile input_file;
+  Code code;
+  ErrorDB error_db;
+  ASSERT_TRUE(TestUtil::BuildTestCode({
+    "prog    START   0",
+    "first   COMP    #3",
+    "        TIX     val",
+    "        COMP    #3",
+    "        JLT     first",
+    "        TIXR    S",
+    "        COMP    #3",
+    "        RSUB",
+    "val     RESW    1",
+    "        END     first",
+  }, config, &input_file, &code, &error_db));
+  PeepholeOptimizer optimizer(&config);
+  ASSERT_TRUE(optimizer.Optimize(&code, &error_db));
+  ASSERT_NE(nullptr, code.peephole_report());
+  EXPECT_EQ(0, code.peephole_report()->rewrite_count());
+}
+
+}  // namespace tests
+}  // namespace sicxe
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "common/string_pool.h"
+
+using std::string;
+using std::vector;
+
+namespace sicxe {
+namespace tests {
+
+TEST(StringPoolTest, Intern) {
+  StringPool pool;
+  EXPECT_EQ(0u, pool.Intern("LDA"));
+  EXPECT_EQ(1u, pool.Intern("lda"));
+  EXPECT_EQ(2u, pool.Intern(""));
+  EXPECT_EQ(0u, pool.Intern(string("LDA")));
+  EXPECT_EQ(3u, pool.size());
+  EXPECT_EQ("lda", pool.Get(1).ToString());
+  EXPECT_EQ(1u, pool.Find("lda"));
+  EXPECT_EQ(StringPool::kInvalidId, pool.Find("STA"));
+}
+
+TEST(StringPoolTest, Grow) {
+  StringPool pool;
+  vector<string> names;
+  for (int i = 0; i < 10000; i++) {
+    names.push_back("sym" + std::to_string(i));
+    EXPECT_EQ(static_cast<StringPool::Id>(i), pool.Intern(names.back()));
+  }
+  for (int i = 0; i < 10000; i++) {
+    EXPECT_EQ(static_cast<StringPool::Id>(i), pool.Find(names[i]));
+    EXPECT_EQ(names[i], pool.Get(i).ToString());
+  }
+}
+
+}  // namespace tests
+}  // namespace sicxe
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include "assembler/code.h"
+#include "assembler/literal_table.h"
 #include "assembler/parser.h"
 #include "assembler/table_builder.h"
 #include "common/error_db.h"
@@ -55,7 +56,8 @@ TEST_P(TableBuilderTest, BuildTables) {
   ASSERT_TRUE(TestUtil::LoadTestTextFile(buffer, &input_file_));
   Parser p(&config_);
   ASSERT_TRUE(p.ParseFile(input_file_, &code_, &error_db_));
-  TableBuilder table_builder;
+  TableBuilder::Config table_builder_config;
+  TableBuilder table_builder(&table_builder_config);
   if (params.success) {
     ASSERT_TRUE(table_builder.BuildTables(&code_, &error_db_));
     snprintf(buffer, sizeof(buffer), "tbuilder-out-%d-good.txt", params.input_number);
@@ -87,5 +89,82 @@ INSTANTIATE_TEST_CASE_P(Good, TableBuilderTest,
 INSTANTIATE_TEST_CASE_P(Bad, TableBuilderTest,
                         ::testing::ValuesIn(GetInputs(1, 29, false)));
 
+TEST(TableBuilderRelaxTest, ExtendsOnlyUnaddressable) {
+  TableBuilder::Config config;
+  config.relax = true;
+  TextFile input_file;
+  Code code;
+  ErrorDB error_db;
+  ASSERT_TRUE(TestUtil::BuildTestCode({
+    "prog    START   0",
+    "        EXTREF  ext",
+    "        LDA     near",
+    "        LDA     far",
+    "        LDA     #5000",
+    "        +JSUB   ext",
+    "        JSUB    ext",
+    "        RSUB",
+    "near    WORD    1",
+    "        RESB    5000",
+    "far     WORD    2",
+    "        END     prog",
+  }, config, &input_file, &code, &error_db));
+  ASSERT_EQ(1u, error_db.entries().size());
+  EXPECT_EQ("relaxation: 3 of 4 instructions extended to format 4, 1 byte saved "
+            "over extending all",
+            error_db.entries().front()->message);
+
+  vector<bool> extended;
+  for (const node::Node* node : code.nodes()) {
+    if (isa<node::InstructionFS34>(*node)) {
+      extended.push_back(cast<node::InstructionFS34>(*node).extended());
+    }
+  }
+  EXPECT_EQ((vector<bool>{false, true, true, true, true, false}), extended);
+  EXPECT_TRUE(TestUtil::GenerateTestCode(code, &error_db));
+}
+
+TEST(TableBuilderLiteralTest, PlacesPoolsNearUses) {
+  TableBuilder::Config config;
+  config.relax = true;
+  config.place_literals = true;
+  TextFile input_file;
+  Code code;
+  ErrorDB error_db;
+  ASSERT_TRUE(TestUtil::BuildTestCode({
+    "prog    START   0",
+    "first   LDA     =5",
+    "        ADD     =7",
+    "        J       mid",
+    "        RESB    3000",
+    "mid     LDA     =5",
+    "        SUB     =9",
+    "        RSUB",
+    "        RESB    1000",
+    "        LDA     =5",
+    "        RSUB",
+    "        END     first",
+  }, config, &input_file, &code, &error_db));
+  EXPECT_EQ(4u, code.literal_table()->entries().size());
+
+  // pools follow J and RSUB, the last =5 reuses the copy of the second pool
+  vector<int> literal_ids;
+  vector<bool> extended;
+  for (const node::Node* node : code.nodes()) {
+    if (isa<node::DirectiveInternalLiteral>(*node)) {
+      literal_ids.push_back(cast<node::DirectiveInternalLiteral>(*node).literal_id());
+    } else if (isa<node::InstructionFS34>(*node)) {
+      const node::InstructionFS34& instruction = cast<node::InstructionFS34>(*node);
+      extended.push_back(instruction.extended());
+      if (instruction.addressing() == node::InstructionFS34::LITERAL_POOL) {
+        literal_ids.push_back(instruction.literal_id());
+      }
+    }
+  }
+  EXPECT_EQ((vector<int>{0, 1, 0, 1, 2, 3, 2, 3, 2}), literal_ids);
+  EXPECT_EQ((vector<bool>(8, false)), extended);
+  EXPECT_TRUE(TestUtil::GenerateTestCode(code, &error_db));
+}
+
 }  // namespace tests
 }  // namespace sicxe
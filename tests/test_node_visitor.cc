@@ -21,11 +21,11 @@ void TestNodeVisitor::DumpCodeAndTables(const assembler::Code& code, TextFile* t
   text_file->set_file_name("code_dump.txt");
   TestNodeVisitor c;
   c.DumpCodeInternal(code, text_file);
-  text_file->mutable_lines()->emplace_back("********");
+  text_file->AppendLine("********");
   code.block_table()->OutputToTextFile(text_file);
-  text_file->mutable_lines()->emplace_back("********");
+  text_file->AppendLine("********");
   code.literal_table()->OutputToTextFile(text_file);
-  text_file->mutable_lines()->emplace_back("********");
+  text_file->AppendLine("********");
   code.symbol_table()->OutputToTextFile(code.block_table(), text_file);
 }
 
@@ -43,7 +43,7 @@ string IntToString(int a) {
 }  // namespace
 
 void TestNodeVisitor::DumpCodeInternal(const assembler::Code& code, TextFile* text_file) {
-  text_file->mutable_lines()->emplace_back(
+  text_file->AppendLine(
       "File '" + code.text_file()->file_name() + "' code dump:");
   line_ = "program_name='";
   line_ += code.program_name();
@@ -53,12 +53,12 @@ void TestNodeVisitor::DumpCodeInternal(const assembler::Code& code, TextFile* te
   line_ += IntToString(code.end_address());
   line_ += " entry_point=";
   line_ += IntToString(code.entry_point());
-  text_file->mutable_lines()->emplace_back(std::move(line_));
+  text_file->AppendLine(line_);
   line_ = string();
-  text_file->mutable_lines()->emplace_back("********");
+  text_file->AppendLine("********");
   for (const auto& node : code.nodes()) {
     node->AcceptVisitor(this);
-    text_file->mutable_lines()->emplace_back(std::move(line_));
+    text_file->AppendLine(line_);
     line_ = string();
   }
 }
@@ -109,7 +109,7 @@ void TestNodeVisitor::VisitNode(const node::InstructionFS34* node) {
   }
   if (node->data_token() != nullptr) {
     line_ += " data_token=";
-    line_ += node->data_token()->value();
+    line_ += node->data_token()->value().ToString();
   } else {
     OutputExpression(node->expression());
   }
@@ -152,7 +152,7 @@ void TestNodeVisitor::VisitNode(const node::DirectiveUse* node) {
   line_ += IntToString(node->block_id());
   if (node->block_name() != nullptr) {
     line_ += " block_name=";
-    line_ += node->block_name()->value();
+    line_ += node->block_name()->value().ToString();
   }
 }
 
@@ -191,7 +191,7 @@ void TestNodeVisitor::VisitNode(const node::DirectiveMemInit* node) {
   line_ += (node->width() == node::DirectiveMemInit::WORD) ? "true" : "false";
   if (node->data_token() != nullptr) {
     line_ += " data_token=";
-    line_ += node->data_token()->value();
+    line_ += node->data_token()->value().ToString();
   } else {
     OutputExpression(node->expression());
   }
@@ -223,7 +223,7 @@ void TestNodeVisitor::OutputDirectiveName(const char* name) {
 void TestNodeVisitor::OutputLabel(const assembler::node::Node* node) {
   if (node->label() != nullptr) {
     line_ += " label=";
-    line_ += node->label()->value();
+    line_ += node->label()->value().ToString();
   }
 }
 
@@ -231,7 +231,7 @@ void TestNodeVisitor::OutputExpression(const assembler::node::Node::TokenList& e
   if (!expr.empty()) {
     line_ += " expr=";
     for (const auto& token : expr) {
-      line_ +=  token->value();
+      line_ +=  token->value().ToString();
     }
   }
 }
@@ -246,7 +246,7 @@ void TestNodeVisitor::OutputSymbolList(const assembler::node::Node::TokenList& s
       } else {
         line_ += ",";
       }
-      line_ += token->value();
+      line_ += token->value().ToString();
     }
   }
 }
@@ -267,11 +267,11 @@ void TestNodeVisitor::OutputInstruction(const assembler::node::Instruction* node
       break;
   }
   line_ += "(";
-  line_ += node->mnemonic()->value();
+  line_ += node->mnemonic()->value().ToString();
   line_ += ")";
   if (node->label() != nullptr) {
     line_ += " label=";
-    line_ += node->label()->value();
+    line_ += node->label()->value().ToString();
   }
   line_ += " opcode=";
   line_ += IntToString(node->opcode());
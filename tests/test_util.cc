@@ -2,6 +2,9 @@
 
 #include <memory>
 #include <gtest/gtest.h>
+#include "assembler/code_generator.h"
+#include "assembler/parser.h"
+#include "common/instruction_db.h"
 
 using std::string;
 using std::unique_ptr;
@@ -71,7 +74,7 @@ void TestUtil::ErrorDBToTextFile(const ErrorDB& error_db, TextFile* text_file) {
       snprintf(buffer.get(), 100, "%s[%d:%d:%d] - ", severity_str,
                entry->position.row + 1, entry->position.column + 1, entry->position.size);
     }
-    text_file->mutable_lines()->emplace_back(string(buffer.get()) + entry->message);
+    text_file->AppendLine(string(buffer.get()) + entry->message);
   }
 }
 
@@ -111,6 +114,34 @@ bool TestUtil::LoadTestFileToString(const char* file_name, std::string* contents
   return LoadFileToString(TestDataFileName(file_name).c_str(), contents);
 }
 
+::testing::AssertionResult TestUtil::BuildTestCode(
+    const vector<const char*>& lines, const assembler::TableBuilder::Config& config,
+    TextFile* input_file, assembler::Code* code, ErrorDB* error_db) {
+  input_file->set_file_name("test.asm");
+  for (const char* line : lines) {
+    input_file->AppendLine(line);
+  }
+  assembler::Parser::Config parser_config;
+  parser_config.instruction_db = InstructionDB::Default();
+  assembler::Parser parser(&parser_config);
+  if (!parser.ParseFile(*input_file, code, error_db)) {
+    return ::testing::AssertionFailure() << "parsing failed: "
+                                         << ErrorDBToStringSimple(*error_db);
+  }
+  assembler::TableBuilder table_builder(&config);
+  if (!table_builder.BuildTables(code, error_db)) {
+    return ::testing::AssertionFailure() << "building tables failed: "
+                                         << ErrorDBToStringSimple(*error_db);
+  }
+  return ::testing::AssertionSuccess();
+}
+
+bool TestUtil::GenerateTestCode(const assembler::Code& code, ErrorDB* error_db) {
+  assembler::CodeGenerator::OutputWriterVector no_writers;
+  assembler::CodeGenerator code_generator;
+  return code_generator.GenerateCode(code, &no_writers, error_db);
+}
+
 namespace {
 
 string StripWhitespace(const string& str) {
@@ -131,10 +162,10 @@ string StripWhitespace(const string& str) {
 ::testing::AssertionResult TestUtil::FilesEqual(const char* a_expr, const char* b_expr,
                                                 const TextFile& a, const TextFile& b) {
   bool equals = false;
-  if (a.lines().size() == b.lines().size()) {
+  if (a.line_count() == b.line_count()) {
     equals = true;
-    for (size_t i = 0; i < a.lines().size(); i++) {
-      if (StripWhitespace(a.lines()[i]) != StripWhitespace(b.lines()[i])) {
+    for (size_t i = 0; i < a.line_count(); i++) {
+      if (StripWhitespace(a.line(i).ToString()) != StripWhitespace(b.line(i).ToString())) {
         equals = false;
         break;
       }
@@ -149,14 +180,14 @@ string StripWhitespace(const string& str) {
   result << std::endl;
   result << "Contents of " << a_expr << " ('" << a.file_name() << "'):";
   result << std::endl << "---------------------------------------" << std::endl;
-  for (const auto& line : a.lines()) {
-    result << line << std::endl;
+  for (size_t i = 0; i < a.line_count(); i++) {
+    result << a.line(i).ToString() << std::endl;
   }
   result << "---------------------------------------" << std::endl;
   result << "Contents of " << b_expr << " ('" << b.file_name() << "'):";
   result << std::endl << "---------------------------------------" << std::endl;
-  for (const auto& line : b.lines()) {
-    result << line << std::endl;
+  for (size_t i = 0; i < b.line_count(); i++) {
+    result << b.line(i).ToString() << std::endl;
   }
   result << "---------------------------------------";
   return result;
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <gtest/gtest.h>
+#include "assembler/code.h"
+#include "assembler/table_builder.h"
 #include "common/error_db.h"
 #include "common/macros.h"
 #include "common/text_file.h"
@@ -27,6 +29,14 @@ class TestUtil {
   static bool LoadFileToString(const char* file_name, std::string* contents);
   static bool LoadTestFileToString(const char* file_name, std::string* contents);
 
+  // Parses the source |lines| into |code| and builds its tables with
+  // |config|. |input_file| keeps the lines, it must outlive |code|.
+  static ::testing::AssertionResult BuildTestCode(
+      const std::vector<const char*>& lines, const assembler::TableBuilder::Config& config,
+      TextFile* input_file, assembler::Code* code, ErrorDB* error_db);
+  // Generates the code of |code| without writing it anywhere.
+  static bool GenerateTestCode(const assembler::Code& code, ErrorDB* error_db);
+
   static ::testing::AssertionResult FilesEqual(const char* a_expr, const char* b_expr,
                                                const TextFile& a, const TextFile& b);
 };
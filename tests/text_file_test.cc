@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string>
+#include "common/text_file.h"
+
+using std::string;
+
+namespace sicxe {
+namespace tests {
+
+class TextFileTest : public testing::Test {
+ protected:
+  // Writes |contents| to a temporary file, opens it and returns the lines
+  // joined by '|'.
+  string OpenLines(const string& contents) {
+    char file_name[] = "/tmp/text_file_test_XXXXXX";
+    int fd = mkstemp(file_name);
+    EXPECT_NE(-1, fd);
+    FILE* fp = fdopen(fd, "w");
+    fwrite(contents.data(), 1, contents.size(), fp);
+    fclose(fp);
+    TextFile file;
+    bool success = file.Open(file_name);
+    remove(file_name);
+    EXPECT_TRUE(success);
+    string rv;
+    for (size_t i = 0; i < file.line_count(); i++) {
+      if (i > 0) {
+        rv += "|";
+      }
+      rv += file.line(i).ToString();
+    }
+    return rv;
+  }
+};
+
+TEST_F(TextFileTest, Open) {
+  EXPECT_EQ("", OpenLines(""));
+  EXPECT_EQ("", OpenLines("\n"));
+  EXPECT_EQ("A|B", OpenLines("A\nB"));
+  EXPECT_EQ("A|B", OpenLines("A\nB\n"));
+  EXPECT_EQ("A||B|", OpenLines("A\n\nB\n\n"));
+  EXPECT_EQ("A|B", OpenLines("A\r\nB\r\n"));
+  EXPECT_EQ("AB", OpenLines("A\rB"));
+  string long_line(200000, 'x');
+  EXPECT_EQ(long_line + "|y", OpenLines(long_line + "\ny"));
+}
+
+TEST_F(TextFileTest, AppendLine) {
+  TextFile file;
+  EXPECT_EQ(0u, file.line_count());
+  file.AppendLine("first");
+  file.AppendLine("");
+  file.AppendLine(string("third"));
+  ASSERT_EQ(3u, file.line_count());
+  EXPECT_EQ("first", file.line(0).ToString());
+  EXPECT_EQ("", file.line(1).ToString());
+  EXPECT_EQ("third", file.line(2).ToString());
+  file.Clear();
+  EXPECT_EQ(0u, file.line_count());
+}
+
+}  // namespace tests
+}  // namespace sicxe
@@ -1,26 +1,27 @@
 #include <gtest/gtest.h>
 #include <string>
-#include <vector>
 #include "assembler/token.h"
 #include "assembler/tokenizer.h"
+#include "common/arena.h"
 #include "common/error_db.h"
+#include "common/string_pool.h"
 #include "test_util.h"
 
 using sicxe::assembler::Token;
 using sicxe::assembler::Tokenizer;
 using std::string;
-using std::unique_ptr;
-using std::vector;
 
 namespace sicxe {
 namespace tests {
 
 class TokenizerTest : public testing::Test {
  protected:
+  TokenizerTest() : tokenizer_(&arena_, &names_) {}
+
   void InitTextFile(const string& line, TextFile* file) {
     file->set_file_name("test.asm");
-    file->mutable_lines()->clear();
-    file->mutable_lines()->push_back(line);
+    file->Clear();
+    file->AppendLine(line);
   }
 
   void TestSplit(const string& input, const string& expected) {
@@ -40,7 +41,7 @@ class TokenizerTest : public testing::Test {
         } else {
           actual += "|";
         }
-        actual += token->value();
+        actual += token->value().ToString();
       }
       EXPECT_EQ(expected, actual);
     }
@@ -59,6 +60,8 @@ class TokenizerTest : public testing::Test {
     }
   }
 
+  Arena arena_;
+  StringPool names_;
   Tokenizer tokenizer_;
 };
 
@@ -157,11 +160,8 @@ TEST_F(TokenizerTest, OperatorId) {
   InitTextFile(" + -*  / [], =#@", &file);
 
   ErrorDB error_db;
-  Tokenizer::TokenList token_list;
-  ASSERT_TRUE(tokenizer_.TokenizeLine(file, 0, &token_list, &error_db));
-  vector<unique_ptr<Token> > tokens(
-      std::make_move_iterator(token_list.begin()),
-      std::make_move_iterator(token_list.end()));
+  Tokenizer::TokenList tokens;
+  ASSERT_TRUE(tokenizer_.TokenizeLine(file, 0, &tokens, &error_db));
   EXPECT_EQ(Token::OP_ADD, tokens[0]->operator_id());
   EXPECT_EQ(Token::OP_SUB, tokens[1]->operator_id());
   EXPECT_EQ(Token::OP_MUL, tokens[2]->operator_id());
@@ -179,11 +179,8 @@ TEST_F(TokenizerTest, ConvertInt) {
   InitTextFile("  1234 0x1234 0o1234 0b01011101   .test", &file);
 
   ErrorDB error_db;
-  Tokenizer::TokenList token_list;
-  ASSERT_TRUE(tokenizer_.TokenizeLine(file, 0, &token_list, &error_db));
-  vector<unique_ptr<Token> > tokens(
-      std::make_move_iterator(token_list.begin()),
-      std::make_move_iterator(token_list.end()));
+  Tokenizer::TokenList tokens;
+  ASSERT_TRUE(tokenizer_.TokenizeLine(file, 0, &tokens, &error_db));
   EXPECT_EQ(1234u, tokens[0]->integer());
   EXPECT_EQ(0x1234u, tokens[1]->integer());
   EXPECT_EQ(01234u, tokens[2]->integer());
@@ -195,11 +192,8 @@ TEST_F(TokenizerTest, ConvertData) {
   InitTextFile("C'abc\\t \\\\123\\'\\n' X'f12' x'abcd' f'123.0123456e-12'", &file);
 
   ErrorDB error_db;
-  Tokenizer::TokenList token_list;
-  ASSERT_TRUE(tokenizer_.TokenizeLine(file, 0, &token_list, &error_db));
-  vector<unique_ptr<Token> > tokens(
-      std::make_move_iterator(token_list.begin()),
-      std::make_move_iterator(token_list.end()));
+  Tokenizer::TokenList tokens;
+  ASSERT_TRUE(tokenizer_.TokenizeLine(file, 0, &tokens, &error_db));
   EXPECT_EQ("abc\t \\123'\n", tokens[0]->data());
   EXPECT_EQ("\x0f\x12", tokens[1]->data());
   EXPECT_EQ("\xab\xcd", tokens[2]->data());
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "machine/execute_result.h"
+#include "machine/machine.h"
+#include "machine/undo_log.h"
+
+using sicxe::machine::ExecuteResult;
+using sicxe::machine::Machine;
+using sicxe::machine::UndoLog;
+
+namespace sicxe {
+namespace tests {
+
+namespace {
+
+// LDA #5, STA 0x100, LDA #7, STA 0x100
+const uint8 kProgram[] = {
+  0x01, 0x00, 0x05, 0x0F, 0x01, 0x00, 0x01, 0x00, 0x07, 0x0F, 0x01, 0x00
+};
+
+void LoadProgram(Machine* machine) {
+  machine->WriteMemory(0, sizeof(kProgram), kProgram);
+  machine->WriteMemoryWord(0x100, 0xABCDEF);
+}
+
+}  // namespace
+
+TEST(UndoLogTest, RoundTrip) {
+  Machine machine;
+  LoadProgram(&machine);
+  UndoLog undo_log;
+  machine.set_undo_log(&undo_log);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(ExecuteResult::OK, machine.Execute());
+  }
+  EXPECT_EQ(4u, undo_log.size());
+  EXPECT_EQ(7u, machine.ReadMemoryWord(0x100));
+  EXPECT_EQ(12u, machine.cpu_state().program_counter);
+
+  size_t steps_ago = 0;
+  uint32 program_counter = 0;
+  EXPECT_TRUE(undo_log.FindLastWrite(0x102, &steps_ago, &program_counter));
+  EXPECT_EQ(1u, steps_ago);
+  EXPECT_EQ(9u, program_counter);
+  EXPECT_FALSE(undo_log.FindLastWrite(0x103, &steps_ago, &program_counter));
+
+  EXPECT_TRUE(undo_log.UndoStep(&machine));
+  EXPECT_EQ(5u, machine.ReadMemoryWord(0x100));
+  EXPECT_EQ(7u, machine.cpu_state().registers[CpuState::REG_A]);
+  EXPECT_EQ(9u, machine.cpu_state().program_counter);
+  EXPECT_TRUE(undo_log.FindLastWrite(0x100, &steps_ago, &program_counter));
+  EXPECT_EQ(2u, steps_ago);
+  EXPECT_EQ(3u, program_counter);
+
+  while (undo_log.UndoStep(&machine)) {}
+  EXPECT_TRUE(undo_log.empty());
+  EXPECT_EQ(0xABCDEFu, machine.ReadMemoryWord(0x100));
+  EXPECT_EQ(0u, machine.cpu_state().registers[CpuState::REG_A]);
+  EXPECT_EQ(0u, machine.cpu_state().program_counter);
+
+  // replaying after the undo gives the same state again
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(ExecuteResult::OK, machine.Execute());
+  }
+  EXPECT_EQ(7u, machine.ReadMemoryWord(0x100));
+  EXPECT_EQ(4u, undo_log.size());
+}
+
+TEST(UndoLogTest, Limits) {
+  Machine machine;
+  LoadProgram(&machine);
+  UndoLog step_limited(2, 100);
+  machine.set_undo_log(&step_limited);
+  for (int i = 0; i < 4; i++) {
+    machine.Execute();
+  }
+  EXPECT_EQ(2u, step_limited.size());
+  while (step_limited.UndoStep(&machine)) {}
+  EXPECT_EQ(6u, machine.cpu_state().program_counter);
+  EXPECT_EQ(5u, machine.ReadMemoryWord(0x100));
+
+  machine.Reset();
+  LoadProgram(&machine);
+  // the second store exceeds the write limit, so the steps up to the first
+  // store are discarded
+  UndoLog write_limited(100, 4);
+  machine.set_undo_log(&write_limited);
+  for (int i = 0; i < 4; i++) {
+    machine.Execute();
+  }
+  EXPECT_EQ(2u, write_limited.size());
+  while (write_limited.UndoStep(&machine)) {}
+  EXPECT_EQ(6u, machine.cpu_state().program_counter);
+  EXPECT_EQ(5u, machine.ReadMemoryWord(0x100));
+}
+
+}  // namespace tests
+}  // namespace sicxe
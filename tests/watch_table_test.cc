@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "machine/machine.h"
+#include "machine/watch_table.h"
+
+using sicxe::machine::Machine;
+using sicxe::machine::WatchTable;
+
+namespace sicxe {
+namespace tests {
+
+TEST(WatchTableTest, PageBoundary) {
+  const uint32 kPageSize = 1 << WatchTable::kPageBits;
+  WatchTable watch_table;
+  EXPECT_TRUE(watch_table.empty());
+  watch_table.Add(1, kPageSize - 2, 4, WatchTable::WRITE);
+  EXPECT_FALSE(watch_table.empty());
+
+  watch_table.CheckWrite(kPageSize - 3);
+  watch_table.CheckWrite(kPageSize + 2);
+  watch_table.CheckRead(kPageSize);
+  EXPECT_FALSE(watch_table.hit());
+
+  watch_table.CheckWrite(kPageSize + 1);
+  EXPECT_TRUE(watch_table.hit());
+  EXPECT_EQ(1, watch_table.hit_id());
+  EXPECT_EQ(kPageSize + 1, watch_table.hit_address());
+  EXPECT_EQ(WatchTable::WRITE, watch_table.hit_access());
+
+  // only the first hit is kept until it is reset
+  watch_table.CheckWrite(kPageSize - 2);
+  EXPECT_EQ(kPageSize + 1, watch_table.hit_address());
+  watch_table.ResetHit();
+  watch_table.CheckWrite(kPageSize - 2);
+  EXPECT_TRUE(watch_table.hit());
+  EXPECT_EQ(kPageSize - 2, watch_table.hit_address());
+}
+
+TEST(WatchTableTest, EndOfMemory) {
+  const uint32 kMemoryEnd = WatchTable::kPageCount << WatchTable::kPageBits;
+  WatchTable watch_table;
+  watch_table.Add(2, kMemoryEnd - 1, 1, WatchTable::READ | WatchTable::WRITE);
+  watch_table.CheckRead(kMemoryEnd - 2);
+  EXPECT_FALSE(watch_table.hit());
+  watch_table.CheckRead(kMemoryEnd - 1);
+  EXPECT_TRUE(watch_table.hit());
+  EXPECT_EQ(WatchTable::READ, watch_table.hit_access());
+
+  watch_table.Clear();
+  EXPECT_TRUE(watch_table.empty());
+  EXPECT_FALSE(watch_table.hit());
+  watch_table.CheckRead(kMemoryEnd - 1);
+  EXPECT_FALSE(watch_table.hit());
+}
+
+TEST(WatchTableTest, Machine) {
+  Machine machine;
+  // STA 0xFE stores a word across the boundary of the first two pages
+  const uint8 kProgram[] = {0x0F, 0x00, 0xFE};
+  machine.WriteMemory(0, sizeof(kProgram), kProgram);
+  WatchTable watch_table;
+  watch_table.Add(3, 0x100, 8, WatchTable::WRITE);
+  // the instruction itself is only read
+  watch_table.Add(4, 0x0, 3, WatchTable::WRITE);
+  machine.set_watch_table(&watch_table);
+  machine.Execute();
+  EXPECT_TRUE(watch_table.hit());
+  EXPECT_EQ(3, watch_table.hit_id());
+  EXPECT_EQ(0x100u, watch_table.hit_address());
+}
+
+}  // namespace tests
+}  // namespace sicxe